@@ -51,7 +51,8 @@ Page *BufferPoolManager::FetchPage(page_id_t page_id) {
   lock_guard<mutex> guard(latch_);
   Page* p;
   if (page_table_->Find(page_id,p)) {
-    p->pin_count_++;
+    // a pinned page must not be chosen as victim
+    if (p->pin_count_++ == 0) replacer_->Erase(p);
     return p;
   }
   if (!free_list_->empty()) {
@@ -89,7 +90,8 @@ bool BufferPoolManager::UnpinPage(page_id_t page_id, bool is_dirty) {
   // return false if pin_count already <= 0 or cannot find page with the input page_id
   if (!page_table_->Find(page_id,p) || p->pin_count_ <= 0) return false;
   p->pin_count_--;
-  p->is_dirty_ = is_dirty;
+  // never clear a dirty flag set by an earlier user of the page
+  p->is_dirty_ = p->is_dirty_ || is_dirty;
   if (p->pin_count_ == 0) replacer_->Insert(p);
   return true;
 }
@@ -109,6 +111,19 @@ bool BufferPoolManager::FlushPage(page_id_t page_id) {
   return true;
 }
 
+/*
+ * Pinned pages are written as well, the dirty flags are cleared
+ */
+void BufferPoolManager::FlushAllPages() {
+  lock_guard<mutex> guard(latch_);
+  for (size_t i = 0; i < pool_size_; ++i) {
+    Page *p = &pages_[i];
+    if (p->page_id_ == INVALID_PAGE_ID || !p->is_dirty_) continue;
+    disk_manager_->WritePage(p->page_id_, p->data_);
+    p->is_dirty_ = false;
+  }
+}
+
 /**
  * User should call this method for deleting a page. This routine will call
  * disk manager to deallocate the page. First, if page is found within page
@@ -121,10 +136,16 @@ bool BufferPoolManager::DeletePage(page_id_t page_id) {
   assert(page_id != INVALID_PAGE_ID);
   lock_guard<mutex> guard(latch_);
   Page* p;
-  // return false if page with input page_id not exist or the page's pin_count != 0
-  if (!page_table_->Find(page_id,p) || p->pin_count_ != 0) return false;
-  // remove from page table
+  // a page not in the buffer pool only needs to be deallocated
+  if (!page_table_->Find(page_id,p)) {
+    disk_manager_->DeallocatePage(page_id);
+    return true;
+  }
+  // return false if the page's pin_count != 0
+  if (p->pin_count_ != 0) return false;
+  // remove from page table and replacer, the frame goes to the free list
   page_table_->Remove(page_id);
+  replacer_->Erase(p);
   // reset page metadata
   p->pin_count_ = 0;
   p->is_dirty_ = false;
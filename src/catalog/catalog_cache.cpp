@@ -0,0 +1,73 @@
+/**
+ * catalog_cache.cpp
+ */
+
+#include "catalog/catalog_cache.h"
+#include "page/header_page.h"
+
+namespace cmudb {
+
+bool CatalogCache::GetRootId(const std::string &name, page_id_t &root_id) {
+  std::lock_guard<std::mutex> guard(latch_);
+  if (!Load())
+    return false;
+  auto it = root_ids_.find(name);
+  if (it == root_ids_.end())
+    return false;
+  root_id = it->second;
+  return true;
+}
+
+void CatalogCache::SetRootId(const std::string &name, page_id_t root_id) {
+  std::lock_guard<std::mutex> guard(latch_);
+  Load();
+  root_ids_[name] = root_id;
+  dirty_.insert(name);
+}
+
+bool CatalogCache::Flush() {
+  std::lock_guard<std::mutex> guard(latch_);
+  if (dirty_.empty())
+    return true;
+  HeaderPage *header_page = static_cast<HeaderPage *>(
+      buffer_pool_manager_->FetchPage(HEADER_PAGE_ID));
+  if (header_page == nullptr)
+    return false;
+  for (auto &name : dirty_) {
+    page_id_t root_id = root_ids_[name];
+    if (!header_page->UpdateRecord(name, root_id))
+      header_page->InsertRecord(name, root_id);
+  }
+  dirty_.clear();
+  buffer_pool_manager_->UnpinPage(HEADER_PAGE_ID, true);
+  return true;
+}
+
+int CatalogCache::GetDirtyCount() {
+  std::lock_guard<std::mutex> guard(latch_);
+  return dirty_.size();
+}
+
+/*
+ * Records set before the first load are kept, they are newer than the
+ * header page
+ */
+bool CatalogCache::Load() {
+  if (loaded_)
+    return true;
+  HeaderPage *header_page = static_cast<HeaderPage *>(
+      buffer_pool_manager_->FetchPage(HEADER_PAGE_ID));
+  if (header_page == nullptr)
+    return false;
+  std::string name;
+  page_id_t root_id;
+  for (int i = 0; i < header_page->GetRecordCount(); i++) {
+    header_page->GetRecord(i, name, root_id);
+    root_ids_.emplace(name, root_id);
+  }
+  buffer_pool_manager_->UnpinPage(HEADER_PAGE_ID, false);
+  loaded_ = true;
+  return true;
+}
+
+} // namespace cmudb
@@ -0,0 +1,71 @@
+/**
+ * epoch_manager.cpp
+ */
+
+#include "concurrency/epoch_manager.h"
+
+namespace cmudb {
+
+EpochManager::EpochManager(BufferPoolManager *buffer_pool_manager)
+    : buffer_pool_manager_(buffer_pool_manager), global_epoch_(1),
+      retired_count_(0) {}
+
+uint64_t EpochManager::Enter() {
+  std::lock_guard<std::mutex> guard(latch_);
+  active_[global_epoch_]++;
+  return global_epoch_;
+}
+
+void EpochManager::Leave(uint64_t epoch) {
+  std::lock_guard<std::mutex> guard(latch_);
+  auto it = active_.find(epoch);
+  if (it != active_.end() && --it->second == 0)
+    active_.erase(it);
+}
+
+void EpochManager::Retire(page_id_t page_id) {
+  std::lock_guard<std::mutex> guard(latch_);
+  limbo_[global_epoch_].push_back(page_id);
+  retired_count_++;
+}
+
+/*
+ * Pages retired in epoch e may still be held by readers that entered in e or
+ * earlier. Readers entering after the advance can not reach them, so they are
+ * safe to delete once the oldest active epoch is newer than e.
+ */
+size_t EpochManager::Reclaim() {
+  std::lock_guard<std::mutex> guard(latch_);
+  global_epoch_++;
+  uint64_t oldest = active_.empty() ? global_epoch_ : active_.begin()->first;
+  size_t deleted = 0;
+  std::vector<page_id_t> pinned;
+  for (auto it = limbo_.begin(); it != limbo_.end() && it->first < oldest;) {
+    for (auto page_id : it->second) {
+      if (buffer_pool_manager_->DeletePage(page_id))
+        deleted++;
+      else
+        pinned.push_back(page_id);
+    }
+    it = limbo_.erase(it);
+  }
+  // a page pinned by someone outside of any epoch, try again next time
+  if (!pinned.empty()) {
+    auto &pages = limbo_[global_epoch_];
+    pages.insert(pages.end(), pinned.begin(), pinned.end());
+  }
+  retired_count_ -= deleted;
+  return deleted;
+}
+
+size_t EpochManager::GetRetiredCount() {
+  std::lock_guard<std::mutex> guard(latch_);
+  return retired_count_;
+}
+
+uint64_t EpochManager::GetEpoch() {
+  std::lock_guard<std::mutex> guard(latch_);
+  return global_epoch_;
+}
+
+} // namespace cmudb
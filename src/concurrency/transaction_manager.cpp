@@ -20,8 +20,13 @@ Transaction *TransactionManager::Begin() {
 
 void TransactionManager::Commit(Transaction *txn) {
   txn->SetState(TransactionState::COMMITTED);
-  // truly delete before commit
   auto write_set = txn->GetWriteSet();
+  // the updated tuples are still in place, even if deleted later on
+  for (auto &item : *write_set) {
+    if (item.wtype_ == WType::UPDATE)
+      item.table_->ApplyUpdate(item.tuple_, item.rid_, txn);
+  }
+  // truly delete before commit
   while (!write_set->empty()) {
     auto &item = write_set->back();
     auto table = item.table_;
@@ -64,7 +69,7 @@ void TransactionManager::Abort(Transaction *txn) {
       table->ApplyDelete(item.rid_, txn);
     } else if (item.wtype_ == WType::UPDATE) {
       LOG_DEBUG("rollback update");
-      table->UpdateTuple(item.tuple_, item.rid_, txn);
+      table->RollbackUpdate(item.tuple_, item.rid_, txn);
     }
     write_set->pop_back();
   }
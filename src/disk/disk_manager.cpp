@@ -53,6 +53,10 @@ DiskManager::DiskManager(const std::string &db_file)
     // reopen with original mode
     db_io_.open(db_file, std::ios::binary | std::ios::in | std::ios::out);
   }
+  // pages of a reopened file are not handed out again
+  int file_size = GetFileSize(file_name_);
+  if (file_size > 0)
+    next_page_id_ = (file_size + PAGE_SIZE - 1) / PAGE_SIZE;
 }
 
 DiskManager::~DiskManager() {
@@ -77,6 +81,21 @@ void DiskManager::WritePage(page_id_t page_id, const char *page_data) {
   db_io_.flush();
 }
 
+/**
+ * Write contiguous pages with a single write and flush, e.g. for bulk loading
+ */
+void DiskManager::WritePages(page_id_t first_page_id, const char *page_data,
+                             int page_count) {
+  size_t offset = static_cast<size_t>(first_page_id) * PAGE_SIZE;
+  db_io_.seekp(offset);
+  db_io_.write(page_data, static_cast<std::streamsize>(page_count) * PAGE_SIZE);
+  if (db_io_.bad()) {
+    LOG_DEBUG("I/O error while writing");
+    return;
+  }
+  db_io_.flush();
+}
+
 /**
  * Read the contents of the specified page into the given memory area
  */
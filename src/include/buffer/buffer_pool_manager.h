@@ -30,6 +30,9 @@ public:
 
   bool FlushPage(page_id_t page_id);
 
+  // write every dirty page back to disk, e.g. before the database is closed
+  void FlushAllPages();
+
   Page *NewPage(page_id_t &page_id);
 
   bool DeletePage(page_id_t page_id);
@@ -0,0 +1,52 @@
+/**
+ * catalog_cache.h
+ *
+ * In-memory copy of the name -> root page id records kept in the header page.
+ * Lookups are served from a hash map instead of scanning the header page, and
+ * root changes only mark the record dirty. Dirty records are written back to
+ * the header page by Flush(), e.g. when a transaction commits or the database
+ * is closed, so splits of different trees no longer contend for the header
+ * page.
+ */
+
+#pragma once
+
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+
+#include "buffer/buffer_pool_manager.h"
+
+namespace cmudb {
+
+class CatalogCache {
+public:
+  explicit CatalogCache(BufferPoolManager *buffer_pool_manager)
+      : buffer_pool_manager_(buffer_pool_manager) {}
+
+  // return false if there is no record of name
+  bool GetRootId(const std::string &name, page_id_t &root_id);
+
+  // insert or update a record, written back by the next flush
+  void SetRootId(const std::string &name, page_id_t root_id);
+
+  // write dirty records back to the header page, return false if the header
+  // page can not be fetched
+  bool Flush();
+
+  // number of records waiting for a flush
+  int GetDirtyCount();
+
+private:
+  // read every record of the header page on first use
+  bool Load();
+
+  BufferPoolManager *buffer_pool_manager_;
+  std::mutex latch_;
+  bool loaded_ = false;
+  std::unordered_map<std::string, page_id_t> root_ids_;
+  std::unordered_set<std::string> dirty_;
+};
+
+} // namespace cmudb
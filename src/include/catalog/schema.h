@@ -95,9 +95,20 @@ public:
     return static_cast<int>(uninlined_columns.size());
   }
 
-  // Return the number of bytes used by one tuple.
+  // Return the number of bytes used by the fixed size columns of one tuple.
   inline int32_t GetLength() const { return length; }
 
+  // bytes of the null bitmap of a tuple, one bit per column
+  inline int32_t GetNullBitmapSize() const {
+    return (GetColumnCount() + 7) / 8;
+  }
+
+  // the null bitmap follows the fixed size columns, the payloads of the
+  // varied-sized columns follow the null bitmap
+  inline int32_t GetVarlenOffset() const {
+    return length + GetNullBitmapSize();
+  }
+
   // Returns a flag indicating whether all columns are inlined
   inline bool IsInlined() const { return tuple_is_inlined; }
 
@@ -105,7 +116,7 @@ public:
   std::string ToString() const;
 
 private:
-  // size of fixed length columns
+  // size of fixed length columns, without the null bitmap
   int32_t length;
 
   // all inlined and uninlined columns in the tuple
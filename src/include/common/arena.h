@@ -0,0 +1,87 @@
+/**
+ * arena.h
+ *
+ * Bump allocator for memory that dies all at once, e.g. the tuples and values
+ * built for one row or one batch. Allocate carves memory out of large blocks,
+ * Reset releases everything and keeps one block for reuse, so a steady
+ * workload stops calling new[] altogether.
+ * Tuples and Values built on an arena do not own their data and must not be
+ * used after the next Reset.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+namespace cmudb {
+
+class Arena {
+public:
+  static const size_t BLOCK_SIZE = 64 * 1024;
+
+  explicit Arena(size_t block_size = BLOCK_SIZE) : block_size_(block_size) {}
+
+  ~Arena() {
+    for (auto &block : blocks_)
+      delete[] block.first;
+  }
+
+  Arena(const Arena &) = delete;
+  Arena &operator=(const Arena &) = delete;
+
+  // size bytes aligned to 8, valid until the next Reset
+  inline char *Allocate(size_t size) {
+    size = (size + 7) & ~static_cast<size_t>(7);
+    if (size > remaining_)
+      return AllocateBlock(size);
+    char *result = current_;
+    current_ += size;
+    remaining_ -= size;
+    return result;
+  }
+
+  // release everything allocated so far
+  void Reset() {
+    char *kept = nullptr;
+    for (auto &block : blocks_) {
+      if (kept == nullptr && block.second == block_size_)
+        kept = block.first;
+      else
+        delete[] block.first;
+    }
+    blocks_.clear();
+    current_ = kept;
+    remaining_ = kept == nullptr ? 0 : block_size_;
+    if (kept != nullptr)
+      blocks_.emplace_back(kept, block_size_);
+  }
+
+  // blocks allocated from the heap since the arena was created
+  inline size_t GetBlockCount() const { return block_count_; }
+
+private:
+  // large requests get a block of their own, so that the current block keeps
+  // its room
+  char *AllocateBlock(size_t size) {
+    block_count_++;
+    if (size > block_size_ / 4) {
+      blocks_.emplace_back(new char[size], size);
+      return blocks_.back().first;
+    }
+    blocks_.emplace_back(new char[block_size_], block_size_);
+    current_ = blocks_.back().first + size;
+    remaining_ = block_size_ - size;
+    return blocks_.back().first;
+  }
+
+  const size_t block_size_;
+  // start and size of every block
+  std::vector<std::pair<char *, size_t>> blocks_;
+  char *current_ = nullptr;
+  size_t remaining_ = 0;
+  size_t block_count_ = 0;
+};
+
+} // namespace cmudb
@@ -34,6 +34,15 @@ public:
       writer_.wait(lock);
   }
 
+  // take the write lock only if no reader or writer holds it
+  bool TryWLock() {
+    std::lock_guard<mutex_t> guard(mutex_);
+    if (writer_entered_ || reader_count_ > 0)
+      return false;
+    writer_entered_ = true;
+    return true;
+  }
+
   void WUnlock() {
     std::lock_guard<mutex_t> guard(mutex_);
     writer_entered_ = false;
@@ -47,6 +56,14 @@ public:
     reader_count_++;
   }
 
+  bool TryRLock() {
+    std::lock_guard<mutex_t> guard(mutex_);
+    if (writer_entered_ || reader_count_ == max_readers_)
+      return false;
+    reader_count_++;
+    return true;
+  }
+
   void RUnlock() {
     std::lock_guard<mutex_t> guard(mutex_);
     reader_count_--;
@@ -0,0 +1,72 @@
+/**
+ * epoch_manager.h
+ *
+ * Epoch based reclamation of deleted pages. Readers that walk pages without
+ * holding a latch (e.g. an index iterator following next page ids) enter the
+ * current global epoch before they reach the first page and leave it when
+ * they are done. Writers retire the pages they unlink instead of deleting
+ * them right away, a retired page goes into the limbo list of the epoch it
+ * was retired in. Reclaim() advances the global epoch and deletes the pages
+ * of every epoch older than the oldest epoch a reader is still in, no reader
+ * can reach those pages anymore.
+ */
+
+#pragma once
+
+#include <map>
+#include <mutex>
+#include <vector>
+
+#include "buffer/buffer_pool_manager.h"
+
+namespace cmudb {
+
+class EpochManager {
+public:
+  // pages still in limbo on destruction are not deleted, the buffer pool
+  // may already be gone
+  explicit EpochManager(BufferPoolManager *buffer_pool_manager);
+
+  // enter the current epoch, return the epoch to leave
+  uint64_t Enter();
+  void Leave(uint64_t epoch);
+
+  // defer deleting an unlinked page until no reader can hold it
+  void Retire(page_id_t page_id);
+  // advance the global epoch and delete the pages of epochs no reader is in
+  // anymore, return the number of deleted pages. A page still pinned stays
+  // in limbo until a later call.
+  size_t Reclaim();
+
+  // number of pages in limbo
+  size_t GetRetiredCount();
+  uint64_t GetEpoch();
+
+private:
+  BufferPoolManager *buffer_pool_manager_;
+  std::mutex latch_;
+  uint64_t global_epoch_;
+  // epoch -> number of readers in it
+  std::map<uint64_t, int> active_;
+  // epoch -> pages retired in it
+  std::map<uint64_t, std::vector<page_id_t>> limbo_;
+  size_t retired_count_;
+};
+
+/*
+ * Keeps the calling thread in an epoch for its lifetime
+ */
+class EpochGuard {
+public:
+  explicit EpochGuard(EpochManager *epoch_manager)
+      : epoch_manager_(epoch_manager), epoch_(epoch_manager->Enter()) {}
+  ~EpochGuard() { epoch_manager_->Leave(epoch_); }
+  EpochGuard(const EpochGuard &) = delete;
+  EpochGuard &operator=(const EpochGuard &) = delete;
+
+private:
+  EpochManager *epoch_manager_;
+  uint64_t epoch_;
+};
+
+} // namespace cmudb
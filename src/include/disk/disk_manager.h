@@ -23,6 +23,10 @@ public:
   ~DiskManager();
 
   void WritePage(page_id_t page_id, const char *page_data);
+  // write page_count pages of page_data, one after the other, to the pages
+  // from first_page_id on in one sequential write
+  void WritePages(page_id_t first_page_id, const char *page_data,
+                  int page_count);
   void ReadPage(page_id_t page_id, char *page_data);
 
   void WriteLog(char *log_data, int size);
@@ -10,16 +10,25 @@
  */
 #pragma once
 
+#include <chrono>
+#include <functional>
+#include <mutex>
 #include <queue>
 #include <vector>
 
+#include "common/rwmutex.h"
+#include "concurrency/epoch_manager.h"
 #include "concurrency/transaction.h"
 #include "index/index_iterator.h"
+#include "index/index_metrics.h"
+#include "index/index_statistics.h"
 #include "page/b_plus_tree_internal_page.h"
 #include "page/b_plus_tree_leaf_page.h"
 
 namespace cmudb {
 
+class CatalogCache;
+
 #define BPLUSTREE_TYPE BPlusTree<KeyType, ValueType, KeyComparator>
 // Main class providing the API for the Interactive B+ Tree.
 INDEX_TEMPLATE_ARGUMENTS
@@ -28,7 +37,8 @@ public:
   explicit BPlusTree(const std::string &name,
                            BufferPoolManager *buffer_pool_manager,
                            const KeyComparator &comparator,
-                           page_id_t root_page_id = INVALID_PAGE_ID);
+                           page_id_t root_page_id = INVALID_PAGE_ID,
+                           CatalogCache *catalog_cache = nullptr);
 
   // Returns true if this B+ tree has no keys and values.
   bool IsEmpty() const;
@@ -44,7 +54,38 @@ public:
   bool GetValue(const KeyType &key, std::vector<ValueType> &result,
                 Transaction *transaction = nullptr);
 
-  // index iterator
+  // return the stored key & value of a given key
+  bool GetEntry(const KeyType &key, MappingType &entry,
+                Transaction *transaction = nullptr);
+
+  // return the values associated with a batch of keys sorted in ascending
+  // order, sharing the root-to-leaf traversal between neighbouring keys
+  bool GetValues(const std::vector<KeyType> &keys,
+                 std::vector<ValueType> &result,
+                 Transaction *transaction = nullptr);
+
+  // build an empty tree bottom-up from entries produced in ascending order
+  bool BulkLoad(const std::function<bool(KeyType &, ValueType &)> &next,
+                double fill_factor = 1.0, Transaction *transaction = nullptr);
+
+  // rebuild the tree into new pages filled to fill_factor, concurrent lookups
+  // keep reading the old tree until the root is swapped. Writers are blocked
+  // for the whole rebuild
+  bool Compact(double fill_factor = 1.0, Transaction *transaction = nullptr);
+
+  // emit compressed leaves from bulk loading and compaction where the
+  // entries allow it, off by default
+  void SetLeafCompression(bool compress_leaves);
+
+  // collect structural statistics and hand the keys of sampled leaves to
+  // sample in ascending order, return the number of sampled entries
+  int64_t CollectStatistics(IndexStatistics &statistics, double sample_rate,
+                            const std::function<void(const KeyType &)> &sample);
+
+  // runtime counters and histograms, disabled by default
+  IndexMetrics &GetMetrics() { return metrics_; }
+
+  // index iterator, keeps deleted pages from being reclaimed while it lives
   INDEXITERATOR_TYPE Begin();
   INDEXITERATOR_TYPE Begin(const KeyType &key);
 
@@ -87,11 +128,30 @@ private:
 
   bool AdjustRoot(BPlusTreePage *node);
 
+  // turn a compressed leaf back into uncompressed leaves, unpins everything
+  void ExpandLeaf(B_PLUS_TREE_LEAF_PAGE_TYPE *leaf,
+                  Transaction *transaction = nullptr);
+
   void UpdateRootPageId(int insert_record = false);
 
+  // helper functions of bulk loading
+  page_id_t
+  BuildFromSorted(const std::function<bool(KeyType &, ValueType &)> &next,
+                  double fill_factor);
+  static int BulkLoadFillSize(int max_size, double fill_factor);
+  static std::vector<int> BulkLoadTailSizes(int remain, int fill,
+                                            int max_size);
+  // page ids of the tree under root_page_id, false if a page can't be fetched
+  bool CollectPages(page_id_t root_page_id, std::vector<page_id_t> &pages);
+
   // helper function to create a new node
   template <typename N> N* NewNode(page_id_t parent_id = INVALID_PAGE_ID);
 
+  // latch acquisition, waits are recorded in metrics_
+  void LatchRoot(bool exclusive);
+  void LatchWriter();
+  void RecordLatchWait(std::chrono::steady_clock::time_point start);
+
   // wrapper function of buffer pool manager operation
   Page* FetchPage(page_id_t page_id);
   Page* NewPage(page_id_t& page_id);
@@ -100,6 +160,16 @@ private:
   page_id_t root_page_id_;
   BufferPoolManager *buffer_pool_manager_;
   KeyComparator comparator_;
+  // root page ids go to the catalog cache instead of the header page if set
+  CatalogCache *catalog_cache_;
+  // lookups share, structure changes and root swaps are exclusive
+  RWMutex root_latch_;
+  // serializes writers, held by compaction during the whole rebuild
+  std::mutex writer_latch_;
+  // unlinked pages are retired here, iterators may still hold them pinned
+  EpochManager epoch_manager_;
+  bool compress_leaves_;
+  IndexMetrics metrics_;
 };
 
 } // namespace cmudb
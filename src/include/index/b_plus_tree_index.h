@@ -21,9 +21,10 @@ class BPlusTreeIndex : public Index {
 public:
   BPlusTreeIndex(IndexMetadata *metadata,
                  BufferPoolManager *buffer_pool_manager,
-                 page_id_t root_page_id = INVALID_PAGE_ID);
+                 page_id_t root_page_id = INVALID_PAGE_ID,
+                 CatalogCache *catalog_cache = nullptr);
 
-  ~BPlusTreeIndex() {}
+  ~BPlusTreeIndex() { delete statistics_; }
 
   void InsertEntry(const Tuple &key, RID rid,
                    Transaction *transaction = nullptr) override;
@@ -34,11 +35,41 @@ public:
   void ScanKey(const Tuple &key, std::vector<RID> &result,
                Transaction *transaction = nullptr) override;
 
+  void ScanKey(const Tuple &key, std::vector<RID> &result,
+               std::vector<Tuple> &entries,
+               Transaction *transaction = nullptr) override;
+
+  void ScanKeys(const std::vector<Tuple> &keys, std::vector<RID> &result,
+                Transaction *transaction = nullptr) override;
+
+  bool BuildIndex(TableHeap *table_heap, Schema *table_schema,
+                  int num_threads = 1,
+                  Transaction *transaction = nullptr) override;
+
+  void UpdateStatistics(double sample_rate = 1.0,
+                        Transaction *transaction = nullptr) override;
+
+  const IndexStatistics *GetStatistics() override;
+
+  IndexMetrics *GetMetrics() override;
+
+  size_t GetKeySize() const override { return sizeof(KeyType); }
+
 protected:
+  // name of the catalog record of the statistics page
+  std::string GetStatisticsRecordName();
+  // read / write a name -> page id record of the catalog
+  bool GetCatalogRecord(const std::string &name, page_id_t &page_id);
+  void SetCatalogRecord(const std::string &name, page_id_t page_id);
+
   // comparator for key
   KeyComparator comparator_;
   // container
   BPlusTree<KeyType, ValueType, KeyComparator> container_;
+  BufferPoolManager *buffer_pool_manager_;
+  CatalogCache *catalog_cache_;
+  // cached statistics, loaded from the catalog on first use
+  IndexStatistics *statistics_ = nullptr;
 };
 
 } // namespace cmudb
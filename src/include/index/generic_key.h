@@ -9,6 +9,7 @@
  */
 #pragma once
 
+#include <algorithm>
 #include <cstring>
 
 #include "table/tuple.h"
@@ -18,9 +19,11 @@ namespace cmudb {
 template <size_t KeySize> class GenericKey {
 public:
   inline void SetFromKey(const Tuple &tuple) {
-    // intialize to 0
+    // a cut off key reads back as garbage, callers check the length first
+    // (see Index::GetKeySize). intialize to 0
     memset(data, 0, KeySize);
-    memcpy(data, tuple.GetData(), tuple.GetLength());
+    memcpy(data, tuple.GetData(),
+           std::min(static_cast<size_t>(tuple.GetLength()), KeySize));
   }
 
   // NOTE: for test purpose only
@@ -9,6 +9,8 @@
 #include <vector>
 
 #include "catalog/schema.h"
+#include "index/index_metrics.h"
+#include "index/index_statistics.h"
 #include "table/tuple.h"
 #include "type/value.h"
 
@@ -23,17 +25,26 @@ namespace cmudb {
  * mapping relation and does the conversion between tuple key and index key
  */
 class Transaction;
+class TableHeap;
 class IndexMetadata {
   IndexMetadata() = delete;
 
 public:
   IndexMetadata(std::string index_name, std::string table_name,
-                const Schema *tuple_schema, const std::vector<int> &key_attrs)
-      : name_(index_name), table_name_(table_name), key_attrs_(key_attrs) {
+                const Schema *tuple_schema, const std::vector<int> &key_attrs,
+                const std::vector<int> &include_attrs = std::vector<int>())
+      : name_(index_name), table_name_(table_name), key_attrs_(key_attrs),
+        entry_attrs_(key_attrs) {
+    entry_attrs_.insert(entry_attrs_.end(), include_attrs.begin(),
+                        include_attrs.end());
     key_schema_ = Schema::CopySchema(tuple_schema, key_attrs_);
+    entry_schema_ = Schema::CopySchema(tuple_schema, entry_attrs_);
   }
 
-  ~IndexMetadata() { delete key_schema_; };
+  ~IndexMetadata() {
+    delete key_schema_;
+    delete entry_schema_;
+  };
 
   inline const std::string &GetName() const { return name_; }
 
@@ -51,6 +62,16 @@ public:
   //  columns
   inline const std::vector<int> &GetKeyAttrs() const { return key_attrs_; }
 
+  // Returns the schema of a whole index entry: the indexed key followed by
+  // the included (covered) columns, which are stored but never compared
+  inline Schema *GetEntrySchema() const { return entry_schema_; }
+
+  //  Returns the mapping relation between entry columns and base table
+  //  columns, the first GetIndexColumnCount() of them are the key attrs
+  inline const std::vector<int> &GetEntryAttrs() const {
+    return entry_attrs_;
+  }
+
   // Get a string representation for debugging
   const std::string ToString() const {
     std::stringstream os;
@@ -60,6 +81,8 @@ public:
        << "Type = B+Tree, "
        << "Table name = " << table_name_ << "] :: ";
     os << key_schema_->ToString();
+    if (entry_attrs_.size() > key_attrs_.size())
+      os << " include :: " << entry_schema_->ToString();
 
     return os.str();
   }
@@ -71,6 +94,10 @@ private:
   const std::vector<int> key_attrs_;
   // schema of the indexed key
   Schema *key_schema_;
+  // key attrs followed by included attrs
+  std::vector<int> entry_attrs_;
+  // schema of the whole index entry
+  Schema *entry_schema_;
 };
 
 /////////////////////////////////////////////////////////////////////
@@ -110,6 +137,12 @@ public:
     return metadata_->GetKeyAttrs();
   }
 
+  Schema *GetEntrySchema() const { return metadata_->GetEntrySchema(); }
+
+  const std::vector<int> &GetEntryAttrs() const {
+    return metadata_->GetEntryAttrs();
+  }
+
   // Get a string representation for debugging
   const std::string ToString() const {
     std::stringstream os;
@@ -122,7 +155,8 @@ public:
   ///////////////////////////////////////////////////////////////////
   // Point Modification
   ///////////////////////////////////////////////////////////////////
-  // designed for secondary indexes.
+  // designed for secondary indexes. key is laid out by the entry schema, so
+  // that included columns are stored along with the key
   virtual void InsertEntry(const Tuple &key, RID rid,
                            Transaction *transaction = nullptr) = 0;
 
@@ -133,6 +167,37 @@ public:
   virtual void ScanKey(const Tuple &key, std::vector<RID> &result,
                        Transaction *transaction = nullptr) = 0;
 
+  // point query that also returns the matching entries (laid out by the
+  // entry schema), so covered columns can be read without the table heap
+  virtual void ScanKey(const Tuple &key, std::vector<RID> &result,
+                       std::vector<Tuple> &entries,
+                       Transaction *transaction = nullptr) = 0;
+
+  // build the index from every tuple of a table with num_threads threads.
+  // Return false if the buffer pool runs out of pages or some entry is larger
+  // than the key, the index then holds part of the table at most
+  virtual bool BuildIndex(TableHeap *table_heap, Schema *table_schema,
+                          int num_threads = 1,
+                          Transaction *transaction = nullptr) = 0;
+
+  // point query for a batch of keys, keys need not be sorted
+  virtual void ScanKeys(const std::vector<Tuple> &keys,
+                        std::vector<RID> &result,
+                        Transaction *transaction = nullptr) = 0;
+
+  // collect statistics from a sample of the index and persist them
+  virtual void UpdateStatistics(double sample_rate = 1.0,
+                                Transaction *transaction = nullptr) = 0;
+
+  // last collected statistics, nullptr if they were never collected
+  virtual const IndexStatistics *GetStatistics() = 0;
+
+  // runtime counters and latency histograms of the index
+  virtual IndexMetrics *GetMetrics() = 0;
+
+  // bytes of a stored key, longer entries can't be inserted
+  virtual size_t GetKeySize() const = 0;
+
 private:
   //===--------------------------------------------------------------------===//
   //  Data members
@@ -3,6 +3,10 @@
  * For range scan of b+ tree
  */
 #pragma once
+#include <vector>
+
+#include "common/rwmutex.h"
+#include "concurrency/epoch_manager.h"
 #include "page/b_plus_tree_leaf_page.h"
 
 namespace cmudb {
@@ -14,7 +18,16 @@ INDEX_TEMPLATE_ARGUMENTS
 class IndexIterator {
 public:
   // you may define your own constructor based on your member variables
-  IndexIterator(B_PLUS_TREE_LEAF_PAGE_TYPE* current_leaf, BufferPoolManager* buffer_pool_manager,int index );
+  // current_leaf is pinned, both the pin and the epoch (if epoch_manager is
+  // set) are released by the destructor. latch guards the leaves against
+  // writers, the caller holds it while constructing and operator++ takes it
+  // for reading
+  IndexIterator(B_PLUS_TREE_LEAF_PAGE_TYPE* current_leaf, BufferPoolManager* buffer_pool_manager,int index,
+                EpochManager *epoch_manager = nullptr, uint64_t epoch = 0,
+                RWMutex *latch = nullptr);
+  IndexIterator(IndexIterator &&other);
+  IndexIterator(const IndexIterator &) = delete;
+  IndexIterator &operator=(const IndexIterator &) = delete;
   ~IndexIterator();
 
   bool isEnd();
@@ -24,11 +37,22 @@ public:
   IndexIterator &operator++();
 
 private:
+  // copy the entries of the current leaf into entries_
+  void CopyLeaf();
+  // move on to the next leaf holding entries, or the end
+  void NextLeaf();
+
   // add your own private member variables here
   B_PLUS_TREE_LEAF_PAGE_TYPE* current_leaf_;
   int index_;
   BufferPoolManager* buffer_pool_manager_;
   bool is_end_;
+  EpochManager *epoch_manager_;
+  uint64_t epoch_;
+  RWMutex *latch_;
+  // entries of the current leaf, copied when the iterator arrives on it so
+  // that writers changing the leaf never move entries under the iterator
+  std::vector<MappingType> entries_;
 };
 
 } // namespace cmudb
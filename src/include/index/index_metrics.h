@@ -0,0 +1,127 @@
+/**
+ * index_metrics.h
+ *
+ * Runtime instrumentation of an index: operation and structure modification
+ * counters, latch waits, and log2 histograms of latency and pages touched
+ * per operation. Metrics are off by default, a disabled index only pays for
+ * one relaxed load per operation (plus a thread local page counter).
+ */
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+namespace cmudb {
+
+/*
+ * Histogram with power of two buckets, bucket i counts values in
+ * [2^(i-1), 2^i), bucket 0 counts zeros
+ */
+class Log2Histogram {
+public:
+  static const int BUCKET_COUNT = 40;
+
+  Log2Histogram() { Reset(); }
+
+  void Record(uint64_t value);
+  void Reset();
+
+  uint64_t GetCount() const { return count_.load(std::memory_order_relaxed); }
+  double GetMean() const;
+  // upper bound of the bucket holding the given percentile (0 - 100)
+  uint64_t GetPercentile(double percentile) const;
+
+  std::string ToString() const;
+
+private:
+  std::atomic<uint64_t> buckets_[BUCKET_COUNT];
+  std::atomic<uint64_t> count_;
+  std::atomic<uint64_t> sum_;
+};
+
+class IndexMetrics {
+public:
+  IndexMetrics() : enabled_(false) { Reset(); }
+
+  inline bool IsEnabled() const {
+    return enabled_.load(std::memory_order_relaxed);
+  }
+  void SetEnabled(bool enabled) { enabled_ = enabled; }
+  void Reset();
+
+  // counted per thread whether enabled or not, an operation records the
+  // pages fetched between its start and its end
+  static inline void CountPage() { pages_fetched_++; }
+  static inline uint64_t GetPagesFetched() { return pages_fetched_; }
+
+  std::string ToString() const;
+
+  // operations
+  std::atomic<uint64_t> lookups;
+  std::atomic<uint64_t> inserts;
+  std::atomic<uint64_t> removes;
+  // root to leaf traversals and pages fetched by operations
+  std::atomic<uint64_t> descents;
+  std::atomic<uint64_t> pages_touched;
+  // structure modifications
+  std::atomic<uint64_t> splits;
+  std::atomic<uint64_t> merges;
+  std::atomic<uint64_t> redistributions;
+  std::atomic<uint64_t> root_changes;
+  // latch acquisitions that had to wait, and the total time waited
+  std::atomic<uint64_t> latch_waits;
+  std::atomic<uint64_t> latch_wait_ns;
+  // in nanoseconds
+  Log2Histogram lookup_latency;
+  Log2Histogram insert_latency;
+  Log2Histogram remove_latency;
+  Log2Histogram pages_per_operation;
+
+private:
+  std::atomic<bool> enabled_;
+  static thread_local uint64_t pages_fetched_;
+};
+
+/*
+ * Counts one operation and records its latency and pages touched when it
+ * goes out of scope, does nothing if metrics are disabled
+ */
+class IndexOperationScope {
+public:
+  IndexOperationScope(IndexMetrics &metrics,
+                      std::atomic<uint64_t> &operations,
+                      Log2Histogram &latency)
+      : metrics_(metrics.IsEnabled() ? &metrics : nullptr),
+        latency_(&latency) {
+    if (metrics_ == nullptr)
+      return;
+    operations.fetch_add(1, std::memory_order_relaxed);
+    pages_ = IndexMetrics::GetPagesFetched();
+    start_ = std::chrono::steady_clock::now();
+  }
+
+  ~IndexOperationScope() {
+    if (metrics_ == nullptr)
+      return;
+    auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now() - start_);
+    latency_->Record(elapsed.count());
+    uint64_t pages = IndexMetrics::GetPagesFetched() - pages_;
+    metrics_->pages_touched.fetch_add(pages, std::memory_order_relaxed);
+    metrics_->pages_per_operation.Record(pages);
+  }
+
+  IndexOperationScope(const IndexOperationScope &) = delete;
+  IndexOperationScope &operator=(const IndexOperationScope &) = delete;
+
+private:
+  IndexMetrics *metrics_;
+  Log2Histogram *latency_;
+  uint64_t pages_ = 0;
+  std::chrono::steady_clock::time_point start_;
+};
+
+} // namespace cmudb
@@ -0,0 +1,74 @@
+/**
+ * index_statistics.h
+ *
+ * Statistics of a B+ tree index, used to estimate selectivity and to spot
+ * bloated trees. Structural numbers come from the internal levels, which are
+ * read completely, while key statistics come from a sample of the leaves.
+ * Distinct values and the histogram describe the first key column.
+ *
+ * Serialized format (size in byte):
+ *  -------------------------------------------------------------------------
+ * | Magic (4) | Height (4) | LevelPages (4 * Height) | LeafFill (8) |
+ *  -------------------------------------------------------------------------
+ *  -------------------------------------------------------------------------
+ * | InternalFill (8) | EntryCount (8) | DistinctCount (8) | BoundCount (4) |
+ *  -------------------------------------------------------------------------
+ *  ------------------------
+ * | Bounds (8 * BoundCount)
+ *  ------------------------
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace cmudb {
+
+// catalog records of statistics pages start with this prefix, which table and
+// index names can't use
+const char STATISTICS_RECORD_PREFIX[] = "__stats_";
+
+inline bool IsStatisticsRecordName(const std::string &name) {
+  return name.compare(0, sizeof(STATISTICS_RECORD_PREFIX) - 1,
+                      STATISTICS_RECORD_PREFIX) == 0;
+}
+
+struct IndexStatistics {
+  // number of levels, 0 for an empty tree
+  int height = 0;
+  // number of pages on every level, root level first
+  std::vector<int> level_pages;
+  // average fill ratio of leaf pages and internal pages
+  double leaf_fill = 0;
+  double internal_fill = 0;
+  // (estimated) number of entries
+  int64_t entry_count = 0;
+  // (estimated) number of distinct values of the first key column
+  int64_t distinct_count = 0;
+  // equi-depth histogram of the first key column: bounds[i], bounds[i + 1]
+  // delimit a bucket holding the same share of entries as any other bucket.
+  // Only kept for numeric columns
+  std::vector<double> bounds;
+
+  // estimated number of entries sharing one value of the first key column
+  double EstimateEqualRows() const;
+
+  // estimated number of entries whose first key column lies in [low, high]
+  double EstimateRangeRows(double low, double high) const;
+
+  // build the histogram from first key column values in ascending order
+  void BuildHistogram(const std::vector<double> &values, int bucket_count);
+
+  // serialized size in bytes
+  int GetSerializedSize() const;
+  void SerializeTo(char *storage) const;
+  // return false if storage does not hold statistics
+  bool DeserializeFrom(const char *storage);
+  static bool IsSerialized(const char *storage);
+
+  std::string ToString() const;
+};
+
+} // namespace cmudb
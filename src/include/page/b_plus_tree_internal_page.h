@@ -53,6 +53,10 @@ public:
   void MoveLastToFrontOf(BPlusTreeInternalPage *recipient,
                          int parent_index,
                          BufferPoolManager *buffer_pool_manager);
+  // append items and adopt the children they point to, also used by bulk
+  // loading
+  void CopyAllFrom(MappingType *items, int size,
+                   BufferPoolManager *buffer_pool_manager);
   // DEUBG and PRINT
   std::string ToString(bool verbose) const;
   void QueueUpChildren(std::queue<BPlusTreePage *> *queue,
@@ -61,8 +65,6 @@ public:
 private:
   void CopyHalfFrom(MappingType *items, int size,
                     BufferPoolManager *buffer_pool_manager);
-  void CopyAllFrom(MappingType *items, int size,
-                   BufferPoolManager *buffer_pool_manager);
   void CopyLastFrom(const MappingType &pair,
                     BufferPoolManager *buffer_pool_manager);
   void CopyFirstFrom(const MappingType &pair, int parent_index,
@@ -17,6 +17,19 @@
  *  ------------------------------
  * | PageId (4) | NextPageId (4)
  *  ------------------------------
+ *
+ * Compressed leaf page format, for keys whose first 8 bytes hold an integer
+ * and rids clustered on nearby table pages. Keys are stored as 32-bit deltas
+ * from the first key (frame of reference), rids as 16-bit page deltas from the
+ * smallest page id packed with 16-bit slot numbers. Keys and rids are kept in
+ * separate arrays so that decoding is a plain loop. Compressed leaves are
+ * read only, writers expand them first.
+ *  --------------------------------------------------------------------------
+ * | HEADER | KeyBase (8) | PageBase (4) | Unused (4) | KeyDelta(1..MaxSize)
+ *  --------------------------------------------------------------------------
+ *  ---------------------------
+ * | PackedRid(1..MaxSize)
+ *  ---------------------------
  */
 #pragma once
 #include <utility>
@@ -40,7 +53,10 @@ public:
   void SetNextPageId(page_id_t next_page_id);
   KeyType KeyAt(int index) const;
   int KeyIndex(const KeyType &key, const KeyComparator &comparator) const;
+  // uncompressed leaf only
   const MappingType &GetItem(int index);
+  // either format
+  MappingType ItemAt(int index) const;
 
   // insert and delete methods
   int Insert(const KeyType &key, const ValueType &value,
@@ -58,15 +74,37 @@ public:
                         BufferPoolManager *buffer_pool_manager);
   void MoveLastToFrontOf(BPlusTreeLeafPage *recipient, int parentIndex,
                          BufferPoolManager *buffer_pool_manager);
+  // append items, larger than every key in this page, also used by bulk
+  // loading
+  void CopyAllFrom(MappingType *items, int size);
+
+  // Compression utility methods
+  static int GetCompressedMaxSize();
+  static bool CanCompress(const MappingType *items, int size);
+  // fill an empty leaf with items in compressed format
+  void CompressFrom(const MappingType *items, int size);
+  // decode the first size entries into items, either format
+  void DecodeAll(MappingType *items, int size) const;
+  // decode every entry into items and turn this page into an empty
+  // uncompressed leaf, page ids are kept
+  void Expand(std::vector<MappingType> &items);
   // Debug
   std::string ToString(bool verbose = false) const;
 
 private:
   void CopyHalfFrom(MappingType *items, int size);
-  void CopyAllFrom(MappingType *items, int size);
   void CopyLastFrom(const MappingType &item);
   void CopyFirstFrom(const MappingType &item, int parentIndex,
                      BufferPoolManager *buffer_pool_manager);
+  // compressed format accessors
+  static const int COMPRESSED_HEADER_SIZE = 16;
+  uint64_t GetKeyBase() const;
+  page_id_t GetPageBase() const;
+  const uint32_t *GetKeyDeltas() const;
+  const uint32_t *GetPackedRids() const;
+  static uint64_t EncodeKey(const KeyType &key);
+  static KeyType DecodeKey(uint64_t value);
+
   page_id_t next_page_id_;
   MappingType array[0];
 };
@@ -32,12 +32,19 @@ namespace cmudb {
   template <typename KeyType, typename ValueType, typename KeyComparator>
 
 // define page type enum
-enum class IndexPageType { INVALID_INDEX_PAGE = 0, LEAF_PAGE, INTERNAL_PAGE };
+enum class IndexPageType {
+  INVALID_INDEX_PAGE = 0,
+  LEAF_PAGE,
+  INTERNAL_PAGE,
+  COMPRESSED_LEAF_PAGE
+};
 
 // Abstract class.
 class BPlusTreePage {
 public:
+  // true for compressed leaf pages as well
   bool IsLeafPage() const;
+  bool IsCompressedLeafPage() const;
   bool IsRootPage() const;
   void SetPageType(IndexPageType page_type);
 
@@ -32,6 +32,8 @@ public:
   // return root_id if success
   bool GetRootId(const std::string &name, page_id_t &root_id);
   int GetRecordCount();
+  // read the index-th record
+  bool GetRecord(int index, std::string &name, page_id_t &root_id);
 
 private:
   /**
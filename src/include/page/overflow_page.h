@@ -0,0 +1,38 @@
+/**
+ * overflow_page.h
+ *
+ * Varlen values too large to be kept in their tuple are cut into slices, one
+ * per overflow page, and the pages are chained through NextPageId. The tuple
+ * keeps an OverflowPointer (see tuple.h) to the first page.
+ *
+ * Overflow page format (size in byte):
+ *  ----------------------------------------------------------------
+ * | PageId (4)| LSN (4)| NextPageId (4)| DataSize (4)| DATA ...    |
+ *  ----------------------------------------------------------------
+ */
+
+#pragma once
+
+#include "page/page.h"
+
+namespace cmudb {
+// tuples larger than this have their largest varlen values moved into
+// overflow pages
+static const int32_t OVERFLOW_THRESHOLD = PAGE_SIZE / 4;
+
+class OverflowPage : public Page {
+public:
+  // bytes of a value one page holds
+  static const int32_t CAPACITY = PAGE_SIZE - 16;
+
+  // fill the page with size (at most CAPACITY) bytes of data
+  void Init(page_id_t page_id, const char *data, int32_t size);
+
+  page_id_t GetPageId();
+  page_id_t GetNextPageId();
+  void SetNextPageId(page_id_t next_page_id);
+  int32_t GetDataSize();
+  const char *GetPayload();
+};
+
+} // namespace cmudb
@@ -0,0 +1,216 @@
+/**
+ * pax_table_page.h
+ *
+ * PAX page format: the values of every column are kept together in a mini
+ * page of their own, so a scan of a few columns only touches their bytes.
+ *  -----------------------------------------------------------------------
+ * | HEADER | ROW STATES | MINI PAGE 0 | MINI PAGE 1 | ... | FREE | VARLEN |
+ *  -----------------------------------------------------------------------
+ *                                                          ^
+ *                                                     var pointer
+ *
+ *  Header format (size in byte):
+ *  --------------------------------------------------------------------------
+ * | PageId (4)| LSN (4)| PrevPageId (4)| NextPageId (4)| Magic (4)|
+ *  --------------------------------------------------------------------------
+ *  --------------------------------------------------------------------------
+ * | RowCount (4)| Capacity (4)| VarPointer (4)| GarbageSize (4)|
+ *  --------------------------------------------------------------------------
+ *  --------------------------------------------------------------------------
+ * | ColumnCount (2)| TupleLength (2)| Column_1 width (2)| ... |
+ *  --------------------------------------------------------------------------
+ *  --------------------------------------------------------------------------
+ * | Column_1 encoding (1)| ... |
+ *  --------------------------------------------------------------------------
+ *
+ * The first 16 bytes are laid out as in TablePage, the magic number sits
+ * where TablePage keeps its free space pointer, which is how TablePage tells
+ * the two formats apart and forwards its calls here.
+ * Mini pages of fixed size columns hold the values as they are stored in a
+ * tuple, mini pages of varchar columns (negative width) hold the offset of a
+ * length prefixed value in the varlen area at the end of the page. Each row
+ * has a state byte: free, live or marked deleted. The varlen bytes of freed
+ * rows are counted as garbage and reclaimed by compaction.
+ * The null bitmap of the tuples is kept as one more fixed size column after
+ * the columns of the schema, so that the fixed part of a row is laid out as
+ * in a tuple.
+ *
+ * Encoded columns:
+ * - a DICTIONARY varchar column stores every distinct value once per page.
+ *   Its mini page holds a one byte code per row, followed by the dictionary:
+ *   PAX_DICTIONARY_SIZE entries of (value offset (2), reference count (2)).
+ *   The code of a value stays the same as long as a row refers to it, so
+ *   filters can compare codes instead of strings.
+ * - a RLE fixed size column stores runs of equal values: a run count (2),
+ *   the end slot (exclusive) of every run (2 each) and then the run values.
+ *   Rows are appended while the page has room, so that the runs of a sorted
+ *   column stay long.
+ * A page whose dictionaries or runs are full takes no more rows, page
+ * planning assumes every value to repeat PAX_EXPECTED_REPEATS times.
+ */
+
+#pragma once
+
+#include <vector>
+
+#include "catalog/schema.h"
+#include "common/rid.h"
+#include "concurrency/lock_manager.h"
+#include "logging/log_manager.h"
+#include "page/page.h"
+#include "table/tuple.h"
+
+namespace cmudb {
+// stored at offset 16 of a PAX page
+static const int32_t PAX_PAGE_MAGIC = 0x58415050;
+// entries in the dictionary of a column, per page
+static const int32_t PAX_DICTIONARY_SIZE = 64;
+// rows a dictionary value or a run is assumed to cover when planning a page
+static const int32_t PAX_EXPECTED_REPEATS = 8;
+
+// how the values of a column are laid out in its mini page
+enum class ColumnEncoding : uint8_t { PLAIN = 0, DICTIONARY = 1, RLE = 2 };
+
+class PaxTablePage : public Page {
+public:
+  /**
+   * Header related
+   */
+  // mini page sizes are planned from schema, with varchar values assumed to
+  // be half their declared length. encodings are per column, empty for all
+  // PLAIN
+  void Init(page_id_t page_id, size_t page_size, page_id_t prev_page_id,
+            Schema *schema, LogManager *log_manager, Transaction *txn,
+            const std::vector<ColumnEncoding> &encodings = {});
+  // same columns, encodings and capacity as other
+  void InitLike(page_id_t page_id, page_id_t prev_page_id,
+                PaxTablePage *other, LogManager *log_manager,
+                Transaction *txn);
+  page_id_t GetPageId();
+
+  /**
+   * Tuple related, same contract as in TablePage
+   */
+  bool InsertTuple(const Tuple &tuple, RID &rid, Transaction *txn,
+                   LockManager *lock_manager, LogManager *log_manager);
+  bool MarkDelete(const RID &rid, Transaction *txn, LockManager *lock_manager,
+                  LogManager *log_manager);
+  bool UpdateTuple(const Tuple &new_tuple, Tuple &old_tuple, const RID &rid,
+                   Transaction *txn, LockManager *lock_manager,
+                   LogManager *log_manager);
+  void ApplyDelete(const RID &rid, Transaction *txn, LogManager *log_manager,
+                   Tuple *deleted_tuple = nullptr);
+  void RollbackDelete(const RID &rid, Transaction *txn,
+                      LogManager *log_manager);
+  // the tuple is always assembled into a copy. With a projection only the
+  // columns set in it are read, the others come back null (zeros in the
+  // fixed part, a null bit and a null varchar)
+  bool GetTuple(const RID &rid, Tuple &tuple, Transaction *txn,
+                LockManager *lock_manager,
+                const std::vector<bool> &projection = {});
+  bool ReadTuple(const RID &rid, Tuple &tuple);
+  bool GetFirstTupleRid(RID &first_rid);
+  bool GetNextTupleRid(const RID &cur_rid, RID &next_rid);
+  // room for one more tuple: the fixed part, its slot and the varlen area
+  // (including garbage), 0 if every row is taken
+  int32_t GetFreeSpaceSize();
+  // see TablePage, the free rows at the end are dropped instead of slots
+  bool IsEmpty();
+  bool Vacuum();
+
+  /**
+   * Column access, for batch scans
+   */
+  // the columns of the schema and the null bitmap
+  int GetColumnCount();
+  // value width of column_id, negative for varchar columns
+  int16_t GetColumnWidth(int column_id);
+  ColumnEncoding GetColumnEncoding(int column_id);
+  // values of a PLAIN column_id, indexed by slot number
+  const char *GetMiniPage(int column_id);
+  // copy the values of the fixed size column_id in slots (ascending) to dest,
+  // one after the other
+  void CopyValues(int column_id, const std::vector<int> &slots, char *dest);
+  // length and bytes of the varchar of column_id in slot_num, with
+  // OVERFLOW_FLAG set in length the bytes are an OverflowPointer
+  const char *GetVarchar(int column_id, int slot_num, uint32_t &length);
+  // dictionary code of the row in slot_num of a DICTIONARY column_id
+  int32_t GetCode(int column_id, int slot_num);
+  // dictionary code of value in column_id, -1 if no row of the page holds it
+  int32_t GetCode(int column_id, const Value &value);
+
+private:
+  enum RowState : uint8_t { FREE = 0, LIVE = 1, DELETED = 2 };
+  struct DictionaryEntry {
+    int16_t offset;
+    // rows referring to the entry, 0 for a free entry
+    uint16_t ref_count;
+  };
+
+  int32_t GetRowCount();
+  void SetRowCount(int32_t row_count);
+  int32_t GetCapacity();
+  int32_t GetVarPointer();
+  void SetVarPointer(int32_t var_pointer);
+  int32_t GetGarbageSize();
+  void SetGarbageSize(int32_t garbage_size);
+  int16_t GetTupleLength();
+  uint8_t *GetRowStates();
+  int32_t GetMiniPageOffset(int column_id);
+  int32_t GetMiniPageSize(int column_id);
+  // end of the last mini page, the varlen area may grow down to it
+  int32_t GetDataEnd();
+  // offset of the length prefixed varchar of column_id in slot_num
+  int32_t GetValueOffset(int column_id, int slot_num);
+  // varlen bytes tuple needs when written to slot_num, values found in a
+  // dictionary need none. -1 if a dictionary or the runs of a column have
+  // no room for it
+  int32_t GetWriteSize(const Tuple &tuple, int slot_num);
+  // varlen bytes of the PLAIN varchars of the row in slot_num, dictionary
+  // values belong to their entries and are only counted if asked for
+  int32_t GetVarlenSize(int slot_num, bool dictionary_values = false);
+  // lay the mini pages out for capacity rows
+  void InitLayout(page_id_t page_id, page_id_t prev_page_id,
+                  const std::vector<int16_t> &widths,
+                  const std::vector<ColumnEncoding> &encodings,
+                  int16_t tuple_length, int32_t capacity);
+  // gather the row in slot_num back into tuple, whatever its state. See
+  // GetTuple for projection
+  void ReadRow(int slot_num, Tuple &tuple,
+               const std::vector<bool> &projection = {});
+  // scatter tuple into the mini pages of slot_num, GetWriteSize must have
+  // found room for it
+  void WriteRow(const Tuple &tuple, int slot_num);
+  // free the row in slot_num, its varlen values turn into garbage
+  void FreeRow(int slot_num);
+  // pack the varlen values of the live and deleted rows and the dictionary
+  // entries at the end of page
+  void Compact();
+
+  /**
+   * Dictionary and runs
+   */
+  uint8_t *GetCodes(int column_id);
+  DictionaryEntry *GetDictionary(int column_id);
+  // code of the length prefixed value in column_id, -1 if it is not there
+  int FindEntry(int column_id, const char *value);
+  // a free entry of column_id, -1 if the dictionary is full
+  int FindFreeEntry(int column_id);
+  // drop a reference to code, a free entry turns into garbage
+  void ReleaseEntry(int column_id, int code);
+  // room for the runs of each RLE column
+  int32_t GetRunCapacity();
+  // run count and run ends of column_id
+  uint16_t *GetRuns(int column_id);
+  char *GetRunValues(int column_id);
+  // run holding slot_num
+  int FindRun(int column_id, int slot_num);
+  // runs writing value to slot_num adds to column_id (0 to 2)
+  int GetNewRunCount(int column_id, int slot_num, const char *value);
+  void SetRunValue(int column_id, int slot_num, const char *value);
+  // drop the runs past the row count
+  void TrimRuns(int column_id);
+  const char *GetFixedValue(int column_id, int slot_num);
+};
+
+} // namespace cmudb
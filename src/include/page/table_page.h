@@ -12,23 +12,40 @@
  *  --------------------------------------------------------------------------
  * | PageId (4)| LSN (4)| PrevPageId (4)| NextPageId (4)| FreeSpacePointer(4) |
  *  --------------------------------------------------------------------------
- *  --------------------------------------------------------------
- * | TupleCount (4) | Tuple_1 offset (4) | Tuple_1 size (4) | ... |
- *  --------------------------------------------------------------
+ *  --------------------------------------------------------------------------
+ * | TupleCount (4) | FreeSlot (4) | GarbageSize (4) | Tuple_1 offset (4) |
+ *  --------------------------------------------------------------------------
+ *  ---------------------------
+ * | Tuple_1 size (4) | ... |
+ *  ---------------------------
+ *
+ * Empty slots (size 0) are chained into a free list through their offset,
+ * FreeSlot is the head of the list (-1: empty). Applying a delete only frees
+ * the slot and counts the tuple's bytes as garbage, the tuples are packed
+ * again only when an insert or update needs more contiguous space than lies
+ * between the slot array and the tuple data.
  *
+ * A page may instead be in PAX format (see pax_table_page.h), the tuple
+ * methods then forward to PaxTablePage.
  */
 
 #pragma once
 
 #include <cstring>
+#include <vector>
 
+#include "catalog/schema.h"
 #include "common/rid.h"
 #include "concurrency/lock_manager.h"
 #include "logging/log_manager.h"
 #include "page/page.h"
+#include "page/pax_table_page.h"
 #include "table/tuple.h"
 
 namespace cmudb {
+// bytes of the slotted page header and of one slot
+static const int32_t TABLE_PAGE_HEADER_SIZE = 32;
+static const int32_t TABLE_PAGE_SLOT_SIZE = 8;
 
 class TablePage : public Page {
 public:
@@ -42,6 +59,11 @@ public:
   page_id_t GetNextPageId();
   void SetPrevPageId(page_id_t prev_page_id);
   void SetNextPageId(page_id_t next_page_id);
+  // is this page in PAX format
+  inline bool IsPax() { return GetFreeSpacePointer() == PAX_PAGE_MAGIC; }
+  inline PaxTablePage *AsPax() {
+    return reinterpret_cast<PaxTablePage *>(this);
+  }
 
   /**
    * Tuple related
@@ -49,6 +71,11 @@ public:
   bool InsertTuple(const Tuple &tuple, RID &rid, Transaction *txn,
                    LockManager *lock_manager,
                    LogManager *log_manager); // return rid if success
+  // insert tuples[begin...] until the page is full, the rids of the inserted
+  // tuples are appended to rids, return the number of tuples inserted
+  size_t InsertTuples(const std::vector<Tuple> &tuples, size_t begin,
+                      std::vector<RID> &rids, Transaction *txn,
+                      LockManager *lock_manager, LogManager *log_manager);
   bool MarkDelete(const RID &rid, Transaction *txn, LockManager *lock_manager,
                   LogManager *log_manager); // delete
   bool UpdateTuple(const Tuple &new_tuple, Tuple &old_tuple, const RID &rid,
@@ -56,14 +83,28 @@ public:
                    LogManager *log_manager);
 
   // commit/abort time
-  void ApplyDelete(const RID &rid, Transaction *txn,
-                   LogManager *log_manager); // when commit success
+  // a copy of the deleted tuple is stored in deleted_tuple if given
+  void ApplyDelete(const RID &rid, Transaction *txn, LogManager *log_manager,
+                   Tuple *deleted_tuple = nullptr); // when commit success
   void RollbackDelete(const RID &rid, Transaction *txn,
                       LogManager *log_manager); // when commit abort
 
-  // return tuple (with data pointing to heap) if success
+  // return tuple (with data pointing to heap) if success. With a projection
+  // (and the schema of the tuples) only the columns set in it are copied, the
+  // others come back null as on PAX pages
   bool GetTuple(const RID &rid, Tuple &tuple, Transaction *txn,
-                LockManager *lock_manager);
+                LockManager *lock_manager, Schema *schema = nullptr,
+                const std::vector<bool> &projection = {});
+
+  // like GetTuple, but tuple points into this page instead of owning a copy,
+  // it is valid only while the page stays pinned and latched. PAX pages can
+  // only hand out a copy
+  bool GetTupleView(const RID &rid, Tuple &tuple, Transaction *txn,
+                    LockManager *lock_manager);
+
+  // copy of the tuple in rid even if it is marked deleted, without locking,
+  // for commit time bookkeeping. Return false if the slot is empty
+  bool ReadTuple(const RID &rid, Tuple &tuple);
 
   /**
    * Tuple iterator
@@ -71,6 +112,19 @@ public:
   bool GetFirstTupleRid(RID &first_rid);
   bool GetNextTupleRid(const RID &cur_rid, RID &next_rid);
 
+  // bytes between the slot array and the tuple data, plus the garbage a
+  // compaction would reclaim
+  int32_t GetFreeSpaceSize();
+
+  /**
+   * Vacuum
+   */
+  // no tuple is left, not even one marked deleted
+  bool IsEmpty();
+  // pack the tuples and drop the empty slots at the end of the slot array,
+  // return false if there was nothing to reclaim
+  bool Vacuum();
+
 private:
   /**
    * helper functions
@@ -84,6 +138,17 @@ private:
   int32_t GetTupleCount(); // Note that this tuple count may be larger than # of
                            // actual tuples because some slots may be empty
   void SetTupleCount(int32_t tuple_count);
-  int32_t GetFreeSpaceSize();
+  int32_t GetFreeSlot(); // head of the free slot list, -1 if it is empty
+  void SetFreeSlot(int32_t slot_num);
+  int32_t GetGarbageSize();
+  void SetGarbageSize(int32_t garbage_size);
+  // pack the tuples at the end of the page if there are fewer than size bytes
+  // between the slot array and the tuple data
+  void MakeRoom(int32_t size);
+  // pack the tuples (marked deleted ones included) at the end of the page
+  void Compact();
+  // copy the columns set in projection of the tuple at data into tuple
+  void CopyColumns(const char *data, Tuple &tuple, Schema *schema,
+                   const std::vector<bool> &projection);
 };
 } // namespace cmudb
@@ -0,0 +1,106 @@
+/**
+ * bulk_loader.h
+ *
+ * Loads rows into a new table heap without going through the buffer pool:
+ * the input is parsed by several threads, the tuples are packed into table
+ * pages in memory and the pages are appended to the database file in large
+ * sequential writes. The pages bypass the log and the lock manager, so the
+ * table must not be used before Finish. Tuples larger than OVERFLOW_THRESHOLD
+ * are inserted through TableHeap at the end, which moves their values to
+ * overflow pages.
+ *
+ * CSV input: one row per line, fields separated by commas. A field may be
+ * quoted with double quotes ("" for a quote) but may not span lines, an empty
+ * unquoted field is null. Empty lines are skipped.
+ * Binary input: the tuples one after the other, as written by
+ * Tuple::SerializeTo (size (4) followed by the tuple).
+ */
+
+#pragma once
+
+#include <istream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "buffer/buffer_pool_manager.h"
+#include "catalog/schema.h"
+#include "disk/disk_manager.h"
+#include "table/table_heap.h"
+#include "table/tuple.h"
+
+namespace cmudb {
+
+class BulkLoader {
+public:
+  // bytes of input parsed at a time
+  static const size_t CHUNK_SIZE = 16 << 20;
+  // pages written at a time
+  static const int WRITE_BATCH_SIZE = 64;
+
+  // the new pages are allocated from disk_manager, pages allocated elsewhere
+  // meanwhile split the writes. buffer_pool_manager is used for the large
+  // tuples
+  BulkLoader(Schema *schema, DiskManager *disk_manager,
+             BufferPoolManager *buffer_pool_manager,
+             TableLayout layout = TableLayout::NSM,
+             const std::vector<ColumnEncoding> &encodings = {});
+
+  // append the rows of in, with header the first line is skipped. Return
+  // false at the first malformed row, see GetError
+  bool LoadCsv(std::istream &in, int num_threads = 1, bool header = false);
+  bool LoadBinary(std::istream &in);
+
+  // write the pages left in memory and insert the large tuples, the table
+  // can be opened from GetFirstPageId afterwards. The pages of large tuples
+  // stay in the buffer pool. Return false if the buffer pool runs out of
+  // pages
+  bool Finish();
+
+  inline page_id_t GetFirstPageId() const { return first_page_id_; }
+  // rows loaded so far
+  inline size_t GetRowCount() const { return row_count_; }
+  inline const std::string &GetError() const { return error_; }
+
+private:
+  // tuples of the lines in [begin, end), every line ends with '\n'. The
+  // fields are terminated in place, tuples are built on arena but for the
+  // large ones. line_count receives the lines read, up to a malformed one
+  bool ParseLines(char *begin, char *end, Arena *arena,
+                  std::vector<Tuple> &tuples, size_t &line_count,
+                  std::string &error);
+  // the values of the line in [begin, end), end points to its newline
+  bool ParseLine(char *begin, char *end, std::vector<Value> &values,
+                 std::string &error);
+  // value of column_id from the terminated field of length bytes
+  bool ParseValue(int column_id, const char *field, size_t length,
+                  bool quoted, Value &value, std::string &error);
+
+  // false if a varchar of the binary tuple at data lies outside of it
+  bool CheckVarlens(const char *data, int32_t size);
+  // add tuple to the last page, large tuples are moved aside. Return false
+  // if tuple does not fit an empty page
+  bool Append(Tuple &tuple);
+  // start a page after the last one, the full pages are written first
+  void StartPage();
+  void WritePages(int page_count);
+
+  Schema *schema_;
+  DiskManager *disk_manager_;
+  BufferPoolManager *buffer_pool_manager_;
+  TableLayout layout_;
+  std::vector<ColumnEncoding> encodings_;
+  // pages not written yet, the last one is being filled
+  std::unique_ptr<Page[]> pages_;
+  int page_count_ = 0;
+  // the pages of a write, one after the other
+  std::unique_ptr<char[]> write_buffer_;
+  page_id_t first_page_id_ = INVALID_PAGE_ID;
+  std::vector<Tuple> large_tuples_;
+  size_t row_count_ = 0;
+  // input lines read, for error messages
+  size_t line_count_ = 0;
+  std::string error_;
+};
+
+} // namespace cmudb
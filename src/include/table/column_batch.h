@@ -0,0 +1,138 @@
+/**
+ * column_batch.h
+ *
+ * Up to CAPACITY rows of a table heap decoded into one vector per column,
+ * filled by TableHeap::NextBatch. Fixed size columns are plain arrays of
+ * their C type (int8_t for BOOLEAN and TINYINT, int16_t, int32_t, int64_t,
+ * double for DECIMAL, uint64_t for TIMESTAMP), VARCHAR columns are an offset
+ * array into a byte heap. Nulls are marked in the null bitmaps of the rows,
+ * which are copied as they are stored. The selection vector lists the rows
+ * that are still
+ * qualified, filters shrink it in place instead of moving column data.
+ * The batch also remembers where the scan stopped.
+ */
+
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "catalog/schema.h"
+#include "common/rid.h"
+#include "page/pax_table_page.h"
+#include "table/tuple.h"
+
+namespace cmudb {
+
+class TableHeap;
+
+class ColumnBatch {
+  friend class TableHeap;
+
+public:
+  static const int CAPACITY = 1024;
+
+  // decode the columns column_ids of schema, every column if it is empty
+  ColumnBatch(Schema *schema, const std::vector<int> &column_ids = {});
+
+  // number of rows in the batch
+  inline int GetSize() const { return size_; }
+
+  inline int GetColumnCount() const {
+    return static_cast<int>(columns_.size());
+  }
+
+  // column of the table schema stored at position i
+  inline int GetColumnId(int i) const { return columns_[i].column_id; }
+
+  // values of fixed size column i, T must match the column type
+  template <typename T> inline const T *GetColumn(int i) const {
+    return reinterpret_cast<const T *>(columns_[i].data.data());
+  }
+
+  // varchar of column i in row, without terminator
+  inline const char *GetVarchar(int i, int row, uint32_t &length) const {
+    const Column &column = columns_[i];
+    length = column.offsets[row + 1] - column.offsets[row];
+    return column.heap.data() + column.offsets[row];
+  }
+
+  inline RID GetRid(int row) const { return rids_[row]; }
+
+  // null bitmap of row, bit i % 8 of byte i / 8 is set if column i of the
+  // table schema is null
+  inline const uint8_t *GetNullBitmap(int row) const {
+    return null_bitmaps_.data() + row * schema_->GetNullBitmapSize();
+  }
+
+  inline bool IsNull(int i, int row) const {
+    int column_id = columns_[i].column_id;
+    return (GetNullBitmap(row)[column_id / 8] >> (column_id % 8)) & 1;
+  }
+
+  // slow path, column i in row as a Value
+  Value GetValue(int i, int row) const;
+
+  // selection vector, indices of the qualified rows in ascending order
+  inline const uint16_t *GetSelection() const { return selection_.data(); }
+
+  inline int GetSelectedCount() const { return selected_count_; }
+
+  // keep the selected rows for which predicate(row) holds
+  template <typename Predicate> void Filter(Predicate predicate) {
+    int count = 0;
+    for (int i = 0; i < selected_count_; i++) {
+      uint16_t row = selection_[i];
+      selection_[count] = row;
+      count += predicate(row) ? 1 : 0;
+    }
+    selected_count_ = count;
+  }
+
+  // restart the scan from the first page
+  void Rewind();
+
+private:
+  struct Column {
+    int column_id;
+    TypeId type;
+    bool is_inlined;
+    int32_t offset; // in the tuple
+    int32_t width;  // of a fixed size value
+    std::vector<char> data;
+    std::vector<uint32_t> offsets; // varchar only, size + 1 entries
+    std::vector<char> heap;        // varchar only
+  };
+
+  // drop all rows, keep the scan position
+  void Clear();
+
+  // decode tuple into the next row, the batch must not be full
+  void Append(const Tuple &tuple);
+
+  // copy the rows slots of a PAX page column by column, the batch must have
+  // room for them
+  void AppendColumns(PaxTablePage *page, const std::vector<int> &slots);
+
+  // set the varchar of column in row, stripping its terminator. With
+  // OVERFLOW_FLAG set in length, value is an OverflowPointer
+  void AppendVarchar(Column &column, int row, const char *value,
+                     uint32_t length);
+
+  Schema *schema_;
+  std::vector<Column> columns_;
+  std::vector<RID> rids_;
+  std::vector<uint8_t> null_bitmaps_;
+  std::vector<uint16_t> selection_;
+  int size_ = 0;
+  int selected_count_ = 0;
+  // scratch space of TableHeap::FillBatch
+  std::vector<int> slots_;
+  // the heap filling the batch, which reads overflow values
+  TableHeap *table_heap_ = nullptr;
+  // scan position: next tuple to read, or INVALID_PAGE_ID when done
+  bool started_ = false;
+  RID position_;
+};
+
+} // namespace cmudb
@@ -0,0 +1,57 @@
+/**
+ * free_space_map.h
+ *
+ * Approximate free space of every page of a table heap. Free space is kept as
+ * one byte per page (in units of PAGE_SIZE / 256 bytes), the bytes are the
+ * leaves of a max tree, so finding a page with room for a tuple costs
+ * O(log #pages) instead of a walk over the page chain.
+ * The map lives in memory only, a table heap rebuilds it on first use. It
+ * doubles as the page directory of the heap.
+ */
+
+#pragma once
+
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#include "common/config.h"
+
+namespace cmudb {
+
+class FreeSpaceMap {
+public:
+  // record the free bytes of page_id, unknown pages are added
+  void Update(page_id_t page_id, int32_t free_space);
+
+  // forget page_id, e.g. after it has been unlinked from the heap
+  void Remove(page_id_t page_id);
+
+  // first page that is known to have at least size free bytes, or
+  // INVALID_PAGE_ID if there is none
+  page_id_t Find(int32_t size);
+
+  // recorded (rounded down) free bytes of page_id, -1 if unknown
+  int32_t GetFreeSpace(page_id_t page_id);
+
+  int GetPageCount();
+
+  // every known page in the order they were added, which for a table heap
+  // is the order of its page chain
+  std::vector<page_id_t> GetPageIds();
+
+private:
+  static uint8_t ToCategory(int32_t free_space);
+  // rebuild the max tree with room for at least capacity leaves
+  void Grow(size_t capacity);
+  void Set(size_t slot, uint8_t category);
+
+  std::mutex latch_;
+  std::unordered_map<page_id_t, size_t> slots_;
+  std::vector<page_id_t> page_ids_;
+  // tree_[1] is the root, leaves start at tree_[capacity_]
+  std::vector<uint8_t> tree_;
+  size_t capacity_ = 0;
+};
+
+} // namespace cmudb
@@ -0,0 +1,45 @@
+/**
+ * morsel_dispenser.h
+ *
+ * Hands out morsels, i.e. runs of consecutive pages of a table heap, to the
+ * workers of a parallel scan. Workers ask for the next morsel whenever they
+ * finish one, so faster workers simply take more of them.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <vector>
+
+#include "common/config.h"
+
+namespace cmudb {
+
+class MorselDispenser {
+public:
+  MorselDispenser(std::vector<page_id_t> page_ids, size_t morsel_size)
+      : page_ids_(std::move(page_ids)),
+        morsel_size_(std::max<size_t>(morsel_size, 1)) {}
+
+  // claim the pages [begin, end) of GetPageIds(), return false when all
+  // morsels are taken
+  bool Next(size_t &begin, size_t &end) {
+    begin = next_.fetch_add(morsel_size_);
+    if (begin >= page_ids_.size())
+      return false;
+    end = std::min(begin + morsel_size_, page_ids_.size());
+    return true;
+  }
+
+  inline const std::vector<page_id_t> &GetPageIds() const {
+    return page_ids_;
+  }
+
+private:
+  const std::vector<page_id_t> page_ids_;
+  const size_t morsel_size_;
+  std::atomic<size_t> next_{0};
+};
+
+} // namespace cmudb
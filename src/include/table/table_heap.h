@@ -6,31 +6,57 @@
 
 #pragma once
 
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
 #include "buffer/buffer_pool_manager.h"
 #include "logging/log_manager.h"
+#include "page/overflow_page.h"
 #include "page/table_page.h"
+#include "table/column_batch.h"
+#include "table/free_space_map.h"
 #include "table/table_iterator.h"
 #include "table/tuple.h"
+#include "table/zone_map.h"
 
 namespace cmudb {
+// page format of a table, chosen when the table is created
+enum class TableLayout { NSM, PAX };
 
 class TableHeap {
   friend class TableIterator;
 
 public:
-  ~TableHeap() {}
+  ~TableHeap() { StopVacuumThread(); }
 
-  // open a table heap
+  // open a table heap. With a schema, varlen values of tuples larger than
+  // OVERFLOW_THRESHOLD are moved to overflow pages
   TableHeap(BufferPoolManager *buffer_pool_manager, LockManager *lock_manager,
-            LogManager *log_manager, page_id_t first_page_id);
+            LogManager *log_manager, page_id_t first_page_id,
+            Schema *schema = nullptr);
 
-  // create table heap
+  // create table heap, a PAX table needs its schema and may encode its
+  // columns (see pax_table_page.h). Overflow pages are used as when opening
   TableHeap(BufferPoolManager *buffer_pool_manager, LockManager *lock_manager,
-            LogManager *log_manager, Transaction *txn);
+            LogManager *log_manager, Transaction *txn,
+            TableLayout layout = TableLayout::NSM, Schema *schema = nullptr,
+            const std::vector<ColumnEncoding> &encodings = {});
 
   // for insert, if tuple is too large (>~page_size), return false
   bool InsertTuple(const Tuple &tuple, RID &rid, Transaction *txn);
 
+  // insert a batch of tuples, each page is latched once and filled as far as
+  // possible, rids receives the rid of every tuple in order. Return false if
+  // some tuple is too large or the buffer pool runs out of pages
+  bool InsertTuples(const std::vector<Tuple> &tuples, std::vector<RID> &rids,
+                    Transaction *txn);
+
   bool MarkDelete(const RID &rid, Transaction *txn); // for delete
 
   // if the new tuple is too large to fit in the old page, return false (will
@@ -41,18 +67,133 @@ public:
   void ApplyDelete(const RID &rid,
                    Transaction *txn); // when commit delete or rollback insert
   void RollbackDelete(const RID &rid, Transaction *txn); // when rollback delete
+  // when commit update, before any delete is applied. Frees the overflow
+  // values of old_tuple the current tuple does not share
+  void ApplyUpdate(const Tuple &old_tuple, const RID &rid, Transaction *txn);
+  // when rollback update, puts old_tuple back
+  void RollbackUpdate(const Tuple &old_tuple, const RID &rid,
+                      Transaction *txn);
 
   bool GetTuple(const RID &rid, Tuple &tuple, Transaction *txn);
 
+  // value of column_id of a tuple of this table, an overflow value is read
+  // from its pages. The value is null if the buffer pool runs out of pages.
+  // Varchars are copied into arena if there is one, see Tuple::GetValue
+  Value GetValue(const Tuple &tuple, Schema *schema, int column_id,
+                 Arena *arena = nullptr);
+
+  // the bytes of an overflow value, false if the buffer pool runs out of
+  // pages
+  bool ReadOverflow(const OverflowPointer &pointer, std::string &value);
+
+  // delete every page of the table and the overflow pages of its tuples. The
+  // table must not be used afterwards
   bool DeleteTableHeap();
 
-  TableIterator begin(Transaction *txn);
+  // vacuum max_pages pages, going on from where the last call stopped: their
+  // garbage is compacted away, and the empty ones are unlinked and deleted
+  // (except for the first and the last page). A page still pinned when it is
+  // unlinked is deleted by a later call. Return the number of pages deleted
+  int Vacuum(int max_pages);
+
+  // vacuum pages_per_round pages every interval in a background thread
+  void RunVacuumThread(int pages_per_round,
+                       std::chrono::milliseconds interval);
+  void StopVacuumThread();
+
+  // scan every tuple with num_threads workers, each worker takes a morsel of
+  // pages at a time and calls callback(worker_id, tuple) under the page's
+  // read latch
+  bool ParallelScan(int num_threads,
+                    const std::function<void(int, const Tuple &)> &callback,
+                    Transaction *txn);
+
+  // like ParallelScan, but every worker decodes the columns column_ids of
+  // schema into its own batch and calls callback(worker_id, batch) whenever
+  // the batch is full, and once more for the rest
+  bool ParallelBatchScan(
+      int num_threads, Schema *schema, const std::vector<int> &column_ids,
+      const std::function<void(int, ColumnBatch &)> &callback,
+      Transaction *txn);
+
+  // decode the next (up to ColumnBatch::CAPACITY) tuples into batch, the scan
+  // position is kept in the batch. Return false when the scan is over
+  bool NextBatch(ColumnBatch &batch, Transaction *txn);
+
+  // see table_iterator.h for zero copy iterators
+  TableIterator begin(Transaction *txn, bool zero_copy = false);
+
+  // filtered scan: only the pages whose zone map does not rule predicates
+  // out are read, their tuples are returned without further filtering but for
+  // the dictionary codes of PAX pages. The zone map is built from schema on
+  // the first filtered scan
+  TableIterator begin(Transaction *txn, Schema *schema,
+                      const std::vector<RangePredicate> &predicates,
+                      bool zero_copy = false);
 
   TableIterator end();
 
   inline page_id_t GetFirstPageId() const { return first_page_id_; }
 
+  // encoding of every column, as recorded by the pages. Empty for a slotted
+  // table
+  std::vector<ColumnEncoding> GetColumnEncodings();
+
+  FreeSpaceMap &GetFreeSpaceMap() { return free_space_map_; }
+
+  ZoneMap &GetZoneMap() { return zone_map_; }
+
 private:
+  // walk the page chain once to fill the free space map
+  void LoadFreeSpaceMap();
+
+  // walk the page chain once to fill the zone map of schema
+  void LoadZoneMap(Schema *schema, Transaction *txn);
+
+  // see TablePage::ReadTuple
+  bool ReadTuple(const RID &rid, Tuple &tuple);
+
+  // tuple with its largest varlen values moved to overflow pages until it is
+  // no larger than OVERFLOW_THRESHOLD, built in moved unless tuple is small
+  // enough as it is. nullptr if the buffer pool runs out of pages
+  const Tuple *MoveToOverflow(const Tuple &tuple, Tuple &moved);
+
+  // write size bytes to a new chain of overflow pages, return its first
+  // page, INVALID_PAGE_ID if the buffer pool runs out of pages
+  page_id_t WriteOverflow(const char *data, uint32_t size);
+
+  // delete the chain of overflow pages starting at page_id
+  void FreeOverflowChain(page_id_t page_id);
+
+  // free the overflow values of tuple, except those keep points to as well
+  void FreeOverflow(const Tuple &tuple, const Tuple *keep = nullptr);
+
+  // link a new page after the last page, return it pinned and write latched
+  TablePage *AppendPage(Transaction *txn);
+
+  // a page with room for size bytes according to the free space map, or a
+  // new one if there is none. Return it pinned and write latched, nullptr if
+  // the buffer pool runs out of pages
+  TablePage *FetchPageWithRoom(int32_t size, bool &is_new_page,
+                               Transaction *txn);
+
+  // unlink page_id from the page chain if it is still empty, the caller
+  // deletes it
+  bool UnlinkPage(page_id_t page_id);
+
+  // decode the tuples of page from rid on into batch until either is used
+  // up, return true if rid names a tuple that did not fit
+  bool FillBatch(TablePage *page, RID &rid, ColumnBatch &batch,
+                 Transaction *txn);
+
+  // run num_threads workers over the morsels of the page directory, calling
+  // page_callback(worker_id, page) with every page read latched, and
+  // done_callback(worker_id) when a worker runs out of morsels
+  bool ScanMorsels(
+      int num_threads,
+      const std::function<void(int, TablePage *)> &page_callback,
+      const std::function<void(int)> &done_callback);
+
   /**
    * Members
    */
@@ -60,6 +201,26 @@ private:
   LockManager *lock_manager_;
   LogManager *log_manager_;
   page_id_t first_page_id_;
+  // nullptr: no overflow pages
+  Schema *schema_;
+  FreeSpaceMap free_space_map_;
+  std::atomic<bool> free_space_map_loaded_{false};
+  ZoneMap zone_map_;
+  std::atomic<bool> zone_map_loaded_{false};
+  // serializes appending and unlinking pages, guards last_page_id_
+  std::mutex append_latch_;
+  page_id_t last_page_id_ = INVALID_PAGE_ID;
+  // serializes vacuums, guards the page the next one starts from and the
+  // retired pages
+  std::mutex vacuum_latch_;
+  page_id_t vacuum_page_id_ = INVALID_PAGE_ID;
+  // unlinked pages that were pinned when vacuum tried to delete them
+  std::vector<page_id_t> retired_page_ids_;
+  // background vacuum
+  std::thread vacuum_thread_;
+  std::mutex vacuum_thread_latch_;
+  std::condition_variable vacuum_cv_;
+  bool vacuum_thread_stopped_ = true;
 };
 
 } // namespace cmudb
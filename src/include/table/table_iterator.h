@@ -2,26 +2,50 @@
  * table_iterator.h
  *
  * For seq scan of table heap
+ *
+ * By default every tuple is copied out of its page. A zero copy iterator
+ * instead keeps the current page pinned and read latched and hands out tuples
+ * pointing into the page frame; writers of that page block until the
+ * iterator moves past it, so such an iterator must not be held across writes
+ * to the same table. Copies of an iterator always copy their tuple.
+ * A filtered iterator (see TableHeap::begin) moves from page to page along
+ * the zone map, skipping the pages that cannot hold a match of its predicates.
+ * On PAX pages it also skips the rows whose dictionary codes differ from the
+ * code of the value of an equality predicate.
  */
 
 #pragma once
 
 #include <cassert>
+#include <vector>
 
 #include "common/rid.h"
 #include "table/tuple.h"
+#include "table/zone_map.h"
 
 namespace cmudb {
 
 class TableHeap;
+class TablePage;
 
 class TableIterator {
   friend class Cursor;
+  friend class TableHeap;
 
 public:
-  TableIterator(TableHeap *table_heap, RID rid, Transaction *txn);
+  TableIterator(TableHeap *table_heap, RID rid, Transaction *txn,
+                bool zero_copy = false,
+                std::vector<RangePredicate> predicates = {});
+
+  TableIterator(const TableIterator &other);
+
+  TableIterator(TableIterator &&other);
 
-  ~TableIterator() { delete tuple_; }
+  TableIterator &operator=(const TableIterator &) = delete;
+
+  TableIterator &operator=(TableIterator &&other);
+
+  ~TableIterator();
 
   inline bool operator==(const TableIterator &itr) const {
     return tuple_->rid_.Get() == itr.tuple_->rid_.Get();
@@ -39,10 +63,44 @@ public:
 
   TableIterator operator++(int);
 
+  // read only the columns set in projection from the next tuple on, the
+  // others come back null. NSM pages skip columns only if the table heap was
+  // given its schema. The tuples of a zero copy iterator are never copied
+  // and come back whole
+  inline void SetProjection(std::vector<bool> projection) {
+    projection_ = std::move(projection);
+  }
+
 private:
+  // unlatch and unpin the current page of a zero copy iterator
+  void ReleasePage();
+
+  // page to visit after page, along the zone map for a filtered iterator
+  page_id_t GetNextPageId(TablePage *page);
+
+  // false if the dictionary codes of rid rule out a match
+  bool MayMatch(TablePage *page, const RID &rid);
+  // same for the current tuple
+  bool MayMatch();
+
+  // move rid to the first tuple of page from rid on that may match, false
+  // (and an invalid rid) if there is none
+  bool SkipMismatches(TablePage *page, RID &rid);
+
   TableHeap *table_heap_;
   Tuple *tuple_;
   Transaction *txn_;
+  bool zero_copy_;
+  // current page of a zero copy iterator, pinned and read latched
+  TablePage *page_ = nullptr;
+  // empty unless filtered
+  std::vector<RangePredicate> predicates_;
+  // empty for all columns
+  std::vector<bool> projection_;
+  // (column, code) of the equality predicates on the dictionary encoded
+  // columns of code_page_id_
+  page_id_t code_page_id_ = INVALID_PAGE_ID;
+  std::vector<std::pair<int, int32_t>> codes_;
 };
 
 } // namespace cmudb
\ No newline at end of file
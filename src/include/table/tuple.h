@@ -2,22 +2,52 @@
  * tuple.h
  *
  * Tuple format:
- *  ------------------------------------------------------------------
- * | FIXED-SIZE or VARIED-SIZED OFFSET | PAYLOAD OF VARIED-SIZED FIELD|
- *  ------------------------------------------------------------------
+ *  ----------------------------------------------------------------------
+ * | FIXED-SIZE or VARIED-SIZED OFFSET | NULL BITMAP | PAYLOAD OF VARIED- |
+ * |                                   |             | SIZED FIELD        |
+ *  ----------------------------------------------------------------------
+ *
+ * Bit i of the null bitmap (bit i % 8 of byte i / 8) is set if column i is
+ * null. The bitmap follows the fixed size part rather than leading it, so
+ * that the columns keep the offsets of the schema, which index keys rely on.
+ * A null value is still stored, as its type's null value, so that GetValue
+ * does not need the bitmap.
+ * The payload of a varied-sized field is a length prefix followed by the
+ * value, a null varchar is a bare PELOTON_VALUE_NULL prefix. A table heap may
+ * move large values into overflow pages, the prefix then has OVERFLOW_FLAG
+ * set and is followed by an OverflowPointer.
  */
 
 #pragma once
 
 #include "catalog/schema.h"
+#include "common/arena.h"
 #include "common/rid.h"
 #include "type/value.h"
 
 namespace cmudb {
+static const uint32_t OVERFLOW_FLAG = 0x80000000;
+
+struct OverflowPointer {
+  page_id_t first_page_id;
+  // length prefix of the value itself
+  uint32_t length;
+};
+
+inline bool IsOverflowPrefix(uint32_t prefix) {
+  return prefix != PELOTON_VALUE_NULL && (prefix & OVERFLOW_FLAG) != 0;
+}
+
+// bytes that follow a length prefix in the payload
+inline uint32_t GetPayloadSize(uint32_t prefix) {
+  return prefix == PELOTON_VALUE_NULL ? 0 : prefix & ~OVERFLOW_FLAG;
+}
 
 class Tuple {
   friend class TablePage;
 
+  friend class PaxTablePage;
+
   friend class TableHeap;
 
   friend class TableIterator;
@@ -27,10 +57,12 @@ public:
   inline Tuple() : allocated_(false), rid_(RID()), size_(0), data_(nullptr) {}
 
   // constructor for table heap tuple
-  Tuple(RID rid) : allocated_(false), rid_(rid) {}
+  Tuple(RID rid) : allocated_(false), rid_(rid), size_(0), data_(nullptr) {}
 
-  // constructor for creating a new tuple based on input value
-  Tuple(std::vector<Value> values, Schema *schema);
+  // constructor for creating a new tuple based on input value. With an arena
+  // the data comes from it and the tuple does not own it
+  Tuple(const std::vector<Value> &values, Schema *schema,
+        Arena *arena = nullptr);
 
   // copy constructor, deep copy
   Tuple(const Tuple &other);
@@ -38,6 +70,17 @@ public:
   // assign operator, deep copy
   Tuple &operator=(const Tuple &other);
 
+  // move constructor and assignment, other is left empty
+  Tuple(Tuple &&other) noexcept
+      : allocated_(other.allocated_), rid_(other.rid_), size_(other.size_),
+        data_(other.data_) {
+    other.allocated_ = false;
+    other.size_ = 0;
+    other.data_ = nullptr;
+  }
+
+  Tuple &operator=(Tuple &&other) noexcept;
+
   ~Tuple() {
     if (allocated_)
       delete[] data_;
@@ -61,12 +104,27 @@ public:
 
   // Get the value of a specified column (const)
   // checks the schema to see how to return the Value.
-  Value GetValue(Schema *schema, const int column_id) const;
+  // values in overflow pages are read by TableHeap::GetValue. A varchar is
+  // copied into arena if there is one, instead of onto the heap
+  Value GetValue(Schema *schema, const int column_id,
+                 Arena *arena = nullptr) const;
+
+  // pointer to the overflow pages of column_id, false if the value is inline
+  bool GetOverflowPointer(Schema *schema, const int column_id,
+                          OverflowPointer &pointer) const;
+
+  inline bool IsOverflow(Schema *schema, const int column_id) const {
+    OverflowPointer pointer;
+    return GetOverflowPointer(schema, column_id, pointer);
+  }
 
   // Is the column value null ?
   inline bool IsNull(Schema *schema, const int column_id) const {
-    Value value = GetValue(schema, column_id);
-    return value.IsNull();
+    return (GetNullBitmap(schema)[column_id / 8] >> (column_id % 8)) & 1;
+  }
+
+  inline const uint8_t *GetNullBitmap(Schema *schema) const {
+    return reinterpret_cast<const uint8_t *>(data_ + schema->GetLength());
   }
   inline bool IsAllocated() { return allocated_; }
 
@@ -0,0 +1,110 @@
+/**
+ * tuple_accessor.h
+ *
+ * Typed getters for the columns of tuples of one schema. The offsets, types
+ * and the place of the null bitmap are looked up once, when the accessor is
+ * built, so that reading a column is a load at a fixed offset (plus one
+ * indirection for a varchar) with no Value in between.
+ * The getters do not check the null bitmap, a null column reads as its type's
+ * null value (see Tuple). Values in overflow pages are left to
+ * TableHeap::GetValue.
+ */
+
+#pragma once
+
+#include <vector>
+
+#include "catalog/schema.h"
+#include "table/tuple.h"
+
+namespace cmudb {
+
+class TupleAccessor {
+public:
+  // schema only needs to live through the constructor
+  explicit TupleAccessor(Schema *schema);
+
+  inline int GetColumnCount() const {
+    return static_cast<int>(columns_.size());
+  }
+
+  inline TypeId GetType(int column_id) const {
+    return columns_[column_id].type;
+  }
+
+  inline bool IsNull(const Tuple &tuple, int column_id) const {
+    const char *bitmap = tuple.GetData() + null_bitmap_offset_;
+    return (bitmap[column_id / 8] >> (column_id % 8)) & 1;
+  }
+
+  // BOOLEAN and TINYINT
+  inline int8_t GetInt8(const Tuple &tuple, int column_id) const {
+    return *reinterpret_cast<const int8_t *>(GetFixed(tuple, column_id));
+  }
+
+  inline int16_t GetInt16(const Tuple &tuple, int column_id) const {
+    return *reinterpret_cast<const int16_t *>(GetFixed(tuple, column_id));
+  }
+
+  inline int32_t GetInt32(const Tuple &tuple, int column_id) const {
+    return *reinterpret_cast<const int32_t *>(GetFixed(tuple, column_id));
+  }
+
+  inline int64_t GetInt64(const Tuple &tuple, int column_id) const {
+    return *reinterpret_cast<const int64_t *>(GetFixed(tuple, column_id));
+  }
+
+  // DECIMAL
+  inline double GetDouble(const Tuple &tuple, int column_id) const {
+    return *reinterpret_cast<const double *>(GetFixed(tuple, column_id));
+  }
+
+  inline uint64_t GetTimestamp(const Tuple &tuple, int column_id) const {
+    return *reinterpret_cast<const uint64_t *>(GetFixed(tuple, column_id));
+  }
+
+  // true if the varchar of column_id lives in overflow pages
+  inline bool IsOverflow(const Tuple &tuple, int column_id) const {
+    return IsOverflowPrefix(*reinterpret_cast<const uint32_t *>(
+        GetVarlen(tuple, column_id)));
+  }
+
+  // bytes of the varchar of column_id, without terminator. Empty for a null
+  // value, the column must not be an overflow value
+  inline const char *GetVarchar(const Tuple &tuple, int column_id,
+                                uint32_t &length) const {
+    const char *value = GetVarlen(tuple, column_id);
+    length = *reinterpret_cast<const uint32_t *>(value);
+    value += sizeof(uint32_t);
+    if (length == PELOTON_VALUE_NULL)
+      length = 0;
+    // strings are stored with their terminator
+    else if (length > 0 && value[length - 1] == '\0')
+      length--;
+    return value;
+  }
+
+private:
+  struct Column {
+    TypeId type;
+    // of the value for a fixed size column, of the offset of the payload
+    // otherwise
+    int32_t offset;
+  };
+
+  inline const char *GetFixed(const Tuple &tuple, int column_id) const {
+    return tuple.GetData() + columns_[column_id].offset;
+  }
+
+  // length prefix of the payload of a varchar column
+  inline const char *GetVarlen(const Tuple &tuple, int column_id) const {
+    const char *data = tuple.GetData();
+    int32_t offset = columns_[column_id].offset;
+    return data + *reinterpret_cast<const int32_t *>(data + offset);
+  }
+
+  std::vector<Column> columns_;
+  int32_t null_bitmap_offset_;
+};
+
+} // namespace cmudb
@@ -0,0 +1,102 @@
+/**
+ * zone_map.h
+ *
+ * Min, max and null count of every numeric column, per page of a table heap.
+ * A scan with range predicates only has to read the pages whose zones do not
+ * rule the predicates out. Zones only ever widen: deleted and overwritten
+ * values stay counted, which can cost a wasted page read but never a missed
+ * tuple.
+ * Like the free space map, the zone map lives in memory only. A table heap
+ * builds it on the first filtered scan and keeps it up to date from then on.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#include "catalog/schema.h"
+#include "table/tuple.h"
+#include "type/value.h"
+
+namespace cmudb {
+
+enum class RangeOp { EQ, LT, LE, GT, GE, IS_NULL };
+
+// column_id op value, e.g. ts > 100. value is ignored for IS_NULL
+struct RangePredicate {
+  RangePredicate(int column_id, RangeOp op, const Value &value)
+      : column_id(column_id), op(op), value(value) {}
+
+  int column_id;
+  RangeOp op;
+  Value value;
+};
+
+// summary of the non null values of one column of a page
+struct ColumnZone {
+  Value min{TypeId::INVALID};
+  Value max{TypeId::INVALID};
+  int32_t null_count = 0;
+  // false until the first non null value, min and max are invalid till then
+  bool has_values = false;
+};
+
+class ZoneMap {
+public:
+  // track the numeric columns of schema, which must outlive the map. Pages
+  // and tuples are ignored until then
+  void Init(Schema *schema);
+
+  inline bool IsInitialized() const { return schema_ != nullptr; }
+
+  // start the zones of page_id, appended to the page directory
+  void AddPage(page_id_t page_id);
+
+  // forget page_id, e.g. after it has been unlinked from the heap. It is
+  // still found by NextPage
+  void RemovePage(page_id_t page_id);
+
+  // widen the zones of page_id to cover tuple, unknown pages are ignored
+  void Add(page_id_t page_id, const Tuple &tuple);
+
+  // false if no tuple of page_id can satisfy all of predicates. Unknown
+  // pages and untracked columns never rule anything out
+  bool MayMatch(page_id_t page_id,
+                const std::vector<RangePredicate> &predicates);
+
+  // first page after page_id (INVALID_PAGE_ID: the first page) in directory
+  // order that may match predicates, INVALID_PAGE_ID if there is none
+  page_id_t NextPage(page_id_t page_id,
+                     const std::vector<RangePredicate> &predicates);
+
+  // copy of the zone of column_id on page_id, false if it is not tracked
+  bool GetColumnZone(page_id_t page_id, int column_id, ColumnZone &zone);
+
+  int GetPageCount();
+
+  // numeric columns are tracked
+  static bool IsTracked(TypeId type);
+
+private:
+  static bool MayMatch(const ColumnZone &zone,
+                       const RangePredicate &predicate);
+  bool MayMatch(size_t slot, const std::vector<RangePredicate> &predicates);
+
+  std::mutex latch_;
+  // set last by Init, the columns below do not change afterwards
+  std::atomic<Schema *> schema_{nullptr};
+  // column -> position in the zones of a page, -1 if untracked
+  std::vector<int> positions_;
+  std::vector<int> tracked_columns_;
+  // removed pages included
+  std::unordered_map<page_id_t, size_t> slots_;
+  int removed_count_ = 0;
+  // pages in the order they were added, INVALID_PAGE_ID for removed ones
+  std::vector<page_id_t> page_ids_;
+  std::vector<std::vector<ColumnZone>> zones_;
+};
+
+} // namespace cmudb
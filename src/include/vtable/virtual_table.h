@@ -4,7 +4,11 @@
 
 #pragma once
 
+#include <algorithm>
+#include <map>
+
 #include "buffer/lru_replacer.h"
+#include "catalog/catalog_cache.h"
 #include "catalog/schema.h"
 #include "concurrency/transaction_manager.h"
 #include "index/b_plus_tree_index.h"
@@ -12,6 +16,7 @@
 #include "sqlite/sqlite3ext.h"
 #include "table/table_heap.h"
 #include "table/tuple.h"
+#include "table/tuple_accessor.h"
 #include "type/value.h"
 
 namespace cmudb {
@@ -22,11 +27,20 @@ IndexMetadata *ParseIndexStatement(std::string &sql,
                                    const std::string &table_name,
                                    Schema *schema);
 
-Tuple ConstructTuple(Schema *schema, sqlite3_value **argv);
+// table option dict=<columns> or rle=<columns>, sets the encodings of the
+// named columns or error
+void ParseEncodingOption(const std::string &option, Schema *schema,
+                         std::vector<ColumnEncoding> &encodings,
+                         std::string &error);
+
+// varchars point into argv, the tuple is allocated from arena if there is one
+Tuple ConstructTuple(Schema *schema, sqlite3_value **argv,
+                     Arena *arena = nullptr);
 
 Index *ConstructIndex(IndexMetadata *metadata,
                       BufferPoolManager *buffer_pool_manager,
-                      page_id_t root_id = INVALID_PAGE_ID);
+                      page_id_t root_id = INVALID_PAGE_ID,
+                      CatalogCache *catalog_cache = nullptr);
 Transaction *GetTransaction();
 
 /* API declaration */
@@ -59,6 +73,14 @@ int VtabCommit(sqlite3_vtab *pVTab);
 
 int VtabBegin(sqlite3_vtab *pVTab);
 
+// SQL function index_metrics(index_name [, command])
+void IndexMetricsFunction(sqlite3_context *ctx, int argc,
+                          sqlite3_value **argv);
+
+// SQL function index_analyze(index_name [, sample_rate])
+void IndexAnalyzeFunction(sqlite3_context *ctx, int argc,
+                          sqlite3_value **argv);
+
 // storage engine
 class StorageEngine {
 public:
@@ -77,11 +99,15 @@ public:
     // txn related
     lock_manager_ = new LockManager(true); // S2PL
     transaction_manager_ = new TransactionManager(lock_manager_, log_manager_);
+
+    // catalog related
+    catalog_cache_ = new CatalogCache(buffer_pool_manager_);
   }
 
   ~StorageEngine() {
     if (ENABLE_LOGGING)
       log_manager_->StopFlushThread();
+    delete catalog_cache_;
     delete disk_manager_;
     delete buffer_pool_manager_;
     delete log_manager_;
@@ -94,9 +120,20 @@ public:
   LockManager *lock_manager_;
   TransactionManager *transaction_manager_;
   LogManager *log_manager_;
+  CatalogCache *catalog_cache_;
+  // indexes of the connected virtual tables by name, for index_metrics()
+  std::map<std::string, Index *> indexes_;
+  // virtual tables created or connected and not disconnected yet
+  int table_count_ = 0;
 };
 
+// nullptr once the last virtual table disconnects, see OpenStorageEngine
 StorageEngine *storage_engine_;
+// statistics are collected from this share of the index leaves
+const double STATISTICS_SAMPLE_RATE = 0.1;
+const int64_t STATISTICS_MIN_MODIFICATIONS = 100;
+// the largest GenericKey an index is built with, see ConstructIndex
+const int MAX_INDEX_KEY_SIZE = 64;
 // global transaction, sqlite does not support concurrent transaction
 Transaction *global_transaction_ = nullptr;
 
@@ -106,17 +143,20 @@ class VirtualTable {
 public:
   VirtualTable(Schema *schema, BufferPoolManager *buffer_pool_manager,
                LockManager *lock_manager, LogManager *log_manager, Index *index,
-               page_id_t first_page_id = INVALID_PAGE_ID)
-      : schema_(schema), index_(index) {
+               page_id_t first_page_id = INVALID_PAGE_ID,
+               TableLayout layout = TableLayout::NSM,
+               const std::vector<ColumnEncoding> &encodings = {})
+      : schema_(schema), index_(index), accessor_(schema) {
     if (first_page_id != INVALID_PAGE_ID) {
       // reopen an exist table
       table_heap_ = new TableHeap(buffer_pool_manager, lock_manager,
-                                  log_manager, first_page_id);
+                                  log_manager, first_page_id, schema);
     } else {
       // create table for the first time
       Transaction *txn = storage_engine_->transaction_manager_->Begin();
-      table_heap_ =
-          new TableHeap(buffer_pool_manager, lock_manager, log_manager, txn);
+      table_heap_ = new TableHeap(buffer_pool_manager, lock_manager,
+                                  log_manager, txn, layout, schema,
+                                  encodings);
       storage_engine_->transaction_manager_->Commit(txn);
     }
   }
@@ -127,22 +167,32 @@ public:
     delete index_;
   }
 
+  // for the tuples of the row being written, VtabUpdate resets it
+  inline Arena *GetArena() { return &arena_; }
+
+  // typed getters for the tuples of the table
+  inline const TupleAccessor &GetAccessor() { return accessor_; }
+
   // insert into table heap
   inline bool InsertTuple(const Tuple &tuple, RID &rid) {
     return table_heap_->InsertTuple(tuple, rid, GetTransaction());
   }
 
+  // false if the index entry of tuple is larger than the index key, e.g. a
+  // varchar longer than its declared length
+  inline bool FitsIndex(const Tuple &tuple) {
+    if (index_ == nullptr)
+      return true;
+    return static_cast<size_t>(ConstructEntry(tuple).GetLength()) <=
+           index_->GetKeySize();
+  }
+
   // insert into index
   inline void InsertEntry(const Tuple &tuple, const RID &rid) {
     if (index_ == nullptr)
       return;
-    // construct indexed key tuple
-    std::vector<Value> key_values;
-
-    for (auto &i : index_->GetKeyAttrs())
-      key_values.push_back(tuple.GetValue(schema_, i));
-    Tuple key(key_values, index_->GetKeySchema());
-    index_->InsertEntry(key, rid, GetTransaction());
+    index_->InsertEntry(ConstructEntry(tuple), rid, GetTransaction());
+    modified_entries_++;
   }
 
   // delete from table heap
@@ -161,9 +211,11 @@ public:
     std::vector<Value> key_values;
 
     for (auto &i : index_->GetKeyAttrs())
-      key_values.push_back(deleted_tuple.GetValue(schema_, i));
-    Tuple key(key_values, index_->GetKeySchema());
+      key_values.push_back(
+          table_heap_->GetValue(deleted_tuple, schema_, i, &arena_));
+    Tuple key(key_values, index_->GetKeySchema(), &arena_);
     index_->DeleteEntry(key, GetTransaction());
+    modified_entries_++;
   }
 
   // update table heap tuple
@@ -174,6 +226,11 @@ public:
 
   inline TableIterator begin() { return table_heap_->begin(GetTransaction()); }
 
+  // skip the pages ruled out by predicates
+  inline TableIterator begin(const std::vector<RangePredicate> &predicates) {
+    return table_heap_->begin(GetTransaction(), schema_, predicates);
+  }
+
   inline TableIterator end() { return table_heap_->end(); }
 
   inline Schema *GetSchema() { return schema_; }
@@ -184,7 +241,43 @@ public:
 
   inline page_id_t GetFirstPageId() { return table_heap_->GetFirstPageId(); }
 
+  // last collected index statistics, nullptr if there are none. Planning
+  // only reads them, they are collected after writes
+  inline const IndexStatistics *GetStatistics() {
+    if (index_ == nullptr)
+      return nullptr;
+    return index_->GetStatistics();
+  }
+
+  // collect index statistics again once a tenth of the entries (and at least
+  // STATISTICS_MIN_MODIFICATIONS) have changed since the last time
+  inline void MaybeUpdateStatistics() {
+    if (index_ == nullptr)
+      return;
+    const IndexStatistics *statistics = index_->GetStatistics();
+    int64_t entry_count = statistics == nullptr ? 0 : statistics->entry_count;
+    if (modified_entries_ >
+        std::max<int64_t>(STATISTICS_MIN_MODIFICATIONS, entry_count / 10))
+      UpdateStatistics();
+  }
+
+  inline void UpdateStatistics() {
+    if (index_ == nullptr)
+      return;
+    index_->UpdateStatistics(STATISTICS_SAMPLE_RATE, GetTransaction());
+    modified_entries_ = 0;
+  }
+
 private:
+  // construct index entry tuple, key along with included columns
+  inline Tuple ConstructEntry(const Tuple &tuple) {
+    std::vector<Value> key_values;
+
+    for (auto &i : index_->GetEntryAttrs())
+      key_values.push_back(tuple.GetValue(schema_, i, &arena_));
+    return Tuple(key_values, index_->GetEntrySchema(), &arena_);
+  }
+
   sqlite3_vtab base_;
   // virtual table schema
   Schema *schema_;
@@ -192,6 +285,11 @@ private:
   TableHeap *table_heap_;
   // to insert/delete index entry
   Index *index_ = nullptr;
+  // tuples and values of the row being written, reset after every row
+  Arena arena_;
+  TupleAccessor accessor_;
+  // index entries inserted or deleted since statistics were collected
+  int64_t modified_entries_ = 0;
 };
 
 class Cursor {
@@ -220,19 +318,43 @@ public:
   }
 
   // return tuple at which cursor is currently pointed
+  // varchars live in the cursor's arena until it moves on
   inline Value GetCurrentValue(Schema *schema, int column) {
-    if (is_index_scan_) {
-      RID rid = results[offset_];
-      Tuple tuple(rid);
-      virtual_table_->table_heap_->GetTuple(rid, tuple, GetTransaction());
-      return tuple.GetValue(schema, column);
-    } else {
-      return table_iterator_->GetValue(schema, column);
+    const Tuple *tuple = GetCurrentTuple(column);
+    if (tuple != nullptr)
+      return virtual_table_->table_heap_->GetValue(*tuple, schema, column,
+                                                   &arena_);
+    // covered column, served straight from the index entry
+    const std::vector<int> &entry_attrs =
+        virtual_table_->index_->GetEntryAttrs();
+    auto it = std::find(entry_attrs.begin(), entry_attrs.end(), column);
+    return entries[offset_].GetValue(
+        virtual_table_->index_->GetEntrySchema(),
+        static_cast<int>(it - entry_attrs.begin()), &arena_);
+  }
+
+  // heap tuple of the current row, nullptr if column is covered by the index
+  // entry of an index scan
+  inline const Tuple *GetCurrentTuple(int column) {
+    if (!is_index_scan_)
+      return &*table_iterator_;
+    const std::vector<int> &entry_attrs =
+        virtual_table_->index_->GetEntryAttrs();
+    if (std::find(entry_attrs.begin(), entry_attrs.end(), column) !=
+        entry_attrs.end())
+      return nullptr;
+    // otherwise fetch the heap tuple, once per row
+    if (heap_tuple_offset_ != offset_) {
+      virtual_table_->table_heap_->GetTuple(results[offset_], heap_tuple_,
+                                            GetTransaction());
+      heap_tuple_offset_ = offset_;
     }
+    return &heap_tuple_;
   }
 
   // move cursor up to next
   Cursor &operator++() {
+    arena_.Reset();
     if (is_index_scan_)
       ++offset_;
     else
@@ -249,19 +371,64 @@ public:
 
   // wrapper around poit scan methods
   inline void ScanKey(const Tuple &key) {
-    virtual_table_->index_->ScanKey(key, results);
+    // filter may be called again to rewind the cursor
+    results.clear();
+    entries.clear();
+    offset_ = 0;
+    heap_tuple_offset_ = -1;
+    // no entry is longer than the index key, so a longer key matches nothing
+    if (static_cast<size_t>(key.GetLength()) >
+        virtual_table_->index_->GetKeySize())
+      return;
+    virtual_table_->index_->ScanKey(key, results, entries);
+  }
+
+  // restart the sequential scan, filtered by the zone map unless predicates
+  // is empty
+  inline void ScanZones(const std::vector<RangePredicate> &predicates) {
+    is_index_scan_ = false;
+    arena_.Reset();
+    if (predicates.empty())
+      table_iterator_ = virtual_table_->begin();
+    else
+      table_iterator_ = virtual_table_->begin(predicates);
+    table_iterator_.SetProjection(projection_);
+  }
+
+  // colUsed of the scan: bit i set if sqlite reads column i, bit 63 stands
+  // for every column from 63 on. A sequential scan skips the other columns
+  // where it can
+  inline void SetColumnsUsed(sqlite3_uint64 columns_used) {
+    int column_count = virtual_table_->schema_->GetColumnCount();
+    projection_.assign(column_count, false);
+    bool is_all = true;
+    for (int i = 0; i < column_count; i++) {
+      projection_[i] = (columns_used >> std::min(i, 63)) & 1;
+      is_all = is_all && projection_[i];
+    }
+    if (is_all)
+      projection_.clear();
   }
 
 private:
   sqlite3_vtab_cursor base_; /* Base class - must be first */
   // for index scan
   std::vector<RID> results;
+  // index entries matching results, carrying the covered columns
+  std::vector<Tuple> entries;
   int offset_ = 0;
+  // heap tuple of results[heap_tuple_offset_], for uncovered columns
+  Tuple heap_tuple_;
+  int heap_tuple_offset_ = -1;
   // for sequential scan
   TableIterator table_iterator_;
   // flag to indicate which scan method is currently used
   bool is_index_scan_ = false;
+  // columns read by a sequential scan, empty for all
+  std::vector<bool> projection_;
   VirtualTable *virtual_table_;
+  // values of the current row
+  Arena arena_;
 }; // namespace cmudb
 
 } // namespace cmudb
\ No newline at end of file
@@ -1,9 +1,13 @@
 /**
  * b_plus_tree.cpp
  */
+#include <algorithm>
+#include <chrono>
+#include <cmath>
 #include <iostream>
 #include <string>
 
+#include "catalog/catalog_cache.h"
 #include "common/exception.h"
 #include "common/logger.h"
 #include "common/rid.h"
@@ -16,9 +20,12 @@ INDEX_TEMPLATE_ARGUMENTS
 BPLUSTREE_TYPE::BPlusTree(const std::string &name,
                           BufferPoolManager *buffer_pool_manager,
                           const KeyComparator &comparator,
-                          page_id_t root_page_id)
+                          page_id_t root_page_id,
+                          CatalogCache *catalog_cache)
     : index_name_(name), root_page_id_(root_page_id),
-      buffer_pool_manager_(buffer_pool_manager), comparator_(comparator) {}
+      buffer_pool_manager_(buffer_pool_manager), comparator_(comparator),
+      catalog_cache_(catalog_cache), epoch_manager_(buffer_pool_manager),
+      compress_leaves_(false) {}
 
 /*
  * Helper function to decide whether current b+tree is empty
@@ -39,17 +46,141 @@ INDEX_TEMPLATE_ARGUMENTS
 bool BPLUSTREE_TYPE::GetValue(const KeyType &key,
                               std::vector<ValueType> &result,
                               Transaction *transaction) {
-  if (this->IsEmpty())
+  IndexOperationScope scope(metrics_, metrics_.lookups,
+                            metrics_.lookup_latency);
+  LatchRoot(false);
+  if (this->IsEmpty()) {
+    root_latch_.RUnlock();
     return false;
+  }
   auto leaf_node = FindLeafPage(key);
   ValueType value;
   bool exist = leaf_node->Lookup(key, value, comparator_);
   if (exist)
     result.push_back(value);
   buffer_pool_manager_->UnpinPage(leaf_node->GetPageId(), false);
+  root_latch_.RUnlock();
+  return exist;
+}
+
+/*
+ * Return the key & value pair stored for input key. The stored key may carry
+ * bytes the comparator ignores (e.g. included columns of a covering index).
+ * @return : true means key exists
+ */
+INDEX_TEMPLATE_ARGUMENTS
+bool BPLUSTREE_TYPE::GetEntry(const KeyType &key, MappingType &entry,
+                              Transaction *transaction) {
+  IndexOperationScope scope(metrics_, metrics_.lookups,
+                            metrics_.lookup_latency);
+  LatchRoot(false);
+  if (IsEmpty()) {
+    root_latch_.RUnlock();
+    return false;
+  }
+  auto leaf_node = FindLeafPage(key);
+  int index = leaf_node->KeyIndex(key, comparator_);
+  bool exist = index != -1 && comparator_(leaf_node->KeyAt(index), key) == 0;
+  if (exist)
+    entry = leaf_node->ItemAt(index);
+  buffer_pool_manager_->UnpinPage(leaf_node->GetPageId(), false);
+  root_latch_.RUnlock();
   return exist;
 }
 
+/*
+ * Return the values associated with a batch of keys, keys must be sorted in
+ * ascending order by comparator_
+ * Instead of descending from the root for every key, the root-to-leaf path is
+ * kept pinned and the search only climbs back to the lowest ancestor whose key
+ * range still covers the next key. Neighbouring keys therefore share most of
+ * the traversal, and keys falling into the same leaf cost a single pin.
+ * @return : true means at least one key exists
+ */
+INDEX_TEMPLATE_ARGUMENTS
+bool BPLUSTREE_TYPE::GetValues(const std::vector<KeyType> &keys,
+                               std::vector<ValueType> &result,
+                               Transaction *transaction) {
+  if (keys.empty())
+    return false;
+  IndexOperationScope scope(metrics_, metrics_.lookups,
+                            metrics_.lookup_latency);
+  LatchRoot(false);
+  if (IsEmpty()) {
+    root_latch_.RUnlock();
+    return false;
+  }
+  using InternalPage = BPlusTreeInternalPage<KeyType, page_id_t, KeyComparator>;
+  // path[i] is the pinned internal node at depth i, the subtree of the child
+  // taken at depth i is bounded by upper[i] (exclusive) when bounded[i]
+  std::vector<InternalPage *> path;
+  std::vector<KeyType> upper;
+  std::vector<bool> bounded;
+  B_PLUS_TREE_LEAF_PAGE_TYPE *leaf = nullptr;
+  bool found = false;
+
+  for (const auto &key : keys) {
+    if (leaf != nullptr) {
+      bool in_leaf = path.empty() || !bounded.back() ||
+                     comparator_(key, upper.back()) < 0;
+      if (!in_leaf) {
+        buffer_pool_manager_->UnpinPage(leaf->GetPageId(), false);
+        leaf = nullptr;
+        // pop every ancestor whose range ends before key, the root never does
+        while (path.size() > 1) {
+          size_t parent = path.size() - 2;
+          if (!bounded[parent] || comparator_(key, upper[parent]) < 0)
+            break;
+          buffer_pool_manager_->UnpinPage(path.back()->GetPageId(), false);
+          path.pop_back();
+          upper.pop_back();
+          bounded.pop_back();
+        }
+        upper.pop_back();
+        bounded.pop_back();
+      }
+    }
+    if (leaf == nullptr) {
+      auto page = path.empty() ? FetchPage(root_page_id_) : nullptr;
+      auto node = path.empty()
+                      ? reinterpret_cast<BPlusTreePage *>(page->GetData())
+                      : reinterpret_cast<BPlusTreePage *>(path.back());
+      if (!path.empty())
+        path.pop_back();
+      while (!node->IsLeafPage()) {
+        auto internal = reinterpret_cast<InternalPage *>(node);
+        page_id_t child_id = internal->Lookup(key, comparator_);
+        int index = internal->ValueIndex(child_id);
+        path.push_back(internal);
+        if (index + 1 < internal->GetSize()) {
+          upper.push_back(internal->KeyAt(index + 1));
+          bounded.push_back(true);
+        } else if (upper.empty()) {
+          upper.push_back(KeyType{});
+          bounded.push_back(false);
+        } else {
+          // rightmost child inherits the bound of its parent
+          upper.push_back(upper.back());
+          bounded.push_back(bounded.back());
+        }
+        node = reinterpret_cast<BPlusTreePage *>(FetchPage(child_id)->GetData());
+      }
+      leaf = reinterpret_cast<B_PLUS_TREE_LEAF_PAGE_TYPE *>(node);
+    }
+    ValueType value;
+    if (leaf->Lookup(key, value, comparator_)) {
+      result.push_back(value);
+      found = true;
+    }
+  }
+
+  buffer_pool_manager_->UnpinPage(leaf->GetPageId(), false);
+  for (auto node : path)
+    buffer_pool_manager_->UnpinPage(node->GetPageId(), false);
+  root_latch_.RUnlock();
+  return found;
+}
+
 /*****************************************************************************
  * INSERTION
  *****************************************************************************/
@@ -63,11 +194,18 @@ bool BPLUSTREE_TYPE::GetValue(const KeyType &key,
 INDEX_TEMPLATE_ARGUMENTS
 bool BPLUSTREE_TYPE::Insert(const KeyType &key, const ValueType &value,
                             Transaction *transaction) {
-  if (IsEmpty()) {
+  IndexOperationScope scope(metrics_, metrics_.inserts,
+                            metrics_.insert_latency);
+  LatchWriter();
+  std::lock_guard<std::mutex> guard(writer_latch_, std::adopt_lock);
+  LatchRoot(true);
+  bool inserted = true;
+  if (IsEmpty())
     StartNewTree(key, value);
-    return true;
-  }
-  return InsertIntoLeaf(key, value);
+  else
+    inserted = InsertIntoLeaf(key, value);
+  root_latch_.WUnlock();
+  return inserted;
 }
 /*
  * Insert constant key & value pair into an empty tree
@@ -84,8 +222,8 @@ void BPLUSTREE_TYPE::StartNewTree(const KeyType &key, const ValueType &value) {
   UpdateRootPageId(true);
   // insert kv to the root node
   node->Insert(key, value, comparator_);
-  // unpin the root node
-  buffer_pool_manager_->UnpinPage(root_page_id_, false);
+  // unpin the root node, dirty so that the entry survives eviction
+  buffer_pool_manager_->UnpinPage(root_page_id_, true);
 }
 
 /*
@@ -103,8 +241,14 @@ bool BPLUSTREE_TYPE::InsertIntoLeaf(const KeyType &key, const ValueType &value,
   auto leaf_node = FindLeafPage(key);
   ValueType v;
   // duplicate key found
-  if (leaf_node->Lookup(key, v, comparator_))
+  if (leaf_node->Lookup(key, v, comparator_)) {
+    buffer_pool_manager_->UnpinPage(leaf_node->GetPageId(), false);
     return false;
+  }
+  if (leaf_node->IsCompressedLeafPage()) {
+    ExpandLeaf(leaf_node, transaction);
+    leaf_node = FindLeafPage(key);
+  }
   // leaf node is not full
   if (leaf_node->GetSize() < leaf_node->GetMaxSize()) {
     leaf_node->Insert(key, value, comparator_);
@@ -116,6 +260,7 @@ bool BPLUSTREE_TYPE::InsertIntoLeaf(const KeyType &key, const ValueType &value,
     leaf_node->Insert(key,value,comparator_);
   else
     new_leaf_node->Insert(key,value,comparator_);
+  new_leaf_node->SetNextPageId(leaf_node->GetNextPageId());
   leaf_node->SetNextPageId(new_leaf_node->GetPageId());
   InsertIntoParent(leaf_node, new_leaf_node->KeyAt(0), new_leaf_node,transaction);
   return true;
@@ -130,6 +275,8 @@ bool BPLUSTREE_TYPE::InsertIntoLeaf(const KeyType &key, const ValueType &value,
  */
 INDEX_TEMPLATE_ARGUMENTS
 template <typename N> N *BPLUSTREE_TYPE::Split(N *node) {
+  if (metrics_.IsEnabled())
+    metrics_.splits++;
   auto recipient = NewNode<N>(node->GetParentPageId());
   node->MoveHalfTo(recipient, buffer_pool_manager_);
   return recipient;
@@ -206,6 +353,298 @@ void BPLUSTREE_TYPE::InsertIntoParent(BPlusTreePage *old_node,
   InsertIntoParent(parent_node, new_parent_node->KeyAt(0), new_parent_node);
 }
 
+/*****************************************************************************
+ * BULK LOAD
+ *****************************************************************************/
+/*
+ * Build the tree bottom-up from key & value pairs produced by "next" in
+ * ascending key order. Only an empty tree can be bulk loaded.
+ * @return: false if current tree is not empty
+ */
+INDEX_TEMPLATE_ARGUMENTS
+bool BPLUSTREE_TYPE::BulkLoad(
+    const std::function<bool(KeyType &, ValueType &)> &next,
+    double fill_factor, Transaction *transaction) {
+  LatchWriter();
+  std::lock_guard<std::mutex> guard(writer_latch_, std::adopt_lock);
+  LatchRoot(true);
+  bool loaded = IsEmpty();
+  if (loaded) {
+    root_page_id_ = BuildFromSorted(next, fill_factor);
+    if (!IsEmpty())
+      UpdateRootPageId(true);
+  }
+  root_latch_.WUnlock();
+  return loaded;
+}
+
+/*
+ * Build a detached tree bottom-up from key & value pairs produced by "next" in
+ * ascending key order, duplicate keys are skipped. Leaves are filled to
+ * fill_factor of their capacity and chained together, then every upper level
+ * is built from the first keys of the level below, until a single root
+ * remains.
+ * @return: root page id of the new tree, INVALID_PAGE_ID if "next" produced
+ * nothing
+ */
+INDEX_TEMPLATE_ARGUMENTS
+page_id_t BPLUSTREE_TYPE::BuildFromSorted(
+    const std::function<bool(KeyType &, ValueType &)> &next,
+    double fill_factor) {
+  using InternalPage = BPlusTreeInternalPage<KeyType, page_id_t, KeyComparator>;
+  // first key & page id of every node on the level just built
+  std::vector<std::pair<KeyType, page_id_t>> level;
+
+  // leaves: keep up to two nodes worth of entries pending, so that the last
+  // two leaves can share the tail evenly instead of leaving one underfull
+  int plain_max = (PAGE_SIZE - sizeof(B_PLUS_TREE_LEAF_PAGE_TYPE)) /
+                  sizeof(MappingType);
+  int leaf_max = compress_leaves_
+                     ? B_PLUS_TREE_LEAF_PAGE_TYPE::GetCompressedMaxSize()
+                     : plain_max;
+  int leaf_fill = BulkLoadFillSize(leaf_max, fill_factor);
+  std::vector<MappingType> pending;
+  B_PLUS_TREE_LEAF_PAGE_TYPE *prev_leaf = nullptr;
+  auto append_leaf = [&](B_PLUS_TREE_LEAF_PAGE_TYPE *leaf) {
+    level.emplace_back(leaf->KeyAt(0), leaf->GetPageId());
+    if (prev_leaf != nullptr) {
+      prev_leaf->SetNextPageId(leaf->GetPageId());
+      buffer_pool_manager_->UnpinPage(prev_leaf->GetPageId(), true);
+    }
+    prev_leaf = leaf;
+  };
+  // entries that do not compress are spread evenly over plain leaves
+  auto emit_leaf = [&](MappingType *items, int size) {
+    if (compress_leaves_ &&
+        B_PLUS_TREE_LEAF_PAGE_TYPE::CanCompress(items, size)) {
+      auto leaf = NewNode<B_PLUS_TREE_LEAF_PAGE_TYPE>();
+      leaf->CompressFrom(items, size);
+      append_leaf(leaf);
+      return;
+    }
+    int count = (size + plain_max - 1) / plain_max;
+    for (int i = 0; i < count; i++) {
+      int begin = static_cast<int64_t>(size) * i / count;
+      int end = static_cast<int64_t>(size) * (i + 1) / count;
+      auto leaf = NewNode<B_PLUS_TREE_LEAF_PAGE_TYPE>();
+      leaf->CopyAllFrom(items + begin, end - begin);
+      append_leaf(leaf);
+    }
+  };
+  KeyType key;
+  ValueType value;
+  while (next(key, value)) {
+    if (!pending.empty() && comparator_(pending.back().first, key) >= 0)
+      continue;
+    pending.emplace_back(key, value);
+    if ((int)pending.size() == 2 * leaf_fill) {
+      emit_leaf(pending.data(), leaf_fill);
+      pending.erase(pending.begin(), pending.begin() + leaf_fill);
+    }
+  }
+  if (pending.empty())
+    return INVALID_PAGE_ID;
+  int offset = 0;
+  for (int size : BulkLoadTailSizes(pending.size(), leaf_fill, leaf_max)) {
+    emit_leaf(pending.data() + offset, size);
+    offset += size;
+  }
+  buffer_pool_manager_->UnpinPage(prev_leaf->GetPageId(), true);
+
+  // internal levels, the whole level below is known at this point
+  int internal_max =
+      (PAGE_SIZE - sizeof(InternalPage)) / sizeof(std::pair<KeyType, page_id_t>);
+  int internal_fill = BulkLoadFillSize(internal_max, fill_factor);
+  while (level.size() > 1) {
+    std::vector<std::pair<KeyType, page_id_t>> upper;
+    int total = level.size();
+    int full = 0;
+    // whole nodes, then let the last one or two share the remainder
+    while (total - full >= 2 * internal_fill)
+      full += internal_fill;
+    std::vector<int> sizes(full / internal_fill, internal_fill);
+    for (int size : BulkLoadTailSizes(total - full, internal_fill,
+                                      internal_max))
+      sizes.push_back(size);
+    offset = 0;
+    for (int size : sizes) {
+      auto node = NewNode<InternalPage>();
+      node->CopyAllFrom(level.data() + offset, size, buffer_pool_manager_);
+      upper.emplace_back(level[offset].first, node->GetPageId());
+      buffer_pool_manager_->UnpinPage(node->GetPageId(), true);
+      offset += size;
+    }
+    level.swap(upper);
+  }
+  return level[0].second;
+}
+
+/*
+ * Rebuild the tree into fresh pages: the old leaves are streamed in key order
+ * into the bottom-up builder, so the new leaves are allocated one after the
+ * other at fill_factor of their capacity and their chain follows key order.
+ * Lookups keep reading the old tree, which stays intact until the root is
+ * swapped. The swap waits for in-flight lookups, after which the old pages
+ * are unreachable and deleted.
+ * NOTE: the rebuild is not incremental, writers wait for all of it, which
+ * takes time linear in the size of the tree. Meant for maintenance windows
+ * rather than for large trees under write load.
+ * @return: false if current tree is empty or a page of the old tree can't be
+ * fetched, the tree is left as it was then
+ */
+INDEX_TEMPLATE_ARGUMENTS
+bool BPLUSTREE_TYPE::Compact(double fill_factor, Transaction *transaction) {
+  LatchWriter();
+  std::lock_guard<std::mutex> guard(writer_latch_, std::adopt_lock);
+  if (IsEmpty())
+    return false;
+  std::vector<page_id_t> old_pages;
+  if (!CollectPages(root_page_id_, old_pages))
+    return false;
+
+  KeyType first_key{};
+  B_PLUS_TREE_LEAF_PAGE_TYPE *leaf = FindLeafPage(first_key, true);
+  int index = 0;
+  bool is_fetched = true;
+  auto next = [&](KeyType &key, ValueType &value) {
+    while (leaf != nullptr && index == leaf->GetSize()) {
+      page_id_t next_page_id = leaf->GetNextPageId();
+      buffer_pool_manager_->UnpinPage(leaf->GetPageId(), false);
+      leaf = nullptr;
+      if (next_page_id == INVALID_PAGE_ID)
+        break;
+      IndexMetrics::CountPage();
+      Page *page = buffer_pool_manager_->FetchPage(next_page_id);
+      if (page == nullptr) {
+        is_fetched = false;
+        break;
+      }
+      leaf = reinterpret_cast<B_PLUS_TREE_LEAF_PAGE_TYPE *>(page->GetData());
+      index = 0;
+    }
+    if (leaf == nullptr)
+      return false;
+    MappingType item = leaf->ItemAt(index);
+    key = item.first;
+    value = item.second;
+    index++;
+    return true;
+  };
+  page_id_t new_root_page_id = BuildFromSorted(next, fill_factor);
+  // the new tree misses entries, nobody has seen it yet
+  if (!is_fetched) {
+    std::vector<page_id_t> new_pages;
+    if (new_root_page_id != INVALID_PAGE_ID)
+      CollectPages(new_root_page_id, new_pages);
+    for (auto page_id : new_pages)
+      buffer_pool_manager_->DeletePage(page_id);
+    return false;
+  }
+
+  LatchRoot(true);
+  root_page_id_ = new_root_page_id;
+  UpdateRootPageId(false);
+  root_latch_.WUnlock();
+  // index iterators may still be walking the old leaves
+  for (auto page_id : old_pages)
+    epoch_manager_.Retire(page_id);
+  epoch_manager_.Reclaim();
+  return true;
+}
+
+/*
+ * Page ids of the tree under root_page_id, level by level
+ * @return: false if a page can't be fetched
+ */
+INDEX_TEMPLATE_ARGUMENTS
+bool BPLUSTREE_TYPE::CollectPages(page_id_t root_page_id,
+                                  std::vector<page_id_t> &pages) {
+  std::vector<page_id_t> level{root_page_id};
+  while (!level.empty()) {
+    std::vector<page_id_t> children;
+    for (auto page_id : level) {
+      IndexMetrics::CountPage();
+      Page *page = buffer_pool_manager_->FetchPage(page_id);
+      if (page == nullptr)
+        return false;
+      pages.push_back(page_id);
+      auto node = reinterpret_cast<BPlusTreePage *>(page->GetData());
+      if (!node->IsLeafPage()) {
+        auto internal = reinterpret_cast<
+            BPlusTreeInternalPage<KeyType, page_id_t, KeyComparator> *>(node);
+        for (int i = 0; i < internal->GetSize(); i++)
+          children.push_back(internal->ValueAt(i));
+      }
+      buffer_pool_manager_->UnpinPage(page_id, false);
+    }
+    level.swap(children);
+  }
+  return true;
+}
+
+/*
+ * Number of entries put into each node by bulk loading, never less than the
+ * min size so that the loaded tree does not trigger immediate merges
+ */
+INDEX_TEMPLATE_ARGUMENTS
+int BPLUSTREE_TYPE::BulkLoadFillSize(int max_size, double fill_factor) {
+  int fill = static_cast<int>(max_size * fill_factor);
+  return std::max(std::max(fill, max_size / 2), 1);
+}
+
+/*
+ * Split the last "remain" (< 2 * fill) entries of a level into node sizes.
+ * A remainder too small for a node of its own is shared evenly with the
+ * previous node.
+ */
+INDEX_TEMPLATE_ARGUMENTS
+std::vector<int> BPLUSTREE_TYPE::BulkLoadTailSizes(int remain, int fill,
+                                                   int max_size) {
+  if (remain <= fill)
+    return {remain};
+  if (remain - fill >= max_size / 2)
+    return {fill, remain - fill};
+  if (remain <= max_size)
+    return {remain};
+  return {remain - remain / 2, remain / 2};
+}
+
+/*****************************************************************************
+ * LEAF COMPRESSION
+ *****************************************************************************/
+INDEX_TEMPLATE_ARGUMENTS
+void BPLUSTREE_TYPE::SetLeafCompression(bool compress_leaves) {
+  std::lock_guard<std::mutex> guard(writer_latch_);
+  compress_leaves_ = compress_leaves;
+}
+
+/*
+ * Writers never modify a compressed leaf in place. The leaf is decoded back
+ * into the uncompressed format, when the entries do not fit into one page
+ * anymore they are split evenly with a new right sibling that is inserted
+ * into the parent. Both leaves (and the parent) are unpinned afterwards, the
+ * caller looks the target leaf up again.
+ */
+INDEX_TEMPLATE_ARGUMENTS
+void BPLUSTREE_TYPE::ExpandLeaf(B_PLUS_TREE_LEAF_PAGE_TYPE *leaf,
+                                Transaction *transaction) {
+  std::vector<MappingType> items;
+  leaf->Expand(items);
+  int size = items.size();
+  if (size <= leaf->GetMaxSize()) {
+    leaf->CopyAllFrom(items.data(), size);
+    buffer_pool_manager_->UnpinPage(leaf->GetPageId(), true);
+    return;
+  }
+  auto new_leaf = NewNode<B_PLUS_TREE_LEAF_PAGE_TYPE>(leaf->GetParentPageId());
+  int half = size / 2;
+  leaf->CopyAllFrom(items.data(), half);
+  new_leaf->CopyAllFrom(items.data() + half, size - half);
+  new_leaf->SetNextPageId(leaf->GetNextPageId());
+  leaf->SetNextPageId(new_leaf->GetPageId());
+  InsertIntoParent(leaf, new_leaf->KeyAt(0), new_leaf, transaction);
+}
+
 /*****************************************************************************
  * REMOVE
  *****************************************************************************/
@@ -218,14 +657,27 @@ void BPLUSTREE_TYPE::InsertIntoParent(BPlusTreePage *old_node,
  */
 INDEX_TEMPLATE_ARGUMENTS
 void BPLUSTREE_TYPE::Remove(const KeyType &key, Transaction *transaction) {
-  if (IsEmpty())
-    return;
-  auto leaf_node = FindLeafPage(key);
-  ValueType v;
-  if (leaf_node->Lookup(key, v, comparator_)) {
-    leaf_node->RemoveAndDeleteRecord(key,comparator_);
-    CoalesceOrRedistribute(leaf_node,transaction);
+  IndexOperationScope scope(metrics_, metrics_.removes,
+                            metrics_.remove_latency);
+  LatchWriter();
+  std::lock_guard<std::mutex> guard(writer_latch_, std::adopt_lock);
+  LatchRoot(true);
+  if (!IsEmpty()) {
+    auto leaf_node = FindLeafPage(key);
+    ValueType v;
+    if (leaf_node->Lookup(key, v, comparator_)) {
+      if (leaf_node->IsCompressedLeafPage()) {
+        ExpandLeaf(leaf_node, transaction);
+        leaf_node = FindLeafPage(key);
+      }
+      leaf_node->RemoveAndDeleteRecord(key, comparator_);
+      CoalesceOrRedistribute(leaf_node, transaction);
+    } else {
+      buffer_pool_manager_->UnpinPage(leaf_node->GetPageId(), false);
+    }
   }
+  root_latch_.WUnlock();
+  epoch_manager_.Reclaim();
 }
 
 /*
@@ -258,11 +710,21 @@ bool BPLUSTREE_TYPE::CoalesceOrRedistribute(N *node, Transaction *transaction) {
     // left sibling if not
     sibling_page = FetchPage(parent->ValueAt(index-1));
   sibling = reinterpret_cast<N*>(sibling_page->GetData());
+  if (sibling->IsLeafPage() &&
+      reinterpret_cast<BPlusTreePage *>(sibling)->IsCompressedLeafPage()) {
+    // compressed leaves are read only, leave the underfull node for the next
+    // compaction instead of expanding its sibling
+    buffer_pool_manager_->UnpinPage(sibling->GetPageId(), false);
+    buffer_pool_manager_->UnpinPage(node->GetPageId(), true);
+    buffer_pool_manager_->UnpinPage(parent->GetPageId(), false);
+    return false;
+  }
   bool deletion;
   if (sibling->GetSize() + node->GetSize() > node->GetMaxSize()) {
     // redistribute
     Redistribute(sibling,node,index);
     buffer_pool_manager_->UnpinPage(sibling->GetPageId(),true);
+    buffer_pool_manager_->UnpinPage(node->GetPageId(), true);
     deletion = false;
   } else {
     if (index == 0) {
@@ -300,9 +762,13 @@ bool BPLUSTREE_TYPE::Coalesce(
     N *&neighbor_node, N *&node,
     BPlusTreeInternalPage<KeyType, page_id_t, KeyComparator> *&parent,
     int index, Transaction *transaction) {
+    if (metrics_.IsEnabled())
+      metrics_.merges++;
     node->MoveAllTo(neighbor_node,index,buffer_pool_manager_);
     parent->Remove(index);
-    buffer_pool_manager_->DeletePage(node->GetPageId());
+    // an index iterator may still follow the next page id into node
+    buffer_pool_manager_->UnpinPage(node->GetPageId(), true);
+    epoch_manager_.Retire(node->GetPageId());
     return parent->GetSize() == 0;
 }
 
@@ -318,6 +784,8 @@ bool BPLUSTREE_TYPE::Coalesce(
 INDEX_TEMPLATE_ARGUMENTS
 template <typename N>
 void BPLUSTREE_TYPE::Redistribute(N *neighbor_node, N *node, int index) {
+  if (metrics_.IsEnabled())
+    metrics_.redistributions++;
   if (index == 0)
     // neighbor_node is the right sibling of node
     neighbor_node->MoveFirstToEndOf(node,buffer_pool_manager_);
@@ -341,11 +809,13 @@ bool BPLUSTREE_TYPE::AdjustRoot(BPlusTreePage *old_root_node) {
   if (old_root_node->IsLeafPage()) {
     if (old_root_node->GetSize() == 0) {
       // delete root page
-      buffer_pool_manager_->DeletePage(root_page_id_);
+      buffer_pool_manager_->UnpinPage(root_page_id_, true);
+      epoch_manager_.Retire(root_page_id_);
       root_page_id_ = INVALID_PAGE_ID;
       UpdateRootPageId();
       return true;
     }
+    buffer_pool_manager_->UnpinPage(root_page_id_, true);
     return false;
   }
 
@@ -356,7 +826,8 @@ bool BPLUSTREE_TYPE::AdjustRoot(BPlusTreePage *old_root_node) {
                 (old_root_node);
     auto child_page_id = root->ValueAt(0);
     // delete root page
-    buffer_pool_manager_->DeletePage(root->GetPageId());
+    buffer_pool_manager_->UnpinPage(root->GetPageId(), false);
+    epoch_manager_.Retire(root->GetPageId());
     // child node becomes the new root
     root_page_id_ = child_page_id;
     UpdateRootPageId();
@@ -366,6 +837,7 @@ bool BPLUSTREE_TYPE::AdjustRoot(BPlusTreePage *old_root_node) {
     buffer_pool_manager_->UnpinPage(child->GetPageId(),true);
     return true;
   }
+  buffer_pool_manager_->UnpinPage(old_root_node->GetPageId(), true);
   return false;
 }
 
@@ -380,7 +852,14 @@ bool BPLUSTREE_TYPE::AdjustRoot(BPlusTreePage *old_root_node) {
 INDEX_TEMPLATE_ARGUMENTS
 INDEXITERATOR_TYPE BPLUSTREE_TYPE::Begin() {
   KeyType k = {};
-  return IndexIterator<KeyType,ValueType,KeyComparator>(FindLeafPage(k, true),buffer_pool_manager_,0);
+  LatchRoot(false);
+  uint64_t epoch = epoch_manager_.Enter();
+  auto leaf_page = FindLeafPage(k, true);
+  // the iterator copies the leaf under the root latch
+  INDEXITERATOR_TYPE iterator(leaf_page, buffer_pool_manager_, 0,
+                              &epoch_manager_, epoch, &root_latch_);
+  root_latch_.RUnlock();
+  return iterator;
 }
 
 /*
@@ -390,8 +869,84 @@ INDEXITERATOR_TYPE BPLUSTREE_TYPE::Begin() {
  */
 INDEX_TEMPLATE_ARGUMENTS
 INDEXITERATOR_TYPE BPLUSTREE_TYPE::Begin(const KeyType &key) {
+  LatchRoot(false);
+  uint64_t epoch = epoch_manager_.Enter();
   auto leaf_page = FindLeafPage(key);
-  return IndexIterator<KeyType,ValueType,KeyComparator>(leaf_page,buffer_pool_manager_,leaf_page->KeyIndex(key,comparator_));
+  INDEXITERATOR_TYPE iterator(leaf_page, buffer_pool_manager_,
+                              leaf_page->KeyIndex(key, comparator_),
+                              &epoch_manager_, epoch, &root_latch_);
+  root_latch_.RUnlock();
+  return iterator;
+}
+
+/*****************************************************************************
+ * STATISTICS
+ *****************************************************************************/
+/*
+ * Walk the internal levels one by one to count pages and their fill, which
+ * ends with the page ids of all leaves. Every step-th leaf is then read for
+ * the leaf statistics, with step derived from the sample rate, and the entry
+ * count is extrapolated from the sampled leaves.
+ */
+INDEX_TEMPLATE_ARGUMENTS
+int64_t BPLUSTREE_TYPE::CollectStatistics(
+    IndexStatistics &statistics, double sample_rate,
+    const std::function<void(const KeyType &)> &sample) {
+  statistics = IndexStatistics();
+  LatchRoot(false);
+  if (IsEmpty()) {
+    root_latch_.RUnlock();
+    return 0;
+  }
+  std::vector<page_id_t> level{root_page_id_};
+  int64_t internal_size = 0, internal_capacity = 0;
+  while (true) {
+    auto node = reinterpret_cast<BPlusTreePage *>(FetchPage(level[0])->GetData());
+    bool is_leaf = node->IsLeafPage();
+    buffer_pool_manager_->UnpinPage(level[0], false);
+    statistics.level_pages.push_back(level.size());
+    if (is_leaf)
+      break;
+    std::vector<page_id_t> children;
+    for (auto page_id : level) {
+      auto internal = reinterpret_cast<
+          BPlusTreeInternalPage<KeyType, page_id_t, KeyComparator> *>(
+          FetchPage(page_id)->GetData());
+      internal_size += internal->GetSize();
+      internal_capacity += internal->GetMaxSize();
+      for (int i = 0; i < internal->GetSize(); i++)
+        children.push_back(internal->ValueAt(i));
+      buffer_pool_manager_->UnpinPage(page_id, false);
+    }
+    level.swap(children);
+  }
+  statistics.height = statistics.level_pages.size();
+  if (internal_capacity != 0)
+    statistics.internal_fill =
+        static_cast<double>(internal_size) / internal_capacity;
+
+  int leaf_count = level.size();
+  int step = 1;
+  if (sample_rate > 0 && sample_rate < 1)
+    step = std::max(1, static_cast<int>(std::round(1 / sample_rate)));
+  int64_t leaf_size = 0, leaf_capacity = 0, sampled_leaves = 0;
+  for (int i = std::min(step / 2, leaf_count - 1); i < leaf_count; i += step) {
+    auto leaf = reinterpret_cast<B_PLUS_TREE_LEAF_PAGE_TYPE *>(
+        FetchPage(level[i])->GetData());
+    leaf_size += leaf->GetSize();
+    leaf_capacity += leaf->GetMaxSize();
+    sampled_leaves++;
+    for (int j = 0; j < leaf->GetSize(); j++)
+      sample(leaf->KeyAt(j));
+    buffer_pool_manager_->UnpinPage(level[i], false);
+  }
+  statistics.leaf_fill = static_cast<double>(leaf_size) / leaf_capacity;
+  statistics.entry_count = sampled_leaves == leaf_count
+                               ? leaf_size
+                               : std::llround(static_cast<double>(leaf_size) *
+                                              leaf_count / sampled_leaves);
+  root_latch_.RUnlock();
+  return leaf_size;
 }
 
 /*****************************************************************************
@@ -404,6 +959,8 @@ INDEXITERATOR_TYPE BPLUSTREE_TYPE::Begin(const KeyType &key) {
 INDEX_TEMPLATE_ARGUMENTS
 B_PLUS_TREE_LEAF_PAGE_TYPE *BPLUSTREE_TYPE::FindLeafPage(const KeyType &key,
                                                          bool leftMost) {
+  if (metrics_.IsEnabled())
+    metrics_.descents++;
   page_id_t page_id = root_page_id_;
   auto page = FetchPage(page_id);
   auto p = reinterpret_cast<BPlusTreePage *>(page->GetData());
@@ -430,17 +987,65 @@ B_PLUS_TREE_LEAF_PAGE_TYPE *BPLUSTREE_TYPE::FindLeafPage(const KeyType &key,
  */
 INDEX_TEMPLATE_ARGUMENTS
 void BPLUSTREE_TYPE::UpdateRootPageId(int insert_record) {
+  if (metrics_.IsEnabled())
+    metrics_.root_changes++;
+  if (catalog_cache_ != nullptr) {
+    // written back to header page when the catalog cache is flushed
+    catalog_cache_->SetRootId(index_name_, root_page_id_);
+    return;
+  }
   HeaderPage *header_page = static_cast<HeaderPage *>(
       buffer_pool_manager_->FetchPage(HEADER_PAGE_ID));
-  if (insert_record)
-    // create a new record<index_name + root_page_id> in header_page
-    header_page->InsertRecord(index_name_, root_page_id_);
-  else
+  if (insert_record) {
+    // create a new record<index_name + root_page_id> in header_page, the
+    // record is kept when the tree becomes empty, so reuse it in that case
+    if (!header_page->InsertRecord(index_name_, root_page_id_))
+      header_page->UpdateRecord(index_name_, root_page_id_);
+  } else
     // update root_page_id in header_page
     header_page->UpdateRecord(index_name_, root_page_id_);
   buffer_pool_manager_->UnpinPage(HEADER_PAGE_ID, true);
 }
 
+/*
+ * Latch helpers, a latch that can not be taken right away counts as a wait
+ * when metrics are enabled
+ */
+INDEX_TEMPLATE_ARGUMENTS
+void BPLUSTREE_TYPE::LatchRoot(bool exclusive) {
+  if (!metrics_.IsEnabled()) {
+    exclusive ? root_latch_.WLock() : root_latch_.RLock();
+    return;
+  }
+  if (exclusive ? root_latch_.TryWLock() : root_latch_.TryRLock())
+    return;
+  auto start = std::chrono::steady_clock::now();
+  exclusive ? root_latch_.WLock() : root_latch_.RLock();
+  RecordLatchWait(start);
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+void BPLUSTREE_TYPE::LatchWriter() {
+  if (!metrics_.IsEnabled()) {
+    writer_latch_.lock();
+    return;
+  }
+  if (writer_latch_.try_lock())
+    return;
+  auto start = std::chrono::steady_clock::now();
+  writer_latch_.lock();
+  RecordLatchWait(start);
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+void BPLUSTREE_TYPE::RecordLatchWait(
+    std::chrono::steady_clock::time_point start) {
+  auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(
+      std::chrono::steady_clock::now() - start);
+  metrics_.latch_waits++;
+  metrics_.latch_wait_ns += elapsed.count();
+}
+
 /*
  * This method is used for debug only
  * print out whole b+tree sturcture, rank by rank
@@ -516,6 +1121,7 @@ void BPLUSTREE_TYPE::RemoveFromFile(const std::string &file_name,
 
 INDEX_TEMPLATE_ARGUMENTS
 Page *BPLUSTREE_TYPE::FetchPage(page_id_t page_id) {
+  IndexMetrics::CountPage();
   auto ptr = buffer_pool_manager_->FetchPage(page_id);
   if (ptr == nullptr)
     throw std::runtime_error("fail to fetch page");
@@ -524,6 +1130,7 @@ Page *BPLUSTREE_TYPE::FetchPage(page_id_t page_id) {
 
 INDEX_TEMPLATE_ARGUMENTS
 Page *BPLUSTREE_TYPE::NewPage(page_id_t &page_id) {
+  IndexMetrics::CountPage();
   auto ptr = buffer_pool_manager_->NewPage(page_id);
   if (ptr == nullptr)
     throw std::runtime_error("run out of memory");
@@ -2,19 +2,35 @@
  * b_plus_tree_index.cpp
  */
 
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <queue>
+#include <thread>
+
+#include "catalog/catalog_cache.h"
+#include "common/hyperloglog.h"
 #include "index/b_plus_tree_index.h"
+#include "page/header_page.h"
+#include "table/table_heap.h"
 
 namespace cmudb {
+// number of buckets in the key histogram
+static const int STATISTICS_BUCKET_COUNT = 32;
+
 /*
  * Constructor
  */
 INDEX_TEMPLATE_ARGUMENTS
 BPLUSTREE_INDEX_TYPE::BPlusTreeIndex(IndexMetadata *metadata,
                                      BufferPoolManager *buffer_pool_manager,
-                                     page_id_t root_page_id)
+                                     page_id_t root_page_id,
+                                     CatalogCache *catalog_cache)
     : Index(metadata), comparator_(metadata->GetKeySchema()),
       container_(metadata->GetName(), buffer_pool_manager, comparator_,
-                 root_page_id) {}
+                 root_page_id, catalog_cache),
+      buffer_pool_manager_(buffer_pool_manager),
+      catalog_cache_(catalog_cache) {}
 
 INDEX_TEMPLATE_ARGUMENTS
 void BPLUSTREE_INDEX_TYPE::InsertEntry(const Tuple &key, RID rid,
@@ -45,6 +61,262 @@ void BPLUSTREE_INDEX_TYPE::ScanKey(const Tuple &key, std::vector<RID> &result,
 
   container_.GetValue(index_key, result, transaction);
 }
+
+INDEX_TEMPLATE_ARGUMENTS
+void BPLUSTREE_INDEX_TYPE::ScanKey(const Tuple &key, std::vector<RID> &result,
+                                   std::vector<Tuple> &entries,
+                                   Transaction *transaction) {
+  // construct scan index key
+  KeyType index_key;
+  index_key.SetFromKey(key);
+
+  MappingType entry;
+  if (!container_.GetEntry(index_key, entry, transaction))
+    return;
+  result.push_back(entry.second);
+  // the stored key carries the included columns
+  Schema *entry_schema = GetEntrySchema();
+  std::vector<Value> values;
+  for (int i = 0; i < entry_schema->GetColumnCount(); i++)
+    values.push_back(entry.first.ToValue(entry_schema, i));
+  entries.emplace_back(values, entry_schema);
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+void BPLUSTREE_INDEX_TYPE::ScanKeys(const std::vector<Tuple> &keys,
+                                    std::vector<RID> &result,
+                                    Transaction *transaction) {
+  // construct scan index keys, sorted so that the tree can share traversals
+  std::vector<KeyType> index_keys(keys.size());
+  for (size_t i = 0; i < keys.size(); i++)
+    index_keys[i].SetFromKey(keys[i]);
+  std::sort(index_keys.begin(), index_keys.end(),
+            [this](const KeyType &lhs, const KeyType &rhs) {
+              return comparator_(lhs, rhs) < 0;
+            });
+
+  container_.GetValues(index_keys, result, transaction);
+}
+/*
+ * Parallel index build: every scan thread extracts and sorts its own run of
+ * key & rid pairs, the sorted runs are then k-way merged straight into the
+ * bottom-up bulk loader. An index that already holds entries falls back to
+ * inserting the merged entries one by one.
+ */
+INDEX_TEMPLATE_ARGUMENTS
+bool BPLUSTREE_INDEX_TYPE::BuildIndex(TableHeap *table_heap,
+                                      Schema *table_schema, int num_threads,
+                                      Transaction *transaction) {
+  num_threads = std::max(num_threads, 1);
+  std::vector<std::vector<MappingType>> runs(num_threads);
+  Schema *entry_schema = GetEntrySchema();
+  const std::vector<int> &entry_attrs = GetEntryAttrs();
+  // a bulk loaded or attached table may hold entries the key cannot
+  std::atomic<bool> is_too_large{false};
+  bool is_scanned = table_heap->ParallelScan(
+      num_threads,
+      [&](int thread_id, const Tuple &tuple) {
+        std::vector<Value> key_values;
+        for (auto &i : entry_attrs)
+          key_values.push_back(table_heap->GetValue(tuple, table_schema, i));
+        Tuple key(key_values, entry_schema);
+        if (static_cast<size_t>(key.GetLength()) > sizeof(KeyType)) {
+          is_too_large = true;
+          return;
+        }
+        KeyType index_key;
+        index_key.SetFromKey(key);
+        runs[thread_id].emplace_back(index_key, tuple.GetRid());
+      },
+      transaction);
+  if (!is_scanned || is_too_large)
+    return false;
+
+  auto less = [this](const MappingType &lhs, const MappingType &rhs) {
+    return comparator_(lhs.first, rhs.first) < 0;
+  };
+  std::vector<std::thread> threads;
+  for (int i = 1; i < num_threads; i++)
+    threads.emplace_back(
+        [&, i] { std::sort(runs[i].begin(), runs[i].end(), less); });
+  std::sort(runs[0].begin(), runs[0].end(), less);
+  for (auto &thread : threads)
+    thread.join();
+
+  // k-way merge, the heap holds the run index of every unfinished run
+  std::vector<size_t> positions(num_threads, 0);
+  auto greater = [&](int lhs, int rhs) {
+    return less(runs[rhs][positions[rhs]], runs[lhs][positions[lhs]]);
+  };
+  std::priority_queue<int, std::vector<int>, decltype(greater)> heap(greater);
+  for (int i = 0; i < num_threads; i++)
+    if (!runs[i].empty())
+      heap.push(i);
+  auto next = [&](KeyType &key, ValueType &value) {
+    if (heap.empty())
+      return false;
+    int run = heap.top();
+    heap.pop();
+    key = runs[run][positions[run]].first;
+    value = runs[run][positions[run]].second;
+    if (++positions[run] < runs[run].size())
+      heap.push(run);
+    return true;
+  };
+
+  if (!container_.IsEmpty()) {
+    KeyType key;
+    ValueType value;
+    while (next(key, value))
+      container_.Insert(key, value, transaction);
+    return true;
+  }
+  return container_.BulkLoad(next, 1.0, transaction);
+}
+
+/*
+ * Statistics are collected from a systematic sample of the leaves. Distinct
+ * values of the first key column are counted with a HyperLogLog sketch and
+ * scaled up to the whole tree, the sampled values of a numeric first column
+ * (already in ascending order) make up the equi-depth histogram. The result
+ * is kept in a page of its own, recorded in the header page under
+ * GetStatisticsRecordName().
+ */
+INDEX_TEMPLATE_ARGUMENTS
+void BPLUSTREE_INDEX_TYPE::UpdateStatistics(double sample_rate,
+                                            Transaction *transaction) {
+  Schema *key_schema = GetKeySchema();
+  const TypeId type = key_schema->GetType(0);
+  const bool is_numeric = type >= TypeId::TINYINT && type <= TypeId::DECIMAL;
+  const bool is_inlined = key_schema->IsInlined(0);
+  const uint32_t offset = key_schema->GetOffset(0);
+  const uint32_t length = key_schema->GetLength(0);
+  HyperLogLog sketch;
+  std::vector<double> values;
+
+  IndexStatistics *statistics = new IndexStatistics();
+  int64_t sampled = container_.CollectStatistics(
+      *statistics, sample_rate, [&](const KeyType &key) {
+        if (is_inlined) {
+          sketch.AddBytes(key.data + offset, length);
+        } else {
+          Value value = key.ToValue(key_schema, 0);
+          sketch.AddBytes(value.GetData(), value.GetLength());
+        }
+        if (is_numeric) {
+          Value value = key.ToValue(key_schema, 0).CastAs(TypeId::DECIMAL);
+          values.push_back(value.GetAs<double>());
+        }
+      });
+  if (key_schema->GetColumnCount() == 1) {
+    // unique keys
+    statistics->distinct_count = statistics->entry_count;
+  } else if (sampled != 0) {
+    double distinct = sketch.Estimate() * statistics->entry_count / sampled;
+    statistics->distinct_count = std::max<int64_t>(
+        1, std::min<int64_t>(std::llround(distinct), statistics->entry_count));
+  }
+  statistics->BuildHistogram(values, STATISTICS_BUCKET_COUNT);
+  delete statistics_;
+  statistics_ = statistics;
+
+  // persist in the catalog
+  std::string name = GetStatisticsRecordName();
+  page_id_t page_id;
+  Page *page = nullptr;
+  bool is_new = !GetCatalogRecord(name, page_id);
+  if (is_new)
+    page = buffer_pool_manager_->NewPage(page_id);
+  else
+    page = buffer_pool_manager_->FetchPage(page_id);
+  if (page == nullptr)
+    return;
+  // never overwrite a page the record does not point at as statistics
+  if (!is_new && !IndexStatistics::IsSerialized(page->GetData())) {
+    buffer_pool_manager_->UnpinPage(page_id, false);
+    return;
+  }
+  statistics->SerializeTo(page->GetData());
+  buffer_pool_manager_->UnpinPage(page_id, true);
+  if (is_new)
+    SetCatalogRecord(name, page_id);
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+const IndexStatistics *BPLUSTREE_INDEX_TYPE::GetStatistics() {
+  if (statistics_ != nullptr)
+    return statistics_;
+  page_id_t page_id;
+  if (!GetCatalogRecord(GetStatisticsRecordName(), page_id))
+    return nullptr;
+  Page *page = buffer_pool_manager_->FetchPage(page_id);
+  if (page == nullptr)
+    return nullptr;
+  IndexStatistics *statistics = new IndexStatistics();
+  if (statistics->DeserializeFrom(page->GetData()))
+    statistics_ = statistics;
+  else
+    delete statistics;
+  buffer_pool_manager_->UnpinPage(page_id, false);
+  return statistics_;
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+IndexMetrics *BPLUSTREE_INDEX_TYPE::GetMetrics() {
+  return &container_.GetMetrics();
+}
+
+/*
+ * "__stats_<index name>", unless that does not fit a header page record: long
+ * index names are replaced by a hash of the name, "__stats_<16 hex digits>".
+ * Tables and indexes can't be named with the prefix
+ */
+INDEX_TEMPLATE_ARGUMENTS
+std::string BPLUSTREE_INDEX_TYPE::GetStatisticsRecordName() {
+  std::string name = STATISTICS_RECORD_PREFIX + GetName();
+  if (name.length() < 32)
+    return name;
+  char hash[17];
+  snprintf(hash, sizeof(hash), "%016llx",
+           static_cast<unsigned long long>(
+               HyperLogLog::Hash(GetName().data(), GetName().length())));
+  return STATISTICS_RECORD_PREFIX + std::string(hash);
+}
+
+/*
+ * Catalog records go through the catalog cache when there is one, otherwise
+ * straight to the header page
+ */
+INDEX_TEMPLATE_ARGUMENTS
+bool BPLUSTREE_INDEX_TYPE::GetCatalogRecord(const std::string &name,
+                                            page_id_t &page_id) {
+  if (catalog_cache_ != nullptr)
+    return catalog_cache_->GetRootId(name, page_id);
+  HeaderPage *header_page = static_cast<HeaderPage *>(
+      buffer_pool_manager_->FetchPage(HEADER_PAGE_ID));
+  if (header_page == nullptr)
+    return false;
+  bool found = header_page->GetRootId(name, page_id);
+  buffer_pool_manager_->UnpinPage(HEADER_PAGE_ID, false);
+  return found;
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+void BPLUSTREE_INDEX_TYPE::SetCatalogRecord(const std::string &name,
+                                            page_id_t page_id) {
+  if (catalog_cache_ != nullptr) {
+    catalog_cache_->SetRootId(name, page_id);
+    return;
+  }
+  HeaderPage *header_page = static_cast<HeaderPage *>(
+      buffer_pool_manager_->FetchPage(HEADER_PAGE_ID));
+  if (header_page == nullptr)
+    return;
+  if (!header_page->UpdateRecord(name, page_id))
+    header_page->InsertRecord(name, page_id);
+  buffer_pool_manager_->UnpinPage(HEADER_PAGE_ID, true);
+}
+
 template class BPlusTreeIndex<GenericKey<4>, RID, GenericComparator<4>>;
 template class BPlusTreeIndex<GenericKey<8>, RID, GenericComparator<8>>;
 template class BPlusTreeIndex<GenericKey<16>, RID, GenericComparator<16>>;
@@ -1,22 +1,68 @@
 /**
  * index_iterator.cpp
  */
+#include <algorithm>
 #include <cassert>
 
 #include "index/index_iterator.h"
 
 namespace cmudb {
 
+namespace {
+// holds latch (if any) for reading until the end of the scope
+class ReadLatchGuard {
+public:
+  explicit ReadLatchGuard(RWMutex *latch) : latch_(latch) {
+    if (latch_ != nullptr)
+      latch_->RLock();
+  }
+  ~ReadLatchGuard() {
+    if (latch_ != nullptr)
+      latch_->RUnlock();
+  }
+
+private:
+  RWMutex *latch_;
+};
+} // namespace
+
 /*
  * NOTE: you can change the destructor/constructor method here
  * set your own input parameters
  */
 INDEX_TEMPLATE_ARGUMENTS
-INDEXITERATOR_TYPE::IndexIterator(B_PLUS_TREE_LEAF_PAGE_TYPE* current_leaf,BufferPoolManager* buffer_pool_manager,int index):
-current_leaf_(current_leaf),index_(index),buffer_pool_manager_(buffer_pool_manager),is_end_(false) {}
+INDEXITERATOR_TYPE::IndexIterator(B_PLUS_TREE_LEAF_PAGE_TYPE* current_leaf,BufferPoolManager* buffer_pool_manager,int index,
+                                  EpochManager *epoch_manager, uint64_t epoch,
+                                  RWMutex *latch):
+current_leaf_(current_leaf),index_(index),buffer_pool_manager_(buffer_pool_manager),is_end_(false),
+epoch_manager_(epoch_manager),epoch_(epoch),latch_(latch) {
+  CopyLeaf();
+  // index is -1 (or past the end) if every key of the leaf is smaller
+  if (index_ < 0 || index_ >= (int)entries_.size())
+    NextLeaf();
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+INDEXITERATOR_TYPE::IndexIterator(IndexIterator &&other)
+    : current_leaf_(other.current_leaf_), index_(other.index_),
+      buffer_pool_manager_(other.buffer_pool_manager_),
+      is_end_(other.is_end_), epoch_manager_(other.epoch_manager_),
+      epoch_(other.epoch_), latch_(other.latch_),
+      entries_(std::move(other.entries_)) {
+  other.current_leaf_ = nullptr;
+  other.epoch_manager_ = nullptr;
+}
 
+/*
+ * Unpin the current leaf and leave the epoch entered by BPlusTree::Begin()
+ */
 INDEX_TEMPLATE_ARGUMENTS
-INDEXITERATOR_TYPE::~IndexIterator() {}
+INDEXITERATOR_TYPE::~IndexIterator() {
+  if (current_leaf_ != nullptr)
+    buffer_pool_manager_->UnpinPage(current_leaf_->GetPageId(), false);
+  if (epoch_manager_ != nullptr)
+    epoch_manager_->Leave(epoch_);
+}
 
 template <typename KeyType, typename ValueType, typename KeyComparator>
 bool IndexIterator<KeyType, ValueType, KeyComparator>::isEnd() {
@@ -25,22 +71,49 @@ bool IndexIterator<KeyType, ValueType, KeyComparator>::isEnd() {
 
 template <typename KeyType, typename ValueType, typename KeyComparator>
 IndexIterator<KeyType,ValueType,KeyComparator> &IndexIterator<KeyType, ValueType, KeyComparator>::operator++() {
-  if (index_ < current_leaf_->GetSize()-1) index_++;
-  else if (current_leaf_->GetNextPageId() == INVALID_PAGE_ID) is_end_ = true;
-  else {
-    auto next_page = buffer_pool_manager_->FetchPage(current_leaf_->GetNextPageId());
+  if (index_ < (int)entries_.size()-1) {
+    index_++;
+    return *this;
+  }
+  ReadLatchGuard guard(latch_);
+  NextLeaf();
+  return *this;
+}
+template <typename KeyType, typename ValueType, typename KeyComparator>
+const pair<KeyType, ValueType> &
+    IndexIterator<KeyType, ValueType, KeyComparator>::operator*() {
+  return entries_[index_];
+}
+
+/*
+ * Called with the latch held, a leaf emptied by a merge keeps its next page id
+ * and is skipped
+ */
+INDEX_TEMPLATE_ARGUMENTS
+void INDEXITERATOR_TYPE::NextLeaf() {
+  while (true) {
+    page_id_t next_page_id = current_leaf_->GetNextPageId();
+    if (next_page_id == INVALID_PAGE_ID) {
+      is_end_ = true;
+      return;
+    }
+    auto next_page = buffer_pool_manager_->FetchPage(next_page_id);
     if (next_page == nullptr) throw std::runtime_error("fail to fetch page");
     // unpin the last page
     buffer_pool_manager_->UnpinPage(current_leaf_->GetPageId(),false);
     current_leaf_ = reinterpret_cast<decltype(current_leaf_)> (next_page->GetData());
     index_ = 0;
+    CopyLeaf();
+    if (!entries_.empty())
+      return;
   }
-  return *this;
 }
-template <typename KeyType, typename ValueType, typename KeyComparator>
-const pair<KeyType, ValueType> &
-    IndexIterator<KeyType, ValueType, KeyComparator>::operator*() {
-  return current_leaf_->GetItem(index_);
+
+INDEX_TEMPLATE_ARGUMENTS
+void INDEXITERATOR_TYPE::CopyLeaf() {
+  int size = std::min(current_leaf_->GetSize(), current_leaf_->GetMaxSize());
+  entries_.resize(std::max(size, 0));
+  current_leaf_->DecodeAll(entries_.data(), entries_.size());
 }
 
 template class IndexIterator<GenericKey<4>, RID, GenericComparator<4>>;
@@ -0,0 +1,95 @@
+/**
+ * index_metrics.cpp
+ */
+
+#include <sstream>
+
+#include "index/index_metrics.h"
+
+namespace cmudb {
+
+thread_local uint64_t IndexMetrics::pages_fetched_ = 0;
+
+void Log2Histogram::Record(uint64_t value) {
+  int bucket = value == 0 ? 0 : 64 - __builtin_clzll(value);
+  if (bucket >= BUCKET_COUNT)
+    bucket = BUCKET_COUNT - 1;
+  buckets_[bucket].fetch_add(1, std::memory_order_relaxed);
+  count_.fetch_add(1, std::memory_order_relaxed);
+  sum_.fetch_add(value, std::memory_order_relaxed);
+}
+
+void Log2Histogram::Reset() {
+  for (auto &bucket : buckets_)
+    bucket = 0;
+  count_ = 0;
+  sum_ = 0;
+}
+
+double Log2Histogram::GetMean() const {
+  uint64_t count = GetCount();
+  return count == 0 ? 0 : static_cast<double>(sum_) / count;
+}
+
+uint64_t Log2Histogram::GetPercentile(double percentile) const {
+  uint64_t count = GetCount();
+  if (count == 0)
+    return 0;
+  uint64_t rank = static_cast<uint64_t>(count * percentile / 100);
+  if (rank >= count)
+    rank = count - 1;
+  uint64_t seen = 0;
+  for (int i = 0; i < BUCKET_COUNT; i++) {
+    seen += buckets_[i].load(std::memory_order_relaxed);
+    if (seen > rank)
+      return i == 0 ? 0 : (1ULL << i) - 1;
+  }
+  return (1ULL << (BUCKET_COUNT - 1)) - 1;
+}
+
+std::string Log2Histogram::ToString() const {
+  std::ostringstream os;
+  os << "count: " << GetCount() << " mean: " << GetMean()
+     << " p50: " << GetPercentile(50) << " p99: " << GetPercentile(99)
+     << " max: " << GetPercentile(100);
+  return os.str();
+}
+
+void IndexMetrics::Reset() {
+  lookups = 0;
+  inserts = 0;
+  removes = 0;
+  descents = 0;
+  pages_touched = 0;
+  splits = 0;
+  merges = 0;
+  redistributions = 0;
+  root_changes = 0;
+  latch_waits = 0;
+  latch_wait_ns = 0;
+  lookup_latency.Reset();
+  insert_latency.Reset();
+  remove_latency.Reset();
+  pages_per_operation.Reset();
+}
+
+std::string IndexMetrics::ToString() const {
+  std::ostringstream os;
+  os << "enabled: " << IsEnabled() << "\n"
+     << "lookups: " << lookups << " inserts: " << inserts
+     << " removes: " << removes << "\n"
+     << "descents: " << descents << " pages touched: " << pages_touched
+     << "\n"
+     << "splits: " << splits << " merges: " << merges
+     << " redistributions: " << redistributions
+     << " root changes: " << root_changes << "\n"
+     << "latch waits: " << latch_waits << " latch wait ns: " << latch_wait_ns
+     << "\n"
+     << "lookup latency ns: " << lookup_latency.ToString() << "\n"
+     << "insert latency ns: " << insert_latency.ToString() << "\n"
+     << "remove latency ns: " << remove_latency.ToString() << "\n"
+     << "pages per operation: " << pages_per_operation.ToString();
+  return os.str();
+}
+
+} // namespace cmudb
@@ -0,0 +1,120 @@
+/**
+ * index_statistics.cpp
+ */
+
+#include <algorithm>
+#include <cstring>
+#include <sstream>
+
+#include "index/index_statistics.h"
+
+namespace cmudb {
+
+static const uint32_t STATISTICS_MAGIC = 0x49535431; // "IST1"
+
+double IndexStatistics::EstimateEqualRows() const {
+  if (entry_count == 0)
+    return 0;
+  return static_cast<double>(entry_count) / std::max<int64_t>(distinct_count, 1);
+}
+
+/*
+ * Every bucket holds entry_count / bucket_count entries, spread uniformly
+ * between its bounds. Without a histogram fall back to a third of the entries.
+ */
+double IndexStatistics::EstimateRangeRows(double low, double high) const {
+  if (entry_count == 0 || low > high)
+    return 0;
+  if (bounds.size() < 2)
+    return entry_count / 3.0;
+  int bucket_count = bounds.size() - 1;
+  double covered = 0;
+  for (int i = 0; i < bucket_count; i++) {
+    double lower = bounds[i], upper = bounds[i + 1];
+    if (high < lower || low > upper)
+      continue;
+    if (upper == lower) {
+      covered += 1;
+      continue;
+    }
+    double from = std::max(low, lower), to = std::min(high, upper);
+    covered += (to - from) / (upper - lower);
+  }
+  return entry_count * covered / bucket_count;
+}
+
+void IndexStatistics::BuildHistogram(const std::vector<double> &values,
+                                     int bucket_count) {
+  bounds.clear();
+  if (values.empty())
+    return;
+  int n = values.size();
+  bucket_count = std::max(1, std::min(bucket_count, n));
+  for (int i = 0; i <= bucket_count; i++)
+    bounds.push_back(values[static_cast<int64_t>(i) * (n - 1) / bucket_count]);
+}
+
+int IndexStatistics::GetSerializedSize() const {
+  return 12 + 4 * height + 32 + 4 + 8 * bounds.size();
+}
+
+void IndexStatistics::SerializeTo(char *storage) const {
+  int offset = 0;
+  auto write = [&](const void *src, size_t size) {
+    memcpy(storage + offset, src, size);
+    offset += size;
+  };
+  int32_t bound_count = bounds.size();
+  write(&STATISTICS_MAGIC, 4);
+  write(&height, 4);
+  write(level_pages.data(), 4 * height);
+  write(&leaf_fill, 8);
+  write(&internal_fill, 8);
+  write(&entry_count, 8);
+  write(&distinct_count, 8);
+  write(&bound_count, 4);
+  write(bounds.data(), 8 * bound_count);
+}
+
+bool IndexStatistics::IsSerialized(const char *storage) {
+  uint32_t magic;
+  memcpy(&magic, storage, 4);
+  return magic == STATISTICS_MAGIC;
+}
+
+bool IndexStatistics::DeserializeFrom(const char *storage) {
+  int offset = 0;
+  auto read = [&](void *dest, size_t size) {
+    memcpy(dest, storage + offset, size);
+    offset += size;
+  };
+  uint32_t magic;
+  read(&magic, 4);
+  if (magic != STATISTICS_MAGIC)
+    return false;
+  read(&height, 4);
+  level_pages.resize(height);
+  read(level_pages.data(), 4 * height);
+  read(&leaf_fill, 8);
+  read(&internal_fill, 8);
+  read(&entry_count, 8);
+  read(&distinct_count, 8);
+  int32_t bound_count;
+  read(&bound_count, 4);
+  bounds.resize(bound_count);
+  read(bounds.data(), 8 * bound_count);
+  return true;
+}
+
+std::string IndexStatistics::ToString() const {
+  std::ostringstream os;
+  os << "height: " << height << " pages:";
+  for (auto pages : level_pages)
+    os << " " << pages;
+  os << " leaf fill: " << leaf_fill << " internal fill: " << internal_fill
+     << " entries: " << entry_count << " distinct: " << distinct_count
+     << " buckets: " << (bounds.empty() ? 0 : bounds.size() - 1);
+  return os.str();
+}
+
+} // namespace cmudb
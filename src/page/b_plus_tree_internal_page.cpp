@@ -217,8 +217,9 @@ INDEX_TEMPLATE_ARGUMENTS
 void B_PLUS_TREE_INTERNAL_PAGE_TYPE::CopyAllFrom(
     MappingType *items, int size, BufferPoolManager *buffer_pool_manager) {
   page_id_t page_id = GetPageId();
+  int this_size = GetSize();
   for (int i = 0; i < size; i++) {
-    array[size + i] = items[i];
+    array[this_size + i] = items[i];
     auto page = buffer_pool_manager->FetchPage(items[i].second);
     if (page == nullptr)
       throw std::runtime_error("fail to fetch page");
@@ -226,7 +227,7 @@ void B_PLUS_TREE_INTERNAL_PAGE_TYPE::CopyAllFrom(
     node->SetParentPageId(page_id);
     buffer_pool_manager->UnpinPage(node->GetPageId(), true);
   }
-  SetSize(GetSize() + size);
+  SetSize(this_size + size);
 }
 
 /*****************************************************************************
@@ -300,7 +301,7 @@ void B_PLUS_TREE_INTERNAL_PAGE_TYPE::CopyFirstFrom(
   array[1].first = parent->KeyAt(parent_index);
   SetSize(size + 1);
   parent->SetKeyAt(parent_index, pair.first);
-  buffer_pool_manager->UnpinPage(parent->GetParentPageId(), true);
+  buffer_pool_manager->UnpinPage(parent->GetPageId(), true);
   // update parent for the moved child
   auto page = buffer_pool_manager->FetchPage(pair.second);
   if (page == nullptr)
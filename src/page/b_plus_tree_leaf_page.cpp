@@ -43,16 +43,20 @@ void B_PLUS_TREE_LEAF_PAGE_TYPE::SetNextPageId(page_id_t next_page_id) { next_pa
 
 /**
  * Helper method to find the first index i so that array[i].first >= key
- * NOTE: This method is only used when generating index iterator
+ * (binary search), -1 if every key is smaller
  */
 INDEX_TEMPLATE_ARGUMENTS
 int B_PLUS_TREE_LEAF_PAGE_TYPE::KeyIndex(
     const KeyType &key, const KeyComparator &comparator) const {
-  int size = this->GetSize();
-  for (int i = 0; i < size; i++) {
-  	if (comparator(array[i].first,key) >= 0) return i;
+  int low = 0, high = this->GetSize();
+  while (low < high) {
+    int mid = low + (high - low) / 2;
+    if (comparator(KeyAt(mid), key) < 0)
+      low = mid + 1;
+    else
+      high = mid;
   }
-  return -1;
+  return low == this->GetSize() ? -1 : low;
 }
 
 /*
@@ -61,7 +65,8 @@ int B_PLUS_TREE_LEAF_PAGE_TYPE::KeyIndex(
  */
 INDEX_TEMPLATE_ARGUMENTS
 KeyType B_PLUS_TREE_LEAF_PAGE_TYPE::KeyAt(int index) const {
-  // replace with your own code
+  if (IsCompressedLeafPage())
+    return DecodeKey(GetKeyBase() + GetKeyDeltas()[index]);
   return array[index].first;
 }
 
@@ -76,6 +81,17 @@ const MappingType &B_PLUS_TREE_LEAF_PAGE_TYPE::GetItem(int index) {
   return array[index];
 }
 
+INDEX_TEMPLATE_ARGUMENTS
+MappingType B_PLUS_TREE_LEAF_PAGE_TYPE::ItemAt(int index) const {
+  if (index < 0 || index >= GetSize()) throw std::runtime_error("out of range");
+  if (!IsCompressedLeafPage())
+    return array[index];
+  uint32_t packed = GetPackedRids()[index];
+  return std::make_pair(KeyAt(index),
+                        RID(GetPageBase() + static_cast<page_id_t>(packed >> 16),
+                            static_cast<int>(packed & 0xFFFF)));
+}
+
 /*****************************************************************************
  * INSERTION
  *****************************************************************************/
@@ -93,7 +109,8 @@ int B_PLUS_TREE_LEAF_PAGE_TYPE::Insert(const KeyType &key,
   	return this->GetSize();
   }
   int index = KeyIndex(key,comparator);
-  if (comparator(array[index].first,key) == 0) return this->GetSize();
+  if (index != -1 && comparator(array[index].first,key) == 0)
+    return this->GetSize();
 
   int size = this->GetSize();
   if (index == -1) {
@@ -144,8 +161,8 @@ INDEX_TEMPLATE_ARGUMENTS
 bool B_PLUS_TREE_LEAF_PAGE_TYPE::Lookup(const KeyType &key, ValueType &value,
                                         const KeyComparator &comparator) const {
   int index = KeyIndex(key,comparator);
-  if (comparator(array[index].first,key) == 0) {
-  	value = array[index].second;
+  if (index != -1 && comparator(KeyAt(index),key) == 0) {
+  	value = ItemAt(index).second;
   	return true;
   }
   return false;
@@ -164,7 +181,7 @@ INDEX_TEMPLATE_ARGUMENTS
 int B_PLUS_TREE_LEAF_PAGE_TYPE::RemoveAndDeleteRecord(
     const KeyType &key, const KeyComparator &comparator) {
 	int index = this->KeyIndex(key,comparator);
-	if (comparator(array[index].first,key) == 0) {
+	if (index != -1 && comparator(array[index].first,key) == 0) {
 		// exist
 		int size = GetSize();
 		for (int i = index+1;i < size; i++) {
@@ -259,6 +276,154 @@ void B_PLUS_TREE_LEAF_PAGE_TYPE::CopyFirstFrom(
 	SetSize(size+1);
 }
 
+/*****************************************************************************
+ * COMPRESSION
+ *****************************************************************************/
+/*
+ * Capacity of a compressed leaf, at most twice the uncompressed capacity so
+ * that an expanded leaf always fits into two pages
+ */
+INDEX_TEMPLATE_ARGUMENTS
+int B_PLUS_TREE_LEAF_PAGE_TYPE::GetCompressedMaxSize() {
+  int max_size = (PAGE_SIZE - sizeof(BPlusTreeLeafPage)) / sizeof(MappingType);
+  int compressed_max_size =
+      (PAGE_SIZE - sizeof(BPlusTreeLeafPage) - COMPRESSED_HEADER_SIZE) /
+      (2 * sizeof(uint32_t));
+  return std::min(compressed_max_size, 2 * max_size);
+}
+
+/*
+ * Items can be compressed if every key is an integer in its first 8 bytes
+ * within 2^32 above the first key (modulo 2^64), and every rid lies within 2^16
+ * pages above the smallest page id with a slot number below 2^16
+ */
+INDEX_TEMPLATE_ARGUMENTS
+bool B_PLUS_TREE_LEAF_PAGE_TYPE::CanCompress(const MappingType *items,
+                                             int size) {
+  if (size == 0 || size > GetCompressedMaxSize())
+    return false;
+  uint64_t key_base = EncodeKey(items[0].first);
+  page_id_t page_base = items[0].second.GetPageId();
+  for (int i = 0; i < size; i++) {
+    KeyType decoded = DecodeKey(EncodeKey(items[i].first));
+    if (memcmp(decoded.data, items[i].first.data, sizeof(KeyType)) != 0)
+      return false;
+    uint64_t delta = EncodeKey(items[i].first) - key_base;
+    if (delta > UINT32_MAX)
+      return false;
+    page_base = std::min(page_base, items[i].second.GetPageId());
+  }
+  for (int i = 0; i < size; i++) {
+    int64_t page_delta =
+        static_cast<int64_t>(items[i].second.GetPageId()) - page_base;
+    int slot = items[i].second.GetSlotNum();
+    if (page_delta > 0xFFFF || slot < 0 || slot > 0xFFFF)
+      return false;
+  }
+  return true;
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+void B_PLUS_TREE_LEAF_PAGE_TYPE::CompressFrom(const MappingType *items,
+                                              int size) {
+  assert(GetSize() == 0 && CanCompress(items, size));
+  SetPageType(IndexPageType::COMPRESSED_LEAF_PAGE);
+  SetMaxSize(GetCompressedMaxSize());
+  char *data = reinterpret_cast<char *>(array);
+  uint64_t key_base = EncodeKey(items[0].first);
+  page_id_t page_base = items[0].second.GetPageId();
+  for (int i = 1; i < size; i++)
+    page_base = std::min(page_base, items[i].second.GetPageId());
+  memcpy(data, &key_base, sizeof(uint64_t));
+  memcpy(data + sizeof(uint64_t), &page_base, sizeof(page_id_t));
+  uint32_t *key_deltas =
+      reinterpret_cast<uint32_t *>(data + COMPRESSED_HEADER_SIZE);
+  uint32_t *packed_rids = key_deltas + GetMaxSize();
+  for (int i = 0; i < size; i++) {
+    key_deltas[i] = static_cast<uint32_t>(EncodeKey(items[i].first) - key_base);
+    packed_rids[i] = static_cast<uint32_t>(items[i].second.GetPageId() -
+                                           page_base) << 16 |
+                     static_cast<uint32_t>(items[i].second.GetSlotNum());
+  }
+  SetSize(size);
+}
+
+/*
+ * Decode keys and rids in two passes over the separate arrays, the loops
+ * carry no dependency between iterations
+ */
+INDEX_TEMPLATE_ARGUMENTS
+void B_PLUS_TREE_LEAF_PAGE_TYPE::DecodeAll(MappingType *items,
+                                           int size) const {
+  if (!IsCompressedLeafPage()) {
+    std::copy(array, array + size, items);
+    return;
+  }
+  const uint64_t key_base = GetKeyBase();
+  const page_id_t page_base = GetPageBase();
+  const uint32_t *key_deltas = GetKeyDeltas();
+  const uint32_t *packed_rids = GetPackedRids();
+  for (int i = 0; i < size; i++)
+    items[i].first = DecodeKey(key_base + key_deltas[i]);
+  for (int i = 0; i < size; i++)
+    items[i].second.Set(page_base + static_cast<page_id_t>(packed_rids[i] >> 16),
+                        static_cast<int>(packed_rids[i] & 0xFFFF));
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+void B_PLUS_TREE_LEAF_PAGE_TYPE::Expand(std::vector<MappingType> &items) {
+  items.resize(GetSize());
+  DecodeAll(items.data(), GetSize());
+  page_id_t next_page_id = GetNextPageId();
+  Init(GetPageId(), GetParentPageId());
+  SetNextPageId(next_page_id);
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+uint64_t B_PLUS_TREE_LEAF_PAGE_TYPE::GetKeyBase() const {
+  uint64_t key_base;
+  memcpy(&key_base, reinterpret_cast<const char *>(array), sizeof(uint64_t));
+  return key_base;
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+page_id_t B_PLUS_TREE_LEAF_PAGE_TYPE::GetPageBase() const {
+  page_id_t page_base;
+  memcpy(&page_base, reinterpret_cast<const char *>(array) + sizeof(uint64_t),
+         sizeof(page_id_t));
+  return page_base;
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+const uint32_t *B_PLUS_TREE_LEAF_PAGE_TYPE::GetKeyDeltas() const {
+  return reinterpret_cast<const uint32_t *>(
+      reinterpret_cast<const char *>(array) + COMPRESSED_HEADER_SIZE);
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+const uint32_t *B_PLUS_TREE_LEAF_PAGE_TYPE::GetPackedRids() const {
+  return GetKeyDeltas() + GetMaxSize();
+}
+
+/*
+ * The first (up to) 8 bytes of the key as an integer. Decoding gives the
+ * same key back only if every other byte is zero
+ */
+INDEX_TEMPLATE_ARGUMENTS
+uint64_t B_PLUS_TREE_LEAF_PAGE_TYPE::EncodeKey(const KeyType &key) {
+  uint64_t value = 0;
+  memcpy(&value, key.data, std::min(sizeof(uint64_t), sizeof(KeyType)));
+  return value;
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+KeyType B_PLUS_TREE_LEAF_PAGE_TYPE::DecodeKey(uint64_t value) {
+  KeyType key;
+  memset(key.data, 0, sizeof(KeyType));
+  memcpy(key.data, &value, std::min(sizeof(uint64_t), sizeof(KeyType)));
+  return key;
+}
+
 /*****************************************************************************
  * DEBUG
  *****************************************************************************/
@@ -282,9 +447,9 @@ std::string B_PLUS_TREE_LEAF_PAGE_TYPE::ToString(bool verbose) const {
     } else {
       stream << " ";
     }
-    stream << std::dec << array[entry].first;
+    stream << std::dec << KeyAt(entry);
     if (verbose) {
-      stream << "(" << array[entry].second << ")";
+      stream << "(" << ItemAt(entry).second << ")";
     }
     ++entry;
   }
@@ -73,6 +73,15 @@ bool HeaderPage::GetRootId(const std::string &name, page_id_t &root_id) {
   return true;
 }
 
+bool HeaderPage::GetRecord(int index, std::string &name, page_id_t &root_id) {
+  if (index < 0 || index >= GetRecordCount())
+    return false;
+  int offset = 4 + index * 36;
+  name = std::string(reinterpret_cast<char *>(GetData() + offset));
+  root_id = *reinterpret_cast<page_id_t *>(GetData() + offset + 32);
+  return true;
+}
+
 /**
  * helper functions
  */
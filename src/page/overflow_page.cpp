@@ -0,0 +1,41 @@
+/**
+ * overflow_page.cpp
+ */
+
+#include <cassert>
+#include <cstring>
+
+#include "page/overflow_page.h"
+
+namespace cmudb {
+
+const int32_t OverflowPage::CAPACITY;
+
+void OverflowPage::Init(page_id_t page_id, const char *data, int32_t size) {
+  assert(size >= 0 && size <= CAPACITY);
+  memcpy(GetData(), &page_id, 4);
+  SetLSN(INVALID_LSN);
+  SetNextPageId(INVALID_PAGE_ID);
+  memcpy(GetData() + 12, &size, 4);
+  memcpy(GetData() + 16, data, size);
+}
+
+page_id_t OverflowPage::GetPageId() {
+  return *reinterpret_cast<page_id_t *>(GetData());
+}
+
+page_id_t OverflowPage::GetNextPageId() {
+  return *reinterpret_cast<page_id_t *>(GetData() + 8);
+}
+
+void OverflowPage::SetNextPageId(page_id_t next_page_id) {
+  memcpy(GetData() + 8, &next_page_id, 4);
+}
+
+int32_t OverflowPage::GetDataSize() {
+  return *reinterpret_cast<int32_t *>(GetData() + 12);
+}
+
+const char *OverflowPage::GetPayload() { return GetData() + 16; }
+
+} // namespace cmudb
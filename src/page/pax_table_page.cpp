@@ -0,0 +1,896 @@
+/**
+ * pax_table_page.cpp
+ */
+
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+
+#include "page/overflow_page.h"
+#include "page/pax_table_page.h"
+
+namespace cmudb {
+// header up to the column widths
+static const int32_t PAX_HEADER_SIZE = 40;
+
+static inline int32_t Align4(int32_t offset) { return (offset + 3) & ~3; }
+static inline int32_t Align8(int32_t offset) { return (offset + 7) & ~7; }
+
+/**
+ * Header related
+ */
+void PaxTablePage::Init(page_id_t page_id, size_t page_size,
+                        page_id_t prev_page_id, Schema *schema,
+                        LogManager *log_manager, Transaction *txn,
+                        const std::vector<ColumnEncoding> &encodings) {
+  assert(page_size == PAGE_SIZE);
+  const int column_count = schema->GetColumnCount();
+  std::vector<int16_t> widths;
+  std::vector<ColumnEncoding> column_encodings(encodings);
+  column_encodings.resize(column_count, ColumnEncoding::PLAIN);
+  // header, column widths, encodings and the worst case of alignment
+  // padding, for the columns and the null bitmap
+  int32_t overhead = PAX_HEADER_SIZE + 3 * (column_count + 1) +
+                     8 * (column_count + 2);
+  // per row, in units of 1 / PAX_EXPECTED_REPEATS bytes, so that encoded
+  // values can take less than a byte
+  int32_t row_size = PAX_EXPECTED_REPEATS; // state byte
+  int32_t tuple_length = 0;
+  for (int i = 0; i < column_count; i++) {
+    assert(schema->GetOffset(i) == tuple_length);
+    ColumnEncoding encoding = column_encodings[i];
+    if (schema->IsInlined(i)) {
+      assert(encoding != ColumnEncoding::DICTIONARY);
+      int32_t width = schema->GetLength(i);
+      widths.push_back(static_cast<int16_t>(width));
+      if (encoding == ColumnEncoding::RLE) {
+        row_size += width + sizeof(uint16_t);
+        // the run count and a run of slack for rounding
+        overhead += 2 * sizeof(uint16_t) + width;
+      } else {
+        row_size += PAX_EXPECTED_REPEATS * width;
+      }
+    } else {
+      assert(encoding != ColumnEncoding::RLE);
+      widths.push_back(-static_cast<int16_t>(sizeof(int32_t)));
+      // values over the overflow threshold are moved out of the tuple
+      int32_t value_size = sizeof(uint32_t) +
+                           std::max(1, std::min(schema->GetVariableLength(i),
+                                                OVERFLOW_THRESHOLD) / 2);
+      if (encoding == ColumnEncoding::DICTIONARY) {
+        row_size += PAX_EXPECTED_REPEATS * sizeof(uint8_t) + value_size;
+        overhead += PAX_DICTIONARY_SIZE * sizeof(DictionaryEntry) + 4;
+      } else {
+        row_size += PAX_EXPECTED_REPEATS * (sizeof(int32_t) + value_size);
+      }
+    }
+    tuple_length += std::abs(widths.back());
+  }
+  assert(schema->GetLength() == tuple_length);
+  widths.push_back(static_cast<int16_t>(schema->GetNullBitmapSize()));
+  column_encodings.push_back(ColumnEncoding::PLAIN);
+  row_size += PAX_EXPECTED_REPEATS * widths.back();
+  tuple_length += widths.back();
+  int32_t capacity = std::max(
+      1, (PAGE_SIZE - overhead) * PAX_EXPECTED_REPEATS / row_size);
+  InitLayout(page_id, prev_page_id, widths, column_encodings,
+             static_cast<int16_t>(tuple_length), capacity);
+}
+
+void PaxTablePage::InitLike(page_id_t page_id, page_id_t prev_page_id,
+                            PaxTablePage *other, LogManager *log_manager,
+                            Transaction *txn) {
+  std::vector<int16_t> widths;
+  std::vector<ColumnEncoding> encodings;
+  for (int i = 0; i < other->GetColumnCount(); i++) {
+    widths.push_back(other->GetColumnWidth(i));
+    encodings.push_back(other->GetColumnEncoding(i));
+  }
+  InitLayout(page_id, prev_page_id, widths, encodings,
+             other->GetTupleLength(), other->GetCapacity());
+}
+
+void PaxTablePage::InitLayout(page_id_t page_id, page_id_t prev_page_id,
+                              const std::vector<int16_t> &widths,
+                              const std::vector<ColumnEncoding> &encodings,
+                              int16_t tuple_length, int32_t capacity) {
+  memset(GetData(), 0, PAGE_SIZE);
+  memcpy(GetData(), &page_id, 4);
+  memcpy(GetData() + 8, &prev_page_id, 4);
+  page_id_t next_page_id = INVALID_PAGE_ID;
+  memcpy(GetData() + 12, &next_page_id, 4);
+  memcpy(GetData() + 16, &PAX_PAGE_MAGIC, 4);
+  SetRowCount(0);
+  memcpy(GetData() + 24, &capacity, 4);
+  SetVarPointer(PAGE_SIZE);
+  SetGarbageSize(0);
+  int16_t column_count = static_cast<int16_t>(widths.size());
+  memcpy(GetData() + 36, &column_count, 2);
+  memcpy(GetData() + 38, &tuple_length, 2);
+  memcpy(GetData() + PAX_HEADER_SIZE, widths.data(), 2 * widths.size());
+  memcpy(GetData() + PAX_HEADER_SIZE + 2 * widths.size(), encodings.data(),
+         encodings.size());
+  assert(GetDataEnd() <= PAGE_SIZE);
+}
+
+page_id_t PaxTablePage::GetPageId() {
+  return *reinterpret_cast<page_id_t *>(GetData());
+}
+
+/**
+ * Tuple related
+ */
+bool PaxTablePage::InsertTuple(const Tuple &tuple, RID &rid, Transaction *txn,
+                               LockManager *lock_manager,
+                               LogManager *log_manager) {
+  assert(tuple.size_ > 0);
+  // try to reuse a free row first, unless that splits runs
+  uint8_t *states = GetRowStates();
+  int slot_num = 0;
+  if (GetRowCount() < GetCapacity()) {
+    for (int i = 0; i < GetColumnCount(); i++) {
+      if (GetColumnEncoding(i) == ColumnEncoding::RLE)
+        slot_num = GetRowCount();
+    }
+  }
+  while (slot_num < GetRowCount() && states[slot_num] != FREE)
+    slot_num++;
+  if (slot_num == GetCapacity())
+    return false; // every row is taken
+
+  int32_t varlen_size = GetWriteSize(tuple, slot_num);
+  int32_t free_size = GetVarPointer() - GetDataEnd();
+  if (varlen_size < 0 || varlen_size > free_size + GetGarbageSize())
+    return false; // not enough space
+  if (varlen_size > free_size)
+    Compact();
+
+  WriteRow(tuple, slot_num);
+  if (slot_num == GetRowCount())
+    SetRowCount(GetRowCount() + 1);
+  rid.Set(GetPageId(), slot_num);
+  if (ENABLE_LOGGING) {
+    // acquire the exclusive lock, nobody else can hold one on a fresh row
+    bool is_locked = lock_manager->LockExclusive(txn, rid.Get());
+    assert(is_locked);
+    (void)is_locked;
+  }
+  return true;
+}
+
+bool PaxTablePage::MarkDelete(const RID &rid, Transaction *txn,
+                              LockManager *lock_manager,
+                              LogManager *log_manager) {
+  int slot_num = rid.GetSlotNum();
+  if (slot_num >= GetRowCount() || GetRowStates()[slot_num] == FREE) {
+    if (ENABLE_LOGGING) {
+      txn->SetState(TransactionState::ABORTED);
+    }
+    return false;
+  }
+
+  if (ENABLE_LOGGING) {
+    // acquire exclusive lock, upgrade a shared one
+    if (txn->GetSharedLockSet()->find(rid) != txn->GetSharedLockSet()->end()) {
+      if (!lock_manager->LockUpgrade(txn, rid))
+        return false;
+    } else if (txn->GetExclusiveLockSet()->find(rid) ==
+                   txn->GetExclusiveLockSet()->end() &&
+               !lock_manager->LockExclusive(txn, rid)) {
+      return false;
+    }
+  }
+  GetRowStates()[slot_num] = DELETED;
+  return true;
+}
+
+bool PaxTablePage::UpdateTuple(const Tuple &new_tuple, Tuple &old_tuple,
+                               const RID &rid, Transaction *txn,
+                               LockManager *lock_manager,
+                               LogManager *log_manager) {
+  int slot_num = rid.GetSlotNum();
+  if (slot_num >= GetRowCount() || GetRowStates()[slot_num] != LIVE) {
+    if (ENABLE_LOGGING) {
+      txn->SetState(TransactionState::ABORTED);
+    }
+    return false;
+  }
+  // the old values become garbage once the row is rewritten
+  int32_t old_size = GetVarlenSize(slot_num);
+  int32_t varlen_size = GetWriteSize(new_tuple, slot_num);
+  int32_t free_size = GetVarPointer() - GetDataEnd();
+  if (varlen_size < 0 ||
+      varlen_size > free_size + GetGarbageSize() + old_size) {
+    // should delete/insert because not enough space
+    return false;
+  }
+
+  GetTuple(rid, old_tuple, txn, lock_manager);
+  if (ENABLE_LOGGING) {
+    // acquire exclusive lock, upgrade a shared one
+    if (txn->GetSharedLockSet()->find(rid) != txn->GetSharedLockSet()->end()) {
+      if (!lock_manager->LockUpgrade(txn, rid))
+        return false;
+    } else if (txn->GetExclusiveLockSet()->find(rid) ==
+                   txn->GetExclusiveLockSet()->end() &&
+               !lock_manager->LockExclusive(txn, rid)) {
+      return false;
+    }
+  }
+
+  // the old dictionary entries are kept until the new row is written, in
+  // case it shares them
+  std::vector<std::pair<int, int>> old_codes;
+  for (int i = 0; i < GetColumnCount(); i++) {
+    if (GetColumnEncoding(i) == ColumnEncoding::DICTIONARY)
+      old_codes.emplace_back(i, GetCodes(i)[slot_num]);
+  }
+  GetRowStates()[slot_num] = FREE;
+  SetGarbageSize(GetGarbageSize() + old_size);
+  if (varlen_size > free_size)
+    Compact();
+  WriteRow(new_tuple, slot_num);
+  for (auto &code : old_codes)
+    ReleaseEntry(code.first, code.second);
+  return true;
+}
+
+void PaxTablePage::ApplyDelete(const RID &rid, Transaction *txn,
+                               LogManager *log_manager, Tuple *deleted_tuple) {
+  int slot_num = rid.GetSlotNum();
+  assert(slot_num < GetRowCount());
+  if (ENABLE_LOGGING) {
+    // must already grab the exclusive lock
+    assert(txn->GetExclusiveLockSet()->find(rid) !=
+           txn->GetExclusiveLockSet()->end());
+  }
+  if (deleted_tuple != nullptr) {
+    ReadRow(slot_num, *deleted_tuple);
+    deleted_tuple->rid_ = rid;
+  }
+  FreeRow(slot_num);
+}
+
+void PaxTablePage::RollbackDelete(const RID &rid, Transaction *txn,
+                                  LogManager *log_manager) {
+  if (ENABLE_LOGGING) {
+    // must have already grab the exclusive lock
+    assert(txn->GetExclusiveLockSet()->find(rid) !=
+           txn->GetExclusiveLockSet()->end());
+  }
+  int slot_num = rid.GetSlotNum();
+  assert(slot_num < GetRowCount());
+  if (GetRowStates()[slot_num] == DELETED)
+    GetRowStates()[slot_num] = LIVE;
+}
+
+bool PaxTablePage::GetTuple(const RID &rid, Tuple &tuple, Transaction *txn,
+                            LockManager *lock_manager,
+                            const std::vector<bool> &projection) {
+  int slot_num = rid.GetSlotNum();
+  if (slot_num >= GetRowCount() || GetRowStates()[slot_num] != LIVE) {
+    if (ENABLE_LOGGING)
+      txn->SetState(TransactionState::ABORTED);
+    return false;
+  }
+  if (ENABLE_LOGGING) {
+    // acquire shared lock
+    if (txn->GetExclusiveLockSet()->find(rid) ==
+            txn->GetExclusiveLockSet()->end() &&
+        txn->GetSharedLockSet()->find(rid) == txn->GetSharedLockSet()->end() &&
+        !lock_manager->LockShared(txn, rid)) {
+      return false;
+    }
+  }
+
+  ReadRow(slot_num, tuple, projection);
+  tuple.rid_ = rid;
+  return true;
+}
+
+bool PaxTablePage::ReadTuple(const RID &rid, Tuple &tuple) {
+  int slot_num = rid.GetSlotNum();
+  if (slot_num >= GetRowCount() || GetRowStates()[slot_num] == FREE)
+    return false;
+  ReadRow(slot_num, tuple);
+  tuple.rid_ = rid;
+  return true;
+}
+
+/*
+ * The null bitmap is the last column, past the end of any projection, so it
+ * is always read. Skipped varchars share one null value
+ */
+void PaxTablePage::ReadRow(int slot_num, Tuple &tuple,
+                           const std::vector<bool> &projection) {
+  const int projected_count = static_cast<int>(projection.size());
+  auto is_skipped = [&](int column_id) {
+    return column_id < projected_count && !projection[column_id];
+  };
+  int32_t tuple_size = GetTupleLength();
+  if (projection.empty()) {
+    tuple_size += GetVarlenSize(slot_num, true);
+  } else {
+    bool has_skipped_varchar = false;
+    for (int i = 0; i < GetColumnCount(); i++) {
+      if (GetColumnWidth(i) > 0)
+        continue;
+      if (is_skipped(i)) {
+        has_skipped_varchar = true;
+        continue;
+      }
+      uint32_t length = *reinterpret_cast<uint32_t *>(
+          GetData() + GetValueOffset(i, slot_num));
+      tuple_size += sizeof(uint32_t) + GetPayloadSize(length);
+    }
+    if (has_skipped_varchar)
+      tuple_size += sizeof(uint32_t);
+  }
+  if (tuple.allocated_)
+    delete[] tuple.data_;
+  tuple.size_ = tuple_size;
+  tuple.data_ = new char[tuple.size_];
+  tuple.allocated_ = true;
+  int32_t offset = 0, varlen_offset = GetTupleLength(), null_offset = -1;
+  for (int i = 0; i < GetColumnCount(); i++) {
+    int16_t width = GetColumnWidth(i);
+    if (is_skipped(i)) {
+      if (width > 0) {
+        memset(tuple.data_ + offset, 0, width);
+        offset += width;
+        continue;
+      }
+      if (null_offset < 0) {
+        null_offset = varlen_offset;
+        memcpy(tuple.data_ + null_offset, &PELOTON_VALUE_NULL,
+               sizeof(uint32_t));
+        varlen_offset += sizeof(uint32_t);
+      }
+      memcpy(tuple.data_ + offset, &null_offset, sizeof(int32_t));
+      offset += sizeof(int32_t);
+      continue;
+    }
+    if (width > 0) {
+      memcpy(tuple.data_ + offset, GetFixedValue(i, slot_num), width);
+      offset += width;
+      continue;
+    }
+    int32_t value_offset = GetValueOffset(i, slot_num);
+    uint32_t length = *reinterpret_cast<uint32_t *>(GetData() + value_offset);
+    int32_t size = sizeof(uint32_t) + GetPayloadSize(length);
+    memcpy(tuple.data_ + offset, &varlen_offset, sizeof(int32_t));
+    memcpy(tuple.data_ + varlen_offset, GetData() + value_offset, size);
+    offset += sizeof(int32_t);
+    varlen_offset += size;
+  }
+  if (projection.empty())
+    return;
+  // the null bitmap has just been copied
+  uint8_t *null_bitmap = reinterpret_cast<uint8_t *>(
+      tuple.data_ + offset - GetColumnWidth(GetColumnCount() - 1));
+  for (int i = 0; i < projected_count && i < GetColumnCount() - 1; i++) {
+    if (!projection[i])
+      null_bitmap[i / 8] |= static_cast<uint8_t>(1 << (i % 8));
+  }
+}
+
+bool PaxTablePage::GetFirstTupleRid(RID &first_rid) {
+  uint8_t *states = GetRowStates();
+  for (int i = 0; i < GetRowCount(); ++i) {
+    if (states[i] == LIVE) {
+      first_rid.Set(GetPageId(), i);
+      return true;
+    }
+  }
+  first_rid.Set(INVALID_PAGE_ID, -1);
+  return false;
+}
+
+bool PaxTablePage::GetNextTupleRid(const RID &cur_rid, RID &next_rid) {
+  assert(cur_rid.GetPageId() == GetPageId());
+  uint8_t *states = GetRowStates();
+  for (auto i = cur_rid.GetSlotNum() + 1; i < GetRowCount(); ++i) {
+    if (states[i] == LIVE) {
+      next_rid.Set(GetPageId(), i);
+      return true;
+    }
+  }
+  return false;
+}
+
+int32_t PaxTablePage::GetFreeSpaceSize() {
+  if (GetRowCount() == GetCapacity()) {
+    uint8_t *states = GetRowStates();
+    if (std::find(states, states + GetRowCount(), FREE) ==
+        states + GetRowCount())
+      return 0;
+  }
+  // a full dictionary or runs rule out some of the inserts
+  int32_t new_runs = GetRowCount() < GetCapacity() ? 1 : 2;
+  for (int i = 0; i < GetColumnCount(); i++) {
+    ColumnEncoding encoding = GetColumnEncoding(i);
+    if (encoding == ColumnEncoding::RLE &&
+        GetRuns(i)[0] + new_runs > GetRunCapacity())
+      return 0;
+    if (encoding == ColumnEncoding::DICTIONARY && FindFreeEntry(i) < 0)
+      return 0;
+  }
+  return GetVarPointer() - GetDataEnd() + GetGarbageSize() +
+         GetTupleLength() + 8;
+}
+
+bool PaxTablePage::IsEmpty() {
+  uint8_t *states = GetRowStates();
+  return std::find_if(states, states + GetRowCount(), [](uint8_t state) {
+           return state != FREE;
+         }) == states + GetRowCount();
+}
+
+bool PaxTablePage::Vacuum() {
+  uint8_t *states = GetRowStates();
+  int32_t row_count = GetRowCount();
+  while (row_count > 0 && states[row_count - 1] == FREE)
+    row_count--;
+  if (row_count == GetRowCount() && GetGarbageSize() == 0)
+    return false;
+  if (row_count < GetRowCount()) {
+    SetRowCount(row_count);
+    for (int i = 0; i < GetColumnCount(); i++) {
+      if (GetColumnEncoding(i) == ColumnEncoding::RLE)
+        TrimRuns(i);
+    }
+  }
+  if (GetGarbageSize() > 0)
+    Compact();
+  return true;
+}
+
+/**
+ * Column access
+ */
+int PaxTablePage::GetColumnCount() {
+  return *reinterpret_cast<int16_t *>(GetData() + 36);
+}
+
+int16_t PaxTablePage::GetColumnWidth(int column_id) {
+  return reinterpret_cast<int16_t *>(GetData() + PAX_HEADER_SIZE)[column_id];
+}
+
+ColumnEncoding PaxTablePage::GetColumnEncoding(int column_id) {
+  return static_cast<ColumnEncoding>(
+      GetData()[PAX_HEADER_SIZE + 2 * GetColumnCount() + column_id]);
+}
+
+const char *PaxTablePage::GetMiniPage(int column_id) {
+  return GetData() + GetMiniPageOffset(column_id);
+}
+
+void PaxTablePage::CopyValues(int column_id, const std::vector<int> &slots,
+                              char *dest) {
+  const int width = GetColumnWidth(column_id);
+  const int count = static_cast<int>(slots.size());
+  if (count == 0)
+    return;
+  if (GetColumnEncoding(column_id) == ColumnEncoding::RLE) {
+    // the slots ascend, so do their runs
+    uint16_t *ends = GetRuns(column_id) + 1;
+    const char *values = GetRunValues(column_id);
+    int run = FindRun(column_id, slots.front());
+    for (int i = 0; i < count; i++) {
+      while (ends[run] <= slots[i])
+        run++;
+      memcpy(dest + i * width, values + run * width, width);
+    }
+    return;
+  }
+  const char *mini_page = GetMiniPage(column_id);
+  if (slots.back() - slots.front() == count - 1) {
+    memcpy(dest, mini_page + slots.front() * width, count * width);
+    return;
+  }
+  for (int i = 0; i < count; i++)
+    memcpy(dest + i * width, mini_page + slots[i] * width, width);
+}
+
+const char *PaxTablePage::GetVarchar(int column_id, int slot_num,
+                                     uint32_t &length) {
+  int32_t value_offset = GetValueOffset(column_id, slot_num);
+  length = *reinterpret_cast<uint32_t *>(GetData() + value_offset);
+  if (length == PELOTON_VALUE_NULL)
+    length = 0;
+  return GetData() + value_offset + sizeof(uint32_t);
+}
+
+int32_t PaxTablePage::GetCode(int column_id, int slot_num) {
+  return GetCodes(column_id)[slot_num];
+}
+
+int32_t PaxTablePage::GetCode(int column_id, const Value &value) {
+  if (GetColumnEncoding(column_id) != ColumnEncoding::DICTIONARY ||
+      value.GetTypeId() != TypeId::VARCHAR)
+    return -1;
+  std::vector<char> buffer(sizeof(uint32_t) +
+                           (value.IsNull() ? 0 : value.GetLength()));
+  value.SerializeTo(buffer.data());
+  return FindEntry(column_id, buffer.data());
+}
+
+/**
+ * helper functions
+ */
+int32_t PaxTablePage::GetRowCount() {
+  return *reinterpret_cast<int32_t *>(GetData() + 20);
+}
+
+void PaxTablePage::SetRowCount(int32_t row_count) {
+  memcpy(GetData() + 20, &row_count, 4);
+}
+
+int32_t PaxTablePage::GetCapacity() {
+  return *reinterpret_cast<int32_t *>(GetData() + 24);
+}
+
+int32_t PaxTablePage::GetVarPointer() {
+  return *reinterpret_cast<int32_t *>(GetData() + 28);
+}
+
+void PaxTablePage::SetVarPointer(int32_t var_pointer) {
+  memcpy(GetData() + 28, &var_pointer, 4);
+}
+
+int32_t PaxTablePage::GetGarbageSize() {
+  return *reinterpret_cast<int32_t *>(GetData() + 32);
+}
+
+void PaxTablePage::SetGarbageSize(int32_t garbage_size) {
+  memcpy(GetData() + 32, &garbage_size, 4);
+}
+
+int16_t PaxTablePage::GetTupleLength() {
+  return *reinterpret_cast<int16_t *>(GetData() + 38);
+}
+
+uint8_t *PaxTablePage::GetRowStates() {
+  return reinterpret_cast<uint8_t *>(GetData() + PAX_HEADER_SIZE +
+                                     3 * GetColumnCount());
+}
+
+int32_t PaxTablePage::GetMiniPageOffset(int column_id) {
+  int32_t offset =
+      Align8(PAX_HEADER_SIZE + 3 * GetColumnCount() + GetCapacity());
+  for (int i = 0; i < column_id; i++)
+    offset += Align8(GetMiniPageSize(i));
+  return offset;
+}
+
+int32_t PaxTablePage::GetMiniPageSize(int column_id) {
+  int32_t width = std::abs(GetColumnWidth(column_id));
+  switch (GetColumnEncoding(column_id)) {
+  case ColumnEncoding::DICTIONARY:
+    return Align4(GetCapacity()) +
+           PAX_DICTIONARY_SIZE * sizeof(DictionaryEntry);
+  case ColumnEncoding::RLE:
+    return sizeof(uint16_t) +
+           GetRunCapacity() * (sizeof(uint16_t) + width);
+  default:
+    return GetCapacity() * width;
+  }
+}
+
+int32_t PaxTablePage::GetDataEnd() {
+  return GetMiniPageOffset(GetColumnCount());
+}
+
+int32_t PaxTablePage::GetValueOffset(int column_id, int slot_num) {
+  if (GetColumnEncoding(column_id) == ColumnEncoding::DICTIONARY)
+    return GetDictionary(column_id)[GetCodes(column_id)[slot_num]].offset;
+  return reinterpret_cast<const int32_t *>(GetMiniPage(column_id))[slot_num];
+}
+
+int32_t PaxTablePage::GetWriteSize(const Tuple &tuple, int slot_num) {
+  int32_t size = 0, offset = 0;
+  for (int i = 0; i < GetColumnCount(); i++) {
+    int16_t width = GetColumnWidth(i);
+    ColumnEncoding encoding = GetColumnEncoding(i);
+    const char *value = tuple.data_ + offset;
+    offset += std::abs(width);
+    if (width > 0) {
+      if (encoding == ColumnEncoding::RLE &&
+          GetRuns(i)[0] + GetNewRunCount(i, slot_num, value) >
+              GetRunCapacity())
+        return -1;
+      continue;
+    }
+    value = tuple.data_ + *reinterpret_cast<const int32_t *>(value);
+    int32_t value_size =
+        sizeof(uint32_t) +
+        GetPayloadSize(*reinterpret_cast<const uint32_t *>(value));
+    if (encoding == ColumnEncoding::DICTIONARY) {
+      if (FindEntry(i, value) >= 0)
+        continue;
+      if (FindFreeEntry(i) < 0)
+        return -1;
+    }
+    size += value_size;
+  }
+  return size;
+}
+
+int32_t PaxTablePage::GetVarlenSize(int slot_num, bool dictionary_values) {
+  int32_t size = 0;
+  for (int i = 0; i < GetColumnCount(); i++) {
+    if (GetColumnWidth(i) > 0 ||
+        (!dictionary_values &&
+         GetColumnEncoding(i) == ColumnEncoding::DICTIONARY))
+      continue;
+    uint32_t length;
+    GetVarchar(i, slot_num, length);
+    size += sizeof(uint32_t) + GetPayloadSize(length);
+  }
+  return size;
+}
+
+void PaxTablePage::WriteRow(const Tuple &tuple, int slot_num) {
+  int32_t offset = 0;
+  for (int i = 0; i < GetColumnCount(); i++) {
+    int16_t width = GetColumnWidth(i);
+    ColumnEncoding encoding = GetColumnEncoding(i);
+    char *mini_page = GetData() + GetMiniPageOffset(i);
+    if (width > 0) {
+      if (encoding == ColumnEncoding::RLE)
+        SetRunValue(i, slot_num, tuple.data_ + offset);
+      else
+        memcpy(mini_page + slot_num * width, tuple.data_ + offset, width);
+      offset += width;
+      continue;
+    }
+    int32_t value_offset =
+        *reinterpret_cast<const int32_t *>(tuple.data_ + offset);
+    offset += sizeof(int32_t);
+    const char *value = tuple.data_ + value_offset;
+    int code = -1;
+    if (encoding == ColumnEncoding::DICTIONARY) {
+      code = FindEntry(i, value);
+      if (code >= 0) {
+        GetDictionary(i)[code].ref_count++;
+        GetCodes(i)[slot_num] = static_cast<uint8_t>(code);
+        continue;
+      }
+    }
+    uint32_t length = *reinterpret_cast<const uint32_t *>(value);
+    int32_t size = sizeof(uint32_t) + GetPayloadSize(length);
+    int32_t var_pointer = GetVarPointer() - size;
+    memcpy(GetData() + var_pointer, value, size);
+    SetVarPointer(var_pointer);
+    if (encoding != ColumnEncoding::DICTIONARY) {
+      reinterpret_cast<int32_t *>(mini_page)[slot_num] = var_pointer;
+      continue;
+    }
+    DictionaryEntry *dictionary = GetDictionary(i);
+    code = FindFreeEntry(i);
+    assert(code >= 0);
+    dictionary[code].offset = static_cast<int16_t>(var_pointer);
+    dictionary[code].ref_count = 1;
+    GetCodes(i)[slot_num] = static_cast<uint8_t>(code);
+  }
+  GetRowStates()[slot_num] = LIVE;
+}
+
+void PaxTablePage::FreeRow(int slot_num) {
+  SetGarbageSize(GetGarbageSize() + GetVarlenSize(slot_num));
+  for (int i = 0; i < GetColumnCount(); i++) {
+    if (GetColumnEncoding(i) == ColumnEncoding::DICTIONARY)
+      ReleaseEntry(i, GetCodes(i)[slot_num]);
+  }
+  GetRowStates()[slot_num] = FREE;
+}
+
+void PaxTablePage::Compact() {
+  char buffer[PAGE_SIZE];
+  int32_t var_pointer = PAGE_SIZE;
+  uint8_t *states = GetRowStates();
+  // the length prefixed value at offset, moved to the end of buffer
+  auto move = [&](int32_t offset) {
+    uint32_t length = *reinterpret_cast<uint32_t *>(GetData() + offset);
+    int32_t size = sizeof(uint32_t) + GetPayloadSize(length);
+    var_pointer -= size;
+    memcpy(buffer + var_pointer, GetData() + offset, size);
+    return var_pointer;
+  };
+  for (int i = 0; i < GetColumnCount(); i++) {
+    if (GetColumnWidth(i) > 0)
+      continue;
+    if (GetColumnEncoding(i) == ColumnEncoding::DICTIONARY) {
+      DictionaryEntry *dictionary = GetDictionary(i);
+      for (int code = 0; code < PAX_DICTIONARY_SIZE; code++) {
+        if (dictionary[code].ref_count > 0)
+          dictionary[code].offset =
+              static_cast<int16_t>(move(dictionary[code].offset));
+      }
+      continue;
+    }
+    int32_t *value_offsets =
+        reinterpret_cast<int32_t *>(GetData() + GetMiniPageOffset(i));
+    for (int slot_num = 0; slot_num < GetRowCount(); slot_num++) {
+      if (states[slot_num] != FREE)
+        value_offsets[slot_num] = move(value_offsets[slot_num]);
+    }
+  }
+  memcpy(GetData() + var_pointer, buffer + var_pointer,
+         PAGE_SIZE - var_pointer);
+  SetVarPointer(var_pointer);
+  SetGarbageSize(0);
+}
+
+/**
+ * Dictionary and runs
+ */
+uint8_t *PaxTablePage::GetCodes(int column_id) {
+  return reinterpret_cast<uint8_t *>(GetData() +
+                                     GetMiniPageOffset(column_id));
+}
+
+PaxTablePage::DictionaryEntry *PaxTablePage::GetDictionary(int column_id) {
+  return reinterpret_cast<DictionaryEntry *>(
+      GetData() + GetMiniPageOffset(column_id) + Align4(GetCapacity()));
+}
+
+int PaxTablePage::FindEntry(int column_id, const char *value) {
+  uint32_t length = *reinterpret_cast<const uint32_t *>(value);
+  int32_t size = sizeof(uint32_t) + GetPayloadSize(length);
+  DictionaryEntry *dictionary = GetDictionary(column_id);
+  for (int code = 0; code < PAX_DICTIONARY_SIZE; code++) {
+    const char *entry = GetData() + dictionary[code].offset;
+    if (dictionary[code].ref_count > 0 &&
+        *reinterpret_cast<const uint32_t *>(entry) == length &&
+        memcmp(entry, value, size) == 0)
+      return code;
+  }
+  return -1;
+}
+
+int PaxTablePage::FindFreeEntry(int column_id) {
+  DictionaryEntry *dictionary = GetDictionary(column_id);
+  for (int code = 0; code < PAX_DICTIONARY_SIZE; code++) {
+    if (dictionary[code].ref_count == 0)
+      return code;
+  }
+  return -1;
+}
+
+void PaxTablePage::ReleaseEntry(int column_id, int code) {
+  DictionaryEntry &entry = GetDictionary(column_id)[code];
+  assert(entry.ref_count > 0);
+  if (--entry.ref_count > 0)
+    return;
+  uint32_t length = *reinterpret_cast<uint32_t *>(GetData() + entry.offset);
+  SetGarbageSize(GetGarbageSize() + sizeof(uint32_t) +
+                 GetPayloadSize(length));
+}
+
+int32_t PaxTablePage::GetRunCapacity() {
+  return std::max(1, GetCapacity() / PAX_EXPECTED_REPEATS);
+}
+
+uint16_t *PaxTablePage::GetRuns(int column_id) {
+  return reinterpret_cast<uint16_t *>(GetData() +
+                                      GetMiniPageOffset(column_id));
+}
+
+char *PaxTablePage::GetRunValues(int column_id) {
+  return GetData() + GetMiniPageOffset(column_id) +
+         sizeof(uint16_t) * (1 + GetRunCapacity());
+}
+
+int PaxTablePage::FindRun(int column_id, int slot_num) {
+  uint16_t *runs = GetRuns(column_id);
+  return static_cast<int>(std::upper_bound(runs + 1, runs + 1 + runs[0],
+                                           static_cast<uint16_t>(slot_num)) -
+                          (runs + 1));
+}
+
+int PaxTablePage::GetNewRunCount(int column_id, int slot_num,
+                                 const char *value) {
+  const int width = GetColumnWidth(column_id);
+  uint16_t *runs = GetRuns(column_id);
+  uint16_t *ends = runs + 1;
+  const char *values = GetRunValues(column_id);
+  auto is_equal = [&](int run) {
+    return memcmp(values + run * width, value, width) == 0;
+  };
+  const int run_count = runs[0];
+  if (slot_num >= GetRowCount()) // appended
+    return run_count > 0 && is_equal(run_count - 1) ? 0 : 1;
+  int run = FindRun(column_id, slot_num);
+  int begin = run == 0 ? 0 : ends[run - 1];
+  bool is_first = slot_num == begin, is_last = slot_num == ends[run] - 1;
+  if (is_equal(run) || (is_first && is_last) ||
+      (is_first && run > 0 && is_equal(run - 1)) ||
+      (is_last && run + 1 < run_count && is_equal(run + 1)))
+    return 0;
+  return is_first || is_last ? 1 : 2;
+}
+
+/*
+ * Mirrors GetNewRunCount: a run is extended, overwritten or split around
+ * slot_num
+ */
+void PaxTablePage::SetRunValue(int column_id, int slot_num,
+                               const char *value) {
+  const int width = GetColumnWidth(column_id);
+  uint16_t *runs = GetRuns(column_id);
+  uint16_t *ends = runs + 1;
+  char *values = GetRunValues(column_id);
+  auto is_equal = [&](int run) {
+    return memcmp(values + run * width, value, width) == 0;
+  };
+  // open count runs at position run
+  auto insert = [&](int run, int count) {
+    memmove(ends + run + count, ends + run,
+            (runs[0] - run) * sizeof(uint16_t));
+    memmove(values + (run + count) * width, values + run * width,
+            (runs[0] - run) * width);
+    runs[0] += count;
+  };
+  const int run_count = runs[0];
+  if (slot_num >= GetRowCount()) {
+    if (run_count > 0 && is_equal(run_count - 1)) {
+      ends[run_count - 1] = slot_num + 1;
+      return;
+    }
+    assert(run_count < GetRunCapacity());
+    ends[run_count] = slot_num + 1;
+    memcpy(values + run_count * width, value, width);
+    runs[0]++;
+    return;
+  }
+  int run = FindRun(column_id, slot_num);
+  int begin = run == 0 ? 0 : ends[run - 1];
+  bool is_first = slot_num == begin, is_last = slot_num == ends[run] - 1;
+  if (is_equal(run))
+    return;
+  if (is_first && is_last) {
+    memcpy(values + run * width, value, width);
+  } else if (is_first && run > 0 && is_equal(run - 1)) {
+    ends[run - 1]++;
+  } else if (is_last && run + 1 < run_count && is_equal(run + 1)) {
+    ends[run]--;
+  } else if (is_first) {
+    insert(run, 1);
+    ends[run] = slot_num + 1;
+    memcpy(values + run * width, value, width);
+  } else if (is_last) {
+    insert(run + 1, 1);
+    ends[run] = slot_num;
+    ends[run + 1] = slot_num + 1;
+    memcpy(values + (run + 1) * width, value, width);
+  } else {
+    int end = ends[run];
+    insert(run + 1, 2);
+    ends[run] = slot_num;
+    ends[run + 1] = slot_num + 1;
+    ends[run + 2] = end;
+    memcpy(values + (run + 1) * width, value, width);
+    memcpy(values + (run + 2) * width, values + run * width, width);
+  }
+}
+
+void PaxTablePage::TrimRuns(int column_id) {
+  uint16_t *runs = GetRuns(column_id);
+  if (GetRowCount() == 0) {
+    runs[0] = 0;
+    return;
+  }
+  int run = FindRun(column_id, GetRowCount() - 1);
+  runs[0] = static_cast<uint16_t>(run + 1);
+  runs[1 + run] = static_cast<uint16_t>(GetRowCount());
+}
+
+const char *PaxTablePage::GetFixedValue(int column_id, int slot_num) {
+  const int width = GetColumnWidth(column_id);
+  if (GetColumnEncoding(column_id) == ColumnEncoding::RLE)
+    return GetRunValues(column_id) + FindRun(column_id, slot_num) * width;
+  return GetMiniPage(column_id) + slot_num * width;
+}
+
+} // namespace cmudb
@@ -3,6 +3,7 @@
  */
 
 #include <cassert>
+#include <cstdlib>
 
 #include "page/table_page.h"
 
@@ -21,6 +22,8 @@ void TablePage::Init(page_id_t page_id, size_t page_size,
   SetNextPageId(INVALID_PAGE_ID);
   SetFreeSpacePointer(page_size);
   SetTupleCount(0);
+  SetFreeSlot(-1);
+  SetGarbageSize(0);
 }
 
 page_id_t TablePage::GetPageId() {
@@ -49,40 +52,35 @@ void TablePage::SetNextPageId(page_id_t next_page_id) {
 bool TablePage::InsertTuple(const Tuple &tuple, RID &rid, Transaction *txn,
                             LockManager *lock_manager,
                             LogManager *log_manager) {
+  if (IsPax())
+    return AsPax()->InsertTuple(tuple, rid, txn, lock_manager, log_manager);
   assert(tuple.size_ > 0);
-  if (GetFreeSpaceSize() < tuple.size_) {
+  // reuse a free slot first
+  int slot_num = GetFreeSlot();
+  bool is_new_slot = slot_num < 0;
+  int32_t needed = tuple.size_ + (is_new_slot ? TABLE_PAGE_SLOT_SIZE : 0);
+  if (GetFreeSpaceSize() < needed) {
     return false; // not enough space
   }
+  MakeRoom(needed);
 
-  // try to reuse a free slot first
-  int i;
-  for (i = 0; i < GetTupleCount(); ++i) {
-    rid.Set(GetPageId(), i);
-    if (GetTupleSize(i) == 0) { // empty slot
-      if (ENABLE_LOGGING) {
-        assert(txn->GetSharedLockSet()->find(rid) ==
-                   txn->GetSharedLockSet()->end() &&
-               txn->GetExclusiveLockSet()->find(rid) ==
-                   txn->GetExclusiveLockSet()->end());
-      }
-      break;
-    }
+  if (is_new_slot) {
+    slot_num = GetTupleCount();
+    SetTupleCount(slot_num + 1);
+  } else {
+    SetFreeSlot(GetTupleOffset(slot_num)); // pop the free slot list
   }
-
-  // no free slot left
-  if (i == GetTupleCount() && GetFreeSpaceSize() < tuple.size_ + 8) {
-    return false; // not enough space
+  rid.Set(GetPageId(), slot_num);
+  if (ENABLE_LOGGING && !is_new_slot) {
+    assert(txn->GetSharedLockSet()->find(rid) ==
+               txn->GetSharedLockSet()->end() &&
+           txn->GetExclusiveLockSet()->find(rid) ==
+               txn->GetExclusiveLockSet()->end());
   }
-
-  SetFreeSpacePointer(GetFreeSpacePointer() -
-                      tuple.size_); // update free space pointer first
+  SetFreeSpacePointer(GetFreeSpacePointer() - tuple.size_);
   memcpy(GetData() + GetFreeSpacePointer(), tuple.data_, tuple.size_);
-  SetTupleOffset(i, GetFreeSpacePointer());
-  SetTupleSize(i, tuple.size_);
-  if (i == GetTupleCount()) {
-    rid.Set(GetPageId(), i);
-    SetTupleCount(GetTupleCount() + 1);
-  }
+  SetTupleOffset(slot_num, GetFreeSpacePointer());
+  SetTupleSize(slot_num, tuple.size_);
   // write the log after set rid
   if (ENABLE_LOGGING) {
     // acquire the exclusive lock
@@ -93,6 +91,23 @@ bool TablePage::InsertTuple(const Tuple &tuple, RID &rid, Transaction *txn,
   return true;
 }
 
+/*
+ * Batched version of InsertTuple. Free slots are popped off the free slot
+ * list, so every insert is O(1) and the batch needs no search of its own
+ */
+size_t TablePage::InsertTuples(const std::vector<Tuple> &tuples, size_t begin,
+                               std::vector<RID> &rids, Transaction *txn,
+                               LockManager *lock_manager,
+                               LogManager *log_manager) {
+  size_t i = begin;
+  RID rid;
+  for (; i < tuples.size() &&
+         InsertTuple(tuples[i], rid, txn, lock_manager, log_manager);
+       i++)
+    rids.push_back(rid);
+  return i - begin;
+}
+
 /*
  * MarkDelete method does not truly delete a tuple from table page
  * Instead it set the tuple as 'deleted' by changing the tuple size metadata to
@@ -101,6 +116,8 @@ bool TablePage::InsertTuple(const Tuple &tuple, RID &rid, Transaction *txn,
  */
 bool TablePage::MarkDelete(const RID &rid, Transaction *txn,
                            LockManager *lock_manager, LogManager *log_manager) {
+  if (IsPax())
+    return AsPax()->MarkDelete(rid, txn, lock_manager, log_manager);
   int slot_num = rid.GetSlotNum();
   if (slot_num >= GetTupleCount()) {
     if (ENABLE_LOGGING) {
@@ -141,6 +158,9 @@ bool TablePage::UpdateTuple(const Tuple &new_tuple, Tuple &old_tuple,
                             const RID &rid, Transaction *txn,
                             LockManager *lock_manager,
                             LogManager *log_manager) {
+  if (IsPax())
+    return AsPax()->UpdateTuple(new_tuple, old_tuple, rid, txn, lock_manager,
+                                log_manager);
   int slot_num = rid.GetSlotNum();
   if (slot_num >= GetTupleCount()) {
     if (ENABLE_LOGGING) {
@@ -185,24 +205,20 @@ bool TablePage::UpdateTuple(const Tuple &new_tuple, Tuple &old_tuple,
     // TODO: add your logging logic here
   }
 
-  // update
-  int32_t free_space_pointer =
-      GetFreeSpacePointer(); // old pointer to the free space
-  assert(tuple_offset >= free_space_pointer);
-  memmove(GetData() + free_space_pointer + tuple_size - new_tuple.size_,
-          GetData() + free_space_pointer, tuple_offset - free_space_pointer);
-  SetFreeSpacePointer(free_space_pointer + tuple_size - new_tuple.size_);
-  memcpy(GetData() + tuple_offset + tuple_size - new_tuple.size_,
-         new_tuple.data_,
-         new_tuple.size_);                 // copy new tuple
-  SetTupleSize(slot_num, new_tuple.size_); // update tuple size in slot
-  for (int i = 0; i < GetTupleCount();
-       ++i) { // update tuple offsets (including the updated one)
-    int32_t tuple_offset_i = GetTupleOffset(i);
-    if (GetTupleSize(i) > 0 && tuple_offset_i < tuple_offset + tuple_size) {
-      SetTupleOffset(i, tuple_offset_i + tuple_size - new_tuple.size_);
-    }
+  // update, in place unless the new tuple is larger
+  if (new_tuple.size_ <= tuple_size) {
+    SetGarbageSize(GetGarbageSize() + tuple_size - new_tuple.size_);
+  } else {
+    // the old bytes turn into garbage, which MakeRoom may reclaim
+    SetTupleSize(slot_num, 0);
+    SetGarbageSize(GetGarbageSize() + tuple_size);
+    MakeRoom(new_tuple.size_);
+    SetFreeSpacePointer(GetFreeSpacePointer() - new_tuple.size_);
+    tuple_offset = GetFreeSpacePointer();
   }
+  memcpy(GetData() + tuple_offset, new_tuple.data_, new_tuple.size_);
+  SetTupleOffset(slot_num, tuple_offset);
+  SetTupleSize(slot_num, new_tuple.size_);
   return true;
 }
 
@@ -212,7 +228,11 @@ bool TablePage::UpdateTuple(const Tuple &new_tuple, Tuple &old_tuple,
  * This function is called when a transaction commits or when you undo insert
  */
 void TablePage::ApplyDelete(const RID &rid, Transaction *txn,
-                            LogManager *log_manager) {
+                            LogManager *log_manager, Tuple *deleted_tuple) {
+  if (IsPax()) {
+    AsPax()->ApplyDelete(rid, txn, log_manager, deleted_tuple);
+    return;
+  }
   int slot_num = rid.GetSlotNum();
   assert(slot_num < GetTupleCount());
   // the tuple offset of the deleted tuple
@@ -223,12 +243,15 @@ void TablePage::ApplyDelete(const RID &rid, Transaction *txn,
   } // else: rollback insert op
 
   // copy out delete value, for undo purpose
-  Tuple delete_tuple;
-  delete_tuple.size_ = tuple_size;
-  delete_tuple.data_ = new char[delete_tuple.size_];
-  memcpy(delete_tuple.data_, GetData() + tuple_offset, delete_tuple.size_);
-  delete_tuple.rid_ = rid;
-  delete_tuple.allocated_ = true;
+  if (deleted_tuple != nullptr) {
+    if (deleted_tuple->allocated_)
+      delete[] deleted_tuple->data_;
+    deleted_tuple->size_ = tuple_size;
+    deleted_tuple->data_ = new char[tuple_size];
+    memcpy(deleted_tuple->data_, GetData() + tuple_offset, tuple_size);
+    deleted_tuple->rid_ = rid;
+    deleted_tuple->allocated_ = true;
+  }
 
   if (ENABLE_LOGGING) {
     // must already grab the exclusive lock
@@ -237,20 +260,15 @@ void TablePage::ApplyDelete(const RID &rid, Transaction *txn,
     // TODO: add your logging logic here
   }
 
-  int32_t free_space_pointer =
-      GetFreeSpacePointer(); // old pointer to the free space
-  assert(tuple_offset >= free_space_pointer);
-  memmove(GetData() + free_space_pointer + tuple_size,
-          GetData() + free_space_pointer, tuple_offset - free_space_pointer);
-  SetFreeSpacePointer(free_space_pointer + tuple_size);
+  // the bytes right at the free space pointer are free space again, others
+  // are left for compaction
+  if (tuple_offset == GetFreeSpacePointer())
+    SetFreeSpacePointer(tuple_offset + tuple_size);
+  else
+    SetGarbageSize(GetGarbageSize() + tuple_size);
   SetTupleSize(slot_num, 0);
-  SetTupleOffset(slot_num, 0); // invalid offset
-  for (int i = 0; i < GetTupleCount(); ++i) {
-    int32_t tuple_offset_i = GetTupleOffset(i);
-    if (GetTupleSize(i) != 0 && tuple_offset_i < tuple_offset) {
-      SetTupleOffset(i, tuple_offset_i + tuple_size);
-    }
-  }
+  SetTupleOffset(slot_num, GetFreeSlot()); // push onto the free slot list
+  SetFreeSlot(slot_num);
 }
 
 /*
@@ -261,6 +279,10 @@ void TablePage::ApplyDelete(const RID &rid, Transaction *txn,
  */
 void TablePage::RollbackDelete(const RID &rid, Transaction *txn,
                                LogManager *log_manager) {
+  if (IsPax()) {
+    AsPax()->RollbackDelete(rid, txn, log_manager);
+    return;
+  }
   if (ENABLE_LOGGING) {
     // must have already grab the exclusive lock
     assert(txn->GetExclusiveLockSet()->find(rid) !=
@@ -279,7 +301,10 @@ void TablePage::RollbackDelete(const RID &rid, Transaction *txn,
 }
 
 bool TablePage::GetTuple(const RID &rid, Tuple &tuple, Transaction *txn,
-                         LockManager *lock_manager) {
+                         LockManager *lock_manager, Schema *schema,
+                         const std::vector<bool> &projection) {
+  if (IsPax())
+    return AsPax()->GetTuple(rid, tuple, txn, lock_manager, projection);
   int slot_num = rid.GetSlotNum();
   if (slot_num >= GetTupleCount()) {
     if (ENABLE_LOGGING)
@@ -304,6 +329,11 @@ bool TablePage::GetTuple(const RID &rid, Tuple &tuple, Transaction *txn,
   }
 
   int32_t tuple_offset = GetTupleOffset(slot_num);
+  if (schema != nullptr && !projection.empty()) {
+    CopyColumns(GetData() + tuple_offset, tuple, schema, projection);
+    tuple.rid_ = rid;
+    return true;
+  }
   tuple.size_ = tuple_size;
   if (tuple.allocated_)
     delete[] tuple.data_;
@@ -314,10 +344,128 @@ bool TablePage::GetTuple(const RID &rid, Tuple &tuple, Transaction *txn,
   return true;
 }
 
+bool TablePage::ReadTuple(const RID &rid, Tuple &tuple) {
+  if (IsPax())
+    return AsPax()->ReadTuple(rid, tuple);
+  int slot_num = rid.GetSlotNum();
+  if (slot_num >= GetTupleCount() || GetTupleSize(slot_num) == 0)
+    return false;
+  if (tuple.allocated_)
+    delete[] tuple.data_;
+  tuple.size_ = std::abs(GetTupleSize(slot_num));
+  tuple.data_ = new char[tuple.size_];
+  memcpy(tuple.data_, GetData() + GetTupleOffset(slot_num), tuple.size_);
+  tuple.rid_ = rid;
+  tuple.allocated_ = true;
+  return true;
+}
+
+bool TablePage::GetTupleView(const RID &rid, Tuple &tuple, Transaction *txn,
+                             LockManager *lock_manager) {
+  if (IsPax())
+    return AsPax()->GetTuple(rid, tuple, txn, lock_manager);
+  int slot_num = rid.GetSlotNum();
+  if (slot_num >= GetTupleCount()) {
+    if (ENABLE_LOGGING)
+      txn->SetState(TransactionState::ABORTED);
+    return false;
+  }
+  int32_t tuple_size = GetTupleSize(slot_num);
+  if (tuple_size <= 0) {
+    if (ENABLE_LOGGING)
+      txn->SetState(TransactionState::ABORTED);
+    return false;
+  }
+
+  if (ENABLE_LOGGING) {
+    // acquire shared lock
+    if (txn->GetExclusiveLockSet()->find(rid) ==
+            txn->GetExclusiveLockSet()->end() &&
+        txn->GetSharedLockSet()->find(rid) == txn->GetSharedLockSet()->end() &&
+        !lock_manager->LockShared(txn, rid)) {
+      return false;
+    }
+  }
+
+  if (tuple.allocated_)
+    delete[] tuple.data_;
+  tuple.size_ = tuple_size;
+  tuple.data_ = GetData() + GetTupleOffset(slot_num);
+  tuple.rid_ = rid;
+  tuple.allocated_ = false;
+  return true;
+}
+
+/*
+ * The fixed size columns and the null bitmap are copied in one piece, the
+ * payloads only for the varchars set in projection. Skipped varchars share
+ * one null value
+ */
+void TablePage::CopyColumns(const char *data, Tuple &tuple, Schema *schema,
+                            const std::vector<bool> &projection) {
+  const int projected_count = static_cast<int>(projection.size());
+  auto is_skipped = [&](int column_id) {
+    return column_id < projected_count && !projection[column_id];
+  };
+  auto get_prefix = [&](int column_id) {
+    int32_t offset = *reinterpret_cast<const int32_t *>(
+        data + schema->GetOffset(column_id));
+    return *reinterpret_cast<const uint32_t *>(data + offset);
+  };
+  int32_t tuple_size = schema->GetVarlenOffset();
+  bool has_skipped_varchar = false;
+  for (int column_id : schema->GetUnlinedColumns()) {
+    if (is_skipped(column_id))
+      has_skipped_varchar = true;
+    else
+      tuple_size += sizeof(uint32_t) + GetPayloadSize(get_prefix(column_id));
+  }
+  if (has_skipped_varchar)
+    tuple_size += sizeof(uint32_t);
+  if (tuple.allocated_)
+    delete[] tuple.data_;
+  tuple.size_ = tuple_size;
+  tuple.data_ = new char[tuple.size_];
+  tuple.allocated_ = true;
+  memcpy(tuple.data_, data, schema->GetVarlenOffset());
+
+  int32_t varlen_offset = schema->GetVarlenOffset(), null_offset = -1;
+  for (int column_id : schema->GetUnlinedColumns()) {
+    char *offset = tuple.data_ + schema->GetOffset(column_id);
+    if (is_skipped(column_id)) {
+      if (null_offset < 0) {
+        null_offset = varlen_offset;
+        memcpy(tuple.data_ + null_offset, &PELOTON_VALUE_NULL,
+               sizeof(uint32_t));
+        varlen_offset += sizeof(uint32_t);
+      }
+      memcpy(offset, &null_offset, sizeof(int32_t));
+      continue;
+    }
+    int32_t value_offset;
+    memcpy(&value_offset, offset, sizeof(int32_t));
+    int32_t size = sizeof(uint32_t) + GetPayloadSize(get_prefix(column_id));
+    memcpy(tuple.data_ + varlen_offset, data + value_offset, size);
+    memcpy(offset, &varlen_offset, sizeof(int32_t));
+    varlen_offset += size;
+  }
+  uint8_t *null_bitmap =
+      reinterpret_cast<uint8_t *>(tuple.data_ + schema->GetLength());
+  for (int i = 0; i < projected_count && i < schema->GetColumnCount(); i++) {
+    if (projection[i])
+      continue;
+    if (schema->IsInlined(i))
+      memset(tuple.data_ + schema->GetOffset(i), 0, schema->GetLength(i));
+    null_bitmap[i / 8] |= static_cast<uint8_t>(1 << (i % 8));
+  }
+}
+
 /**
  * Tuple iterator
  */
 bool TablePage::GetFirstTupleRid(RID &first_rid) {
+  if (IsPax())
+    return AsPax()->GetFirstTupleRid(first_rid);
   for (int i = 0; i < GetTupleCount(); ++i) {
     if (GetTupleSize(i) > 0) { // valid tuple
       first_rid.Set(GetPageId(), i);
@@ -330,6 +478,8 @@ bool TablePage::GetFirstTupleRid(RID &first_rid) {
 }
 
 bool TablePage::GetNextTupleRid(const RID &cur_rid, RID &next_rid) {
+  if (IsPax())
+    return AsPax()->GetNextTupleRid(cur_rid, next_rid);
   assert(cur_rid.GetPageId() == GetPageId());
   for (auto i = cur_rid.GetSlotNum() + 1; i < GetTupleCount(); ++i) {
     if (GetTupleSize(i) > 0) { // valid tuple
@@ -346,19 +496,19 @@ bool TablePage::GetNextTupleRid(const RID &cur_rid, RID &next_rid) {
 
 // tuple slots
 int32_t TablePage::GetTupleOffset(int slot_num) {
-  return *reinterpret_cast<int32_t *>(GetData() + 24 + 8 * slot_num);
+  return *reinterpret_cast<int32_t *>(GetData() + 32 + 8 * slot_num);
 }
 
 int32_t TablePage::GetTupleSize(int slot_num) {
-  return *reinterpret_cast<int32_t *>(GetData() + 28 + 8 * slot_num);
+  return *reinterpret_cast<int32_t *>(GetData() + 36 + 8 * slot_num);
 }
 
 void TablePage::SetTupleOffset(int slot_num, int32_t offset) {
-  memcpy(GetData() + 24 + 8 * slot_num, &offset, 4);
+  memcpy(GetData() + 32 + 8 * slot_num, &offset, 4);
 }
 
 void TablePage::SetTupleSize(int slot_num, int32_t offset) {
-  memcpy(GetData() + 28 + 8 * slot_num, &offset, 4);
+  memcpy(GetData() + 36 + 8 * slot_num, &offset, 4);
 }
 
 // free space
@@ -379,8 +529,94 @@ void TablePage::SetTupleCount(int32_t tuple_count) {
   memcpy(GetData() + 20, &tuple_count, 4);
 }
 
+// free slot list
+int32_t TablePage::GetFreeSlot() {
+  return *reinterpret_cast<int32_t *>(GetData() + 24);
+}
+
+void TablePage::SetFreeSlot(int32_t slot_num) {
+  memcpy(GetData() + 24, &slot_num, 4);
+}
+
+// bytes of freed tuples that are not free space yet
+int32_t TablePage::GetGarbageSize() {
+  return *reinterpret_cast<int32_t *>(GetData() + 28);
+}
+
+void TablePage::SetGarbageSize(int32_t garbage_size) {
+  memcpy(GetData() + 28, &garbage_size, 4);
+}
+
 // for free space calculation
 int32_t TablePage::GetFreeSpaceSize() {
-  return GetFreeSpacePointer() - 24 - GetTupleCount() * 8;
+  if (IsPax())
+    return AsPax()->GetFreeSpaceSize();
+  return GetFreeSpacePointer() - TABLE_PAGE_HEADER_SIZE -
+         GetTupleCount() * TABLE_PAGE_SLOT_SIZE + GetGarbageSize();
+}
+
+/**
+ * Vacuum
+ */
+bool TablePage::IsEmpty() {
+  if (IsPax())
+    return AsPax()->IsEmpty();
+  for (int i = 0; i < GetTupleCount(); i++) {
+    if (GetTupleSize(i) != 0)
+      return false;
+  }
+  return true;
+}
+
+bool TablePage::Vacuum() {
+  if (IsPax())
+    return AsPax()->Vacuum();
+  int32_t tuple_count = GetTupleCount();
+  while (tuple_count > 0 && GetTupleSize(tuple_count - 1) == 0)
+    tuple_count--;
+  if (tuple_count == GetTupleCount() && GetGarbageSize() == 0)
+    return false;
+  if (tuple_count < GetTupleCount()) {
+    // the free list may run through the dropped slots, thread it again
+    SetTupleCount(tuple_count);
+    int32_t free_slot = -1;
+    for (int i = tuple_count - 1; i >= 0; i--) {
+      if (GetTupleSize(i) == 0) {
+        SetTupleOffset(i, free_slot);
+        free_slot = i;
+      }
+    }
+    SetFreeSlot(free_slot);
+  }
+  if (GetGarbageSize() > 0)
+    Compact();
+  return true;
+}
+
+void TablePage::MakeRoom(int32_t size) {
+  if (GetFreeSpacePointer() - TABLE_PAGE_HEADER_SIZE -
+          GetTupleCount() * TABLE_PAGE_SLOT_SIZE <
+      size)
+    Compact();
+}
+
+/*
+ * The tuples are gathered in slot order into a scratch page and copied back
+ * in one piece, which saves sorting them by offset
+ */
+void TablePage::Compact() {
+  char buffer[PAGE_SIZE];
+  int32_t end = PAGE_SIZE;
+  for (int i = 0; i < GetTupleCount(); i++) {
+    int32_t size = std::abs(GetTupleSize(i));
+    if (size == 0)
+      continue;
+    end -= size;
+    memcpy(buffer + end, GetData() + GetTupleOffset(i), size);
+    SetTupleOffset(i, end);
+  }
+  memcpy(GetData() + end, buffer + end, PAGE_SIZE - end);
+  SetFreeSpacePointer(end);
+  SetGarbageSize(0);
 }
 } // namespace cmudb
@@ -0,0 +1,386 @@
+/**
+ * bulk_loader.cpp
+ */
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+
+#include "page/overflow_page.h"
+#include "table/bulk_loader.h"
+
+namespace cmudb {
+
+BulkLoader::BulkLoader(Schema *schema, DiskManager *disk_manager,
+                       BufferPoolManager *buffer_pool_manager,
+                       TableLayout layout,
+                       const std::vector<ColumnEncoding> &encodings)
+    : schema_(schema), disk_manager_(disk_manager),
+      buffer_pool_manager_(buffer_pool_manager), layout_(layout),
+      encodings_(encodings), pages_(new Page[WRITE_BATCH_SIZE]),
+      write_buffer_(new char[WRITE_BATCH_SIZE * PAGE_SIZE]) {}
+
+/*
+ * The input is read in chunks of whole lines. Every chunk is cut into
+ * num_threads ranges at line ends, the ranges are parsed in parallel and
+ * their tuples are packed into pages in input order
+ */
+bool BulkLoader::LoadCsv(std::istream &in, int num_threads, bool header) {
+  num_threads = std::max(num_threads, 1);
+  std::vector<std::unique_ptr<Arena>> arenas;
+  for (int i = 0; i < num_threads; i++)
+    arenas.emplace_back(new Arena());
+  std::vector<std::vector<Tuple>> tuples(num_threads);
+  std::vector<size_t> line_counts(num_threads);
+  std::vector<std::string> errors(num_threads);
+  std::string buffer;
+  bool skip_line = header;
+  while (true) {
+    size_t carry = buffer.size();
+    buffer.resize(carry + CHUNK_SIZE);
+    in.read(&buffer[carry], CHUNK_SIZE);
+    buffer.resize(carry + in.gcount());
+    bool is_last = !in;
+    if (is_last && !buffer.empty() && buffer.back() != '\n')
+      buffer.push_back('\n');
+    // parse up to the last complete line
+    size_t size = buffer.rfind('\n') + 1;
+    char *begin = &buffer[0];
+    char *end = begin + size;
+    if (skip_line && size > 0) {
+      begin = static_cast<char *>(memchr(begin, '\n', size)) + 1;
+      line_count_++;
+      skip_line = false;
+    }
+
+    std::vector<char *> bounds{begin};
+    for (int i = 1; i < num_threads; i++) {
+      char *bound = begin + (end - begin) * i / num_threads;
+      bound = std::max(bound, bounds.back());
+      if (bound != begin && bound != end && bound[-1] != '\n')
+        bound = static_cast<char *>(memchr(bound, '\n', end - bound)) + 1;
+      bounds.push_back(bound);
+    }
+    bounds.push_back(end);
+    std::vector<bool> results(num_threads);
+    auto parse = [&](int i) {
+      results[i] = ParseLines(bounds[i], bounds[i + 1], arenas[i].get(),
+                              tuples[i], line_counts[i], errors[i]);
+    };
+    std::vector<std::thread> threads;
+    for (int i = 1; i < num_threads; i++)
+      threads.emplace_back(parse, i);
+    parse(0);
+    for (auto &thread : threads)
+      thread.join();
+
+    for (int i = 0; i < num_threads; i++) {
+      if (!results[i]) {
+        error_ = "line " + std::to_string(line_count_ + line_counts[i] + 1) +
+                 ": " + errors[i];
+        return false;
+      }
+      line_count_ += line_counts[i];
+      for (auto &tuple : tuples[i])
+        if (!Append(tuple))
+          return false;
+      tuples[i].clear();
+      arenas[i]->Reset();
+    }
+    buffer.erase(0, size);
+    if (is_last)
+      return true;
+  }
+}
+
+bool BulkLoader::LoadBinary(std::istream &in) {
+  std::string buffer;
+  Tuple tuple;
+  while (true) {
+    size_t carry = buffer.size();
+    buffer.resize(carry + CHUNK_SIZE);
+    in.read(&buffer[carry], CHUNK_SIZE);
+    buffer.resize(carry + in.gcount());
+    bool is_last = !in;
+    size_t offset = 0;
+    while (buffer.size() - offset >= sizeof(int32_t)) {
+      int32_t size = *reinterpret_cast<const int32_t *>(&buffer[offset]);
+      if (size < schema_->GetVarlenOffset()) {
+        error_ = "row " + std::to_string(row_count_ + 1) + ": bad size";
+        return false;
+      }
+      if (buffer.size() - offset - sizeof(int32_t) < (size_t)size)
+        break;
+      if (!CheckVarlens(&buffer[offset + sizeof(int32_t)], size))
+        return false;
+      tuple.DeserializeFrom(&buffer[offset]);
+      if (!Append(tuple))
+        return false;
+      offset += sizeof(int32_t) + size;
+    }
+    buffer.erase(0, offset);
+    if (is_last) {
+      if (buffer.empty())
+        return true;
+      error_ = "row " + std::to_string(row_count_ + 1) + ": truncated";
+      return false;
+    }
+  }
+}
+
+bool BulkLoader::Finish() {
+  if (first_page_id_ == INVALID_PAGE_ID)
+    StartPage();
+  WritePages(page_count_);
+  page_count_ = 0;
+  if (large_tuples_.empty())
+    return true;
+  TableHeap table_heap(buffer_pool_manager_, nullptr, nullptr, first_page_id_,
+                       schema_);
+  Transaction txn(0);
+  RID rid;
+  for (auto &tuple : large_tuples_) {
+    if (!table_heap.InsertTuple(tuple, rid, &txn)) {
+      error_ = "out of buffer pool pages for a large row";
+      return false;
+    }
+  }
+  large_tuples_.clear();
+  return true;
+}
+
+bool BulkLoader::ParseLines(char *begin, char *end, Arena *arena,
+                            std::vector<Tuple> &tuples, size_t &line_count,
+                            std::string &error) {
+  std::vector<Value> values;
+  line_count = 0;
+  while (begin != end) {
+    char *line_end = static_cast<char *>(memchr(begin, '\n', end - begin));
+    char *next = line_end + 1;
+    if (line_end != begin && line_end[-1] == '\r')
+      line_end--;
+    if (line_end != begin) {
+      if (!ParseLine(begin, line_end, values, error))
+        return false;
+      tuples.emplace_back(values, schema_, arena);
+      // large tuples outlive the arena
+      if (tuples.back().GetLength() > OVERFLOW_THRESHOLD)
+        tuples.back() = Tuple(values, schema_);
+    }
+    line_count++;
+    begin = next;
+  }
+  return true;
+}
+
+bool BulkLoader::ParseLine(char *begin, char *end, std::vector<Value> &values,
+                           std::string &error) {
+  values.clear();
+  int column_count = schema_->GetColumnCount();
+  char *p = begin;
+  for (int i = 0; i < column_count; i++) {
+    if (p > end) {
+      error = "expected " + std::to_string(column_count) + " fields";
+      return false;
+    }
+    char *field = p;
+    size_t length;
+    bool quoted = p != end && *p == '"';
+    if (quoted) {
+      // unescape in place
+      char *out = p++;
+      while (true) {
+        if (p == end) {
+          error = "unterminated quote";
+          return false;
+        }
+        if (*p == '"' && (p + 1 == end || p[1] != '"'))
+          break;
+        if (*p == '"')
+          p++;
+        *out++ = *p++;
+      }
+      p++;
+      if (p != end && *p != ',') {
+        error = "text after a quoted field";
+        return false;
+      }
+      length = out - field;
+    } else {
+      char *comma = static_cast<char *>(memchr(p, ',', end - p));
+      p = comma == nullptr ? end : comma;
+      length = p - field;
+    }
+    // overwrites the comma or the line end
+    field[length] = '\0';
+    p++;
+    values.emplace_back(TypeId::INVALID);
+    if (!ParseValue(i, field, length, quoted, values.back(), error))
+      return false;
+  }
+  if (p <= end) {
+    error = "expected " + std::to_string(column_count) + " fields";
+    return false;
+  }
+  return true;
+}
+
+bool BulkLoader::ParseValue(int column_id, const char *field, size_t length,
+                            bool quoted, Value &value, std::string &error) {
+  TypeId type = schema_->GetType(column_id);
+  if (length == 0 && !quoted) {
+    value = Type::GetNullValue(type);
+    return true;
+  }
+  char *parsed_end;
+  errno = 0;
+  switch (type) {
+  case TypeId::VARCHAR:
+    // with the terminator
+    value = Value(type, field, length + 1, false);
+    return true;
+  case TypeId::BOOLEAN:
+    if (strcmp(field, "1") == 0 || strcmp(field, "true") == 0) {
+      value = Value(type, (int32_t)1);
+      return true;
+    }
+    if (strcmp(field, "0") == 0 || strcmp(field, "false") == 0) {
+      value = Value(type, (int32_t)0);
+      return true;
+    }
+    break;
+  case TypeId::TINYINT:
+  case TypeId::SMALLINT:
+  case TypeId::INTEGER:
+  case TypeId::BIGINT: {
+    long long integer = strtoll(field, &parsed_end, 10);
+    if (length == 0 || parsed_end != field + length || errno != 0)
+      break;
+    if (type == TypeId::BIGINT) {
+      if (integer < PELOTON_INT64_MIN)
+        break;
+      value = Value(type, (int64_t)integer);
+      return true;
+    }
+    long long min = type == TypeId::TINYINT
+                        ? PELOTON_INT8_MIN
+                        : type == TypeId::SMALLINT ? PELOTON_INT16_MIN
+                                                   : PELOTON_INT32_MIN;
+    long long max = type == TypeId::TINYINT
+                        ? PELOTON_INT8_MAX
+                        : type == TypeId::SMALLINT ? PELOTON_INT16_MAX
+                                                   : PELOTON_INT32_MAX;
+    if (integer < min || integer > max)
+      break;
+    value = Value(type, (int32_t)integer);
+    return true;
+  }
+  case TypeId::DECIMAL: {
+    double decimal = strtod(field, &parsed_end);
+    if (length == 0 || parsed_end != field + length || errno != 0)
+      break;
+    value = Value(type, decimal);
+    return true;
+  }
+  default:
+    error = "column " + schema_->GetColumn(column_id).GetName() +
+            " has an unsupported type";
+    return false;
+  }
+  error = "bad value for column " + schema_->GetColumn(column_id).GetName() +
+          ": " + std::string(field, length);
+  return false;
+}
+
+/*
+ * The varchars of a binary tuple of size bytes at data must lie within the
+ * tuple: every offset points past the null bitmap and its payload ends
+ * before the tuple does. Overflow values point into another database.
+ */
+bool BulkLoader::CheckVarlens(const char *data, int32_t size) {
+  for (int i = 0; i < schema_->GetColumnCount(); i++) {
+    if (schema_->IsInlined(i))
+      continue;
+    int32_t offset;
+    memcpy(&offset, data + schema_->GetOffset(i), sizeof(int32_t));
+    uint32_t prefix = 0;
+    bool is_valid = offset >= schema_->GetVarlenOffset() &&
+                    (size_t)offset + sizeof(uint32_t) <= (size_t)size;
+    if (is_valid) {
+      memcpy(&prefix, data + offset, sizeof(uint32_t));
+      is_valid = !IsOverflowPrefix(prefix) &&
+                 (size_t)offset + sizeof(uint32_t) + GetPayloadSize(prefix) <=
+                     (size_t)size;
+    }
+    if (!is_valid) {
+      error_ = "row " + std::to_string(row_count_ + 1) +
+               ": bad value for column " + schema_->GetColumn(i).GetName();
+      return false;
+    }
+  }
+  return true;
+}
+
+bool BulkLoader::Append(Tuple &tuple) {
+  if (tuple.GetLength() > OVERFLOW_THRESHOLD) {
+    large_tuples_.push_back(std::move(tuple));
+    row_count_++;
+    return true;
+  }
+  if (first_page_id_ == INVALID_PAGE_ID)
+    StartPage();
+  RID rid;
+  auto page = static_cast<TablePage *>(&pages_[page_count_ - 1]);
+  if (!page->InsertTuple(tuple, rid, nullptr, nullptr, nullptr)) {
+    StartPage();
+    page = static_cast<TablePage *>(&pages_[page_count_ - 1]);
+    if (!page->InsertTuple(tuple, rid, nullptr, nullptr, nullptr)) {
+      // e.g. varchars beyond the room a PAX page plans for
+      error_ = "row " + std::to_string(row_count_ + 1) + " does not fit a page";
+      return false;
+    }
+  }
+  row_count_++;
+  return true;
+}
+
+void BulkLoader::StartPage() {
+  page_id_t page_id = disk_manager_->AllocatePage();
+  page_id_t prev_page_id = INVALID_PAGE_ID;
+  if (page_count_ > 0) {
+    auto prev_page = static_cast<TablePage *>(&pages_[page_count_ - 1]);
+    prev_page->SetNextPageId(page_id);
+    prev_page_id = prev_page->GetPageId();
+  } else {
+    first_page_id_ = page_id;
+  }
+  // a batch is written in one go, so it must hold consecutive pages. A page
+  // allocated elsewhere in between starts a new batch
+  if (page_count_ == WRITE_BATCH_SIZE ||
+      (page_count_ > 0 && prev_page_id + 1 != page_id)) {
+    WritePages(page_count_);
+    page_count_ = 0;
+  }
+  auto page = static_cast<TablePage *>(&pages_[page_count_++]);
+  memset(page->GetData(), 0, PAGE_SIZE);
+  if (layout_ == TableLayout::PAX)
+    page->AsPax()->Init(page_id, PAGE_SIZE, prev_page_id, schema_, nullptr,
+                        nullptr, encodings_);
+  else
+    page->Init(page_id, PAGE_SIZE, prev_page_id, nullptr, nullptr);
+}
+
+void BulkLoader::WritePages(int page_count) {
+  if (page_count == 0)
+    return;
+  for (int i = 0; i < page_count; i++)
+    memcpy(write_buffer_.get() + i * PAGE_SIZE, pages_[i].GetData(),
+           PAGE_SIZE);
+  disk_manager_->WritePages(
+      static_cast<TablePage *>(&pages_[0])->GetPageId(), write_buffer_.get(),
+      page_count);
+}
+
+} // namespace cmudb
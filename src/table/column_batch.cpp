@@ -0,0 +1,144 @@
+/**
+ * column_batch.cpp
+ */
+
+#include <cassert>
+#include <cstring>
+
+#include "table/column_batch.h"
+#include "table/table_heap.h"
+
+namespace cmudb {
+
+const int ColumnBatch::CAPACITY;
+
+ColumnBatch::ColumnBatch(Schema *schema, const std::vector<int> &column_ids)
+    : schema_(schema), rids_(CAPACITY),
+      null_bitmaps_(CAPACITY * schema->GetNullBitmapSize()),
+      selection_(CAPACITY) {
+  std::vector<int> ids = column_ids;
+  if (ids.empty())
+    for (int i = 0; i < schema->GetColumnCount(); i++)
+      ids.push_back(i);
+  for (int id : ids) {
+    Column column;
+    column.column_id = id;
+    column.type = schema->GetType(id);
+    column.is_inlined = schema->IsInlined(id);
+    column.offset = schema->GetOffset(id);
+    column.width = schema->GetLength(id);
+    if (column.is_inlined) {
+      column.data.resize(CAPACITY * column.width);
+    } else {
+      column.offsets.resize(CAPACITY + 1);
+      column.heap.reserve(CAPACITY * 16);
+    }
+    columns_.push_back(std::move(column));
+  }
+}
+
+Value ColumnBatch::GetValue(int i, int row) const {
+  const Column &column = columns_[i];
+  if (column.is_inlined)
+    return Value::DeserializeFrom(column.data.data() + row * column.width,
+                                  column.type);
+  if (IsNull(i, row))
+    return Value(column.type, nullptr, PELOTON_VALUE_NULL, false);
+  uint32_t length;
+  const char *data = GetVarchar(i, row, length);
+  return Value(column.type, std::string(data, length));
+}
+
+void ColumnBatch::Rewind() {
+  Clear();
+  started_ = false;
+  position_ = RID();
+}
+
+void ColumnBatch::Clear() {
+  size_ = 0;
+  selected_count_ = 0;
+  for (auto &column : columns_)
+    column.heap.clear();
+}
+
+void ColumnBatch::Append(const Tuple &tuple) {
+  assert(size_ < CAPACITY);
+  const char *data = tuple.GetData();
+  int32_t bitmap_size = schema_->GetNullBitmapSize();
+  memcpy(null_bitmaps_.data() + size_ * bitmap_size,
+         tuple.GetNullBitmap(schema_), bitmap_size);
+  for (auto &column : columns_) {
+    if (column.is_inlined) {
+      memcpy(column.data.data() + size_ * column.width, data + column.offset,
+             column.width);
+      continue;
+    }
+    int32_t offset = *reinterpret_cast<const int32_t *>(data + column.offset);
+    uint32_t length = *reinterpret_cast<const uint32_t *>(data + offset);
+    if (length == PELOTON_VALUE_NULL)
+      length = 0;
+    AppendVarchar(column, size_, data + offset + sizeof(uint32_t), length);
+  }
+  rids_[size_] = tuple.GetRid();
+  selection_[size_] = static_cast<uint16_t>(size_);
+  size_++;
+  selected_count_ = size_;
+}
+
+/*
+ * Runs of consecutive rows of a fixed size column are one memcpy out of the
+ * column's mini page
+ */
+void ColumnBatch::AppendColumns(PaxTablePage *page,
+                                const std::vector<int> &slots) {
+  const int count = static_cast<int>(slots.size());
+  assert(size_ + count <= CAPACITY);
+  if (count == 0)
+    return;
+  for (auto &column : columns_) {
+    if (column.is_inlined) {
+      page->CopyValues(column.column_id, slots,
+                       column.data.data() + size_ * column.width);
+      continue;
+    }
+    for (int i = 0; i < count; i++) {
+      uint32_t length;
+      const char *value = page->GetVarchar(column.column_id, slots[i], length);
+      AppendVarchar(column, size_ + i, value, length);
+    }
+  }
+  // the null bitmap is the last column of the page
+  page->CopyValues(page->GetColumnCount() - 1, slots,
+                   reinterpret_cast<char *>(null_bitmaps_.data()) +
+                       size_ * schema_->GetNullBitmapSize());
+  page_id_t page_id = page->GetPageId();
+  for (int i = 0; i < count; i++) {
+    rids_[size_ + i] = RID(page_id, slots[i]);
+    selection_[size_ + i] = static_cast<uint16_t>(size_ + i);
+  }
+  size_ += count;
+  selected_count_ = size_;
+}
+
+void ColumnBatch::AppendVarchar(Column &column, int row, const char *value,
+                                uint32_t length) {
+  if (IsOverflowPrefix(length)) {
+    OverflowPointer pointer;
+    memcpy(&pointer, value, sizeof(OverflowPointer));
+    // left empty if the buffer pool runs out of pages
+    std::string overflow;
+    table_heap_->ReadOverflow(pointer, overflow);
+    AppendVarchar(column, row, overflow.data(),
+                  static_cast<uint32_t>(overflow.size()));
+    return;
+  }
+  // strings are stored with their terminator
+  if (length > 0 && value[length - 1] == '\0')
+    length--;
+  column.offsets[row] = static_cast<uint32_t>(column.heap.size());
+  column.heap.insert(column.heap.end(), value, value + length);
+  column.offsets[row + 1] = static_cast<uint32_t>(column.heap.size());
+}
+
+} // namespace cmudb
@@ -0,0 +1,109 @@
+/**
+ * free_space_map.cpp
+ */
+
+#include <algorithm>
+
+#include "table/free_space_map.h"
+
+namespace cmudb {
+// bytes per category
+static const int32_t CATEGORY_SIZE = PAGE_SIZE / 256;
+
+uint8_t FreeSpaceMap::ToCategory(int32_t free_space) {
+  return static_cast<uint8_t>(
+      std::min<int32_t>(std::max<int32_t>(free_space, 0) / CATEGORY_SIZE, 255));
+}
+
+void FreeSpaceMap::Update(page_id_t page_id, int32_t free_space) {
+  std::lock_guard<std::mutex> guard(latch_);
+  auto it = slots_.find(page_id);
+  size_t slot;
+  if (it == slots_.end()) {
+    slot = page_ids_.size();
+    if (slot == capacity_)
+      Grow(std::max<size_t>(capacity_ * 2, 16));
+    page_ids_.push_back(page_id);
+    slots_[page_id] = slot;
+  } else {
+    slot = it->second;
+  }
+  Set(slot, ToCategory(free_space));
+}
+
+/*
+ * The slot is left in place with no free space, so that the slots of other
+ * pages stay valid
+ */
+void FreeSpaceMap::Remove(page_id_t page_id) {
+  std::lock_guard<std::mutex> guard(latch_);
+  auto it = slots_.find(page_id);
+  if (it == slots_.end())
+    return;
+  Set(it->second, 0);
+  page_ids_[it->second] = INVALID_PAGE_ID;
+  slots_.erase(it);
+}
+
+page_id_t FreeSpaceMap::Find(int32_t size) {
+  // round up, a page in the category surely has room
+  int32_t category = (std::max<int32_t>(size, 1) + CATEGORY_SIZE - 1) /
+                     CATEGORY_SIZE;
+  std::lock_guard<std::mutex> guard(latch_);
+  if (capacity_ == 0 || tree_[1] < category)
+    return INVALID_PAGE_ID;
+  // descend towards the leftmost leaf that is large enough
+  size_t node = 1;
+  while (node < capacity_) {
+    node *= 2;
+    if (tree_[node] < category)
+      node++;
+  }
+  return page_ids_[node - capacity_];
+}
+
+int32_t FreeSpaceMap::GetFreeSpace(page_id_t page_id) {
+  std::lock_guard<std::mutex> guard(latch_);
+  auto it = slots_.find(page_id);
+  if (it == slots_.end())
+    return -1;
+  return tree_[capacity_ + it->second] * CATEGORY_SIZE;
+}
+
+int FreeSpaceMap::GetPageCount() {
+  std::lock_guard<std::mutex> guard(latch_);
+  return static_cast<int>(slots_.size());
+}
+
+std::vector<page_id_t> FreeSpaceMap::GetPageIds() {
+  std::lock_guard<std::mutex> guard(latch_);
+  std::vector<page_id_t> page_ids;
+  page_ids.reserve(slots_.size());
+  for (auto page_id : page_ids_)
+    if (page_id != INVALID_PAGE_ID)
+      page_ids.push_back(page_id);
+  return page_ids;
+}
+
+void FreeSpaceMap::Grow(size_t capacity) {
+  std::vector<uint8_t> tree(2 * capacity, 0);
+  for (size_t i = 0; i < page_ids_.size(); i++)
+    tree[capacity + i] = tree_[capacity_ + i];
+  for (size_t node = capacity - 1; node > 0; node--)
+    tree[node] = std::max(tree[2 * node], tree[2 * node + 1]);
+  tree_.swap(tree);
+  capacity_ = capacity;
+}
+
+void FreeSpaceMap::Set(size_t slot, uint8_t category) {
+  size_t node = capacity_ + slot;
+  tree_[node] = category;
+  for (node /= 2; node > 0; node /= 2) {
+    uint8_t max = std::max(tree_[2 * node], tree_[2 * node + 1]);
+    if (tree_[node] == max)
+      break;
+    tree_[node] = max;
+  }
+}
+
+} // namespace cmudb
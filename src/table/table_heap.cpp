@@ -2,89 +2,177 @@
  * table_heap.cpp
  */
 
+#include <algorithm>
+#include <atomic>
 #include <cassert>
+#include <cstring>
+#include <thread>
+#include <utility>
 
 #include "common/logger.h"
+#include "table/morsel_dispenser.h"
 #include "table/table_heap.h"
 
 namespace cmudb {
+// pages per morsel of a parallel scan
+static const size_t MORSEL_SIZE = 16;
+// largest tuple an empty slotted page can hold
+static const int32_t MAX_TUPLE_SIZE =
+    PAGE_SIZE - TABLE_PAGE_HEADER_SIZE - TABLE_PAGE_SLOT_SIZE;
 
 // open table
 TableHeap::TableHeap(BufferPoolManager *buffer_pool_manager,
                      LockManager *lock_manager, LogManager *log_manager,
-                     page_id_t first_page_id)
+                     page_id_t first_page_id, Schema *schema)
     : buffer_pool_manager_(buffer_pool_manager), lock_manager_(lock_manager),
-      log_manager_(log_manager), first_page_id_(first_page_id) {}
+      log_manager_(log_manager), first_page_id_(first_page_id),
+      schema_(schema) {}
 
 // create table
 TableHeap::TableHeap(BufferPoolManager *buffer_pool_manager,
                      LockManager *lock_manager, LogManager *log_manager,
-                     Transaction *txn)
+                     Transaction *txn, TableLayout layout, Schema *schema,
+                     const std::vector<ColumnEncoding> &encodings)
     : buffer_pool_manager_(buffer_pool_manager), lock_manager_(lock_manager),
-      log_manager_(log_manager) {
+      log_manager_(log_manager), schema_(schema) {
   auto first_page =
       static_cast<TablePage *>(buffer_pool_manager_->NewPage(first_page_id_));
   assert(first_page != nullptr); // todo: abort table creation?
   first_page->WLatch();
   LOG_DEBUG("new table page created %d", first_page_id_);
 
-  first_page->Init(first_page_id_, PAGE_SIZE, INVALID_LSN, log_manager_, txn);
+  if (layout == TableLayout::PAX) {
+    assert(schema != nullptr);
+    first_page->AsPax()->Init(first_page_id_, PAGE_SIZE, INVALID_LSN, schema,
+                              log_manager_, txn, encodings);
+  } else {
+    first_page->Init(first_page_id_, PAGE_SIZE, INVALID_LSN, log_manager_,
+                     txn);
+  }
+  free_space_map_.Update(first_page_id_, first_page->GetFreeSpaceSize());
+  last_page_id_ = first_page_id_;
+  free_space_map_loaded_ = true;
   first_page->WUnlatch();
   buffer_pool_manager_->UnpinPage(first_page_id_, true);
 }
 
-bool TableHeap::InsertTuple(const Tuple &tuple, RID &rid, Transaction *txn) {
-  if (tuple.size_ + 32 > PAGE_SIZE) { // larger than one page size
+/*
+ * The free space map names a page that should have room, the page's real
+ * free space is written back after every attempt, so a stale entry costs one
+ * wasted fetch. A new page is appended only when no page has room.
+ */
+bool TableHeap::InsertTuple(const Tuple &original, RID &rid,
+                            Transaction *txn) {
+  Tuple moved;
+  const Tuple *stored = MoveToOverflow(original, moved);
+  if (stored == nullptr || stored->size_ > MAX_TUPLE_SIZE) {
+    if (stored != nullptr)
+      FreeOverflow(*stored, &original);
     txn->SetState(TransactionState::ABORTED);
     return false;
   }
+  const Tuple &tuple = *stored;
+  if (!free_space_map_loaded_)
+    LoadFreeSpaceMap();
+
+  // tuple and a new slot
+  const int32_t needed = tuple.size_ + TABLE_PAGE_SLOT_SIZE;
+  while (true) {
+    bool is_new_page;
+    TablePage *page = FetchPageWithRoom(needed, is_new_page, txn);
+    if (page == nullptr) {
+      FreeOverflow(tuple, &original);
+      txn->SetState(TransactionState::ABORTED);
+      return false;
+    }
+    bool is_inserted =
+        page->InsertTuple(tuple, rid, txn, lock_manager_, log_manager_);
+    if (is_inserted)
+      zone_map_.Add(page->GetPageId(), tuple);
+    free_space_map_.Update(page->GetPageId(), page->GetFreeSpaceSize());
+    page->WUnlatch();
+    buffer_pool_manager_->UnpinPage(page->GetPageId(), is_new_page ||
+                                                           is_inserted);
+    if (is_inserted)
+      break;
+    if (is_new_page) { // does not fit even an empty page
+      FreeOverflow(tuple, &original);
+      txn->SetState(TransactionState::ABORTED);
+      return false;
+    }
+  }
+  txn->GetWriteSet()->emplace_back(rid, WType::INSERT, Tuple{}, this);
+  return true;
+}
 
-  auto cur_page =
-      static_cast<TablePage *>(buffer_pool_manager_->FetchPage(first_page_id_));
-  if (cur_page == nullptr) {
+/*
+ * Only a batch holding a large tuple is copied, with the values of its large
+ * tuples moved to overflow pages
+ */
+bool TableHeap::InsertTuples(const std::vector<Tuple> &originals,
+                             std::vector<RID> &rids, Transaction *txn) {
+  std::vector<Tuple> moved_tuples;
+  size_t next = 0;
+  // free the overflow values of the tuples not inserted
+  auto abort = [&]() {
+    for (size_t i = next; i < moved_tuples.size(); i++)
+      FreeOverflow(moved_tuples[i], &originals[i]);
     txn->SetState(TransactionState::ABORTED);
     return false;
+  };
+  bool has_large_tuple = false;
+  for (auto &tuple : originals)
+    has_large_tuple = has_large_tuple || tuple.size_ > OVERFLOW_THRESHOLD;
+  if (schema_ != nullptr && has_large_tuple) {
+    moved_tuples.reserve(originals.size());
+    for (auto &original : originals) {
+      moved_tuples.emplace_back();
+      const Tuple *stored = MoveToOverflow(original, moved_tuples.back());
+      if (stored == nullptr) {
+        moved_tuples.pop_back();
+        return abort();
+      }
+      if (stored == &original)
+        moved_tuples.back() = original;
+    }
+  }
+  const std::vector<Tuple> &tuples =
+      moved_tuples.empty() ? originals : moved_tuples;
+  for (auto &tuple : tuples) {
+    if (tuple.size_ > MAX_TUPLE_SIZE)
+      return abort();
   }
+  if (!free_space_map_loaded_)
+    LoadFreeSpaceMap();
 
-  cur_page->WLatch();
-  while (!cur_page->InsertTuple(
-      tuple, rid, txn, lock_manager_,
-      log_manager_)) { // fail to insert due to not enough space
-    auto next_page_id = cur_page->GetNextPageId();
-    if (next_page_id != INVALID_PAGE_ID) { // valid next page
-      cur_page->WUnlatch();
-      buffer_pool_manager_->UnpinPage(cur_page->GetPageId(), false);
-      cur_page = static_cast<TablePage *>(
-          buffer_pool_manager_->FetchPage(next_page_id));
-      cur_page->WLatch();
-    } else { // create new page
-      auto new_page =
-          static_cast<TablePage *>(buffer_pool_manager_->NewPage(next_page_id));
-      if (new_page == nullptr) {
-        cur_page->WUnlatch();
-        buffer_pool_manager_->UnpinPage(cur_page->GetPageId(), false);
-        txn->SetState(TransactionState::ABORTED);
-        return false;
-      }
-      new_page->WLatch();
-      // std::cout << "new table page " << next_page_id << " created" <<
-      // std::endl;
-      cur_page->SetNextPageId(next_page_id);
-      new_page->Init(next_page_id, PAGE_SIZE, cur_page->GetPageId(),
-                     log_manager_, txn);
-      cur_page->WUnlatch();
-      buffer_pool_manager_->UnpinPage(cur_page->GetPageId(), true);
-      cur_page = new_page;
+  rids.reserve(rids.size() + tuples.size());
+  auto write_set = txn->GetWriteSet();
+  while (next < tuples.size()) {
+    bool is_new_page;
+    TablePage *page = FetchPageWithRoom(
+        tuples[next].size_ + TABLE_PAGE_SLOT_SIZE, is_new_page, txn);
+    if (page == nullptr)
+      return abort();
+    size_t count = page->InsertTuples(tuples, next, rids, txn, lock_manager_,
+                                      log_manager_);
+    if (zone_map_.IsInitialized()) {
+      for (size_t i = next; i < next + count; i++)
+        zone_map_.Add(page->GetPageId(), tuples[i]);
     }
+    free_space_map_.Update(page->GetPageId(), page->GetFreeSpaceSize());
+    page->WUnlatch();
+    buffer_pool_manager_->UnpinPage(page->GetPageId(),
+                                    is_new_page || count != 0);
+    for (size_t i = rids.size() - count; i < rids.size(); i++)
+      write_set->emplace_back(rids[i], WType::INSERT, Tuple{}, this);
+    next += count;
+    if (is_new_page && count == 0) // does not fit even an empty page
+      return abort();
   }
-  cur_page->WUnlatch();
-  buffer_pool_manager_->UnpinPage(cur_page->GetPageId(), true);
-  txn->GetWriteSet()->emplace_back(rid, WType::INSERT, Tuple{}, this);
   return true;
 }
 
 bool TableHeap::MarkDelete(const RID &rid, Transaction *txn) {
-  // todo: remove empty page
   auto page = reinterpret_cast<TablePage *>(
       buffer_pool_manager_->FetchPage(rid.GetPageId()));
   if (page == nullptr) {
@@ -99,20 +187,33 @@ bool TableHeap::MarkDelete(const RID &rid, Transaction *txn) {
   return true;
 }
 
-bool TableHeap::UpdateTuple(const Tuple &tuple, const RID &rid,
+bool TableHeap::UpdateTuple(const Tuple &original, const RID &rid,
                             Transaction *txn) {
-  auto page = reinterpret_cast<TablePage *>(
-      buffer_pool_manager_->FetchPage(rid.GetPageId()));
+  Tuple moved;
+  const Tuple *stored = MoveToOverflow(original, moved);
+  auto page = stored == nullptr
+                  ? nullptr
+                  : reinterpret_cast<TablePage *>(
+                        buffer_pool_manager_->FetchPage(rid.GetPageId()));
   if (page == nullptr) {
+    if (stored != nullptr)
+      FreeOverflow(*stored, &original);
     txn->SetState(TransactionState::ABORTED);
     return false;
   }
+  const Tuple &tuple = *stored;
   Tuple old_tuple;
   page->WLatch();
   bool is_updated = page->UpdateTuple(tuple, old_tuple, rid, txn, lock_manager_,
                                       log_manager_);
+  if (is_updated) {
+    zone_map_.Add(page->GetPageId(), tuple);
+    free_space_map_.Update(page->GetPageId(), page->GetFreeSpaceSize());
+  }
   page->WUnlatch();
   buffer_pool_manager_->UnpinPage(page->GetPageId(), is_updated);
+  if (!is_updated)
+    FreeOverflow(tuple, &original);
   if (is_updated && txn->GetState() != TransactionState::ABORTED)
     txn->GetWriteSet()->emplace_back(rid, WType::UPDATE, old_tuple, this);
   return is_updated;
@@ -122,11 +223,49 @@ void TableHeap::ApplyDelete(const RID &rid, Transaction *txn) {
   auto page = reinterpret_cast<TablePage *>(
       buffer_pool_manager_->FetchPage(rid.GetPageId()));
   assert(page != nullptr);
+  Tuple deleted_tuple;
   page->WLatch();
-  page->ApplyDelete(rid, txn, log_manager_);
+  page->ApplyDelete(rid, txn, log_manager_,
+                    schema_ == nullptr ? nullptr : &deleted_tuple);
   lock_manager_->Unlock(txn, rid);
+  free_space_map_.Update(page->GetPageId(), page->GetFreeSpaceSize());
   page->WUnlatch();
   buffer_pool_manager_->UnpinPage(page->GetPageId(), true);
+  FreeOverflow(deleted_tuple);
+}
+
+/*
+ * Every update writes the overflow values of the new tuple to chains of their
+ * own, so the chains of old_tuple the current tuple does not point to are
+ * garbage once the update is committed
+ */
+void TableHeap::ApplyUpdate(const Tuple &old_tuple, const RID &rid,
+                            Transaction *txn) {
+  Tuple current;
+  if (schema_ == nullptr || !ReadTuple(rid, current))
+    return;
+  FreeOverflow(old_tuple, &current);
+}
+
+void TableHeap::RollbackUpdate(const Tuple &old_tuple, const RID &rid,
+                               Transaction *txn) {
+  Tuple current;
+  bool has_current = schema_ != nullptr && ReadTuple(rid, current);
+  UpdateTuple(old_tuple, rid, txn);
+  if (has_current)
+    FreeOverflow(current, &old_tuple);
+}
+
+bool TableHeap::ReadTuple(const RID &rid, Tuple &tuple) {
+  auto page = static_cast<TablePage *>(
+      buffer_pool_manager_->FetchPage(rid.GetPageId()));
+  if (page == nullptr)
+    return false;
+  page->RLatch();
+  bool res = page->ReadTuple(rid, tuple);
+  page->RUnlatch();
+  buffer_pool_manager_->UnpinPage(rid.GetPageId(), false);
+  return res;
 }
 
 void TableHeap::RollbackDelete(const RID &rid, Transaction *txn) {
@@ -135,6 +274,12 @@ void TableHeap::RollbackDelete(const RID &rid, Transaction *txn) {
   assert(page != nullptr);
   page->WLatch();
   page->RollbackDelete(rid, txn, log_manager_);
+  // the zone map walk skips deleted tuples
+  if (zone_map_.IsInitialized()) {
+    Tuple tuple;
+    if (page->GetTupleView(rid, tuple, txn, lock_manager_))
+      zone_map_.Add(page->GetPageId(), tuple);
+  }
   page->WUnlatch();
   buffer_pool_manager_->UnpinPage(page->GetPageId(), true);
 }
@@ -154,22 +299,712 @@ bool TableHeap::GetTuple(const RID &rid, Tuple &tuple, Transaction *txn) {
   return res;
 }
 
+Value TableHeap::GetValue(const Tuple &tuple, Schema *schema, int column_id,
+                          Arena *arena) {
+  OverflowPointer pointer;
+  if (!tuple.GetOverflowPointer(schema, column_id, pointer))
+    return tuple.GetValue(schema, column_id, arena);
+  std::string value;
+  if (!ReadOverflow(pointer, value))
+    return Value(schema->GetType(column_id));
+  if (arena == nullptr)
+    return Value(schema->GetType(column_id), value.data(),
+                 static_cast<uint32_t>(value.size()), true);
+  char *data = arena->Allocate(value.size());
+  memcpy(data, value.data(), value.size());
+  return Value(schema->GetType(column_id), data,
+               static_cast<uint32_t>(value.size()), false);
+}
+
+bool TableHeap::ReadOverflow(const OverflowPointer &pointer,
+                             std::string &value) {
+  value.resize(GetPayloadSize(pointer.length));
+  size_t offset = 0;
+  page_id_t page_id = pointer.first_page_id;
+  while (offset < value.size() && page_id != INVALID_PAGE_ID) {
+    auto page =
+        static_cast<OverflowPage *>(buffer_pool_manager_->FetchPage(page_id));
+    if (page == nullptr)
+      break;
+    // overflow pages are never written after the chain is linked
+    size_t size = std::min<size_t>(page->GetDataSize(), value.size() - offset);
+    memcpy(&value[offset], page->GetPayload(), size);
+    offset += size;
+    page_id_t next_page_id = page->GetNextPageId();
+    buffer_pool_manager_->UnpinPage(page_id, false);
+    page_id = next_page_id;
+  }
+  if (offset == value.size())
+    return true;
+  value.clear();
+  return false;
+}
+
+/*
+ * Pages are deleted one by one while walking the chain, the overflow values
+ * of the live tuples go first
+ */
 bool TableHeap::DeleteTableHeap() {
-  // todo: real delete
-  return true;
+  StopVacuumThread();
+  std::lock_guard<std::mutex> vacuum_guard(vacuum_latch_);
+  std::lock_guard<std::mutex> guard(append_latch_);
+  bool success = true;
+  Tuple tuple;
+  page_id_t page_id = first_page_id_;
+  while (page_id != INVALID_PAGE_ID) {
+    auto page =
+        static_cast<TablePage *>(buffer_pool_manager_->FetchPage(page_id));
+    if (page == nullptr)
+      return false; // the rest of the chain leaks
+    page->WLatch();
+    RID rid;
+    bool valid = schema_ != nullptr && page->GetFirstTupleRid(rid);
+    while (valid) {
+      if (page->ReadTuple(rid, tuple))
+        FreeOverflow(tuple);
+      RID next_rid;
+      valid = page->GetNextTupleRid(rid, next_rid);
+      rid = next_rid;
+    }
+    page_id_t next_page_id = page->GetNextPageId();
+    page->WUnlatch();
+    buffer_pool_manager_->UnpinPage(page_id, false);
+    success = buffer_pool_manager_->DeletePage(page_id) && success;
+    page_id = next_page_id;
+  }
+  for (auto retired_page_id : retired_page_ids_)
+    success = buffer_pool_manager_->DeletePage(retired_page_id) && success;
+  retired_page_ids_.clear();
+  first_page_id_ = INVALID_PAGE_ID;
+  last_page_id_ = INVALID_PAGE_ID;
+  return success;
+}
+
+/*
+ * Pages are vacuumed one at a time, so that inserts and scans only ever wait
+ * for a single page. A page found empty is unlinked afterwards, see
+ * UnlinkPage. An unlinked page that is still pinned cannot be deleted yet, it
+ * is retired and the next vacuums try again
+ */
+int TableHeap::Vacuum(int max_pages) {
+  if (!free_space_map_loaded_)
+    LoadFreeSpaceMap();
+  if (!free_space_map_loaded_)
+    return 0;
+  std::lock_guard<std::mutex> guard(vacuum_latch_);
+  int deleted_count = 0;
+  for (auto itr = retired_page_ids_.begin();
+       itr != retired_page_ids_.end();) {
+    if (buffer_pool_manager_->DeletePage(*itr)) {
+      deleted_count++;
+      itr = retired_page_ids_.erase(itr);
+    } else {
+      ++itr;
+    }
+  }
+  for (int i = 0; i < max_pages; i++) {
+    // start over at the end of the chain
+    page_id_t page_id = vacuum_page_id_ == INVALID_PAGE_ID ? first_page_id_
+                                                           : vacuum_page_id_;
+    if (page_id == INVALID_PAGE_ID)
+      break;
+    auto page =
+        static_cast<TablePage *>(buffer_pool_manager_->FetchPage(page_id));
+    if (page == nullptr)
+      break;
+    page->WLatch();
+    bool is_vacuumed = page->Vacuum();
+    if (is_vacuumed)
+      free_space_map_.Update(page_id, page->GetFreeSpaceSize());
+    bool is_empty = page->IsEmpty();
+    vacuum_page_id_ = page->GetNextPageId();
+    page->WUnlatch();
+    buffer_pool_manager_->UnpinPage(page_id, is_vacuumed);
+    if (!is_empty || !UnlinkPage(page_id))
+      continue;
+    if (buffer_pool_manager_->DeletePage(page_id))
+      deleted_count++;
+    else
+      retired_page_ids_.push_back(page_id);
+  }
+  return deleted_count;
+}
+
+void TableHeap::RunVacuumThread(int pages_per_round,
+                                std::chrono::milliseconds interval) {
+  std::lock_guard<std::mutex> guard(vacuum_thread_latch_);
+  if (!vacuum_thread_stopped_)
+    return;
+  vacuum_thread_stopped_ = false;
+  vacuum_thread_ = std::thread([this, pages_per_round, interval]() {
+    std::unique_lock<std::mutex> lock(vacuum_thread_latch_);
+    while (!vacuum_thread_stopped_) {
+      lock.unlock();
+      Vacuum(pages_per_round);
+      lock.lock();
+      vacuum_cv_.wait_for(lock, interval,
+                          [this]() { return vacuum_thread_stopped_; });
+    }
+  });
+}
+
+void TableHeap::StopVacuumThread() {
+  {
+    std::lock_guard<std::mutex> guard(vacuum_thread_latch_);
+    if (vacuum_thread_stopped_)
+      return;
+    vacuum_thread_stopped_ = true;
+  }
+  vacuum_cv_.notify_all();
+  vacuum_thread_.join();
+}
+
+void TableHeap::LoadFreeSpaceMap() {
+  std::lock_guard<std::mutex> guard(append_latch_);
+  if (free_space_map_loaded_)
+    return;
+  page_id_t page_id = first_page_id_;
+  while (page_id != INVALID_PAGE_ID) {
+    auto page =
+        static_cast<TablePage *>(buffer_pool_manager_->FetchPage(page_id));
+    if (page == nullptr)
+      return; // try again on the next insert
+    page->RLatch();
+    free_space_map_.Update(page_id, page->GetFreeSpaceSize());
+    last_page_id_ = page_id;
+    page_id = page->GetNextPageId();
+    page->RUnlatch();
+    buffer_pool_manager_->UnpinPage(last_page_id_, false);
+  }
+  free_space_map_loaded_ = true;
+}
+
+/*
+ * Inserts keep the zones of known pages up to date from the moment the map is
+ * initialized, so a tuple inserted while the walk is under way is either seen
+ * by the walk or added to the zones by its insert. Appends wait for the walk,
+ * which keeps the directory in page chain order.
+ */
+void TableHeap::LoadZoneMap(Schema *schema, Transaction *txn) {
+  std::lock_guard<std::mutex> guard(append_latch_);
+  if (zone_map_loaded_)
+    return;
+  zone_map_.Init(schema);
+  Tuple tuple;
+  page_id_t page_id = first_page_id_;
+  while (page_id != INVALID_PAGE_ID) {
+    auto page =
+        static_cast<TablePage *>(buffer_pool_manager_->FetchPage(page_id));
+    if (page == nullptr)
+      return; // try again on the next filtered scan
+    page->RLatch();
+    zone_map_.AddPage(page_id);
+    RID rid;
+    bool valid = page->GetFirstTupleRid(rid);
+    while (valid) {
+      if (page->GetTupleView(rid, tuple, txn, lock_manager_))
+        zone_map_.Add(page_id, tuple);
+      RID next_rid;
+      valid = page->GetNextTupleRid(rid, next_rid);
+      rid = next_rid;
+    }
+    page_id_t next_page_id = page->GetNextPageId();
+    page->RUnlatch();
+    buffer_pool_manager_->UnpinPage(page_id, false);
+    // a tuple the walk could not lock may be missing
+    if (txn->GetState() == TransactionState::ABORTED)
+      return;
+    page_id = next_page_id;
+  }
+  zone_map_loaded_ = true;
+}
+
+/*
+ * A moved value leaves an OverflowPointer behind, values no larger than that
+ * are not worth moving
+ */
+const Tuple *TableHeap::MoveToOverflow(const Tuple &tuple, Tuple &moved) {
+  if (schema_ == nullptr || tuple.size_ <= OVERFLOW_THRESHOLD)
+    return &tuple;
+  const std::vector<int> &columns = schema_->GetUnlinedColumns();
+  // (payload size, position in columns) of the values that may be moved
+  std::vector<std::pair<uint32_t, size_t>> candidates;
+  for (size_t i = 0; i < columns.size(); i++) {
+    uint32_t prefix = *reinterpret_cast<const uint32_t *>(
+        tuple.GetDataPtr(schema_, columns[i]));
+    if (!IsOverflowPrefix(prefix) &&
+        GetPayloadSize(prefix) > sizeof(OverflowPointer))
+      candidates.emplace_back(GetPayloadSize(prefix), i);
+  }
+  // largest first
+  std::sort(candidates.rbegin(), candidates.rend());
+  std::vector<OverflowPointer> pointers(columns.size(),
+                                        OverflowPointer{INVALID_PAGE_ID, 0});
+  int32_t size = tuple.size_;
+  for (auto &candidate : candidates) {
+    if (size <= OVERFLOW_THRESHOLD)
+      break;
+    const char *value = tuple.GetDataPtr(schema_, columns[candidate.second]);
+    page_id_t page_id = WriteOverflow(value + sizeof(uint32_t),
+                                      candidate.first);
+    if (page_id == INVALID_PAGE_ID) {
+      for (auto &pointer : pointers) {
+        if (pointer.first_page_id != INVALID_PAGE_ID)
+          FreeOverflowChain(pointer.first_page_id);
+      }
+      return nullptr;
+    }
+    pointers[candidate.second] =
+        OverflowPointer{page_id, *reinterpret_cast<const uint32_t *>(value)};
+    size -= candidate.first - sizeof(OverflowPointer);
+  }
+  if (size == tuple.size_)
+    return &tuple;
+
+  // the fixed part and the null bitmap as is, then the varlen values in
+  // column order
+  if (moved.allocated_)
+    delete[] moved.data_;
+  moved.size_ = size;
+  moved.data_ = new char[size];
+  moved.rid_ = tuple.rid_;
+  moved.allocated_ = true;
+  int32_t offset = schema_->GetVarlenOffset();
+  memcpy(moved.data_, tuple.data_, offset);
+  for (size_t i = 0; i < columns.size(); i++) {
+    memcpy(moved.data_ + schema_->GetOffset(columns[i]), &offset,
+           sizeof(int32_t));
+    if (pointers[i].first_page_id != INVALID_PAGE_ID) {
+      uint32_t prefix = OVERFLOW_FLAG | sizeof(OverflowPointer);
+      memcpy(moved.data_ + offset, &prefix, sizeof(uint32_t));
+      memcpy(moved.data_ + offset + sizeof(uint32_t), &pointers[i],
+             sizeof(OverflowPointer));
+      offset += sizeof(uint32_t) + sizeof(OverflowPointer);
+      continue;
+    }
+    const char *value = tuple.GetDataPtr(schema_, columns[i]);
+    int32_t value_size = sizeof(uint32_t) +
+        GetPayloadSize(*reinterpret_cast<const uint32_t *>(value));
+    memcpy(moved.data_ + offset, value, value_size);
+    offset += value_size;
+  }
+  assert(offset == size);
+  return &moved;
+}
+
+/*
+ * Overflow pages are not logged, with logging enabled they are flushed before
+ * the tuple pointing to them can reach the log
+ */
+page_id_t TableHeap::WriteOverflow(const char *data, uint32_t size) {
+  page_id_t first_page_id = INVALID_PAGE_ID;
+  OverflowPage *prev_page = nullptr;
+  uint32_t offset = 0;
+  auto release = [&](OverflowPage *page) {
+    if (ENABLE_LOGGING)
+      buffer_pool_manager_->FlushPage(page->GetPageId());
+    buffer_pool_manager_->UnpinPage(page->GetPageId(), true);
+  };
+  while (offset < size) {
+    page_id_t page_id;
+    auto page =
+        static_cast<OverflowPage *>(buffer_pool_manager_->NewPage(page_id));
+    if (page == nullptr) {
+      if (prev_page != nullptr)
+        release(prev_page);
+      if (first_page_id != INVALID_PAGE_ID)
+        FreeOverflowChain(first_page_id);
+      return INVALID_PAGE_ID;
+    }
+    uint32_t slice = std::min<uint32_t>(size - offset, OverflowPage::CAPACITY);
+    page->Init(page_id, data + offset, slice);
+    offset += slice;
+    if (prev_page == nullptr) {
+      first_page_id = page_id;
+    } else {
+      prev_page->SetNextPageId(page_id);
+      release(prev_page);
+    }
+    prev_page = page;
+  }
+  if (prev_page != nullptr)
+    release(prev_page);
+  return first_page_id;
+}
+
+void TableHeap::FreeOverflowChain(page_id_t page_id) {
+  while (page_id != INVALID_PAGE_ID) {
+    auto page =
+        static_cast<OverflowPage *>(buffer_pool_manager_->FetchPage(page_id));
+    if (page == nullptr)
+      return; // the rest of the chain leaks
+    page_id_t next_page_id = page->GetNextPageId();
+    buffer_pool_manager_->UnpinPage(page_id, false);
+    buffer_pool_manager_->DeletePage(page_id);
+    page_id = next_page_id;
+  }
 }
 
-TableIterator TableHeap::begin(Transaction *txn) {
+void TableHeap::FreeOverflow(const Tuple &tuple, const Tuple *keep) {
+  if (schema_ == nullptr || tuple.data_ == nullptr)
+    return;
+  for (auto &column_id : schema_->GetUnlinedColumns()) {
+    OverflowPointer pointer, kept;
+    if (!tuple.GetOverflowPointer(schema_, column_id, pointer))
+      continue;
+    if (keep != nullptr && keep->data_ != nullptr &&
+        keep->GetOverflowPointer(schema_, column_id, kept) &&
+        kept.first_page_id == pointer.first_page_id)
+      continue;
+    FreeOverflowChain(pointer.first_page_id);
+  }
+}
+
+/*
+ * A page found in the free space map may be unlinked by vacuum before it is
+ * latched, vacuum removes it from the map first, so such a page is skipped
+ */
+TablePage *TableHeap::FetchPageWithRoom(int32_t size, bool &is_new_page,
+                                        Transaction *txn) {
+  while (true) {
+    page_id_t page_id = free_space_map_.Find(size);
+    is_new_page = page_id == INVALID_PAGE_ID;
+    if (is_new_page)
+      return AppendPage(txn);
+    auto page =
+        static_cast<TablePage *>(buffer_pool_manager_->FetchPage(page_id));
+    if (page == nullptr)
+      return nullptr;
+    page->WLatch();
+    if (free_space_map_.GetFreeSpace(page_id) >= 0)
+      return page;
+    page->WUnlatch();
+    buffer_pool_manager_->UnpinPage(page_id, false);
+  }
+}
+
+/*
+ * The neighbours are latched in chain order, prev, page, next, under the
+ * append latch, which keeps them from changing meanwhile. The unlinked page
+ * keeps its links and is written out empty before it is deleted, so a scan
+ * that still holds its page id reads an empty page and goes on from there.
+ * Page links are not logged, as when appending.
+ */
+bool TableHeap::UnlinkPage(page_id_t page_id) {
+  std::lock_guard<std::mutex> guard(append_latch_);
+  // the first page anchors the table, the last one takes the appends
+  if (page_id == first_page_id_ || page_id == last_page_id_)
+    return false;
   auto page =
-      static_cast<TablePage *>(buffer_pool_manager_->FetchPage(first_page_id_));
+      static_cast<TablePage *>(buffer_pool_manager_->FetchPage(page_id));
+  if (page == nullptr)
+    return false;
   page->RLatch();
+  page_id_t prev_page_id = page->GetPrevPageId();
+  page_id_t next_page_id = page->GetNextPageId();
+  page->RUnlatch();
+  auto prev_page =
+      static_cast<TablePage *>(buffer_pool_manager_->FetchPage(prev_page_id));
+  auto next_page = prev_page == nullptr
+                       ? nullptr
+                       : static_cast<TablePage *>(
+                             buffer_pool_manager_->FetchPage(next_page_id));
+  if (next_page == nullptr) {
+    if (prev_page != nullptr)
+      buffer_pool_manager_->UnpinPage(prev_page_id, false);
+    buffer_pool_manager_->UnpinPage(page_id, false);
+    return false;
+  }
+  prev_page->WLatch();
+  page->WLatch();
+  next_page->WLatch();
+  // an insert may have come in since the page was vacuumed
+  bool is_unlinked = page->IsEmpty();
+  if (is_unlinked) {
+    prev_page->SetNextPageId(next_page_id);
+    next_page->SetPrevPageId(prev_page_id);
+    free_space_map_.Remove(page_id);
+    zone_map_.RemovePage(page_id);
+  }
+  next_page->WUnlatch();
+  page->WUnlatch();
+  prev_page->WUnlatch();
+  buffer_pool_manager_->UnpinPage(next_page_id, is_unlinked);
+  buffer_pool_manager_->UnpinPage(prev_page_id, is_unlinked);
+  if (is_unlinked)
+    buffer_pool_manager_->FlushPage(page_id);
+  buffer_pool_manager_->UnpinPage(page_id, false);
+  return is_unlinked;
+}
+
+TablePage *TableHeap::AppendPage(Transaction *txn) {
+  std::lock_guard<std::mutex> guard(append_latch_);
+  auto last_page = static_cast<TablePage *>(
+      buffer_pool_manager_->FetchPage(last_page_id_));
+  if (last_page == nullptr)
+    return nullptr;
+  page_id_t page_id;
+  auto new_page =
+      static_cast<TablePage *>(buffer_pool_manager_->NewPage(page_id));
+  if (new_page == nullptr) {
+    buffer_pool_manager_->UnpinPage(last_page_id_, false);
+    return nullptr;
+  }
+  new_page->WLatch();
+  last_page->WLatch();
+  // new pages take the layout of the table
+  if (last_page->IsPax())
+    new_page->AsPax()->InitLike(page_id, last_page_id_, last_page->AsPax(),
+                                log_manager_, txn);
+  else
+    new_page->Init(page_id, PAGE_SIZE, last_page_id_, log_manager_, txn);
+  last_page->SetNextPageId(page_id);
+  last_page->WUnlatch();
+  buffer_pool_manager_->UnpinPage(last_page_id_, true);
+  last_page_id_ = page_id;
+  free_space_map_.Update(page_id, new_page->GetFreeSpaceSize());
+  zone_map_.AddPage(page_id);
+  return new_page;
+}
+
+/**
+ * Parallel scan: the page directory (the free space map) is split into
+ * morsels of MORSEL_SIZE pages, every worker repeatedly claims the next
+ * morsel and reads all tuples of its pages. The callback runs while the page
+ * is read latched, so it must not modify this table, and the tuple it gets
+ * points into the page, so it must be copied to outlive the callback.
+ */
+bool TableHeap::ParallelScan(
+    int num_threads, const std::function<void(int, const Tuple &)> &callback,
+    Transaction *txn) {
+  std::vector<Tuple> tuples(std::max(num_threads, 1));
+  return ScanMorsels(
+      num_threads,
+      [&](int worker_id, TablePage *page) {
+        Tuple &tuple = tuples[worker_id];
+        RID rid;
+        bool valid = page->GetFirstTupleRid(rid);
+        while (valid) {
+          if (page->GetTupleView(rid, tuple, txn, lock_manager_))
+            callback(worker_id, tuple);
+          RID next_rid;
+          valid = page->GetNextTupleRid(rid, next_rid);
+          rid = next_rid;
+        }
+      },
+      [](int) {});
+}
+
+bool TableHeap::ParallelBatchScan(
+    int num_threads, Schema *schema, const std::vector<int> &column_ids,
+    const std::function<void(int, ColumnBatch &)> &callback,
+    Transaction *txn) {
+  std::vector<ColumnBatch> batches(std::max(num_threads, 1),
+                                   ColumnBatch(schema, column_ids));
+  return ScanMorsels(
+      num_threads,
+      [&](int worker_id, TablePage *page) {
+        ColumnBatch &batch = batches[worker_id];
+        RID rid;
+        bool valid = page->GetFirstTupleRid(rid);
+        while (valid) {
+          valid = FillBatch(page, rid, batch, txn);
+          if (batch.GetSize() == ColumnBatch::CAPACITY) {
+            callback(worker_id, batch);
+            batch.Clear();
+          }
+        }
+      },
+      [&](int worker_id) {
+        ColumnBatch &batch = batches[worker_id];
+        if (batch.GetSize() > 0)
+          callback(worker_id, batch);
+        batch.Clear();
+      });
+}
+
+bool TableHeap::ScanMorsels(
+    int num_threads,
+    const std::function<void(int, TablePage *)> &page_callback,
+    const std::function<void(int)> &done_callback) {
+  if (!free_space_map_loaded_)
+    LoadFreeSpaceMap();
+  if (!free_space_map_loaded_)
+    return false;
+  MorselDispenser dispenser(free_space_map_.GetPageIds(), MORSEL_SIZE);
+  const std::vector<page_id_t> &page_ids = dispenser.GetPageIds();
+
+  std::atomic<bool> success{true};
+  auto worker = [&](int worker_id) {
+    size_t begin, end;
+    while (success && dispenser.Next(begin, end)) {
+      for (size_t i = begin; i < end; i++) {
+        auto page = static_cast<TablePage *>(
+            buffer_pool_manager_->FetchPage(page_ids[i]));
+        if (page == nullptr) {
+          success = false;
+          break;
+        }
+        page->RLatch();
+        page_callback(worker_id, page);
+        page->RUnlatch();
+        buffer_pool_manager_->UnpinPage(page_ids[i], false);
+      }
+    }
+    done_callback(worker_id);
+  };
+
+  std::vector<std::thread> threads;
+  for (int i = 1; i < num_threads; i++)
+    threads.emplace_back(worker, i);
+  worker(0);
+  for (auto &thread : threads)
+    thread.join();
+  return success;
+}
+
+/*
+ * Tuples are decoded straight out of the page, which is latched once per
+ * batch (or once per page for pages with fewer rows than a batch)
+ */
+bool TableHeap::NextBatch(ColumnBatch &batch, Transaction *txn) {
+  batch.Clear();
+  if (!batch.started_) {
+    batch.started_ = true;
+    batch.position_ = RID(first_page_id_, 0);
+  }
+  while (batch.position_.GetPageId() != INVALID_PAGE_ID &&
+         batch.size_ < ColumnBatch::CAPACITY) {
+    page_id_t page_id = batch.position_.GetPageId();
+    auto page =
+        static_cast<TablePage *>(buffer_pool_manager_->FetchPage(page_id));
+    if (page == nullptr) {
+      txn->SetState(TransactionState::ABORTED);
+      return false;
+    }
+    page->RLatch();
+    // first tuple at or after position_
+    RID rid;
+    int slot_num = batch.position_.GetSlotNum();
+    bool valid = slot_num == 0
+                     ? page->GetFirstTupleRid(rid)
+                     : page->GetNextTupleRid(RID(page_id, slot_num - 1), rid);
+    if (valid)
+      valid = FillBatch(page, rid, batch, txn);
+    if (valid)
+      batch.position_ = rid; // batch is full, rid is not read yet
+    else if (page->GetNextPageId() != INVALID_PAGE_ID)
+      batch.position_ = RID(page->GetNextPageId(), 0);
+    else
+      batch.position_ = RID();
+    page->RUnlatch();
+    buffer_pool_manager_->UnpinPage(page_id, false);
+  }
+  return batch.size_ > 0;
+}
+
+/*
+ * Rows of a PAX page are copied column by column, straight out of the mini
+ * pages, rows of a slotted page tuple by tuple
+ */
+bool TableHeap::FillBatch(TablePage *page, RID &rid, ColumnBatch &batch,
+                          Transaction *txn) {
+  bool valid = true;
+  batch.table_heap_ = this;
+  if (page->IsPax()) {
+    std::vector<int> &slots = batch.slots_;
+    slots.clear();
+    while (valid &&
+           batch.size_ + static_cast<int>(slots.size()) <
+               ColumnBatch::CAPACITY) {
+      slots.push_back(rid.GetSlotNum());
+      RID next_rid;
+      valid = page->GetNextTupleRid(rid, next_rid);
+      rid = next_rid;
+    }
+    batch.AppendColumns(page->AsPax(), slots);
+    return valid;
+  }
+  Tuple tuple;
+  while (valid && batch.size_ < ColumnBatch::CAPACITY) {
+    if (page->GetTupleView(rid, tuple, txn, lock_manager_))
+      batch.Append(tuple);
+    RID next_rid;
+    valid = page->GetNextTupleRid(rid, next_rid);
+    rid = next_rid;
+  }
+  return valid;
+}
+
+TableIterator TableHeap::begin(Transaction *txn, bool zero_copy) {
+  // first page holding a tuple, if all pages are empty rid stays invalid,
+  // which means eof
   RID rid;
-  // if failed (no tuple), rid will be the result of default
-  // constructor, which means eof
-  page->GetFirstTupleRid(rid);
+  page_id_t page_id = first_page_id_;
+  while (page_id != INVALID_PAGE_ID) {
+    auto page =
+        static_cast<TablePage *>(buffer_pool_manager_->FetchPage(page_id));
+    assert(page != nullptr);
+    page->RLatch();
+    bool found = page->GetFirstTupleRid(rid);
+    page_id_t next_page_id = page->GetNextPageId();
+    page->RUnlatch();
+    buffer_pool_manager_->UnpinPage(page_id, false);
+    if (found)
+      break;
+    page_id = next_page_id;
+  }
+  return TableIterator(this, rid, txn, zero_copy);
+}
+
+TableIterator TableHeap::begin(Transaction *txn, Schema *schema,
+                               const std::vector<RangePredicate> &predicates,
+                               bool zero_copy) {
+  if (predicates.empty())
+    return begin(txn, zero_copy);
+  if (!zone_map_loaded_)
+    LoadZoneMap(schema, txn);
+  if (!zone_map_loaded_)
+    return begin(txn, zero_copy);
+  // first candidate page holding a tuple
+  RID rid;
+  page_id_t page_id = zone_map_.NextPage(INVALID_PAGE_ID, predicates);
+  while (page_id != INVALID_PAGE_ID) {
+    auto page =
+        static_cast<TablePage *>(buffer_pool_manager_->FetchPage(page_id));
+    assert(page != nullptr);
+    page->RLatch();
+    bool found = page->GetFirstTupleRid(rid);
+    page->RUnlatch();
+    buffer_pool_manager_->UnpinPage(page_id, false);
+    if (found)
+      break;
+    page_id = zone_map_.NextPage(page_id, predicates);
+  }
+  TableIterator itr(this, rid, txn, zero_copy, predicates);
+  // the first tuple may still be ruled out by its dictionary codes
+  if (rid.GetPageId() != INVALID_PAGE_ID && !itr.MayMatch())
+    ++itr;
+  return itr;
+}
+
+std::vector<ColumnEncoding> TableHeap::GetColumnEncodings() {
+  std::vector<ColumnEncoding> encodings;
+  if (first_page_id_ == INVALID_PAGE_ID)
+    return encodings;
+  auto page = static_cast<TablePage *>(
+      buffer_pool_manager_->FetchPage(first_page_id_));
+  if (page == nullptr)
+    return encodings;
+  page->RLatch();
+  if (page->IsPax()) {
+    // the null bitmap is not a column of the table
+    for (int i = 0; i + 1 < page->AsPax()->GetColumnCount(); i++)
+      encodings.push_back(page->AsPax()->GetColumnEncoding(i));
+  }
   page->RUnlatch();
   buffer_pool_manager_->UnpinPage(first_page_id_, false);
-  return TableIterator(this, rid, txn);
+  return encodings;
 }
 
 TableIterator TableHeap::end() {
@@ -3,17 +3,153 @@
  */
 
 #include <cassert>
+#include <cstring>
 
 #include "table/table_heap.h"
 
 namespace cmudb {
 
-TableIterator::TableIterator(TableHeap *table_heap, RID rid, Transaction *txn)
-    : table_heap_(table_heap), tuple_(new Tuple(rid)), txn_(txn) {
-  if (rid.GetPageId() != INVALID_PAGE_ID) {
+TableIterator::TableIterator(TableHeap *table_heap, RID rid, Transaction *txn,
+                             bool zero_copy,
+                             std::vector<RangePredicate> predicates)
+    : table_heap_(table_heap), tuple_(new Tuple(rid)), txn_(txn),
+      zero_copy_(zero_copy), predicates_(std::move(predicates)) {
+  if (rid.GetPageId() == INVALID_PAGE_ID)
+    return;
+  if (!zero_copy_) {
     table_heap_->GetTuple(tuple_->rid_, *tuple_, txn_);
+    return;
   }
-};
+  page_ = static_cast<TablePage *>(
+      table_heap_->buffer_pool_manager_->FetchPage(rid.GetPageId()));
+  assert(page_ != nullptr);
+  page_->RLatch();
+  page_->GetTupleView(rid, *tuple_, txn_, table_heap_->lock_manager_);
+}
+
+TableIterator::TableIterator(const TableIterator &other)
+    : table_heap_(other.table_heap_), tuple_(new Tuple(other.tuple_->rid_)),
+      txn_(other.txn_), zero_copy_(false), predicates_(other.predicates_),
+      projection_(other.projection_) {
+  // the tuple may point into the other iterator's page
+  if (other.tuple_->data_ != nullptr) {
+    tuple_->size_ = other.tuple_->size_;
+    tuple_->data_ = new char[tuple_->size_];
+    memcpy(tuple_->data_, other.tuple_->data_, tuple_->size_);
+    tuple_->allocated_ = true;
+  }
+}
+
+TableIterator::TableIterator(TableIterator &&other)
+    : table_heap_(other.table_heap_), tuple_(other.tuple_), txn_(other.txn_),
+      zero_copy_(other.zero_copy_), page_(other.page_),
+      predicates_(std::move(other.predicates_)),
+      projection_(std::move(other.projection_)) {
+  other.tuple_ = new Tuple(tuple_->rid_);
+  other.page_ = nullptr;
+}
+
+TableIterator &TableIterator::operator=(TableIterator &&other) {
+  if (this == &other)
+    return *this;
+  ReleasePage();
+  delete tuple_;
+  table_heap_ = other.table_heap_;
+  tuple_ = other.tuple_;
+  txn_ = other.txn_;
+  zero_copy_ = other.zero_copy_;
+  page_ = other.page_;
+  predicates_ = std::move(other.predicates_);
+  projection_ = std::move(other.projection_);
+  other.tuple_ = new Tuple(tuple_->rid_);
+  other.page_ = nullptr;
+  return *this;
+}
+
+TableIterator::~TableIterator() {
+  ReleasePage();
+  delete tuple_;
+}
+
+void TableIterator::ReleasePage() {
+  if (page_ == nullptr)
+    return;
+  page_->RUnlatch();
+  table_heap_->buffer_pool_manager_->UnpinPage(page_->GetPageId(), false);
+  page_ = nullptr;
+}
+
+page_id_t TableIterator::GetNextPageId(TablePage *page) {
+  if (predicates_.empty())
+    return page->GetNextPageId();
+  return table_heap_->zone_map_.NextPage(page->GetPageId(), predicates_);
+}
+
+/*
+ * The codes are looked up once per page. A code stays with its value as long
+ * as a row refers to it, so the rows that were there when the page was first
+ * seen are never skipped wrongly. Neither are rows whose value was moved to
+ * overflow pages
+ */
+bool TableIterator::MayMatch(TablePage *page, const RID &rid) {
+  if (predicates_.empty() || !page->IsPax())
+    return true;
+  PaxTablePage *pax_page = page->AsPax();
+  if (code_page_id_ != page->GetPageId()) {
+    code_page_id_ = page->GetPageId();
+    codes_.clear();
+    for (auto &predicate : predicates_) {
+      int column_id = predicate.column_id;
+      if (predicate.op != RangeOp::EQ || column_id < 0 ||
+          column_id >= pax_page->GetColumnCount() ||
+          pax_page->GetColumnEncoding(column_id) !=
+              ColumnEncoding::DICTIONARY ||
+          predicate.value.GetTypeId() != TypeId::VARCHAR ||
+          predicate.value.IsNull())
+        continue;
+      codes_.emplace_back(column_id,
+                          pax_page->GetCode(column_id, predicate.value));
+    }
+  }
+  for (auto &code : codes_) {
+    if (pax_page->GetCode(code.first, rid.GetSlotNum()) == code.second)
+      continue;
+    // a value moved to overflow pages is an OverflowPointer in the dictionary
+    uint32_t length;
+    pax_page->GetVarchar(code.first, rid.GetSlotNum(), length);
+    if (!IsOverflowPrefix(length))
+      return false;
+  }
+  return true;
+}
+
+bool TableIterator::MayMatch() {
+  auto page = page_;
+  if (page == nullptr) {
+    page = static_cast<TablePage *>(
+        table_heap_->buffer_pool_manager_->FetchPage(tuple_->rid_.GetPageId()));
+    assert(page != nullptr);
+    page->RLatch();
+  }
+  bool res = MayMatch(page, tuple_->rid_);
+  if (page != page_) {
+    page->RUnlatch();
+    table_heap_->buffer_pool_manager_->UnpinPage(page->GetPageId(), false);
+  }
+  return res;
+}
+
+bool TableIterator::SkipMismatches(TablePage *page, RID &rid) {
+  while (!MayMatch(page, rid)) {
+    RID next_rid;
+    if (!page->GetNextTupleRid(rid, next_rid)) {
+      rid = RID();
+      return false;
+    }
+    rid = next_rid;
+  }
+  return true;
+}
 
 const Tuple &TableIterator::operator*() {
   assert(*this != table_heap_->end());
@@ -27,29 +163,47 @@ Tuple *TableIterator::operator->() {
 
 TableIterator &TableIterator::operator++() {
   BufferPoolManager *buffer_pool_manager = table_heap_->buffer_pool_manager_;
-  auto cur_page = static_cast<TablePage *>(
-      buffer_pool_manager->FetchPage(tuple_->rid_.GetPageId()));
-  cur_page->RLatch();
-  assert(cur_page != nullptr); // all pages are pinned
+  auto cur_page = page_;
+  if (cur_page == nullptr) {
+    cur_page = static_cast<TablePage *>(
+        buffer_pool_manager->FetchPage(tuple_->rid_.GetPageId()));
+    assert(cur_page != nullptr); // all pages are pinned
+    cur_page->RLatch();
+  }
 
   RID next_tuple_rid;
-  if (!cur_page->GetNextTupleRid(tuple_->rid_,
-                                 next_tuple_rid)) { // end of this page
-    while (cur_page->GetNextPageId() != INVALID_PAGE_ID) {
+  if (!cur_page->GetNextTupleRid(tuple_->rid_, next_tuple_rid) ||
+      !SkipMismatches(cur_page, next_tuple_rid)) { // end of this page
+    page_id_t next_page_id = GetNextPageId(cur_page);
+    while (next_page_id != INVALID_PAGE_ID) {
       auto next_page = static_cast<TablePage *>(
-          buffer_pool_manager->FetchPage(cur_page->GetNextPageId()));
+          buffer_pool_manager->FetchPage(next_page_id));
       cur_page->RUnlatch();
       buffer_pool_manager->UnpinPage(cur_page->GetPageId(), false);
       cur_page = next_page;
       cur_page->RLatch();
-      if (cur_page->GetFirstTupleRid(next_tuple_rid))
+      if (cur_page->GetFirstTupleRid(next_tuple_rid) &&
+          SkipMismatches(cur_page, next_tuple_rid))
         break;
+      next_page_id = GetNextPageId(cur_page);
     }
   }
   tuple_->rid_ = next_tuple_rid;
 
-  if (*this != table_heap_->end()) {
-    table_heap_->GetTuple(tuple_->rid_, *tuple_, txn_);
+  if (zero_copy_) {
+    // stay on the page, unless the scan is over
+    page_ = cur_page;
+    if (tuple_->rid_.GetPageId() != INVALID_PAGE_ID)
+      cur_page->GetTupleView(tuple_->rid_, *tuple_, txn_,
+                             table_heap_->lock_manager_);
+    else
+      ReleasePage();
+    return *this;
+  }
+  if (tuple_->rid_.GetPageId() != INVALID_PAGE_ID) {
+    cur_page->GetTuple(tuple_->rid_, *tuple_, txn_,
+                       table_heap_->lock_manager_, table_heap_->schema_,
+                       projection_);
   }
   // release until copy the tuple
   cur_page->RUnlatch();
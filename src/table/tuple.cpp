@@ -11,27 +11,35 @@
 
 namespace cmudb {
 
-Tuple::Tuple(std::vector<Value> values, Schema *schema) : allocated_(true) {
+Tuple::Tuple(const std::vector<Value> &values, Schema *schema, Arena *arena)
+    : allocated_(arena == nullptr) {
   assert((int)values.size() == schema->GetColumnCount());
 
-  // step1: calculate size of the tuple
-  int32_t tuple_size = schema->GetLength();
+  // step1: calculate size of the tuple, a null varchar is its prefix only
+  int32_t tuple_size = schema->GetVarlenOffset();
   for (auto &i : schema->GetUnlinedColumns())
-    tuple_size += (values[i].GetLength() + sizeof(uint32_t));
-  // allocate memory using new, allocated_ flag set as true
+    tuple_size += (values[i].IsNull() ? 0 : values[i].GetLength()) +
+                  sizeof(uint32_t);
+  // allocate memory using new (allocated_ flag set as true) or from arena
   size_ = tuple_size;
-  data_ = new char[size_];
+  data_ = arena == nullptr ? new char[size_] : arena->Allocate(size_);
 
   // step2: Serialize each column(attribute) based on input value
   int column_count = schema->GetColumnCount();
-  int32_t offset = schema->GetLength();
+  uint8_t *null_bitmap = reinterpret_cast<uint8_t *>(data_ +
+                                                     schema->GetLength());
+  memset(null_bitmap, 0, schema->GetNullBitmapSize());
+  int32_t offset = schema->GetVarlenOffset();
   for (int i = 0; i < column_count; i++) {
+    if (values[i].IsNull())
+      null_bitmap[i / 8] |= static_cast<uint8_t>(1 << (i % 8));
     if (!schema->IsInlined(i)) {
       // Serialize relative offset, where the actual varchar data is stored
       *reinterpret_cast<int32_t *>(data_ + schema->GetOffset(i)) = offset;
       // Serialize varchar value, in place(size+data)
       values[i].SerializeTo(data_ + offset);
-      offset += (values[i].GetLength() + sizeof(uint32_t));
+      offset += (values[i].IsNull() ? 0 : values[i].GetLength()) +
+                sizeof(uint32_t);
     } else {
       values[i].SerializeTo(data_ + schema->GetOffset(i));
     }
@@ -53,6 +61,10 @@ Tuple::Tuple(const Tuple &other)
 }
 
 Tuple &Tuple::operator=(const Tuple &other) {
+  if (this == &other)
+    return *this;
+  if (allocated_)
+    delete[] data_;
   allocated_ = other.allocated_;
   rid_ = other.rid_;
   size_ = other.size_;
@@ -69,16 +81,53 @@ Tuple &Tuple::operator=(const Tuple &other) {
   return *this;
 }
 
+Tuple &Tuple::operator=(Tuple &&other) noexcept {
+  if (this == &other)
+    return *this;
+  if (allocated_)
+    delete[] data_;
+  allocated_ = other.allocated_;
+  rid_ = other.rid_;
+  size_ = other.size_;
+  data_ = other.data_;
+  other.allocated_ = false;
+  other.size_ = 0;
+  other.data_ = nullptr;
+  return *this;
+}
+
 // Get the value of a specified column (const)
-Value Tuple::GetValue(Schema *schema, const int column_id) const {
+Value Tuple::GetValue(Schema *schema, const int column_id,
+                      Arena *arena) const {
   assert(schema);
   assert(data_);
+  assert(!IsOverflow(schema, column_id));
   const TypeId column_type = schema->GetType(column_id);
   const char *data_ptr = GetDataPtr(schema, column_id);
+  if (arena != nullptr && !schema->IsInlined(column_id)) {
+    uint32_t length = *reinterpret_cast<const uint32_t *>(data_ptr);
+    if (length == PELOTON_VALUE_NULL)
+      return Value(column_type, nullptr, 0, false);
+    char *data = arena->Allocate(length);
+    memcpy(data, data_ptr + sizeof(uint32_t), length);
+    return Value(column_type, data, length, false);
+  }
   // the third parameter "is_inlined" is unused
   return Value::DeserializeFrom(data_ptr, column_type);
 }
 
+bool Tuple::GetOverflowPointer(Schema *schema, const int column_id,
+                               OverflowPointer &pointer) const {
+  if (schema->IsInlined(column_id))
+    return false;
+  const char *data_ptr = GetDataPtr(schema, column_id);
+  uint32_t prefix = *reinterpret_cast<const uint32_t *>(data_ptr);
+  if (!IsOverflowPrefix(prefix))
+    return false;
+  memcpy(&pointer, data_ptr + sizeof(uint32_t), sizeof(OverflowPointer));
+  return true;
+}
+
 const char *Tuple::GetDataPtr(Schema *schema, const int column_id) const {
   assert(schema);
   assert(data_);
@@ -109,6 +158,8 @@ std::string Tuple::ToString(Schema *schema) const {
     }
     if (IsNull(schema, column_itr)) {
       os << "<NULL>";
+    } else if (IsOverflow(schema, column_itr)) {
+      os << "<OVERFLOW>";
     } else {
       Value val = (GetValue(schema, column_itr));
       os << val.ToString();
@@ -0,0 +1,16 @@
+/**
+ * tuple_accessor.cpp
+ */
+
+#include "table/tuple_accessor.h"
+
+namespace cmudb {
+
+TupleAccessor::TupleAccessor(Schema *schema)
+    : null_bitmap_offset_(schema->GetLength()) {
+  columns_.reserve(schema->GetColumnCount());
+  for (int i = 0; i < schema->GetColumnCount(); i++)
+    columns_.push_back(Column{schema->GetType(i), schema->GetOffset(i)});
+}
+
+} // namespace cmudb
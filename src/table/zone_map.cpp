@@ -0,0 +1,169 @@
+/**
+ * zone_map.cpp
+ */
+
+#include "table/zone_map.h"
+
+namespace cmudb {
+
+bool ZoneMap::IsTracked(TypeId type) {
+  return type >= TypeId::TINYINT && type <= TypeId::DECIMAL;
+}
+
+void ZoneMap::Init(Schema *schema) {
+  std::lock_guard<std::mutex> guard(latch_);
+  if (schema_ != nullptr)
+    return;
+  positions_.assign(schema->GetColumnCount(), -1);
+  tracked_columns_.clear();
+  for (int i = 0; i < schema->GetColumnCount(); i++) {
+    if (!IsTracked(schema->GetType(i)))
+      continue;
+    positions_[i] = static_cast<int>(tracked_columns_.size());
+    tracked_columns_.push_back(i);
+  }
+  schema_ = schema;
+}
+
+void ZoneMap::AddPage(page_id_t page_id) {
+  std::lock_guard<std::mutex> guard(latch_);
+  if (schema_ == nullptr || slots_.count(page_id) != 0)
+    return;
+  slots_[page_id] = page_ids_.size();
+  page_ids_.push_back(page_id);
+  zones_.emplace_back(tracked_columns_.size());
+}
+
+/*
+ * The slot is left in place, so that the slots of other pages stay valid, and
+ * so is the entry of page_id, so that a scan standing on the page can still
+ * find the page after it
+ */
+void ZoneMap::RemovePage(page_id_t page_id) {
+  std::lock_guard<std::mutex> guard(latch_);
+  auto it = slots_.find(page_id);
+  if (it == slots_.end() || page_ids_[it->second] == INVALID_PAGE_ID)
+    return;
+  page_ids_[it->second] = INVALID_PAGE_ID;
+  zones_[it->second].clear();
+  removed_count_++;
+}
+
+void ZoneMap::Add(page_id_t page_id, const Tuple &tuple) {
+  Schema *schema = schema_;
+  if (schema == nullptr)
+    return;
+  // decode outside of the latch
+  std::vector<Value> values;
+  values.reserve(tracked_columns_.size());
+  for (auto &column_id : tracked_columns_)
+    values.push_back(tuple.GetValue(schema, column_id));
+
+  std::lock_guard<std::mutex> guard(latch_);
+  auto it = slots_.find(page_id);
+  if (it == slots_.end() || page_ids_[it->second] == INVALID_PAGE_ID)
+    return;
+  std::vector<ColumnZone> &zones = zones_[it->second];
+  for (size_t i = 0; i < values.size(); i++) {
+    ColumnZone &zone = zones[i];
+    if (values[i].IsNull()) {
+      zone.null_count++;
+    } else if (!zone.has_values) {
+      zone.min = values[i];
+      zone.max = values[i];
+      zone.has_values = true;
+    } else if (values[i].CompareLessThan(zone.min) == CMP_TRUE) {
+      zone.min = values[i];
+    } else if (values[i].CompareGreaterThan(zone.max) == CMP_TRUE) {
+      zone.max = values[i];
+    }
+  }
+}
+
+/*
+ * A comparison with a null value is never true, so a zone without values
+ * rules out every predicate but IS NULL. Comparisons that come out null are
+ * taken as a possible match.
+ */
+bool ZoneMap::MayMatch(const ColumnZone &zone,
+                       const RangePredicate &predicate) {
+  if (predicate.op == RangeOp::IS_NULL)
+    return zone.null_count > 0;
+  if (!zone.has_values)
+    return false;
+  const Value &value = predicate.value;
+  switch (predicate.op) {
+  case RangeOp::EQ:
+    return zone.min.CompareLessThanEquals(value) != CMP_FALSE &&
+           zone.max.CompareGreaterThanEquals(value) != CMP_FALSE;
+  case RangeOp::LT:
+    return zone.min.CompareLessThan(value) != CMP_FALSE;
+  case RangeOp::LE:
+    return zone.min.CompareLessThanEquals(value) != CMP_FALSE;
+  case RangeOp::GT:
+    return zone.max.CompareGreaterThan(value) != CMP_FALSE;
+  case RangeOp::GE:
+    return zone.max.CompareGreaterThanEquals(value) != CMP_FALSE;
+  default:
+    return true;
+  }
+}
+
+bool ZoneMap::MayMatch(size_t slot,
+                       const std::vector<RangePredicate> &predicates) {
+  for (auto &predicate : predicates) {
+    if (predicate.column_id < 0 ||
+        predicate.column_id >= static_cast<int>(positions_.size()) ||
+        positions_[predicate.column_id] < 0)
+      continue;
+    if (!MayMatch(zones_[slot][positions_[predicate.column_id]], predicate))
+      return false;
+  }
+  return true;
+}
+
+bool ZoneMap::MayMatch(page_id_t page_id,
+                       const std::vector<RangePredicate> &predicates) {
+  std::lock_guard<std::mutex> guard(latch_);
+  auto it = slots_.find(page_id);
+  if (it == slots_.end() || page_ids_[it->second] == INVALID_PAGE_ID)
+    return true;
+  return MayMatch(it->second, predicates);
+}
+
+page_id_t ZoneMap::NextPage(page_id_t page_id,
+                            const std::vector<RangePredicate> &predicates) {
+  std::lock_guard<std::mutex> guard(latch_);
+  size_t slot = 0;
+  if (page_id != INVALID_PAGE_ID) {
+    auto it = slots_.find(page_id);
+    if (it == slots_.end())
+      return INVALID_PAGE_ID;
+    slot = it->second + 1;
+  }
+  for (; slot < page_ids_.size(); slot++) {
+    if (page_ids_[slot] != INVALID_PAGE_ID && MayMatch(slot, predicates))
+      return page_ids_[slot];
+  }
+  return INVALID_PAGE_ID;
+}
+
+bool ZoneMap::GetColumnZone(page_id_t page_id, int column_id,
+                            ColumnZone &zone) {
+  std::lock_guard<std::mutex> guard(latch_);
+  auto it = slots_.find(page_id);
+  if (it == slots_.end() || page_ids_[it->second] == INVALID_PAGE_ID ||
+      column_id < 0 ||
+      column_id >= static_cast<int>(positions_.size()) ||
+      positions_[column_id] < 0)
+    return false;
+  zone = zones_[it->second][positions_[column_id]];
+  return true;
+}
+
+int ZoneMap::GetPageCount() {
+  std::lock_guard<std::mutex> guard(latch_);
+  return static_cast<int>(slots_.size()) - removed_count_;
+}
+
+} // namespace cmudb
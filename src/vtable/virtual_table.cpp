@@ -2,9 +2,13 @@
  * virtual_table.cpp
  */
 #include <algorithm>
+#include <cmath>
 #include <cstring>
 #include <iostream>
+#include <limits>
+#include <sstream>
 #include <sys/stat.h>
+#include <thread>
 #include <vector>
 
 #include "common/exception.h"
@@ -17,47 +21,174 @@ namespace cmudb {
 
 SQLITE_EXTENSION_INIT1
 
+/*
+ * Table option dict=<columns> or rle=<columns> (comma separated), error is
+ * set if a column cannot take the encoding
+ */
+void ParseEncodingOption(const std::string &option, Schema *schema,
+                         std::vector<ColumnEncoding> &encodings,
+                         std::string &error) {
+  std::string::size_type n = option.find('=');
+  ColumnEncoding encoding = option.substr(0, n) == "dict"
+                                ? ColumnEncoding::DICTIONARY
+                                : ColumnEncoding::RLE;
+  std::string columns = option.substr(n + 1);
+  std::transform(columns.begin(), columns.end(), columns.begin(), ::tolower);
+  for (auto column_name : StringUtility::Split(columns, ',')) {
+    StringUtility::Trim(column_name);
+    int column_id = schema->GetColumnID(column_name);
+    // dictionaries are for varchars, runs for fixed size values
+    if (column_id < 0 ||
+        schema->IsInlined(column_id) !=
+            (encoding == ColumnEncoding::RLE)) {
+      error = "cannot encode column " + column_name + " as " +
+              option.substr(0, n);
+      return;
+    }
+    encodings[column_id] = encoding;
+  }
+}
+
+/*
+ * The storage engine is opened when the extension is loaded and again by the
+ * first table created or connected after the last one disconnected
+ */
+static void OpenStorageEngine() {
+  if (storage_engine_ != nullptr)
+    return;
+  std::string db_file_name = "vtable.db";
+  struct stat buffer;
+  bool is_file_exist = (stat(db_file_name.c_str(), &buffer) == 0);
+
+  // init storage engine
+  storage_engine_ = new StorageEngine(db_file_name);
+  // start the logging
+  storage_engine_->log_manager_->RunFlushThread();
+  // create header page from BufferPoolManager if necessary
+  if (!is_file_exist) {
+    page_id_t header_page_id;
+    storage_engine_->buffer_pool_manager_->NewPage(header_page_id);
+
+    assert(header_page_id == HEADER_PAGE_ID);
+    storage_engine_->buffer_pool_manager_->UnpinPage(header_page_id, true);
+  }
+}
+
 /* API implementation */
 int VtabCreate(sqlite3 *db, void *pAux, int argc, const char *const *argv,
                sqlite3_vtab **ppVtab, char **pzErr) {
+  OpenStorageEngine();
   BufferPoolManager *buffer_pool_manager =
       storage_engine_->buffer_pool_manager_;
   LockManager *lock_manager = storage_engine_->lock_manager_;
   LogManager *log_manager = storage_engine_->log_manager_;
-
-  // fetch header page from buffer pool
-  HeaderPage *header_page =
-      static_cast<HeaderPage *>(buffer_pool_manager->FetchPage(HEADER_PAGE_ID));
+  CatalogCache *catalog_cache = storage_engine_->catalog_cache_;
 
   // the first three parameter:(1) module name (2) database name (3)table name
   assert(argc >= 4);
+  // the prefix is taken by statistics records of the same catalog
+  if (IsStatisticsRecordName(argv[2])) {
+    *pzErr = sqlite3_mprintf("reserved table name: %s", argv[2]);
+    return SQLITE_ERROR;
+  }
   // parse arg[3](string that defines table schema)
   std::string schema_string(argv[3]);
   schema_string = schema_string.substr(1, (schema_string.size() - 2));
   Schema *schema = ParseCreateStatement(schema_string);
 
-  // parse arg[4](string that defines table index)
+  // parse the remaining args: table options (key=value) and the string that
+  // defines table index
   Index *index = nullptr;
-  if (argc > 4) {
-    std::string index_string(argv[4]);
-    index_string = index_string.substr(1, (index_string.size() - 2));
-    // create index object, allocate memory space
-    IndexMetadata *index_metadata =
-        ParseIndexStatement(index_string, std::string(argv[2]), schema);
-    index = ConstructIndex(index_metadata, buffer_pool_manager);
+  TableLayout layout = TableLayout::NSM;
+  std::vector<ColumnEncoding> encodings(schema->GetColumnCount(),
+                                        ColumnEncoding::PLAIN);
+  bool is_encoded = false;
+  // open the table a bulk load registered under the table name (attach=1)
+  page_id_t table_root_id = INVALID_PAGE_ID;
+  bool attach = false;
+  std::string index_string;
+  for (int i = 4; i < argc; i++) {
+    std::string arg(argv[i]);
+    arg = arg.substr(1, (arg.size() - 2));
+    if (arg.find('=') != std::string::npos) {
+      std::string error;
+      if (arg == "layout=pax") {
+        layout = TableLayout::PAX;
+      } else if (arg.compare(0, 5, "dict=") == 0 ||
+                 arg.compare(0, 4, "rle=") == 0) {
+        is_encoded = true;
+        ParseEncodingOption(arg, schema, encodings, error);
+      } else if (arg == "attach=1") {
+        attach = true;
+        if (!catalog_cache->GetRootId(std::string(argv[2]), table_root_id))
+          error = "no table " + std::string(argv[2]) + " to attach";
+      } else if (arg != "layout=nsm") {
+        error = "unknown table option: " + arg;
+      }
+      if (!error.empty()) {
+        *pzErr = sqlite3_mprintf("%s", error.c_str());
+        delete schema;
+        return SQLITE_ERROR;
+      }
+      continue;
+    }
+    index_string = arg;
+  }
+  // only the mini pages of PAX pages can be encoded
+  if (is_encoded && layout != TableLayout::PAX) {
+    *pzErr = sqlite3_mprintf("column encodings need layout=pax");
+    delete schema;
+    return SQLITE_ERROR;
+  }
+  page_id_t index_root_id = INVALID_PAGE_ID;
+  if (!index_string.empty()) {
+    // create index object, allocate memory space. An attached table may
+    // bring its index along
+    IndexMetadata *index_metadata;
+    try {
+      index_metadata =
+          ParseIndexStatement(index_string, std::string(argv[2]), schema);
+    } catch (Exception &e) {
+      *pzErr = sqlite3_mprintf("%s", e.what());
+      delete schema;
+      return SQLITE_ERROR;
+    }
+    if (attach)
+      catalog_cache->GetRootId(index_metadata->GetName(), index_root_id);
+    index = ConstructIndex(index_metadata, buffer_pool_manager, index_root_id,
+                           catalog_cache);
   }
   // create table object, allocate memory space
-  VirtualTable *table = new VirtualTable(schema, buffer_pool_manager,
-                                         lock_manager, log_manager, index);
+  VirtualTable *table =
+      new VirtualTable(schema, buffer_pool_manager, lock_manager, log_manager,
+                       index, table_root_id, layout, encodings);
+  if (index != nullptr)
+    storage_engine_->indexes_[index->GetName()] = index;
+  // otherwise the index is built from the tuples of the attached table
+  if (attach && index != nullptr && index_root_id == INVALID_PAGE_ID) {
+    int num_threads = std::max<int>(std::thread::hardware_concurrency(), 1);
+    Transaction *txn = storage_engine_->transaction_manager_->Begin();
+    bool is_built =
+        index->BuildIndex(table->GetTableHeap(), schema, num_threads, txn);
+    storage_engine_->transaction_manager_->Commit(txn);
+    if (!is_built) {
+      *pzErr = sqlite3_mprintf("cannot build index %s",
+                               index->GetName().c_str());
+      storage_engine_->indexes_.erase(index->GetName());
+      delete table;
+      return SQLITE_ERROR;
+    }
+    table->UpdateStatistics();
+  }
 
-  // insert table root page info into header page
-  header_page->InsertRecord(std::string(argv[2]), table->GetFirstPageId());
-  buffer_pool_manager->UnpinPage(HEADER_PAGE_ID, true);
+  // record table root page, written back to header page on commit
+  catalog_cache->SetRootId(std::string(argv[2]), table->GetFirstPageId());
 
   // register virtual table within sqlite system
   schema_string = "CREATE TABLE X(" + schema_string + ");";
   assert(sqlite3_declare_vtab(db, schema_string.c_str()) == SQLITE_OK);
 
+  storage_engine_->table_count_++;
   *ppVtab = reinterpret_cast<sqlite3_vtab *>(table);
   return SQLITE_OK;
 }
@@ -71,57 +202,200 @@ int VtabConnect(sqlite3 *db, void *pAux, int argc, const char *const *argv,
   // new virtual table object, allocate memory space
   Schema *schema = ParseCreateStatement(schema_string);
 
+  OpenStorageEngine();
   BufferPoolManager *buffer_pool_manager =
       storage_engine_->buffer_pool_manager_;
   LockManager *lock_manager = storage_engine_->lock_manager_;
   LogManager *log_manager = storage_engine_->log_manager_;
+  CatalogCache *catalog_cache = storage_engine_->catalog_cache_;
 
-  // Retrieve table root page info from header page
-  HeaderPage *header_page =
-      static_cast<HeaderPage *>(buffer_pool_manager->FetchPage(HEADER_PAGE_ID));
+  // Retrieve table root page info from catalog
   page_id_t table_root_id;
-  header_page->GetRootId(std::string(argv[2]), table_root_id);
-  // parse arg[4](string that defines table index)
+  catalog_cache->GetRootId(std::string(argv[2]), table_root_id);
+  // parse the string that defines table index, table options only matter
+  // on create, the pages record the layout
   Index *index = nullptr;
-  if (argc > 4) {
-    std::string index_string(argv[4]);
+  for (int i = 4; i < argc; i++) {
+    std::string index_string(argv[i]);
     index_string = index_string.substr(1, (index_string.size() - 2));
+    if (index_string.find('=') != std::string::npos)
+      continue;
     // create index object, allocate memory space
-    IndexMetadata *index_metadata =
-        ParseIndexStatement(index_string, std::string(argv[2]), schema);
-    // Retrieve index root page info from header page
-    page_id_t index_root_id;
-    header_page->GetRootId(index_metadata->GetName(), index_root_id);
-    index = ConstructIndex(index_metadata, buffer_pool_manager, index_root_id);
+    IndexMetadata *index_metadata;
+    try {
+      index_metadata =
+          ParseIndexStatement(index_string, std::string(argv[2]), schema);
+    } catch (Exception &e) {
+      *pzErr = sqlite3_mprintf("%s", e.what());
+      delete index;
+      delete schema;
+      return SQLITE_ERROR;
+    }
+    // Retrieve index root page info from catalog
+    page_id_t index_root_id = INVALID_PAGE_ID;
+    catalog_cache->GetRootId(index_metadata->GetName(), index_root_id);
+    index = ConstructIndex(index_metadata, buffer_pool_manager, index_root_id,
+                           catalog_cache);
   }
   VirtualTable *table =
       new VirtualTable(schema, buffer_pool_manager, lock_manager, log_manager,
                        index, table_root_id);
+  if (index != nullptr)
+    storage_engine_->indexes_[index->GetName()] = index;
 
   // register virtual table within sqlite system
   schema_string = "CREATE TABLE X(" + schema_string + ");";
   assert(sqlite3_declare_vtab(db, schema_string.c_str()) == SQLITE_OK);
 
+  storage_engine_->table_count_++;
   *ppVtab = reinterpret_cast<sqlite3_vtab *>(table);
-  buffer_pool_manager->UnpinPage(HEADER_PAGE_ID, false);
   return SQLITE_OK;
 }
 
 /*
- * we only support
+ * Numeric constant on the right-hand side of constraint i, false if sqlite
+ * does not tell. xBestIndex only learns the constants through
+ * sqlite3_vtab_rhs_value, which arrived in SQLite 3.38: the bundled 3.20
+ * never hands them over, so its range estimates can't use the histogram.
+ */
+static bool GetConstraintConstant(sqlite3_index_info *pIdxInfo, int i,
+                                  double &constant) {
+#if SQLITE_VERSION_NUMBER >= 3038000
+  sqlite3_value *value = nullptr;
+  if (sqlite3_vtab_rhs_value(pIdxInfo, i, &value) != SQLITE_OK)
+    return false;
+  int type = sqlite3_value_numeric_type(value);
+  if (type != SQLITE_INTEGER && type != SQLITE_FLOAT)
+    return false;
+  constant = sqlite3_value_double(value);
+  return true;
+#else
+  (void)pIdxInfo;
+  (void)i;
+  (void)constant;
+  return false;
+#endif
+}
+
+/*
+ * Estimate the rows returned by a full scan from the index statistics: an
+ * equality on the first key column keeps the rows of one distinct value, the
+ * range constraints with a known constant on the first key column keep the
+ * rows the histogram puts in their range, every other range constraint keeps
+ * a third of the rows.
+ */
+static void EstimateFullScan(const IndexStatistics *statistics,
+                             int first_key_column,
+                             sqlite3_index_info *pIdxInfo) {
+  double rows = std::max<int64_t>(statistics->entry_count, 1);
+  pIdxInfo->estimatedCost = rows;
+  double low = -std::numeric_limits<double>::infinity();
+  double high = std::numeric_limits<double>::infinity();
+  bool is_bounded = false;
+  for (int i = 0; i < pIdxInfo->nConstraint; i++) {
+    const auto &constraint = pIdxInfo->aConstraint[i];
+    if (constraint.usable == 0)
+      continue;
+    double constant;
+    switch (constraint.op) {
+    case SQLITE_INDEX_CONSTRAINT_EQ:
+      if (constraint.iColumn == first_key_column)
+        rows = std::min(rows, statistics->EstimateEqualRows());
+      break;
+    case SQLITE_INDEX_CONSTRAINT_GT:
+    case SQLITE_INDEX_CONSTRAINT_GE:
+    case SQLITE_INDEX_CONSTRAINT_LT:
+    case SQLITE_INDEX_CONSTRAINT_LE:
+      if (constraint.iColumn == first_key_column &&
+          !statistics->bounds.empty() &&
+          GetConstraintConstant(pIdxInfo, i, constant)) {
+        if (constraint.op == SQLITE_INDEX_CONSTRAINT_GT ||
+            constraint.op == SQLITE_INDEX_CONSTRAINT_GE)
+          low = std::max(low, constant);
+        else
+          high = std::min(high, constant);
+        is_bounded = true;
+      } else {
+        rows /= 3;
+      }
+      break;
+    default:
+      break;
+    }
+  }
+  if (is_bounded && statistics->entry_count > 0)
+    rows *= statistics->EstimateRangeRows(low, high) / statistics->entry_count;
+  // estimatedRows is available since 3.8.2
+  if (sqlite3_libversion_number() >= 3008002)
+    pIdxInfo->estimatedRows = std::max<sqlite3_int64>(std::llround(rows), 1);
+}
+
+/*
+ * Range constraints on numeric columns are handed to the filtered table scan,
+ * which skips the pages ruled out by the zone map, and so are equality
+ * constraints on dictionary encoded columns, whose rows are skipped by code
+ * (VtabFilter drops values too large to be kept in a dictionary).
+ * The plan lists the column and operator of every handed constraint in argv
+ * order, sqlite still checks the constraints on every row it gets.
+ */
+static std::string BestZoneMapScan(VirtualTable *table,
+                                   sqlite3_index_info *pIdxInfo) {
+  Schema *schema = table->GetSchema();
+  std::vector<ColumnEncoding> encodings =
+      table->GetTableHeap()->GetColumnEncodings();
+  std::string plan;
+  int argc = 0;
+  for (int i = 0; i < pIdxInfo->nConstraint; i++) {
+    pIdxInfo->aConstraintUsage[i].argvIndex = 0;
+    const auto &constraint = pIdxInfo->aConstraint[i];
+    if (constraint.usable == 0 || constraint.iColumn < 0)
+      continue;
+    if (!ZoneMap::IsTracked(schema->GetType(constraint.iColumn))) {
+      bool is_dictionary =
+          constraint.iColumn < static_cast<int>(encodings.size()) &&
+          encodings[constraint.iColumn] == ColumnEncoding::DICTIONARY;
+      if (is_dictionary && constraint.op == SQLITE_INDEX_CONSTRAINT_EQ) {
+        pIdxInfo->aConstraintUsage[i].argvIndex = ++argc;
+        plan += std::to_string(constraint.iColumn) + " " +
+                std::to_string(constraint.op) + " ";
+      }
+      continue;
+    }
+    switch (constraint.op) {
+    case SQLITE_INDEX_CONSTRAINT_EQ:
+    case SQLITE_INDEX_CONSTRAINT_GT:
+    case SQLITE_INDEX_CONSTRAINT_GE:
+    case SQLITE_INDEX_CONSTRAINT_LT:
+    case SQLITE_INDEX_CONSTRAINT_LE:
+      pIdxInfo->aConstraintUsage[i].argvIndex = ++argc;
+      plan += std::to_string(constraint.iColumn) + " " +
+              std::to_string(constraint.op) + " ";
+      break;
+    default:
+      break;
+    }
+  }
+  if (argc > 0)
+    pIdxInfo->idxNum = 2;
+  return plan;
+}
+
+/*
+ * Point lookup through the index, return true if it is chosen. we only support
  * (1) equlity check. e.g select * from foo where a = 1
  * (2) indexed column == predicated column
  */
-int VtabBestIndex(sqlite3_vtab *tab, sqlite3_index_info *pIdxInfo) {
-  // LOG_DEBUG("VtabBestIndex");
-  VirtualTable *table = reinterpret_cast<VirtualTable *>(tab);
+static bool BestIndexScan(VirtualTable *table, sqlite3_index_info *pIdxInfo) {
   if (table->GetIndex() == nullptr)
-    return SQLITE_OK;
+    return false;
   const std::vector<int> key_attrs = table->GetIndex()->GetKeyAttrs();
+  const IndexStatistics *statistics = table->GetStatistics();
+  if (statistics != nullptr)
+    EstimateFullScan(statistics, key_attrs[0], pIdxInfo);
   // make sure indexed column == predicate column
   // e.g select * from foo where a = 1 and b =2; indexed column must be {a,b}
   if (pIdxInfo->nConstraint != (int)(key_attrs.size()))
-    return SQLITE_OK;
+    return false;
 
   int counter = 0;
   bool is_index_scan = true;
@@ -142,17 +416,48 @@ int VtabBestIndex(sqlite3_vtab *tab, sqlite3_index_info *pIdxInfo) {
     }
   }
 
-  if (counter == (int)key_attrs.size() && is_index_scan) {
-    pIdxInfo->idxNum = 1;
+  if (counter != (int)key_attrs.size() || !is_index_scan)
+    return false;
+  pIdxInfo->idxNum = 1;
+  // a point lookup reads one page per level and then the tuple
+  if (statistics != nullptr) {
+    pIdxInfo->estimatedCost = statistics->height + 1;
+    if (sqlite3_libversion_number() >= 3008002)
+      pIdxInfo->estimatedRows = 1;
   }
+  return true;
+}
+
+int VtabBestIndex(sqlite3_vtab *tab, sqlite3_index_info *pIdxInfo) {
+  // LOG_DEBUG("VtabBestIndex");
+  VirtualTable *table = reinterpret_cast<VirtualTable *>(tab);
+  if (BestIndexScan(table, pIdxInfo))
+    return SQLITE_OK;
+  // idxStr of a sequential scan: the columns used, then the zone map plan
+  sqlite3_uint64 columns_used = ~static_cast<sqlite3_uint64>(0);
+  if (sqlite3_libversion_number() >= 3010000)
+    columns_used = pIdxInfo->colUsed;
+  std::string plan = std::to_string(columns_used) + " " +
+                     BestZoneMapScan(table, pIdxInfo);
+  pIdxInfo->idxStr = sqlite3_mprintf("%s", plan.c_str());
+  pIdxInfo->needToFreeIdxStr = 1;
   return SQLITE_OK;
 }
 
 int VtabDisconnect(sqlite3_vtab *pVtab) {
   VirtualTable *virtual_table = reinterpret_cast<VirtualTable *>(pVtab);
+  if (virtual_table->GetIndex() != nullptr)
+    storage_engine_->indexes_.erase(virtual_table->GetIndex()->GetName());
   delete virtual_table;
+  if (--storage_engine_->table_count_ > 0)
+    return SQLITE_OK;
+  // write back root page changes not flushed by a commit, and every page, so
+  // that the next table can open the file again
+  storage_engine_->catalog_cache_->Flush();
+  storage_engine_->buffer_pool_manager_->FlushAllPages();
   // delete all the global managers
   delete storage_engine_;
+  storage_engine_ = nullptr;
   return SQLITE_OK;
 }
 
@@ -196,6 +501,51 @@ int VtabFilter(sqlite3_vtab_cursor *pVtabCursor, int idxNum, const char *idxStr,
     key_schema = cursor->GetKeySchema();
     Tuple scan_tuple = ConstructTuple(key_schema, argv);
     cursor->ScanKey(scan_tuple);
+  } else {
+    // columns used and range constraints, as planned by VtabBestIndex
+    Schema *schema = cursor->GetVirtualTable()->GetSchema();
+    std::vector<RangePredicate> predicates;
+    std::istringstream plan(idxStr);
+    sqlite3_uint64 columns_used;
+    plan >> columns_used;
+    cursor->SetColumnsUsed(columns_used);
+    int column_id, op;
+    for (int i = 0; i < argc && plan >> column_id >> op; i++) {
+      Value value(TypeId::INVALID);
+      if (sqlite3_value_type(argv[i]) == SQLITE_INTEGER)
+        value = Value(TypeId::BIGINT, (int64_t)sqlite3_value_int64(argv[i]));
+      else if (sqlite3_value_type(argv[i]) == SQLITE_FLOAT)
+        value = Value(TypeId::DECIMAL, sqlite3_value_double(argv[i]));
+      else if (sqlite3_value_type(argv[i]) == SQLITE_TEXT &&
+               schema->GetType(column_id) == TypeId::VARCHAR &&
+               sqlite3_value_bytes(argv[i]) <= OVERFLOW_THRESHOLD)
+        value = Value(TypeId::VARCHAR,
+                      reinterpret_cast<const char *>(
+                          sqlite3_value_text(argv[i])),
+                      sqlite3_value_bytes(argv[i]) + 1, true);
+      else
+        continue; // no pages are skipped for other values
+      switch (op) {
+      case SQLITE_INDEX_CONSTRAINT_EQ:
+        predicates.emplace_back(column_id, RangeOp::EQ, value);
+        break;
+      case SQLITE_INDEX_CONSTRAINT_GT:
+        predicates.emplace_back(column_id, RangeOp::GT, value);
+        break;
+      case SQLITE_INDEX_CONSTRAINT_GE:
+        predicates.emplace_back(column_id, RangeOp::GE, value);
+        break;
+      case SQLITE_INDEX_CONSTRAINT_LT:
+        predicates.emplace_back(column_id, RangeOp::LT, value);
+        break;
+      case SQLITE_INDEX_CONSTRAINT_LE:
+        predicates.emplace_back(column_id, RangeOp::LE, value);
+        break;
+      default:
+        break;
+      }
+    }
+    cursor->ScanZones(predicates);
   }
   return SQLITE_OK;
 }
@@ -213,12 +563,56 @@ int VtabEof(sqlite3_vtab_cursor *cur) {
   return cursor->isEof();
 }
 
+/*
+ * Columns of heap tuples are read through the table's accessor, index
+ * entries and overflow values go through Value
+ */
 int VtabColumn(sqlite3_vtab_cursor *cur, sqlite3_context *ctx, int i) {
   Cursor *cursor = reinterpret_cast<Cursor *>(cur);
   Schema *schema = cursor->GetVirtualTable()->GetSchema();
+  const TupleAccessor &accessor = cursor->GetVirtualTable()->GetAccessor();
   // get column type and value
   TypeId type = schema->GetType(i);
+  const Tuple *tuple = cursor->GetCurrentTuple(i);
+  if (tuple != nullptr &&
+      (type != TypeId::VARCHAR || !accessor.IsOverflow(*tuple, i))) {
+    if (accessor.IsNull(*tuple, i)) {
+      sqlite3_result_null(ctx);
+      return SQLITE_OK;
+    }
+    switch (type) {
+    case TypeId::TINYINT:
+    case TypeId::BOOLEAN:
+      sqlite3_result_int(ctx, accessor.GetInt8(*tuple, i));
+      break;
+    case TypeId::SMALLINT:
+      sqlite3_result_int(ctx, accessor.GetInt16(*tuple, i));
+      break;
+    case TypeId::INTEGER:
+      sqlite3_result_int(ctx, accessor.GetInt32(*tuple, i));
+      break;
+    case TypeId::BIGINT:
+      sqlite3_result_int64(ctx, accessor.GetInt64(*tuple, i));
+      break;
+    case TypeId::DECIMAL:
+      sqlite3_result_double(ctx, accessor.GetDouble(*tuple, i));
+      break;
+    case TypeId::VARCHAR: {
+      uint32_t length;
+      const char *data = accessor.GetVarchar(*tuple, i, length);
+      sqlite3_result_text(ctx, data, length, SQLITE_TRANSIENT);
+      break;
+    }
+    default:
+      return SQLITE_ERROR;
+    } // End of switch
+    return SQLITE_OK;
+  }
   Value v = cursor->GetCurrentValue(schema, i);
+  if (v.IsNull()) {
+    sqlite3_result_null(ctx);
+    return SQLITE_OK;
+  }
 
   switch (type) {
   case TypeId::TINYINT:
@@ -254,6 +648,16 @@ int VtabRowid(sqlite3_vtab_cursor *cur, sqlite3_int64 *pRowid) {
   return SQLITE_OK;
 }
 
+// reject a row whose index entry is larger than the index key
+static int IndexEntryTooLarge(VirtualTable *table) {
+  sqlite3_vtab *vtab = reinterpret_cast<sqlite3_vtab *>(table);
+  sqlite3_free(vtab->zErrMsg);
+  vtab->zErrMsg = sqlite3_mprintf("values too long for index %s",
+                                  table->GetIndex()->GetName().c_str());
+  table->GetArena()->Reset();
+  return SQLITE_CONSTRAINT;
+}
+
 int VtabUpdate(sqlite3_vtab *pVTab, int argc, sqlite3_value **argv,
                sqlite_int64 *pRowid) {
   // LOG_DEBUG("VtabUpdate");
@@ -271,7 +675,9 @@ int VtabUpdate(sqlite3_vtab *pVTab, int argc, sqlite3_value **argv,
   // automatically.
   else if (argc > 1 && sqlite3_value_type(argv[0]) == SQLITE_NULL) {
     Schema *schema = table->GetSchema();
-    Tuple tuple = ConstructTuple(schema, (argv + 2));
+    Tuple tuple = ConstructTuple(schema, (argv + 2), table->GetArena());
+    if (!table->FitsIndex(tuple))
+      return IndexEntryTooLarge(table);
     // insert into table heap
     RID rid;
     table->InsertTuple(tuple, rid);
@@ -282,7 +688,9 @@ int VtabUpdate(sqlite3_vtab *pVTab, int argc, sqlite3_value **argv,
   // following parameters.
   else if (argc > 1 && sqlite3_value_type(argv[0]) != SQLITE_NULL) {
     Schema *schema = table->GetSchema();
-    Tuple tuple = ConstructTuple(schema, (argv + 2));
+    Tuple tuple = ConstructTuple(schema, (argv + 2), table->GetArena());
+    if (!table->FitsIndex(tuple))
+      return IndexEntryTooLarge(table);
     RID rid(sqlite3_value_int64(argv[0]));
     // for update, index always delete and insert
     // because you have no clue key has been updated or not
@@ -296,6 +704,9 @@ int VtabUpdate(sqlite3_vtab *pVTab, int argc, sqlite3_value **argv,
     }
     table->InsertEntry(tuple, rid);
   }
+  // statistics follow the writes, so that xBestIndex never collects them
+  table->MaybeUpdateStatistics();
+  table->GetArena()->Reset();
   return SQLITE_OK;
 }
 
@@ -315,6 +726,8 @@ int VtabCommit(sqlite3_vtab *pVTab) {
   auto transaction_manager = storage_engine_->transaction_manager_;
   // invoke transaction manager to commit(this txn can't fail)
   transaction_manager->Commit(transaction);
+  // root page changes of this transaction go to header page
+  storage_engine_->catalog_cache_->Flush();
   // when commit, delete transaction pointer and set to null
   delete transaction;
   global_transaction_ = nullptr;
@@ -322,6 +735,71 @@ int VtabCommit(sqlite3_vtab *pVTab) {
   return SQLITE_OK;
 }
 
+// index of a connected table by name, nullptr if there is none
+static Index *FindIndex(sqlite3_value *name_value) {
+  const char *name =
+      reinterpret_cast<const char *>(sqlite3_value_text(name_value));
+  if (name == nullptr || storage_engine_ == nullptr)
+    return nullptr;
+  auto it = storage_engine_->indexes_.find(name);
+  return it == storage_engine_->indexes_.end() ? nullptr : it->second;
+}
+
+/*
+ * index_metrics(index_name [, command]) returns the metrics of an index as
+ * text. The optional command 'enable', 'disable' or 'reset' is applied first.
+ */
+void IndexMetricsFunction(sqlite3_context *ctx, int argc,
+                          sqlite3_value **argv) {
+  Index *index = FindIndex(argv[0]);
+  if (index == nullptr) {
+    sqlite3_result_error(ctx, "no such index", -1);
+    return;
+  }
+  IndexMetrics *metrics = index->GetMetrics();
+  if (argc > 1) {
+    const char *command =
+        reinterpret_cast<const char *>(sqlite3_value_text(argv[1]));
+    std::string cmd = command == nullptr ? "" : command;
+    if (cmd == "enable") {
+      metrics->SetEnabled(true);
+    } else if (cmd == "disable") {
+      metrics->SetEnabled(false);
+    } else if (cmd == "reset") {
+      metrics->Reset();
+    } else {
+      sqlite3_result_error(ctx, "unknown index_metrics command", -1);
+      return;
+    }
+  }
+  std::string text = metrics->ToString();
+  sqlite3_result_text(ctx, text.c_str(), text.length(), SQLITE_TRANSIENT);
+}
+
+/*
+ * index_analyze(index_name [, sample_rate]) collects the statistics of an
+ * index from the given share of its leaves (all of them by default) and
+ * returns them as text.
+ */
+void IndexAnalyzeFunction(sqlite3_context *ctx, int argc,
+                          sqlite3_value **argv) {
+  Index *index = FindIndex(argv[0]);
+  if (index == nullptr) {
+    sqlite3_result_error(ctx, "no such index", -1);
+    return;
+  }
+  double sample_rate = argc > 1 ? sqlite3_value_double(argv[1]) : 1.0;
+  if (sample_rate <= 0 || sample_rate > 1) {
+    sqlite3_result_error(ctx, "sample rate must be in (0, 1]", -1);
+    return;
+  }
+  index->UpdateStatistics(sample_rate, GetTransaction());
+  // the statistics page is recorded in the catalog
+  storage_engine_->catalog_cache_->Flush();
+  std::string text = index->GetStatistics()->ToString();
+  sqlite3_result_text(ctx, text.c_str(), text.length(), SQLITE_TRANSIENT);
+}
+
 sqlite3_module VtableModule = {
     0,              /* iVersion */
     VtabCreate,     /* xCreate */
@@ -354,24 +832,19 @@ __declspec(dllexport)
     extern "C" int sqlite3_vtable_init(sqlite3 *db, char **pzErrMsg,
                                        const sqlite3_api_routines *pApi) {
   SQLITE_EXTENSION_INIT2(pApi);
-  std::string db_file_name = "vtable.db";
-  struct stat buffer;
-  bool is_file_exist = (stat(db_file_name.c_str(), &buffer) == 0);
-
-  // init storage engine
-  storage_engine_ = new StorageEngine(db_file_name);
-  // start the logging
-  storage_engine_->log_manager_->RunFlushThread();
-  // create header page from BufferPoolManager if necessary
-  if (!is_file_exist) {
-    page_id_t header_page_id;
-    storage_engine_->buffer_pool_manager_->NewPage(header_page_id);
-
-    assert(header_page_id == HEADER_PAGE_ID);
-    storage_engine_->buffer_pool_manager_->UnpinPage(header_page_id, true);
-  }
+  OpenStorageEngine();
 
   int rc = sqlite3_create_module(db, "vtable", &VtableModule, nullptr);
+  if (rc != SQLITE_OK)
+    return rc;
+  for (int argc = 1; argc <= 2 && rc == SQLITE_OK; argc++)
+    rc = sqlite3_create_function(db, "index_metrics", argc, SQLITE_UTF8,
+                                 nullptr, IndexMetricsFunction, nullptr,
+                                 nullptr);
+  for (int argc = 1; argc <= 2 && rc == SQLITE_OK; argc++)
+    rc = sqlite3_create_function(db, "index_analyze", argc, SQLITE_UTF8,
+                                 nullptr, IndexAnalyzeFunction, nullptr,
+                                 nullptr);
   return rc;
 }
 
@@ -436,6 +909,19 @@ Schema *ParseCreateStatement(const std::string &sql_base) {
   return schema;
 }
 
+/*
+ * Bytes an index entry takes when every varchar holds as many bytes as its
+ * declared length: the fixed part, the null bitmap, then a length prefix,
+ * the value and its terminator per varchar.
+ */
+static int GetMaxEntrySize(Schema *entry_schema) {
+  int size = entry_schema->GetVarlenOffset();
+  for (int i = 0; i < entry_schema->GetColumnCount(); i++)
+    if (!entry_schema->IsInlined(i))
+      size += sizeof(uint32_t) + entry_schema->GetColumn(i).GetLength() + 1;
+  return size;
+}
+
 IndexMetadata *ParseIndexStatement(std::string &sql,
                                    const std::string &table_name,
                                    Schema *schema) {
@@ -450,6 +936,16 @@ IndexMetadata *ParseIndexStatement(std::string &sql,
   assert(n != std::string::npos);
   index_name = sql.substr(0, n);
   sql = sql.substr(n + 1);
+  if (IsStatisticsRecordName(index_name))
+    throw Exception(EXCEPTION_TYPE_INDEX, "can't create index, reserved name");
+
+  // optional covered columns, e.g. "foo_idx a,b include c,d"
+  std::string include_sql;
+  n = sql.find(" include ");
+  if (n != std::string::npos) {
+    include_sql = sql.substr(n + 9);
+    sql = sql.substr(0, n);
+  }
 
   std::vector<std::string> tok = StringUtility::Split(sql, ',');
   // iterate through returned result
@@ -462,20 +958,49 @@ IndexMetadata *ParseIndexStatement(std::string &sql,
   if ((int)key_attrs.size() > schema->GetColumnCount())
     throw Exception(EXCEPTION_TYPE_INDEX, "can't create index, format error");
 
-  IndexMetadata *metadata =
-      new IndexMetadata(index_name, table_name, schema, key_attrs);
+  std::vector<int> include_attrs;
+  if (!include_sql.empty()) {
+    for (std::string &t : StringUtility::Split(include_sql, ',')) {
+      StringUtility::Trim(t);
+      column_id = schema->GetColumnID(t);
+      if (column_id == -1)
+        throw Exception(EXCEPTION_TYPE_INDEX,
+                        "can't create index, unknown included column");
+      // key columns are stored in the entry already
+      if (std::find(key_attrs.begin(), key_attrs.end(), column_id) ==
+              key_attrs.end() &&
+          std::find(include_attrs.begin(), include_attrs.end(), column_id) ==
+              include_attrs.end())
+        include_attrs.emplace_back(column_id);
+    }
+  }
+
+  IndexMetadata *metadata = new IndexMetadata(index_name, table_name, schema,
+                                              key_attrs, include_attrs);
+  // included columns are stored in the key, which can't grow past
+  // MAX_INDEX_KEY_SIZE
+  if (!include_attrs.empty() &&
+      GetMaxEntrySize(metadata->GetEntrySchema()) > MAX_INDEX_KEY_SIZE) {
+    delete metadata;
+    throw Exception(EXCEPTION_TYPE_INDEX,
+                    "can't create index, included columns don't fit the key");
+  }
 
   // LOG_DEBUG("%s", metadata->ToString().c_str());
   return metadata;
 }
 
-Tuple ConstructTuple(Schema *schema, sqlite3_value **argv) {
+Tuple ConstructTuple(Schema *schema, sqlite3_value **argv, Arena *arena) {
   int column_count = schema->GetColumnCount();
   Value v(TypeId::INVALID);
   std::vector<Value> values;
   // iterate through schema, generate column value to insert
   for (int i = 0; i < column_count; i++) {
     TypeId type = schema->GetType(i);
+    if (sqlite3_value_type(argv[i]) == SQLITE_NULL) {
+      values.emplace_back(Type::GetNullValue(type));
+      continue;
+    }
 
     switch (type) {
     case TypeId::BOOLEAN:
@@ -491,15 +1016,17 @@ Tuple ConstructTuple(Schema *schema, sqlite3_value **argv) {
       v = Value(type, sqlite3_value_double(argv[i]));
       break;
     case TypeId::VARCHAR:
-      v = Value(type, std::string(reinterpret_cast<const char *>(
-                          sqlite3_value_text(argv[i]))));
+      // with the terminator, which sqlite keeps after the text
+      v = Value(type,
+                reinterpret_cast<const char *>(sqlite3_value_text(argv[i])),
+                sqlite3_value_bytes(argv[i]) + 1, false);
       break;
     default:
       break;
     } // End of switch
     values.emplace_back(v);
   }
-  Tuple tuple(values, schema);
+  Tuple tuple(values, schema, arena);
 
   return tuple;
 }
@@ -507,28 +1034,26 @@ Tuple ConstructTuple(Schema *schema, sqlite3_value **argv) {
 // serve the functionality of index factory
 Index *ConstructIndex(IndexMetadata *metadata,
                       BufferPoolManager *buffer_pool_manager,
-                      page_id_t root_id) {
-  // The size of the key in bytes
-  Schema *key_schema = metadata->GetKeySchema();
-  int key_size = key_schema->GetLength();
-  // for each varchar attribute, we assume the largest size is 16 bytes
-  key_size += 16 * key_schema->GetUnlinedColumnCount();
+                      page_id_t root_id, CatalogCache *catalog_cache) {
+  // The size of the key in bytes, included columns are stored in the key.
+  // Entries of wider keys have to be turned away, see VirtualTable::FitsIndex
+  int key_size = GetMaxEntrySize(metadata->GetEntrySchema());
 
   if (key_size <= 4) {
     return new BPlusTreeIndex<GenericKey<4>, RID, GenericComparator<4>>(
-        metadata, buffer_pool_manager, root_id);
+        metadata, buffer_pool_manager, root_id, catalog_cache);
   } else if (key_size <= 8) {
     return new BPlusTreeIndex<GenericKey<8>, RID, GenericComparator<8>>(
-        metadata, buffer_pool_manager, root_id);
+        metadata, buffer_pool_manager, root_id, catalog_cache);
   } else if (key_size <= 16) {
     return new BPlusTreeIndex<GenericKey<16>, RID, GenericComparator<16>>(
-        metadata, buffer_pool_manager, root_id);
+        metadata, buffer_pool_manager, root_id, catalog_cache);
   } else if (key_size <= 32) {
     return new BPlusTreeIndex<GenericKey<32>, RID, GenericComparator<32>>(
-        metadata, buffer_pool_manager, root_id);
+        metadata, buffer_pool_manager, root_id, catalog_cache);
   } else {
     return new BPlusTreeIndex<GenericKey<64>, RID, GenericComparator<64>>(
-        metadata, buffer_pool_manager, root_id);
+        metadata, buffer_pool_manager, root_id, catalog_cache);
   }
 }
 
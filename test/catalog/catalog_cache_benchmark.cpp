@@ -0,0 +1,82 @@
+/**
+ * catalog_cache_benchmark.cpp
+ */
+
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+#include <memory>
+#include <thread>
+
+#include "buffer/buffer_pool_manager.h"
+#include "catalog/catalog_cache.h"
+#include "index/b_plus_tree.h"
+#include "page/header_page.h"
+#include "vtable/virtual_table.h"
+#include "gtest/gtest.h"
+
+namespace cmudb {
+
+/*
+ * Every thread fills a tree of its own. Without the cache every root split
+ * fetches and dirties the shared header page, with the cache root changes
+ * stay in memory and the header page is written once by the flush.
+ */
+TEST(CatalogCacheBenchmark, MultiIndex) {
+  const int num_trees = 4;
+  const int64_t scale = 20000;
+  Schema *key_schema = ParseCreateStatement("a bigint");
+  GenericComparator<8> comparator(key_schema);
+  using Tree = BPlusTree<GenericKey<8>, RID, GenericComparator<8>>;
+
+  for (bool use_cache : {false, true}) {
+    DiskManager *disk_manager = new DiskManager("test.db");
+    BufferPoolManager *bpm = new BufferPoolManager(50, disk_manager);
+    page_id_t header_page_id;
+    HeaderPage *header_page =
+        static_cast<HeaderPage *>(bpm->NewPage(header_page_id));
+    header_page->Init();
+    CatalogCache *cache = use_cache ? new CatalogCache(bpm) : nullptr;
+
+    std::vector<std::unique_ptr<Tree>> trees;
+    GenericKey<8> index_key;
+    for (int i = 0; i < num_trees; i++) {
+      trees.emplace_back(new Tree("tree_" + std::to_string(i), bpm,
+                                  comparator, INVALID_PAGE_ID, cache));
+      // inserting header page records is not thread safe
+      index_key.SetFromInteger(0);
+      trees[i]->Insert(index_key, RID(0));
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    std::vector<std::thread> threads;
+    for (int i = 0; i < num_trees; i++)
+      threads.emplace_back([&, i] {
+        GenericKey<8> key;
+        for (int64_t k = 1; k < scale; k++) {
+          key.SetFromInteger(k);
+          trees[i]->Insert(key, RID((int32_t)k));
+        }
+      });
+    for (auto &thread : threads)
+      thread.join();
+    if (use_cache) {
+      EXPECT_TRUE(cache->Flush());
+    }
+    auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now() - start);
+    std::cout << (use_cache ? "catalog cache: " : "header page: ")
+              << elapsed.count() << " ms" << std::endl;
+
+    bpm->UnpinPage(HEADER_PAGE_ID, true);
+    trees.clear();
+    delete cache;
+    delete bpm;
+    delete disk_manager;
+    remove("test.db");
+    remove("test.log");
+  }
+  delete key_schema;
+}
+
+} // namespace cmudb
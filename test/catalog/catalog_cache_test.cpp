@@ -0,0 +1,143 @@
+/**
+ * catalog_cache_test.cpp
+ */
+
+#include <cstdio>
+#include <memory>
+#include <thread>
+
+#include "buffer/buffer_pool_manager.h"
+#include "catalog/catalog_cache.h"
+#include "index/b_plus_tree.h"
+#include "page/header_page.h"
+#include "vtable/virtual_table.h"
+#include "gtest/gtest.h"
+
+namespace cmudb {
+
+TEST(CatalogCacheTest, FlushTest) {
+  DiskManager *disk_manager = new DiskManager("test.db");
+  BufferPoolManager *bpm = new BufferPoolManager(20, disk_manager);
+  page_id_t header_page_id;
+  HeaderPage *header_page =
+      static_cast<HeaderPage *>(bpm->NewPage(header_page_id));
+  header_page->Init();
+  EXPECT_TRUE(header_page->InsertRecord("foo", 1));
+
+  CatalogCache *cache = new CatalogCache(bpm);
+  page_id_t root_id;
+  // records already in the header page are loaded
+  EXPECT_TRUE(cache->GetRootId("foo", root_id));
+  EXPECT_EQ(root_id, 1);
+  EXPECT_FALSE(cache->GetRootId("bar", root_id));
+
+  // changes stay in memory until flushed
+  cache->SetRootId("foo", 2);
+  cache->SetRootId("bar", 3);
+  EXPECT_EQ(cache->GetDirtyCount(), 2);
+  EXPECT_TRUE(cache->GetRootId("bar", root_id));
+  EXPECT_EQ(root_id, 3);
+  EXPECT_TRUE(header_page->GetRootId("foo", root_id));
+  EXPECT_EQ(root_id, 1);
+  EXPECT_FALSE(header_page->GetRootId("bar", root_id));
+
+  EXPECT_TRUE(cache->Flush());
+  EXPECT_EQ(cache->GetDirtyCount(), 0);
+  EXPECT_TRUE(header_page->GetRootId("foo", root_id));
+  EXPECT_EQ(root_id, 2);
+  EXPECT_TRUE(header_page->GetRootId("bar", root_id));
+  EXPECT_EQ(root_id, 3);
+  EXPECT_EQ(header_page->GetRecordCount(), 2);
+
+  // a fresh cache sees the flushed records
+  delete cache;
+  cache = new CatalogCache(bpm);
+  EXPECT_TRUE(cache->GetRootId("bar", root_id));
+  EXPECT_EQ(root_id, 3);
+
+  bpm->UnpinPage(HEADER_PAGE_ID, true);
+  delete cache;
+  delete bpm;
+  delete disk_manager;
+  remove("test.db");
+  remove("test.log");
+}
+
+/*
+ * Every thread fills a tree of its own. With the cache root changes stay in
+ * memory and the header page is written once by the flush, see
+ * catalog_cache_benchmark.cpp for the timing.
+ */
+TEST(CatalogCacheTest, MultiIndexTest) {
+  const int num_trees = 4;
+  const int64_t scale = 2000;
+  Schema *key_schema = ParseCreateStatement("a bigint");
+  GenericComparator<8> comparator(key_schema);
+  using Tree = BPlusTree<GenericKey<8>, RID, GenericComparator<8>>;
+
+  for (bool use_cache : {false, true}) {
+    DiskManager *disk_manager = new DiskManager("test.db");
+    BufferPoolManager *bpm = new BufferPoolManager(50, disk_manager);
+    page_id_t header_page_id;
+    HeaderPage *header_page =
+        static_cast<HeaderPage *>(bpm->NewPage(header_page_id));
+    header_page->Init();
+    CatalogCache *cache = use_cache ? new CatalogCache(bpm) : nullptr;
+
+    std::vector<std::unique_ptr<Tree>> trees;
+    GenericKey<8> index_key;
+    for (int i = 0; i < num_trees; i++) {
+      trees.emplace_back(new Tree("tree_" + std::to_string(i), bpm,
+                                  comparator, INVALID_PAGE_ID, cache));
+      // create the records up front, inserting header page records is not
+      // thread safe
+      index_key.SetFromInteger(0);
+      trees[i]->Insert(index_key, RID(0));
+    }
+    page_id_t root_id;
+    if (use_cache) {
+      EXPECT_FALSE(header_page->GetRootId("tree_0", root_id));
+    }
+
+    std::vector<std::thread> threads;
+    for (int i = 0; i < num_trees; i++)
+      threads.emplace_back([&, i] {
+        GenericKey<8> key;
+        for (int64_t k = 1; k < scale; k++) {
+          key.SetFromInteger(k);
+          trees[i]->Insert(key, RID((int32_t)k));
+        }
+      });
+    for (auto &thread : threads)
+      thread.join();
+
+    if (use_cache) {
+      // the header page was not touched by any root change
+      EXPECT_EQ(header_page->GetRecordCount(), 0);
+      EXPECT_EQ(cache->GetDirtyCount(), num_trees);
+      EXPECT_TRUE(cache->Flush());
+    }
+    std::vector<RID> rids;
+    for (int i = 0; i < num_trees; i++) {
+      EXPECT_TRUE(header_page->GetRootId("tree_" + std::to_string(i), root_id));
+      // the recorded root reaches every key
+      Tree reopened("tree_" + std::to_string(i), bpm, comparator, root_id);
+      for (int64_t k = 0; k < scale; k += 97) {
+        rids.clear();
+        index_key.SetFromInteger(k);
+        EXPECT_TRUE(reopened.GetValue(index_key, rids));
+      }
+    }
+
+    bpm->UnpinPage(HEADER_PAGE_ID, true);
+    trees.clear();
+    delete cache;
+    delete bpm;
+    delete disk_manager;
+    remove("test.db");
+    remove("test.log");
+  }
+  delete key_schema;
+}
+
+} // namespace cmudb
@@ -0,0 +1,91 @@
+/**
+ * epoch_manager_test.cpp
+ */
+
+#include <atomic>
+#include <cstdio>
+#include <thread>
+#include <vector>
+
+#include "buffer/buffer_pool_manager.h"
+#include "concurrency/epoch_manager.h"
+#include "gtest/gtest.h"
+
+namespace cmudb {
+
+TEST(EpochManagerTest, ReclaimTest) {
+  DiskManager *disk_manager = new DiskManager("test.db");
+  BufferPoolManager *bpm = new BufferPoolManager(10, disk_manager);
+  EpochManager epoch_manager(bpm);
+  page_id_t page_id[3];
+  for (int i = 0; i < 3; i++) {
+    EXPECT_NE(bpm->NewPage(page_id[i]), nullptr);
+    bpm->UnpinPage(page_id[i], true);
+  }
+
+  // no reader, deleted right away
+  epoch_manager.Retire(page_id[0]);
+  EXPECT_EQ(epoch_manager.GetRetiredCount(), 1);
+  EXPECT_EQ(epoch_manager.Reclaim(), 1);
+  EXPECT_EQ(epoch_manager.GetRetiredCount(), 0);
+
+  // a reader that entered before the page was retired holds it back
+  uint64_t old_epoch = epoch_manager.Enter();
+  epoch_manager.Retire(page_id[1]);
+  EXPECT_EQ(epoch_manager.Reclaim(), 0);
+  // readers entering afterwards do not
+  uint64_t new_epoch = epoch_manager.Enter();
+  EXPECT_GT(new_epoch, old_epoch);
+  EXPECT_EQ(epoch_manager.Reclaim(), 0);
+  epoch_manager.Leave(old_epoch);
+  EXPECT_EQ(epoch_manager.Reclaim(), 1);
+  epoch_manager.Leave(new_epoch);
+
+  // a page pinned outside of any epoch stays in limbo until unpinned
+  EXPECT_NE(bpm->FetchPage(page_id[2]), nullptr);
+  epoch_manager.Retire(page_id[2]);
+  EXPECT_EQ(epoch_manager.Reclaim(), 0);
+  EXPECT_EQ(epoch_manager.GetRetiredCount(), 1);
+  bpm->UnpinPage(page_id[2], false);
+  EXPECT_EQ(epoch_manager.Reclaim(), 1);
+  EXPECT_EQ(epoch_manager.GetRetiredCount(), 0);
+
+  delete bpm;
+  delete disk_manager;
+  remove("test.db");
+}
+
+TEST(EpochManagerTest, ConcurrentTest) {
+  DiskManager *disk_manager = new DiskManager("test.db");
+  BufferPoolManager *bpm = new BufferPoolManager(50, disk_manager);
+  EpochManager epoch_manager(bpm);
+  std::atomic<bool> done(false);
+  std::vector<std::thread> readers;
+  for (int i = 0; i < 4; i++)
+    readers.emplace_back([&] {
+      while (!done) {
+        EpochGuard guard(&epoch_manager);
+        std::this_thread::yield();
+      }
+    });
+  size_t deleted = 0;
+  for (int i = 0; i < 1000; i++) {
+    page_id_t page_id;
+    ASSERT_NE(bpm->NewPage(page_id), nullptr);
+    bpm->UnpinPage(page_id, true);
+    epoch_manager.Retire(page_id);
+    deleted += epoch_manager.Reclaim();
+  }
+  done = true;
+  for (auto &reader : readers)
+    reader.join();
+  deleted += epoch_manager.Reclaim();
+  EXPECT_EQ(deleted, 1000);
+  EXPECT_EQ(epoch_manager.GetRetiredCount(), 0);
+
+  delete bpm;
+  delete disk_manager;
+  remove("test.db");
+}
+
+} // namespace cmudb
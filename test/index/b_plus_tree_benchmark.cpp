@@ -0,0 +1,133 @@
+/**
+ * b_plus_tree_benchmark.cpp
+ */
+
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+#include <memory>
+
+#include "buffer/buffer_pool_manager.h"
+#include "index/b_plus_tree.h"
+#include "vtable/virtual_table.h"
+#include "gtest/gtest.h"
+
+namespace cmudb {
+
+/*
+ * Full scans of a tree with plain leaves and of one with compressed leaves,
+ * both bulk loaded with sequential keys whose rids are clustered 100 to a
+ * table page.
+ */
+TEST(BPlusTreeBenchmark, CompressedLeafScan) {
+  Schema *key_schema = ParseCreateStatement("a bigint");
+  GenericComparator<8> comparator(key_schema);
+
+  DiskManager *disk_manager = new DiskManager("test.db");
+  BufferPoolManager *bpm = new BufferPoolManager(100, disk_manager);
+  BPlusTree<GenericKey<8>, RID, GenericComparator<8>> plain_tree(
+      "foo_pk", bpm, comparator);
+  BPlusTree<GenericKey<8>, RID, GenericComparator<8>> tree("bar_pk", bpm,
+                                                           comparator);
+  tree.SetLeafCompression(true);
+  Transaction *transaction = new Transaction(0);
+  page_id_t page_id;
+  bpm->NewPage(page_id);
+
+  int64_t scale = 100000;
+  auto loader = [scale]() {
+    auto current = std::make_shared<int64_t>(0);
+    return [scale, current](GenericKey<8> &key, RID &value) {
+      if (*current >= scale)
+        return false;
+      key.SetFromInteger(*current);
+      value.Set((int32_t)(*current / 100), (int)(*current % 100));
+      (*current)++;
+      return true;
+    };
+  };
+  EXPECT_TRUE(plain_tree.BulkLoad(loader(), 1.0, transaction));
+  EXPECT_TRUE(tree.BulkLoad(loader(), 1.0, transaction));
+
+  IndexStatistics plain_statistics, statistics;
+  auto ignore = [](const GenericKey<8> &) {};
+  plain_tree.CollectStatistics(plain_statistics, 1.0, ignore);
+  tree.CollectStatistics(statistics, 1.0, ignore);
+
+  auto scan = [scale](BPlusTree<GenericKey<8>, RID, GenericComparator<8>> &t) {
+    auto start = std::chrono::steady_clock::now();
+    int64_t count = 0;
+    for (auto iterator = t.Begin(); iterator.isEnd() == false; ++iterator)
+      count++;
+    EXPECT_EQ(count, scale);
+    return std::chrono::duration<double, std::milli>(
+               std::chrono::steady_clock::now() - start)
+        .count();
+  };
+  double plain_time = scan(plain_tree);
+  double time = scan(tree);
+  std::cout << "leaf pages: " << plain_statistics.level_pages.back() << " -> "
+            << statistics.level_pages.back() << ", full scan: " << plain_time
+            << "ms -> " << time << "ms" << std::endl;
+
+  bpm->UnpinPage(HEADER_PAGE_ID, true);
+  delete transaction;
+  delete key_schema;
+  delete disk_manager;
+  delete bpm;
+  remove("test.db");
+  remove("test.log");
+}
+
+/*
+ * Inserts, lookups and removes with the index metrics disabled and enabled,
+ * the metrics of the enabled run are printed.
+ */
+TEST(BPlusTreeBenchmark, Metrics) {
+  Schema *key_schema = ParseCreateStatement("a bigint");
+  GenericComparator<8> comparator(key_schema);
+  const int64_t scale = 100000;
+
+  for (bool enabled : {false, true}) {
+    DiskManager *disk_manager = new DiskManager("test.db");
+    BufferPoolManager *bpm = new BufferPoolManager(50, disk_manager);
+    BPlusTree<GenericKey<8>, RID, GenericComparator<8>> tree("foo_pk", bpm,
+                                                             comparator);
+    tree.GetMetrics().SetEnabled(enabled);
+    GenericKey<8> index_key;
+    Transaction *transaction = new Transaction(0);
+    page_id_t page_id;
+    bpm->NewPage(page_id);
+
+    auto start = std::chrono::steady_clock::now();
+    std::vector<RID> rids;
+    for (int64_t key = 0; key < scale; key++) {
+      index_key.SetFromInteger(key);
+      tree.Insert(index_key, RID((int32_t)key), transaction);
+    }
+    for (int64_t key = 0; key < scale; key++) {
+      index_key.SetFromInteger(key);
+      tree.GetValue(index_key, rids);
+    }
+    for (int64_t key = 0; key < scale; key++) {
+      index_key.SetFromInteger(key);
+      tree.Remove(index_key, transaction);
+    }
+    std::chrono::duration<double, std::milli> elapsed =
+        std::chrono::steady_clock::now() - start;
+    std::cout << "metrics " << (enabled ? "enabled" : "disabled") << ": "
+              << elapsed.count() << "ms" << std::endl;
+    if (enabled)
+      std::cout << tree.GetMetrics().ToString() << std::endl;
+
+    bpm->UnpinPage(HEADER_PAGE_ID, true);
+    delete transaction;
+    delete disk_manager;
+    delete bpm;
+    remove("test.db");
+    remove("test.log");
+  }
+  delete key_schema;
+}
+
+} // namespace cmudb
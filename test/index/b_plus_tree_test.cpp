@@ -4,12 +4,14 @@
 
 #include <algorithm>
 #include <cstdio>
-#include <iostream>
+#include <cstring>
 #include <sstream>
 
 #include "buffer/buffer_pool_manager.h"
+#include "common/exception.h"
 #include "common/logger.h"
 #include "index/b_plus_tree.h"
+#include "page/header_page.h"
 #include "vtable/virtual_table.h"
 #include "gtest/gtest.h"
 
@@ -395,4 +397,557 @@ TEST(BPlusTreeTests, ScaleTest) {
   remove("test.db");
   remove("test.log");
 }
+TEST(BPlusTreeTests, GetValuesTest) {
+  // create KeyComparator and index schema
+  Schema *key_schema = ParseCreateStatement("a bigint");
+  GenericComparator<8> comparator(key_schema);
+
+  DiskManager *disk_manager = new DiskManager("test.db");
+  BufferPoolManager *bpm = new BufferPoolManager(50, disk_manager);
+  // create b+ tree
+  BPlusTree<GenericKey<8>, RID, GenericComparator<8>> tree("foo_pk", bpm,
+                                                           comparator);
+  GenericKey<8> index_key;
+  RID rid;
+  // create transaction
+  Transaction *transaction = new Transaction(0);
+  // create and fetch header_page
+  page_id_t page_id;
+  auto header_page = bpm->NewPage(page_id);
+  (void)header_page;
+
+  // only even keys are present
+  int64_t scale = 20000;
+  for (int64_t key = 0; key < scale; key += 2) {
+    rid.Set((int32_t)(key >> 32), key & 0xFFFFFFFF);
+    index_key.SetFromInteger(key);
+    tree.Insert(index_key, rid, transaction);
+  }
+
+  // sorted probe keys: duplicates, misses below, inside and beyond the range
+  std::vector<int64_t> probes = {-5, 0, 0, 1, 2};
+  for (int64_t key = 3; key < scale + 10; key += 7)
+    probes.push_back(key);
+  std::vector<GenericKey<8>> index_keys;
+  for (auto key : probes) {
+    index_key.SetFromInteger(key);
+    index_keys.push_back(index_key);
+  }
+
+  std::vector<RID> rids;
+  EXPECT_EQ(tree.GetValues(index_keys, rids, transaction), true);
+  std::vector<int64_t> expected;
+  for (auto key : probes) {
+    if (key >= 0 && key < scale && key % 2 == 0)
+      expected.push_back(key);
+  }
+  EXPECT_EQ(rids.size(), expected.size());
+  for (size_t i = 0; i < rids.size() && i < expected.size(); i++)
+    EXPECT_EQ(rids[i].GetSlotNum(), expected[i]);
+
+  // no key present
+  rids.clear();
+  index_keys.clear();
+  for (int64_t key = 1; key < 2000; key += 2) {
+    index_key.SetFromInteger(key);
+    index_keys.push_back(index_key);
+  }
+  EXPECT_EQ(tree.GetValues(index_keys, rids, transaction), false);
+  EXPECT_EQ(rids.size(), 0);
+
+  // every page pinned by the batched lookups must have been released
+  for (int i = 0; i < 49; i++) {
+    page_id_t temp_page_id;
+    EXPECT_NE(nullptr, bpm->NewPage(temp_page_id));
+  }
+
+  bpm->UnpinPage(HEADER_PAGE_ID, true);
+  delete transaction;
+  delete disk_manager;
+  delete bpm;
+  remove("test.db");
+  remove("test.log");
+}
+TEST(BPlusTreeTests, BulkLoadTest) {
+  // create KeyComparator and index schema
+  Schema *key_schema = ParseCreateStatement("a bigint");
+  GenericComparator<8> comparator(key_schema);
+
+  DiskManager *disk_manager = new DiskManager("test.db");
+  BufferPoolManager *bpm = new BufferPoolManager(50, disk_manager);
+  // create b+ tree
+  BPlusTree<GenericKey<8>, RID, GenericComparator<8>> tree("foo_pk", bpm,
+                                                           comparator);
+  GenericKey<8> index_key;
+  RID rid;
+  // create transaction
+  Transaction *transaction = new Transaction(0);
+  // create and fetch header_page
+  page_id_t page_id;
+  auto header_page = bpm->NewPage(page_id);
+  (void)header_page;
+
+  // ascending keys with a duplicate, which is skipped
+  int64_t scale = 30000;
+  int64_t current = 1;
+  bool duplicated = false;
+  auto next = [&](GenericKey<8> &key, RID &value) {
+    if (current >= scale)
+      return false;
+    key.SetFromInteger(current);
+    value.Set((int32_t)(current >> 32), current & 0xFFFFFFFF);
+    if (current == 100 && !duplicated)
+      duplicated = true;
+    else
+      current++;
+    return true;
+  };
+  EXPECT_EQ(tree.BulkLoad(next, 0.7, transaction), true);
+  // only an empty tree can be bulk loaded
+  EXPECT_EQ(tree.BulkLoad(next, 0.7, transaction), false);
+
+  std::vector<RID> rids;
+  for (int64_t key = 1; key < scale; key++) {
+    rids.clear();
+    index_key.SetFromInteger(key);
+    tree.GetValue(index_key, rids);
+    EXPECT_EQ(rids.size(), 1);
+    if (rids.size() == 1) {
+      EXPECT_EQ(rids[0].GetSlotNum(), key);
+    }
+  }
+
+  int64_t current_key = 1;
+  for (auto iterator = tree.Begin(); iterator.isEnd() == false; ++iterator) {
+    EXPECT_EQ((*iterator).second.GetSlotNum(), current_key);
+    current_key = current_key + 1;
+  }
+  EXPECT_EQ(current_key, scale);
+
+  // the loaded tree keeps working with ordinary inserts
+  for (int64_t key = scale; key < scale + 1000; key++) {
+    rid.Set((int32_t)(key >> 32), key & 0xFFFFFFFF);
+    index_key.SetFromInteger(key);
+    EXPECT_EQ(tree.Insert(index_key, rid, transaction), true);
+  }
+  index_key.SetFromInteger(500);
+  EXPECT_EQ(tree.Insert(index_key, rid, transaction), false);
+  int64_t size = 0;
+  for (auto iterator = tree.Begin(); iterator.isEnd() == false; ++iterator)
+    size = size + 1;
+  EXPECT_EQ(size, scale - 1 + 1000);
+
+  bpm->UnpinPage(HEADER_PAGE_ID, true);
+  delete transaction;
+  delete disk_manager;
+  delete bpm;
+  remove("test.db");
+  remove("test.log");
+}
+
+TEST(BPlusTreeTests, BuildIndexTest) {
+  Schema *schema = ParseCreateStatement("a bigint, b varchar(16)");
+  std::vector<int> key_attrs = {0};
+  Schema *key_schema = Schema::CopySchema(schema, key_attrs);
+
+  DiskManager *disk_manager = new DiskManager("test.db");
+  BufferPoolManager *bpm = new BufferPoolManager(50, disk_manager);
+  Transaction *transaction = new Transaction(0);
+  // create and fetch header_page
+  page_id_t page_id;
+  auto header_page = bpm->NewPage(page_id);
+  (void)header_page;
+
+  TableHeap *table = new TableHeap(bpm, nullptr, nullptr, transaction);
+  int64_t scale = 20000;
+  std::vector<int64_t> keys;
+  for (int64_t key = 0; key < scale; key++)
+    keys.push_back(key);
+  std::random_shuffle(keys.begin(), keys.end());
+  std::vector<RID> table_rids(scale);
+  for (auto key : keys) {
+    std::vector<Value> values = {
+        Value(TypeId::BIGINT, key),
+        Value(TypeId::VARCHAR, "row" + std::to_string(key))};
+    Tuple tuple(values, schema);
+    RID rid;
+    EXPECT_EQ(table->InsertTuple(tuple, rid, transaction), true);
+    table_rids[key] = rid;
+  }
+
+  for (int num_threads : {1, 4}) {
+    std::string name = "idx" + std::to_string(num_threads);
+    IndexMetadata *metadata =
+        new IndexMetadata(name, "foo", schema, key_attrs);
+    // the key and its null bitmap
+    BPlusTreeIndex<GenericKey<16>, RID, GenericComparator<16>> index(metadata,
+                                                                     bpm);
+    EXPECT_TRUE(index.BuildIndex(table, schema, num_threads, transaction));
+
+    std::vector<RID> rids;
+    for (int64_t key = 0; key < scale; key++) {
+      rids.clear();
+      Tuple key_tuple({Value(TypeId::BIGINT, key)}, key_schema);
+      index.ScanKey(key_tuple, rids, transaction);
+      EXPECT_EQ(rids.size(), 1);
+      if (rids.size() == 1) {
+        EXPECT_EQ(rids[0].Get(), table_rids[key].Get());
+      }
+    }
+  }
+  // so does an entry larger than the key, here a varchar with its offset
+  {
+    IndexMetadata *metadata =
+        new IndexMetadata("idx_b", "foo", schema, std::vector<int>{1});
+    BPlusTreeIndex<GenericKey<16>, RID, GenericComparator<16>> index(metadata,
+                                                                     bpm);
+    EXPECT_FALSE(index.BuildIndex(table, schema, 4, transaction));
+  }
+  // with every frame pinned the build fails instead of indexing part of the
+  // table
+  std::vector<page_id_t> pinned_page_ids;
+  while (bpm->NewPage(page_id) != nullptr)
+    pinned_page_ids.push_back(page_id);
+  {
+    IndexMetadata *metadata =
+        new IndexMetadata("idx_full", "foo", schema, key_attrs);
+    BPlusTreeIndex<GenericKey<16>, RID, GenericComparator<16>> index(metadata,
+                                                                     bpm);
+    EXPECT_FALSE(index.BuildIndex(table, schema, 1, transaction));
+  }
+  for (auto pinned_page_id : pinned_page_ids)
+    bpm->UnpinPage(pinned_page_id, false);
+
+  bpm->UnpinPage(HEADER_PAGE_ID, true);
+  delete table;
+  delete key_schema;
+  delete schema;
+  delete transaction;
+  delete disk_manager;
+  delete bpm;
+  remove("test.db");
+  remove("test.log");
+}
+TEST(BPlusTreeTests, CoveringIndexTest) {
+  Schema *schema = ParseCreateStatement("a bigint, b varchar(8), c int");
+  std::string index_sql = "foo_idx a include c, b";
+  IndexMetadata *metadata = ParseIndexStatement(index_sql, "foo", schema);
+  EXPECT_EQ(metadata->GetKeyAttrs(), std::vector<int>({0}));
+  EXPECT_EQ(metadata->GetEntryAttrs(), std::vector<int>({0, 2, 1}));
+  Schema *entry_schema = metadata->GetEntrySchema();
+
+  DiskManager *disk_manager = new DiskManager("test.db");
+  BufferPoolManager *bpm = new BufferPoolManager(50, disk_manager);
+  Transaction *transaction = new Transaction(0);
+  // create and fetch header_page
+  page_id_t page_id;
+  auto header_page = bpm->NewPage(page_id);
+  (void)header_page;
+
+  Index *index = ConstructIndex(metadata, bpm);
+  int64_t scale = 2000;
+  for (int64_t key = 0; key < scale; key++) {
+    // entry tuple: key followed by included columns
+    std::vector<Value> values = {Value(TypeId::BIGINT, key),
+                                 Value(TypeId::INTEGER, (int32_t)(key * 3)),
+                                 Value(TypeId::VARCHAR, std::to_string(key))};
+    Tuple entry(values, entry_schema);
+    index->InsertEntry(entry, RID((int32_t)(key >> 32), key & 0xFFFFFFFF),
+                       transaction);
+  }
+
+  std::vector<RID> rids;
+  std::vector<Tuple> entries;
+  for (int64_t key = 0; key < scale + 10; key++) {
+    rids.clear();
+    entries.clear();
+    // probe with the bare key, included columns never take part in compare
+    Tuple key_tuple({Value(TypeId::BIGINT, key)}, index->GetKeySchema());
+    index->ScanKey(key_tuple, rids, entries, transaction);
+    if (key >= scale) {
+      EXPECT_EQ(rids.size(), 0);
+      EXPECT_EQ(entries.size(), 0);
+      continue;
+    }
+    EXPECT_EQ(rids.size(), 1);
+    ASSERT_EQ(entries.size(), 1);
+    EXPECT_EQ(rids[0].GetSlotNum(), key);
+    EXPECT_EQ(entries[0].GetValue(entry_schema, 0).GetAs<int64_t>(), key);
+    EXPECT_EQ(entries[0].GetValue(entry_schema, 1).GetAs<int32_t>(), key * 3);
+    EXPECT_EQ(entries[0].GetValue(entry_schema, 2).ToString(),
+              std::to_string(key));
+  }
+
+  bpm->UnpinPage(HEADER_PAGE_ID, true);
+  delete index;
+  delete schema;
+  delete transaction;
+  delete disk_manager;
+  delete bpm;
+  remove("test.db");
+  remove("test.log");
+}
+
+TEST(BPlusTreeTests, StatisticsTest) {
+  Schema *schema = ParseCreateStatement("a bigint, b int");
+  // parsing consumes the statement
+  auto parse = [schema](std::string sql) {
+    return ParseIndexStatement(sql, "foo", schema);
+  };
+  DiskManager *disk_manager = new DiskManager("test.db");
+  BufferPoolManager *bpm = new BufferPoolManager(50, disk_manager);
+  Transaction *transaction = new Transaction(0);
+  // create and fetch header_page
+  page_id_t page_id;
+  auto header_page = static_cast<HeaderPage *>(bpm->NewPage(page_id));
+
+  Index *index = ConstructIndex(parse("foo_idx a, b"), bpm);
+  Index *unique_index = ConstructIndex(parse("bar_idx b"), bpm);
+  EXPECT_EQ(index->GetStatistics(), nullptr);
+  // 2000 distinct values of a, each shared by 10 entries
+  int64_t scale = 20000;
+  for (int64_t i = 0; i < scale; i++) {
+    Tuple key({Value(TypeId::BIGINT, i / 10),
+               Value(TypeId::INTEGER, (int32_t)i)},
+              index->GetKeySchema());
+    index->InsertEntry(key, RID((int32_t)i), transaction);
+    Tuple unique_key({Value(TypeId::INTEGER, (int32_t)i)},
+                     unique_index->GetKeySchema());
+    unique_index->InsertEntry(unique_key, RID((int32_t)i), transaction);
+  }
+
+  // full walk, counts are exact
+  index->UpdateStatistics(1.0, transaction);
+  const IndexStatistics *statistics = index->GetStatistics();
+  ASSERT_NE(statistics, nullptr);
+  EXPECT_EQ(statistics->entry_count, scale);
+  EXPECT_GE(statistics->height, 2);
+  EXPECT_EQ(statistics->level_pages.size(), statistics->height);
+  EXPECT_EQ(statistics->level_pages[0], 1);
+  EXPECT_GT(statistics->leaf_fill, 0.4);
+  EXPECT_LE(statistics->leaf_fill, 1.0);
+  EXPECT_NEAR(statistics->distinct_count, 2000, 100);
+  EXPECT_NEAR(statistics->EstimateEqualRows(), 10, 1);
+  EXPECT_NEAR(statistics->EstimateRangeRows(0, 499), scale / 4, scale / 40);
+  EXPECT_EQ(statistics->EstimateRangeRows(5000, 6000), 0);
+
+  unique_index->UpdateStatistics(1.0, transaction);
+  EXPECT_EQ(unique_index->GetStatistics()->entry_count, scale);
+  EXPECT_EQ(unique_index->GetStatistics()->distinct_count, scale);
+
+  // sampled walk, counts are estimated
+  index->UpdateStatistics(0.1, transaction);
+  statistics = index->GetStatistics();
+  EXPECT_NEAR(statistics->entry_count, scale, scale / 10);
+  EXPECT_NEAR(statistics->distinct_count, 2000, 300);
+  EXPECT_NEAR(statistics->EstimateRangeRows(0, 999), scale / 2, scale / 10);
+  int64_t entry_count = statistics->entry_count;
+  int height = statistics->height;
+
+  // statistics are persisted in the catalog
+  page_id_t root_page_id;
+  EXPECT_TRUE(header_page->GetRootId("foo_idx", root_page_id));
+  delete index;
+  index = ConstructIndex(parse("foo_idx a, b"), bpm, root_page_id);
+  statistics = index->GetStatistics();
+  ASSERT_NE(statistics, nullptr);
+  EXPECT_EQ(statistics->entry_count, entry_count);
+  EXPECT_EQ(statistics->height, height);
+  // in a namespace tables and indexes can't use
+  EXPECT_TRUE(header_page->GetRootId("__stats_foo_idx", page_id));
+  EXPECT_THROW(parse("__stats_foo_idx b"), Exception);
+  // and never written to pages that do not hold statistics
+  page_id_t other_page_id;
+  Page *other_page = bpm->NewPage(other_page_id);
+  memset(other_page->GetData(), 0x5a, PAGE_SIZE);
+  header_page->InsertRecord("__stats_baz_idx", other_page_id);
+  Index *other_index = ConstructIndex(parse("baz_idx b"), bpm);
+  other_index->UpdateStatistics(1.0, transaction);
+  EXPECT_EQ(other_page->GetData()[0], 0x5a);
+  bpm->UnpinPage(other_page_id, true);
+  delete other_index;
+  // also for names too long for "<index name>_stats"
+  delete unique_index;
+  unique_index = ConstructIndex(parse("a_rather_long_index_name_idx b"), bpm);
+  unique_index->InsertEntry(
+      Tuple({Value(TypeId::INTEGER, 1)}, unique_index->GetKeySchema()),
+      RID(1), transaction);
+  unique_index->UpdateStatistics(1.0, transaction);
+  delete unique_index;
+  unique_index = ConstructIndex(parse("a_rather_long_index_name_idx b"), bpm);
+  ASSERT_NE(unique_index->GetStatistics(), nullptr);
+  EXPECT_EQ(unique_index->GetStatistics()->entry_count, 1);
+
+  bpm->UnpinPage(HEADER_PAGE_ID, true);
+  delete index;
+  delete unique_index;
+  delete schema;
+  delete transaction;
+  delete disk_manager;
+  delete bpm;
+  remove("test.db");
+  remove("test.log");
+}
+
+TEST(BPlusTreeTests, CompressedLeafTest) {
+  Schema *key_schema = ParseCreateStatement("a bigint");
+  GenericComparator<8> comparator(key_schema);
+
+  DiskManager *disk_manager = new DiskManager("test.db");
+  BufferPoolManager *bpm = new BufferPoolManager(100, disk_manager);
+  BPlusTree<GenericKey<8>, RID, GenericComparator<8>> plain_tree(
+      "foo_pk", bpm, comparator);
+  BPlusTree<GenericKey<8>, RID, GenericComparator<8>> tree("bar_pk", bpm,
+                                                           comparator);
+  tree.SetLeafCompression(true);
+  GenericKey<8> index_key;
+  RID rid;
+  Transaction *transaction = new Transaction(0);
+  page_id_t page_id;
+  auto header_page = bpm->NewPage(page_id);
+  (void)header_page;
+
+  // sequential keys, rids clustered 100 to a table page
+  int64_t scale = 10000;
+  auto loader = [scale]() {
+    auto current = std::make_shared<int64_t>(0);
+    return [scale, current](GenericKey<8> &key, RID &value) {
+      if (*current >= scale)
+        return false;
+      key.SetFromInteger(*current);
+      value.Set((int32_t)(*current / 100), (int)(*current % 100));
+      (*current)++;
+      return true;
+    };
+  };
+  EXPECT_TRUE(plain_tree.BulkLoad(loader(), 1.0, transaction));
+  EXPECT_TRUE(tree.BulkLoad(loader(), 1.0, transaction));
+
+  IndexStatistics plain_statistics, statistics;
+  auto ignore = [](const GenericKey<8> &) {};
+  plain_tree.CollectStatistics(plain_statistics, 1.0, ignore);
+  tree.CollectStatistics(statistics, 1.0, ignore);
+  int plain_leaves = plain_statistics.level_pages.back();
+  int leaves = statistics.level_pages.back();
+  EXPECT_LT(leaves, plain_leaves * 6 / 10);
+
+  int64_t count = 0;
+  for (auto iterator = tree.Begin(); iterator.isEnd() == false; ++iterator) {
+    const RID &value = (*iterator).second;
+    EXPECT_EQ(value.GetPageId() * 100 + value.GetSlotNum(), count);
+    count++;
+  }
+  EXPECT_EQ(count, scale);
+
+  std::vector<RID> rids;
+  for (int64_t key = 0; key < scale; key += 7) {
+    rids.clear();
+    index_key.SetFromInteger(key);
+    EXPECT_TRUE(tree.GetValue(index_key, rids));
+    if (rids.size() == 1) {
+      EXPECT_EQ(rids[0].GetPageId(), key / 100);
+      EXPECT_EQ(rids[0].GetSlotNum(), key % 100);
+    }
+  }
+
+  // writes expand the compressed leaves they touch
+  for (int64_t key = 0; key < scale; key += 1000) {
+    index_key.SetFromInteger(key);
+    tree.Remove(index_key, transaction);
+    rid.Set((int32_t)(key / 100), (int)(key % 100));
+    index_key.SetFromInteger(scale + key);
+    EXPECT_TRUE(tree.Insert(index_key, rid, transaction));
+  }
+  for (int64_t key = 0; key < scale; key++) {
+    rids.clear();
+    index_key.SetFromInteger(key);
+    EXPECT_EQ(tree.GetValue(index_key, rids), key % 1000 != 0);
+    index_key.SetFromInteger(scale + key);
+    EXPECT_EQ(tree.GetValue(index_key, rids), key % 1000 == 0);
+  }
+  int64_t size = 0;
+  for (auto iterator = tree.Begin(); iterator.isEnd() == false; ++iterator)
+    size++;
+  EXPECT_EQ(size, scale);
+
+  bpm->UnpinPage(HEADER_PAGE_ID, true);
+  delete transaction;
+  delete disk_manager;
+  delete bpm;
+  remove("test.db");
+  remove("test.log");
+}
+TEST(BPlusTreeTests, MetricsTest) {
+  Schema *key_schema = ParseCreateStatement("a bigint");
+  GenericComparator<8> comparator(key_schema);
+
+  DiskManager *disk_manager = new DiskManager("test.db");
+  BufferPoolManager *bpm = new BufferPoolManager(50, disk_manager);
+  BPlusTree<GenericKey<8>, RID, GenericComparator<8>> tree("foo_pk", bpm,
+                                                           comparator);
+  GenericKey<8> index_key;
+  Transaction *transaction = new Transaction(0);
+  page_id_t page_id;
+  auto header_page = bpm->NewPage(page_id);
+  (void)header_page;
+
+  IndexMetrics &metrics = tree.GetMetrics();
+  EXPECT_FALSE(metrics.IsEnabled());
+  const uint64_t scale = 2000;
+  // nothing is recorded while disabled
+  for (uint64_t key = 0; key < scale / 2; key++) {
+    index_key.SetFromInteger((int64_t)key);
+    tree.Insert(index_key, RID((int32_t)key), transaction);
+  }
+  EXPECT_EQ(metrics.inserts.load(), 0u);
+  EXPECT_EQ(metrics.splits.load(), 0u);
+
+  metrics.SetEnabled(true);
+  for (uint64_t key = scale / 2; key < scale; key++) {
+    index_key.SetFromInteger((int64_t)key);
+    tree.Insert(index_key, RID((int32_t)key), transaction);
+  }
+  EXPECT_EQ(metrics.inserts.load(), scale / 2);
+  EXPECT_EQ(metrics.insert_latency.GetCount(), scale / 2);
+  EXPECT_GE(metrics.descents.load(), scale / 2);
+  EXPECT_GT(metrics.splits.load(), 0u);
+  // every insert fetches at least one page per level
+  EXPECT_GE(metrics.pages_touched.load(), scale);
+  EXPECT_EQ(metrics.pages_per_operation.GetCount(), scale / 2);
+  EXPECT_GE(metrics.pages_per_operation.GetPercentile(50), 2u);
+
+  std::vector<RID> rids;
+  for (uint64_t key = 0; key < scale; key++) {
+    index_key.SetFromInteger((int64_t)key);
+    tree.GetValue(index_key, rids);
+  }
+  EXPECT_EQ(metrics.lookups.load(), scale);
+  EXPECT_EQ(metrics.lookup_latency.GetCount(), scale);
+  EXPECT_LE(metrics.lookup_latency.GetPercentile(50),
+            metrics.lookup_latency.GetPercentile(100));
+
+  for (uint64_t key = 0; key < scale; key++) {
+    index_key.SetFromInteger((int64_t)key);
+    tree.Remove(index_key, transaction);
+  }
+  EXPECT_EQ(metrics.removes.load(), scale);
+  EXPECT_GT(metrics.merges.load(), 0u);
+  EXPECT_GT(metrics.redistributions.load() + metrics.merges.load(),
+            metrics.splits.load() / 2);
+  // the tree shrank back to nothing
+  EXPECT_GE(metrics.root_changes.load(), 2u);
+  EXPECT_EQ(metrics.latch_waits.load(), 0u);
+  EXPECT_NE(metrics.ToString().find("removes: 2000"), std::string::npos);
+
+  metrics.Reset();
+  EXPECT_EQ(metrics.removes.load(), 0u);
+  EXPECT_EQ(metrics.lookup_latency.GetCount(), 0u);
+
+  bpm->UnpinPage(HEADER_PAGE_ID, true);
+  delete transaction;
+  delete disk_manager;
+  delete bpm;
+  remove("test.db");
+  remove("test.log");
+}
 } // namespace cmudb
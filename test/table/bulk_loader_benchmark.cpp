@@ -0,0 +1,97 @@
+/**
+ * bulk_loader_benchmark.cpp
+ */
+
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "buffer/buffer_pool_manager.h"
+#include "common/string_utility.h"
+#include "table/bulk_loader.h"
+#include "table/table_heap.h"
+#include "vtable/virtual_table.h"
+#include "gtest/gtest.h"
+
+namespace cmudb {
+
+// a CSV file loaded and indexed in bulk and through row inserts
+TEST(BulkLoaderBenchmark, Load) {
+  std::string create = "a int, b bigint, c double, s varchar(32)";
+  const int row_count = 200000;
+  std::string csv;
+  for (int i = 0; i < row_count; i++)
+    csv += std::to_string(i) + "," + std::to_string(i * 7) + "," +
+           std::to_string(i / 4.0) + ",name" + std::to_string(i % 1000) +
+           "\n";
+
+  for (bool bulk : {false, true}) {
+    remove("test.db");
+    Schema *schema = ParseCreateStatement(create);
+    DiskManager *disk_manager = new DiskManager("test.db");
+    BufferPoolManager *buffer_pool_manager =
+        new BufferPoolManager(1000, disk_manager);
+    LockManager *lock_manager = new LockManager(false);
+    Transaction transaction(0);
+    page_id_t header_page_id;
+    buffer_pool_manager->NewPage(header_page_id);
+    buffer_pool_manager->UnpinPage(header_page_id, true);
+
+    auto start = std::chrono::steady_clock::now();
+    page_id_t first_page_id;
+    if (bulk) {
+      std::istringstream in(csv);
+      BulkLoader loader(schema, disk_manager, buffer_pool_manager);
+      EXPECT_TRUE(loader.LoadCsv(in, 4));
+      EXPECT_TRUE(loader.Finish());
+      first_page_id = loader.GetFirstPageId();
+    } else {
+      // a parse of every line and an insert per row
+      TableHeap table(buffer_pool_manager, lock_manager, nullptr,
+                      &transaction, TableLayout::NSM, schema);
+      first_page_id = table.GetFirstPageId();
+      std::istringstream in(csv);
+      std::string line;
+      RID rid;
+      while (std::getline(in, line)) {
+        std::vector<std::string> fields = StringUtility::Split(line, ',');
+        Tuple tuple({Value(TypeId::INTEGER, std::stoi(fields[0])),
+                     Value(TypeId::BIGINT, (int64_t)std::stoll(fields[1])),
+                     Value(TypeId::DECIMAL, std::stod(fields[2])),
+                     Value(TypeId::VARCHAR, fields[3])},
+                    schema);
+        EXPECT_TRUE(table.InsertTuple(tuple, rid, &transaction));
+      }
+    }
+    std::string index_string = "foo_pk a";
+    Index *index = ConstructIndex(
+        ParseIndexStatement(index_string, "foo", schema),
+        buffer_pool_manager);
+    TableHeap table(buffer_pool_manager, lock_manager, nullptr,
+                    first_page_id, schema);
+    index->BuildIndex(&table, schema, bulk ? 4 : 1, &transaction);
+    buffer_pool_manager->FlushAllPages();
+    std::chrono::duration<double, std::milli> elapsed =
+        std::chrono::steady_clock::now() - start;
+    std::cout << (bulk ? "bulk load" : "row inserts") << ": "
+              << elapsed.count() << "ms" << std::endl;
+
+    std::vector<RID> result;
+    index->ScanKey(Tuple({Value(TypeId::INTEGER, 4242)},
+                         index->GetKeySchema()),
+                   result, &transaction);
+    EXPECT_EQ(1, (int)result.size());
+    delete index;
+    delete lock_manager;
+    delete buffer_pool_manager;
+    delete disk_manager;
+    delete schema;
+  }
+  remove("test.db");
+  remove("test.log");
+}
+
+} // namespace cmudb
@@ -0,0 +1,260 @@
+/**
+ * bulk_loader_test.cpp
+ */
+
+#include <cstdio>
+#include <cstring>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "buffer/buffer_pool_manager.h"
+#include "common/string_utility.h"
+#include "table/bulk_loader.h"
+#include "table/table_heap.h"
+#include "vtable/virtual_table.h"
+#include "gtest/gtest.h"
+
+namespace cmudb {
+
+TEST(BulkLoaderTest, CsvTest) {
+  Schema *schema = ParseCreateStatement(
+      "a int, b bigint, c double, d bool, e varchar(16), f varchar(2000)");
+  DiskManager *disk_manager = new DiskManager("test.db");
+  BufferPoolManager *buffer_pool_manager =
+      new BufferPoolManager(50, disk_manager);
+  std::string large(1500, 'x');
+  std::string csv = "a,b,c,d,e,f\n"
+                    "1,10,1.5,true,foo,bar\r\n"
+                    "2,,2.5,0,\"a,\"\"b\"\"\",\n"
+                    "\n"
+                    "3,30,,1,\"\"," +
+                    large + "\n" + "4,40,4.5,false,,last";
+  std::istringstream in(csv);
+  BulkLoader loader(schema, disk_manager, buffer_pool_manager);
+  EXPECT_TRUE(loader.LoadCsv(in, 3, true));
+  EXPECT_TRUE(loader.Finish());
+  EXPECT_EQ(4, (int)loader.GetRowCount());
+
+  Transaction transaction(0);
+  TableHeap table(buffer_pool_manager, nullptr, nullptr,
+                  loader.GetFirstPageId(), schema);
+  std::vector<std::string> rows;
+  for (auto itr = table.begin(&transaction); itr != table.end(); ++itr) {
+    std::string row;
+    for (int i = 0; i < 5; i++)
+      row += (itr->IsNull(schema, i)
+                  ? "null"
+                  : itr->GetValue(schema, i).ToString()) + "|";
+    Value f = table.GetValue(*itr, schema, 5);
+    row += f.IsNull() ? "null" : std::to_string(f.GetLength());
+    rows.push_back(row);
+  }
+  // the large row is inserted last
+  ASSERT_EQ(4, (int)rows.size());
+  EXPECT_EQ("1|10|1.500000|true|foo|4", rows[0]);
+  EXPECT_EQ("2|null|2.500000|false|a,\"b\"|null", rows[1]);
+  EXPECT_EQ("4|40|4.500000|false|null|5", rows[2]);
+  EXPECT_EQ("3|30|null|true||1501", rows[3]);
+
+  delete buffer_pool_manager;
+  delete disk_manager;
+  delete schema;
+  remove("test.db");
+  remove("test.log");
+}
+
+TEST(BulkLoaderTest, ErrorTest) {
+  Schema *schema = ParseCreateStatement("a int, b tinyint, c varchar(8)");
+  DiskManager *disk_manager = new DiskManager("test.db");
+  BufferPoolManager *buffer_pool_manager =
+      new BufferPoolManager(50, disk_manager);
+  std::vector<std::pair<std::string, std::string>> cases{
+      {"1,2,x\n2,3\n", "line 2: expected 3 fields"},
+      {"1,2,x,y\n", "line 1: expected 3 fields"},
+      {"1,2,x\n2,200,y\n", "line 2: bad value for column b: 200"},
+      {"1,2,x\n\n1x,2,y\n", "line 3: bad value for column a: 1x"},
+      {"1,2,\"x\n", "line 1: unterminated quote"},
+      {"1,2,\"x\"y\n", "line 1: text after a quoted field"}};
+  for (auto &test_case : cases) {
+    std::istringstream in(test_case.first);
+    BulkLoader loader(schema, disk_manager, buffer_pool_manager);
+    EXPECT_FALSE(loader.LoadCsv(in));
+    EXPECT_EQ(test_case.second, loader.GetError());
+  }
+  std::istringstream in(std::string("\x08\0\0\0abc", 7));
+  BulkLoader loader(schema, disk_manager, buffer_pool_manager);
+  EXPECT_FALSE(loader.LoadBinary(in));
+  EXPECT_EQ("row 1: bad size", loader.GetError());
+  // varchars must lie within their tuple
+  Tuple tuple({Value(TypeId::INTEGER, 1), Value(TypeId::TINYINT, 2),
+               Value(TypeId::VARCHAR, "abc")},
+              schema);
+  std::string row(sizeof(int32_t) + tuple.GetLength(), '\0');
+  tuple.SerializeTo(&row[0]);
+  // where the offset of c is stored
+  size_t position = sizeof(int32_t) + schema->GetOffset(2);
+  for (int32_t offset : {tuple.GetLength(), 2}) {
+    std::string bad_row = row;
+    memcpy(&bad_row[position], &offset, sizeof(int32_t));
+    std::istringstream bad_in(row + bad_row);
+    BulkLoader bad_loader(schema, disk_manager, buffer_pool_manager);
+    EXPECT_FALSE(bad_loader.LoadBinary(bad_in));
+    EXPECT_EQ("row 2: bad value for column c", bad_loader.GetError());
+    EXPECT_EQ(1, (int)bad_loader.GetRowCount());
+  }
+  std::string long_row = row;
+  uint32_t length = 100;
+  int32_t offset;
+  memcpy(&offset, &row[position], sizeof(int32_t));
+  memcpy(&long_row[sizeof(int32_t) + offset], &length, sizeof(uint32_t));
+  std::istringstream long_in(long_row);
+  BulkLoader long_loader(schema, disk_manager, buffer_pool_manager);
+  EXPECT_FALSE(long_loader.LoadBinary(long_in));
+  EXPECT_EQ("row 1: bad value for column c", long_loader.GetError());
+  EXPECT_EQ(0, (int)long_loader.GetRowCount());
+
+  delete buffer_pool_manager;
+  delete disk_manager;
+  delete schema;
+  remove("test.db");
+  remove("test.log");
+}
+
+TEST(BulkLoaderTest, BinaryTest) {
+  Schema *schema = ParseCreateStatement("a int, b varchar(16)");
+  DiskManager *disk_manager = new DiskManager("test.db");
+  BufferPoolManager *buffer_pool_manager =
+      new BufferPoolManager(50, disk_manager);
+  // the rows are loaded in two halves
+  std::string data[2];
+  for (int i = 0; i < 5000; i++) {
+    Tuple tuple({Value(TypeId::INTEGER, i),
+                 Value(TypeId::VARCHAR, "row " + std::to_string(i))},
+                schema);
+    std::string row(sizeof(int32_t) + tuple.GetLength(), '\0');
+    tuple.SerializeTo(&row[0]);
+    data[i >= 2500] += row;
+  }
+  std::istringstream first_half(data[0]);
+  std::istringstream second_half(data[1]);
+  BulkLoader loader(schema, disk_manager, buffer_pool_manager,
+                    TableLayout::PAX);
+  EXPECT_TRUE(loader.LoadBinary(first_half));
+  // a page allocated in the middle of the load is skipped
+  page_id_t other_page_id = disk_manager->AllocatePage();
+  EXPECT_TRUE(loader.LoadBinary(second_half));
+  EXPECT_TRUE(loader.Finish());
+
+  Transaction transaction(0);
+  TableHeap table(buffer_pool_manager, nullptr, nullptr,
+                  loader.GetFirstPageId(), schema);
+  int i = 0;
+  for (auto itr = table.begin(&transaction); itr != table.end(); ++itr, i++) {
+    EXPECT_EQ(i, itr->GetValue(schema, 0).GetAs<int32_t>());
+    EXPECT_EQ("row " + std::to_string(i),
+              itr->GetValue(schema, 1).ToString());
+    EXPECT_NE(other_page_id, itr->GetRid().GetPageId());
+  }
+  EXPECT_EQ(5000, i);
+  EXPECT_FALSE(table.GetColumnEncodings().empty());
+
+  delete buffer_pool_manager;
+  delete disk_manager;
+  delete schema;
+  remove("test.db");
+  remove("test.log");
+}
+
+TEST(BulkLoaderTest, LoadTest) {
+  std::string create = "a int, b bigint, c double, s varchar(32)";
+  const int row_count = 20000;
+  std::string csv;
+  for (int i = 0; i < row_count; i++)
+    csv += std::to_string(i) + "," + std::to_string(i * 7) + "," +
+           std::to_string(i / 4.0) + ",name" + std::to_string(i % 1000) +
+           "\n";
+
+  for (bool bulk : {false, true}) {
+    remove("test.db");
+    Schema *schema = ParseCreateStatement(create);
+    DiskManager *disk_manager = new DiskManager("test.db");
+    BufferPoolManager *buffer_pool_manager =
+        new BufferPoolManager(1000, disk_manager);
+    LockManager *lock_manager = new LockManager(false);
+    Transaction transaction(0);
+    page_id_t header_page_id;
+    buffer_pool_manager->NewPage(header_page_id);
+    buffer_pool_manager->UnpinPage(header_page_id, true);
+
+    page_id_t first_page_id;
+    if (bulk) {
+      std::istringstream in(csv);
+      BulkLoader loader(schema, disk_manager, buffer_pool_manager);
+      EXPECT_TRUE(loader.LoadCsv(in, 4));
+      EXPECT_TRUE(loader.Finish());
+      first_page_id = loader.GetFirstPageId();
+    } else {
+      // a parse of every line and an insert per row
+      TableHeap table(buffer_pool_manager, lock_manager, nullptr,
+                      &transaction, TableLayout::NSM, schema);
+      first_page_id = table.GetFirstPageId();
+      std::istringstream in(csv);
+      std::string line;
+      RID rid;
+      while (std::getline(in, line)) {
+        std::vector<std::string> fields = StringUtility::Split(line, ',');
+        Tuple tuple({Value(TypeId::INTEGER, std::stoi(fields[0])),
+                     Value(TypeId::BIGINT, (int64_t)std::stoll(fields[1])),
+                     Value(TypeId::DECIMAL, std::stod(fields[2])),
+                     Value(TypeId::VARCHAR, fields[3])},
+                    schema);
+        EXPECT_TRUE(table.InsertTuple(tuple, rid, &transaction));
+      }
+    }
+    std::string index_string = "foo_pk a";
+    Index *index = ConstructIndex(
+        ParseIndexStatement(index_string, "foo", schema),
+        buffer_pool_manager);
+    TableHeap table(buffer_pool_manager, lock_manager, nullptr,
+                    first_page_id, schema);
+    EXPECT_TRUE(
+        index->BuildIndex(&table, schema, bulk ? 4 : 1, &transaction));
+    buffer_pool_manager->FlushAllPages();
+
+    std::vector<RID> result;
+    index->ScanKey(Tuple({Value(TypeId::INTEGER, 4242)},
+                         index->GetKeySchema()),
+                   result, &transaction);
+    ASSERT_EQ(1, (int)result.size());
+    Tuple tuple(result[0]);
+    EXPECT_TRUE(table.GetTuple(result[0], tuple, &transaction));
+    EXPECT_EQ("name242", tuple.GetValue(schema, 3).ToString());
+    delete index;
+    delete lock_manager;
+    delete buffer_pool_manager;
+    delete disk_manager;
+
+    // reopened, the file hands out new pages after the loaded ones
+    disk_manager = new DiskManager("test.db");
+    buffer_pool_manager = new BufferPoolManager(50, disk_manager);
+    TableHeap reopened(buffer_pool_manager, nullptr, nullptr, first_page_id,
+                       schema);
+    int count = 0;
+    for (auto itr = reopened.begin(&transaction); itr != reopened.end();
+         ++itr)
+      count++;
+    EXPECT_EQ(row_count, count);
+    page_id_t page_id;
+    buffer_pool_manager->NewPage(page_id);
+    EXPECT_GT(page_id, first_page_id + 100);
+    buffer_pool_manager->UnpinPage(page_id, false);
+    delete buffer_pool_manager;
+    delete disk_manager;
+    delete schema;
+  }
+  remove("test.db");
+  remove("test.log");
+}
+
+} // namespace cmudb
@@ -0,0 +1,552 @@
+/**
+ * table_heap_benchmark.cpp
+ */
+
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+#include <random>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "buffer/buffer_pool_manager.h"
+#include "table/column_batch.h"
+#include "table/table_heap.h"
+#include "vtable/virtual_table.h"
+#include "gtest/gtest.h"
+
+namespace cmudb {
+
+/*
+ * Inserts into a growing heap, the insert rate must not drop with the number
+ * of pages
+ */
+TEST(TableHeapBenchmark, Insert) {
+  Schema *schema = ParseCreateStatement("a bigint, b varchar(200)");
+  Transaction *transaction = new Transaction(0);
+  DiskManager *disk_manager = new DiskManager("test.db");
+  BufferPoolManager *buffer_pool_manager =
+      new BufferPoolManager(50, disk_manager);
+  LockManager *lock_manager = new LockManager(false);
+  LogManager *log_manager = new LogManager(disk_manager);
+  TableHeap *table = new TableHeap(buffer_pool_manager, lock_manager,
+                                   log_manager, transaction);
+
+  const int rounds = 10, per_round = 4000;
+  std::set<page_id_t> page_ids;
+  RID rid;
+  for (int round = 0; round < rounds; round++) {
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < per_round; i++) {
+      std::vector<Value> values{
+          Value(TypeId::BIGINT, (int64_t)(round * per_round + i)),
+          Value(TypeId::VARCHAR, std::string(150, 'a' + i % 26))};
+      Tuple tuple(values, schema);
+      ASSERT_TRUE(table->InsertTuple(tuple, rid, transaction));
+      page_ids.insert(rid.GetPageId());
+    }
+    std::chrono::duration<double, std::milli> elapsed =
+        std::chrono::steady_clock::now() - start;
+    std::cout << "pages: " << page_ids.size() << " inserts/ms: "
+              << per_round / elapsed.count() << std::endl;
+  }
+
+  delete table;
+  delete log_manager;
+  delete lock_manager;
+  delete buffer_pool_manager;
+  delete disk_manager;
+  delete transaction;
+  delete schema;
+  remove("test.db");
+  remove("test.log");
+}
+
+// rows inserted one at a time and in whole batches
+TEST(TableHeapBenchmark, BatchInsert) {
+  Schema *schema = ParseCreateStatement("a bigint, b int, c varchar(16)");
+  DiskManager *disk_manager = new DiskManager("test.db");
+  BufferPoolManager *buffer_pool_manager =
+      new BufferPoolManager(50, disk_manager);
+  LockManager *lock_manager = new LockManager(false);
+  LogManager *log_manager = new LogManager(disk_manager);
+
+  const int row_count = 200000;
+  std::vector<Tuple> tuples;
+  for (int i = 0; i < row_count; i++) {
+    std::vector<Value> values{Value(TypeId::BIGINT, (int64_t)i),
+                              Value(TypeId::INTEGER, (int32_t)(i % 1000)),
+                              Value(TypeId::VARCHAR, std::to_string(i))};
+    tuples.emplace_back(values, schema);
+  }
+
+  // one tuple at a time
+  Transaction *transaction = new Transaction(0);
+  TableHeap *table = new TableHeap(buffer_pool_manager, lock_manager,
+                                   log_manager, transaction);
+  auto start = std::chrono::steady_clock::now();
+  RID rid;
+  for (auto &tuple : tuples)
+    ASSERT_TRUE(table->InsertTuple(tuple, rid, transaction));
+  std::chrono::duration<double> single =
+      std::chrono::steady_clock::now() - start;
+  delete table;
+  delete transaction;
+
+  // whole batches
+  transaction = new Transaction(1);
+  table = new TableHeap(buffer_pool_manager, lock_manager, log_manager,
+                        transaction);
+  start = std::chrono::steady_clock::now();
+  std::vector<RID> rids;
+  const int batch_size = 10000;
+  for (int i = 0; i < row_count; i += batch_size) {
+    std::vector<Tuple> batch(tuples.begin() + i,
+                             tuples.begin() + i + batch_size);
+    ASSERT_TRUE(table->InsertTuples(batch, rids, transaction));
+  }
+  std::chrono::duration<double> batched =
+      std::chrono::steady_clock::now() - start;
+  std::cout << "rows/s single: " << row_count / single.count()
+            << " batched: " << row_count / batched.count() << std::endl;
+
+  delete table;
+  delete transaction;
+  delete log_manager;
+  delete lock_manager;
+  delete buffer_pool_manager;
+  delete disk_manager;
+  delete schema;
+  remove("test.db");
+  remove("test.log");
+}
+
+// full scans that copy every tuple and that read tuples in place
+TEST(TableHeapBenchmark, ZeroCopyScan) {
+  Schema *schema = ParseCreateStatement("a bigint, b varchar(16)");
+  Transaction *transaction = new Transaction(0);
+  DiskManager *disk_manager = new DiskManager("test.db");
+  BufferPoolManager *buffer_pool_manager =
+      new BufferPoolManager(50, disk_manager);
+  LockManager *lock_manager = new LockManager(false);
+  LogManager *log_manager = new LogManager(disk_manager);
+  TableHeap *table = new TableHeap(buffer_pool_manager, lock_manager,
+                                   log_manager, transaction);
+
+  const int64_t row_count = 200000;
+  std::vector<Tuple> tuples;
+  for (int64_t i = 0; i < row_count; i++) {
+    std::vector<Value> values{Value(TypeId::BIGINT, i),
+                              Value(TypeId::VARCHAR, std::to_string(i))};
+    tuples.emplace_back(values, schema);
+  }
+  std::vector<RID> rids;
+  ASSERT_TRUE(table->InsertTuples(tuples, rids, transaction));
+
+  for (bool zero_copy : {false, true}) {
+    auto start = std::chrono::steady_clock::now();
+    int64_t sum = 0;
+    for (auto itr = table->begin(transaction, zero_copy); itr != table->end();
+         ++itr)
+      sum += itr->GetValue(schema, 0).GetAs<int64_t>();
+    std::chrono::duration<double, std::milli> elapsed =
+        std::chrono::steady_clock::now() - start;
+    std::cout << (zero_copy ? "zero copy" : "copy") << " scan: "
+              << elapsed.count() << "ms" << std::endl;
+    EXPECT_EQ(row_count * (row_count - 1) / 2, sum);
+  }
+
+  delete table;
+  delete log_manager;
+  delete lock_manager;
+  delete buffer_pool_manager;
+  delete disk_manager;
+  delete transaction;
+  delete schema;
+  remove("test.db");
+  remove("test.log");
+}
+
+// a filter on one column, over column batches and tuple at a time
+TEST(TableHeapBenchmark, BatchScan) {
+  Schema *schema =
+      ParseCreateStatement("a bigint, b int, c double, d varchar(16)");
+  Transaction *transaction = new Transaction(0);
+  DiskManager *disk_manager = new DiskManager("test.db");
+  BufferPoolManager *buffer_pool_manager =
+      new BufferPoolManager(50, disk_manager);
+  LockManager *lock_manager = new LockManager(false);
+  LogManager *log_manager = new LogManager(disk_manager);
+  TableHeap *table = new TableHeap(buffer_pool_manager, lock_manager,
+                                   log_manager, transaction);
+
+  const int64_t row_count = 100000;
+  std::vector<Tuple> tuples;
+  for (int64_t i = 0; i < row_count; i++) {
+    std::vector<Value> values{Value(TypeId::BIGINT, i),
+                              Value(TypeId::INTEGER, (int32_t)(i % 100)),
+                              Value(TypeId::DECIMAL, i * 0.5),
+                              Value(TypeId::VARCHAR, std::to_string(i))};
+    tuples.emplace_back(values, schema);
+  }
+  std::vector<RID> rids;
+  ASSERT_TRUE(table->InsertTuples(tuples, rids, transaction));
+
+  auto start = std::chrono::steady_clock::now();
+  ColumnBatch projected(schema, {1});
+  int64_t selected = 0;
+  while (table->NextBatch(projected, transaction)) {
+    const int32_t *b = projected.GetColumn<int32_t>(0);
+    projected.Filter([b](int row) { return b[row] < 10; });
+    selected += projected.GetSelectedCount();
+  }
+  std::chrono::duration<double, std::milli> batched =
+      std::chrono::steady_clock::now() - start;
+  start = std::chrono::steady_clock::now();
+  int64_t expected = 0;
+  for (auto itr = table->begin(transaction); itr != table->end(); ++itr)
+    expected += itr->GetValue(schema, 1).GetAs<int32_t>() < 10 ? 1 : 0;
+  std::chrono::duration<double, std::milli> single =
+      std::chrono::steady_clock::now() - start;
+  std::cout << "filter scan, iterator: " << single.count()
+            << "ms batches: " << batched.count() << "ms" << std::endl;
+  EXPECT_EQ(expected, selected);
+
+  delete table;
+  delete log_manager;
+  delete lock_manager;
+  delete buffer_pool_manager;
+  delete disk_manager;
+  delete transaction;
+  delete schema;
+  remove("test.db");
+  remove("test.log");
+}
+
+// a sum over column batches with 1, 2 and 4 scan threads
+TEST(TableHeapBenchmark, ParallelScan) {
+  Schema *schema = ParseCreateStatement("a bigint, b varchar(16)");
+  Transaction *transaction = new Transaction(0);
+  DiskManager *disk_manager = new DiskManager("test.db");
+  BufferPoolManager *buffer_pool_manager =
+      new BufferPoolManager(2000, disk_manager);
+  LockManager *lock_manager = new LockManager(false);
+  LogManager *log_manager = new LogManager(disk_manager);
+  TableHeap *table = new TableHeap(buffer_pool_manager, lock_manager,
+                                   log_manager, transaction);
+
+  const int64_t row_count = 300000;
+  std::vector<Tuple> tuples;
+  for (int64_t i = 0; i < row_count; i++) {
+    std::vector<Value> values{Value(TypeId::BIGINT, i),
+                              Value(TypeId::VARCHAR, std::to_string(i))};
+    tuples.emplace_back(values, schema);
+  }
+  std::vector<RID> rids;
+  ASSERT_TRUE(table->InsertTuples(tuples, rids, transaction));
+
+  for (int num_threads : {1, 2, 4}) {
+    std::vector<int64_t> sums(num_threads, 0);
+    auto start = std::chrono::steady_clock::now();
+    ASSERT_TRUE(table->ParallelBatchScan(
+        num_threads, schema, {0},
+        [&](int worker_id, ColumnBatch &batch) {
+          const int64_t *a = batch.GetColumn<int64_t>(0);
+          int64_t sum = 0;
+          for (int row = 0; row < batch.GetSize(); row++)
+            sum += a[row];
+          sums[worker_id] += sum;
+        },
+        transaction));
+    std::chrono::duration<double, std::milli> elapsed =
+        std::chrono::steady_clock::now() - start;
+    std::cout << num_threads << " threads: " << elapsed.count() << "ms"
+              << std::endl;
+    int64_t sum = 0;
+    for (int i = 0; i < num_threads; i++)
+      sum += sums[i];
+    EXPECT_EQ(row_count * (row_count - 1) / 2, sum);
+  }
+
+  delete table;
+  delete log_manager;
+  delete lock_manager;
+  delete buffer_pool_manager;
+  delete disk_manager;
+  delete transaction;
+  delete schema;
+  remove("test.db");
+  remove("test.log");
+}
+
+// deletes, updates and inserts within a single page
+TEST(TableHeapBenchmark, PageChurn) {
+  Schema *schema = ParseCreateStatement("a int, b varchar(64)");
+  Transaction *transaction = new Transaction(0);
+  DiskManager *disk_manager = new DiskManager("test.db");
+  BufferPoolManager *buffer_pool_manager =
+      new BufferPoolManager(50, disk_manager);
+  LockManager *lock_manager = new LockManager(false);
+  LogManager *log_manager = new LogManager(disk_manager);
+  page_id_t page_id;
+  auto page =
+      static_cast<TablePage *>(buffer_pool_manager->NewPage(page_id));
+  page->Init(page_id, PAGE_SIZE, INVALID_PAGE_ID, log_manager, transaction);
+
+  // tuple i has a = i and i % 16 characters in b
+  std::vector<Tuple> tuples;
+  for (int32_t i = 0; i < 256; i++) {
+    std::vector<Value> values{Value(TypeId::INTEGER, i),
+                              Value(TypeId::VARCHAR,
+                                    std::string(i % 16, 'a' + i % 26))};
+    tuples.emplace_back(values, schema);
+  }
+  std::mt19937 random(42);
+  // live slots, and the tuple in every slot (-1: free)
+  std::vector<int> live;
+  std::vector<int32_t> contents;
+  RID rid;
+  auto insert = [&]() {
+    int32_t i = random() % tuples.size();
+    if (!page->InsertTuple(tuples[i], rid, transaction, lock_manager,
+                           log_manager))
+      return false;
+    int slot = rid.GetSlotNum();
+    if (slot >= static_cast<int>(contents.size()))
+      contents.resize(slot + 1, -1);
+    EXPECT_EQ(-1, contents[slot]);
+    contents[slot] = i;
+    live.push_back(slot);
+    return true;
+  };
+  while (insert()) {
+  }
+
+  // every round deletes half of the tuples at random, resizes a quarter of
+  // the rest and fills the page up again
+  const int rounds = 2000;
+  int64_t operations = 0;
+  auto start = std::chrono::steady_clock::now();
+  for (int round = 0; round < rounds; round++) {
+    for (size_t n = live.size() / 2; n > 0; n--, operations++) {
+      size_t victim = random() % live.size();
+      rid.Set(page_id, live[victim]);
+      page->ApplyDelete(rid, transaction, log_manager);
+      contents[live[victim]] = -1;
+      live[victim] = live.back();
+      live.pop_back();
+    }
+    for (size_t n = live.size() / 4; n > 0; n--, operations++) {
+      int slot = live[random() % live.size()];
+      int32_t i = random() % tuples.size();
+      Tuple old_tuple;
+      rid.Set(page_id, slot);
+      if (page->UpdateTuple(tuples[i], old_tuple, rid, transaction,
+                            lock_manager, log_manager))
+        contents[slot] = i;
+    }
+    while (insert())
+      operations++;
+  }
+  std::chrono::duration<double, std::milli> elapsed =
+      std::chrono::steady_clock::now() - start;
+  std::cout << "page churn operations/ms: " << operations / elapsed.count()
+            << std::endl;
+
+  buffer_pool_manager->UnpinPage(page_id, true);
+
+  delete log_manager;
+  delete lock_manager;
+  delete buffer_pool_manager;
+  delete disk_manager;
+  delete transaction;
+  delete schema;
+  remove("test.db");
+  remove("test.log");
+}
+
+// one column of a wide table scanned in batches, in either layout
+TEST(TableHeapBenchmark, PaxScan) {
+  std::string create = "a int";
+  for (int i = 1; i < 20; i++)
+    create += ", c" + std::to_string(i) + " bigint";
+  Schema *schema = ParseCreateStatement(create);
+  Transaction *transaction = new Transaction(0);
+  LockManager *lock_manager = new LockManager(false);
+
+  // a small table scanned many times keeps the buffer pool bookkeeping out of
+  // the measurement
+  const int row_count = 20000;
+  const int scan_count = 20;
+  std::vector<Tuple> tuples;
+  for (int i = 0; i < row_count; i++) {
+    std::vector<Value> values{Value(TypeId::INTEGER, (int32_t)i)};
+    for (int j = 1; j < 20; j++)
+      values.emplace_back(TypeId::BIGINT, (int64_t)j);
+    tuples.emplace_back(values, schema);
+  }
+  for (auto layout : {TableLayout::NSM, TableLayout::PAX}) {
+    // a buffer pool of its own that holds the whole table
+    DiskManager *disk_manager = new DiskManager("test.db");
+    BufferPoolManager *buffer_pool_manager =
+        new BufferPoolManager(10000, disk_manager);
+    LogManager *log_manager = new LogManager(disk_manager);
+    TableHeap table(buffer_pool_manager, lock_manager, log_manager,
+                    transaction, layout, schema);
+    std::vector<RID> rids;
+    ASSERT_TRUE(table.InsertTuples(tuples, rids, transaction));
+    ColumnBatch batch(schema, {0});
+    auto start = std::chrono::steady_clock::now();
+    int64_t sum = 0;
+    for (int i = 0; i < scan_count; i++) {
+      while (table.NextBatch(batch, transaction)) {
+        const int32_t *a = batch.GetColumn<int32_t>(0);
+        for (int row = 0; row < batch.GetSize(); row++)
+          sum += a[row];
+      }
+      batch.Rewind();
+    }
+    std::chrono::duration<double, std::milli> elapsed =
+        std::chrono::steady_clock::now() - start;
+    std::cout << (layout == TableLayout::PAX ? "pax" : "nsm")
+              << " one column scan x" << scan_count << ": "
+              << elapsed.count() << "ms, "
+              << table.GetFreeSpaceMap().GetPageCount() << " pages"
+              << std::endl;
+    EXPECT_EQ((int64_t)scan_count * row_count * (row_count - 1) / 2, sum);
+    delete log_manager;
+    delete buffer_pool_manager;
+    delete disk_manager;
+    remove("test.db");
+  }
+
+  delete lock_manager;
+  delete transaction;
+  delete schema;
+  remove("test.db");
+  remove("test.log");
+}
+
+// two columns out of thirty read with and without a projection, in either
+// layout
+TEST(TableHeapBenchmark, Projection) {
+  std::string create = "a int";
+  for (int i = 1; i < 29; i++)
+    create += ", c" + std::to_string(i) + " bigint";
+  create += ", s varchar(32)";
+  Schema *schema = ParseCreateStatement(create);
+  Transaction *transaction = new Transaction(0);
+  LockManager *lock_manager = new LockManager(false);
+  const int row_count = 20000;
+  std::vector<bool> projection(schema->GetColumnCount(), false);
+  projection[0] = projection[29] = true;
+  for (auto layout : {TableLayout::NSM, TableLayout::PAX}) {
+    DiskManager *disk_manager = new DiskManager("test.db");
+    BufferPoolManager *buffer_pool_manager =
+        new BufferPoolManager(10000, disk_manager);
+    LogManager *log_manager = new LogManager(disk_manager);
+    TableHeap table(buffer_pool_manager, lock_manager, log_manager,
+                    transaction, layout, schema);
+    RID rid;
+    for (int i = 0; i < row_count; i++) {
+      std::vector<Value> values{Value(TypeId::INTEGER, i)};
+      for (int j = 1; j < 29; j++)
+        values.emplace_back(TypeId::BIGINT, (int64_t)j);
+      values.emplace_back(TypeId::VARCHAR, "s" + std::to_string(i % 10));
+      ASSERT_TRUE(table.InsertTuple(Tuple(values, schema), rid, transaction));
+    }
+    for (bool project : {false, true}) {
+      auto start = std::chrono::steady_clock::now();
+      int64_t sum = 0;
+      for (int n = 0; n < 10; n++) {
+        auto itr = table.begin(transaction);
+        if (project)
+          itr.SetProjection(projection);
+        for (; itr != table.end(); ++itr) {
+          sum += itr->GetValue(schema, 0).GetAs<int32_t>();
+          sum += itr->GetValue(schema, 29).GetLength();
+        }
+      }
+      std::chrono::duration<double, std::milli> elapsed =
+          std::chrono::steady_clock::now() - start;
+      std::cout << (layout == TableLayout::PAX ? "pax " : "nsm ")
+                << (project ? "two columns" : "all columns")
+                << " scan x10: " << elapsed.count() << "ms" << std::endl;
+      EXPECT_EQ(10 * ((int64_t)row_count * (row_count - 1) / 2 +
+                      row_count * 3),
+                sum);
+    }
+    delete log_manager;
+    delete buffer_pool_manager;
+    delete disk_manager;
+    remove("test.db");
+  }
+
+  delete lock_manager;
+  delete transaction;
+  delete schema;
+  remove("test.db");
+  remove("test.log");
+}
+
+// a filtered scan of plain and of dictionary and run length encoded pages
+TEST(TableHeapBenchmark, Encoding) {
+  Schema *schema =
+      ParseCreateStatement("day int, status varchar(32), a bigint");
+  Transaction *transaction = new Transaction(0);
+  LockManager *lock_manager = new LockManager(false);
+  const std::vector<std::string> statuses{"pending", "shipped", "delivered",
+                                          "returned with damage"};
+  const int row_count = 40000;
+  const std::vector<ColumnEncoding> plain;
+  const std::vector<ColumnEncoding> encoded{
+      ColumnEncoding::RLE, ColumnEncoding::DICTIONARY, ColumnEncoding::PLAIN};
+  for (int e = 0; e < 2; e++) {
+    DiskManager *disk_manager = new DiskManager("test.db");
+    BufferPoolManager *buffer_pool_manager =
+        new BufferPoolManager(10000, disk_manager);
+    LogManager *log_manager = new LogManager(disk_manager);
+    TableHeap table(buffer_pool_manager, lock_manager, log_manager,
+                    transaction, TableLayout::PAX, schema,
+                    e == 0 ? plain : encoded);
+    RID rid;
+    for (int i = 0; i < row_count; i++) {
+      std::vector<Value> values{Value(TypeId::INTEGER, (int32_t)(i / 100)),
+                                Value(TypeId::VARCHAR, statuses[i % 4]),
+                                Value(TypeId::BIGINT, (int64_t)i)};
+      ASSERT_TRUE(table.InsertTuple(Tuple(values, schema), rid, transaction));
+    }
+
+    std::vector<RangePredicate> shipped{
+        RangePredicate(1, RangeOp::EQ, Value(TypeId::VARCHAR, "shipped"))};
+    auto start = std::chrono::steady_clock::now();
+    int count = 0;
+    for (int i = 0; i < 10; i++) {
+      for (auto itr = table.begin(transaction, schema, shipped, true);
+           itr != table.end(); ++itr) {
+        if (itr->GetValue(schema, 1).ToString() == "shipped")
+          count++;
+      }
+    }
+    std::chrono::duration<double, std::milli> elapsed =
+        std::chrono::steady_clock::now() - start;
+    std::cout << (e == 0 ? "plain" : "dict+rle") << ": "
+              << table.GetFreeSpaceMap().GetPageCount()
+              << " pages, status scan x10: " << elapsed.count() << "ms"
+              << std::endl;
+    EXPECT_EQ(10 * row_count / 4, count);
+    delete log_manager;
+    delete buffer_pool_manager;
+    delete disk_manager;
+    remove("test.db");
+  }
+
+  delete lock_manager;
+  delete transaction;
+  delete schema;
+  remove("test.db");
+  remove("test.log");
+}
+
+} // namespace cmudb
@@ -0,0 +1,1133 @@
+/**
+ * table_heap_test.cpp
+ */
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "buffer/buffer_pool_manager.h"
+#include "table/column_batch.h"
+#include "table/free_space_map.h"
+#include "table/table_heap.h"
+#include "table/zone_map.h"
+#include "vtable/virtual_table.h"
+#include "gtest/gtest.h"
+
+namespace cmudb {
+
+TEST(TableHeapTest, FreeSpaceMapTest) {
+  FreeSpaceMap map;
+  EXPECT_EQ(INVALID_PAGE_ID, map.Find(1));
+  for (page_id_t page_id = 0; page_id < 100; page_id++)
+    map.Update(page_id, 100);
+  map.Update(42, 2000);
+  map.Update(77, 3000);
+  EXPECT_EQ(100, map.GetPageCount());
+  EXPECT_EQ(0, map.Find(50));
+  EXPECT_EQ(42, map.Find(1000));
+  EXPECT_EQ(77, map.Find(2500));
+  EXPECT_EQ(INVALID_PAGE_ID, map.Find(3500));
+  // free space is rounded down, requests are rounded up
+  EXPECT_LE(map.GetFreeSpace(42), 2000);
+  EXPECT_EQ(77, map.Find(2001));
+
+  map.Update(42, 0);
+  EXPECT_EQ(77, map.Find(1000));
+  map.Remove(77);
+  EXPECT_EQ(INVALID_PAGE_ID, map.Find(1000));
+  EXPECT_EQ(-1, map.GetFreeSpace(77));
+  EXPECT_EQ(99, map.GetPageCount());
+  map.Update(1000, 2000);
+  EXPECT_EQ(1000, map.Find(1000));
+}
+
+TEST(TableHeapTest, InsertTest) {
+  Schema *schema = ParseCreateStatement("a bigint, b varchar(200)");
+  Transaction *transaction = new Transaction(0);
+  DiskManager *disk_manager = new DiskManager("test.db");
+  BufferPoolManager *buffer_pool_manager =
+      new BufferPoolManager(50, disk_manager);
+  LockManager *lock_manager = new LockManager(false);
+  LogManager *log_manager = new LogManager(disk_manager);
+  TableHeap *table = new TableHeap(buffer_pool_manager, lock_manager,
+                                   log_manager, transaction);
+
+  std::vector<RID> rids;
+  std::set<page_id_t> page_ids;
+  RID rid;
+  for (int i = 0; i < 4000; i++) {
+    std::vector<Value> values{
+        Value(TypeId::BIGINT, (int64_t)rids.size()),
+        Value(TypeId::VARCHAR, std::string(150, 'a' + i % 26))};
+    Tuple tuple(values, schema);
+    ASSERT_TRUE(table->InsertTuple(tuple, rid, transaction));
+    rids.push_back(rid);
+    page_ids.insert(rid.GetPageId());
+  }
+  EXPECT_EQ((int)page_ids.size(), table->GetFreeSpaceMap().GetPageCount());
+
+  // free every other tuple of the first half, new tuples go to those pages
+  for (size_t i = 0; i < rids.size() / 2; i += 2) {
+    EXPECT_TRUE(table->MarkDelete(rids[i], transaction));
+    table->ApplyDelete(rids[i], transaction);
+  }
+  const int page_count = table->GetFreeSpaceMap().GetPageCount();
+  for (size_t i = 0; i < rids.size() / 4; i++) {
+    std::vector<Value> values{Value(TypeId::BIGINT, (int64_t)i),
+                              Value(TypeId::VARCHAR, std::string(150, 'z'))};
+    Tuple tuple(values, schema);
+    ASSERT_TRUE(table->InsertTuple(tuple, rid, transaction));
+    EXPECT_EQ(1u, page_ids.count(rid.GetPageId()));
+  }
+  EXPECT_EQ(page_count, table->GetFreeSpaceMap().GetPageCount());
+
+  // a reopened heap rebuilds its map from the page chain
+  TableHeap reopened(buffer_pool_manager, lock_manager, log_manager,
+                     table->GetFirstPageId());
+  std::vector<Value> values{Value(TypeId::BIGINT, (int64_t)0),
+                            Value(TypeId::VARCHAR, std::string(150, 'y'))};
+  Tuple tuple(values, schema);
+  ASSERT_TRUE(reopened.InsertTuple(tuple, rid, transaction));
+  EXPECT_EQ(page_count, reopened.GetFreeSpaceMap().GetPageCount() -
+                            (page_ids.count(rid.GetPageId()) ? 0 : 1));
+  Tuple result;
+  EXPECT_TRUE(reopened.GetTuple(rid, result, transaction));
+  EXPECT_EQ(150u, result.GetValue(schema, 1).ToString().size());
+
+  delete table;
+  delete log_manager;
+  delete lock_manager;
+  delete buffer_pool_manager;
+  delete disk_manager;
+  delete transaction;
+  delete schema;
+  remove("test.db");
+  remove("test.log");
+}
+
+TEST(TableHeapTest, BatchInsertTest) {
+  Schema *schema = ParseCreateStatement("a bigint, b int, c varchar(16)");
+  DiskManager *disk_manager = new DiskManager("test.db");
+  BufferPoolManager *buffer_pool_manager =
+      new BufferPoolManager(50, disk_manager);
+  LockManager *lock_manager = new LockManager(false);
+  LogManager *log_manager = new LogManager(disk_manager);
+
+  const int row_count = 20000;
+  std::vector<Tuple> tuples;
+  for (int i = 0; i < row_count; i++) {
+    std::vector<Value> values{Value(TypeId::BIGINT, (int64_t)i),
+                              Value(TypeId::INTEGER, (int32_t)(i % 1000)),
+                              Value(TypeId::VARCHAR, std::to_string(i))};
+    tuples.emplace_back(values, schema);
+  }
+
+  // whole batches
+  Transaction *transaction = new Transaction(0);
+  TableHeap *table = new TableHeap(buffer_pool_manager, lock_manager,
+                                   log_manager, transaction);
+  std::vector<RID> rids;
+  const int batch_size = 1000;
+  for (int i = 0; i < row_count; i += batch_size) {
+    std::vector<Tuple> batch(tuples.begin() + i,
+                             tuples.begin() + i + batch_size);
+    ASSERT_TRUE(table->InsertTuples(batch, rids, transaction));
+  }
+
+  ASSERT_EQ((size_t)row_count, rids.size());
+  EXPECT_EQ((size_t)row_count, transaction->GetWriteSet()->size());
+  Tuple result;
+  for (int i = 0; i < row_count; i += 997) {
+    ASSERT_TRUE(table->GetTuple(rids[i], result, transaction));
+    EXPECT_EQ(i, result.GetValue(schema, 0).GetAs<int64_t>());
+  }
+  int count = 0;
+  for (auto itr = table->begin(transaction); itr != table->end(); ++itr)
+    count++;
+  EXPECT_EQ(row_count, count);
+
+  // an oversized tuple rejects the whole batch
+  std::vector<Value> values{
+      Value(TypeId::BIGINT, (int64_t)0), Value(TypeId::INTEGER, (int32_t)0),
+      Value(TypeId::VARCHAR, std::string(PAGE_SIZE, 'x'))};
+  std::vector<Tuple> oversized{tuples[0], Tuple(values, schema)};
+  rids.clear();
+  EXPECT_FALSE(table->InsertTuples(oversized, rids, transaction));
+  EXPECT_TRUE(rids.empty());
+
+  delete table;
+  delete transaction;
+  delete log_manager;
+  delete lock_manager;
+  delete buffer_pool_manager;
+  delete disk_manager;
+  delete schema;
+  remove("test.db");
+  remove("test.log");
+}
+
+TEST(TableHeapTest, ZeroCopyScanTest) {
+  Schema *schema = ParseCreateStatement("a bigint, b varchar(16)");
+  Transaction *transaction = new Transaction(0);
+  DiskManager *disk_manager = new DiskManager("test.db");
+  BufferPoolManager *buffer_pool_manager =
+      new BufferPoolManager(50, disk_manager);
+  LockManager *lock_manager = new LockManager(false);
+  LogManager *log_manager = new LogManager(disk_manager);
+  TableHeap *table = new TableHeap(buffer_pool_manager, lock_manager,
+                                   log_manager, transaction);
+
+  const int64_t row_count = 20000;
+  std::vector<Tuple> tuples;
+  for (int64_t i = 0; i < row_count; i++) {
+    std::vector<Value> values{Value(TypeId::BIGINT, i),
+                              Value(TypeId::VARCHAR, std::to_string(i))};
+    tuples.emplace_back(values, schema);
+  }
+  std::vector<RID> rids;
+  ASSERT_TRUE(table->InsertTuples(tuples, rids, transaction));
+
+  auto scan = [&](bool zero_copy, int64_t &count) {
+    int64_t sum = 0;
+    count = 0;
+    for (auto itr = table->begin(transaction, zero_copy); itr != table->end();
+         ++itr) {
+      EXPECT_EQ(zero_copy, !itr->IsAllocated());
+      sum += itr->GetValue(schema, 0).GetAs<int64_t>();
+      count++;
+    }
+    return sum;
+  };
+  int64_t count, zero_copy_count;
+  int64_t sum = scan(false, count);
+  EXPECT_EQ(row_count, count);
+  EXPECT_EQ(row_count * (row_count - 1) / 2, sum);
+  EXPECT_EQ(sum, scan(true, zero_copy_count));
+  EXPECT_EQ(row_count, zero_copy_count);
+
+  // a copy owns its tuple and holds no page
+  {
+    auto itr = table->begin(transaction, true);
+    auto copy = itr++;
+    EXPECT_TRUE(copy->IsAllocated());
+    EXPECT_EQ(0, copy->GetValue(schema, 0).GetAs<int64_t>());
+    EXPECT_EQ(1, itr->GetValue(schema, 0).GetAs<int64_t>());
+  }
+  // iterators are gone, so the pages can be written again
+  Tuple tuple;
+  ASSERT_TRUE(table->GetTuple(rids[0], tuple, transaction));
+  for (auto &rid : rids) {
+    if (rid.GetPageId() != rids[0].GetPageId())
+      break;
+    EXPECT_TRUE(table->MarkDelete(rid, transaction));
+    table->ApplyDelete(rid, transaction);
+  }
+  // the first page is empty now
+  {
+    auto itr = table->begin(transaction, true);
+    ASSERT_TRUE(itr != table->end());
+    EXPECT_NE(rids[0].GetPageId(), itr->GetRid().GetPageId());
+  }
+
+  delete table;
+  delete log_manager;
+  delete lock_manager;
+  delete buffer_pool_manager;
+  delete disk_manager;
+  delete transaction;
+  delete schema;
+  remove("test.db");
+  remove("test.log");
+}
+
+TEST(TableHeapTest, BatchScanTest) {
+  Schema *schema =
+      ParseCreateStatement("a bigint, b int, c double, d varchar(16)");
+  Transaction *transaction = new Transaction(0);
+  DiskManager *disk_manager = new DiskManager("test.db");
+  BufferPoolManager *buffer_pool_manager =
+      new BufferPoolManager(50, disk_manager);
+  LockManager *lock_manager = new LockManager(false);
+  LogManager *log_manager = new LogManager(disk_manager);
+  TableHeap *table = new TableHeap(buffer_pool_manager, lock_manager,
+                                   log_manager, transaction);
+
+  const int64_t row_count = 10000;
+  std::vector<Tuple> tuples;
+  for (int64_t i = 0; i < row_count; i++) {
+    std::vector<Value> values{Value(TypeId::BIGINT, i),
+                              Value(TypeId::INTEGER, (int32_t)(i % 100)),
+                              Value(TypeId::DECIMAL, i * 0.5),
+                              Value(TypeId::VARCHAR, std::to_string(i))};
+    tuples.emplace_back(values, schema);
+  }
+  std::vector<RID> rids;
+  ASSERT_TRUE(table->InsertTuples(tuples, rids, transaction));
+  // a hole in the first page
+  EXPECT_TRUE(table->MarkDelete(rids[3], transaction));
+  table->ApplyDelete(rids[3], transaction);
+
+  // every column
+  ColumnBatch batch(schema);
+  int64_t count = 0, sum = 0;
+  double decimal_sum = 0;
+  while (table->NextBatch(batch, transaction)) {
+    EXPECT_LE(batch.GetSize(), ColumnBatch::CAPACITY);
+    const int64_t *a = batch.GetColumn<int64_t>(0);
+    const double *c = batch.GetColumn<double>(2);
+    for (int row = 0; row < batch.GetSize(); row++) {
+      sum += a[row];
+      decimal_sum += c[row];
+      uint32_t length;
+      const char *d = batch.GetVarchar(3, row, length);
+      EXPECT_EQ(std::to_string(a[row]), std::string(d, length));
+    }
+    EXPECT_EQ(a[0], batch.GetValue(0, 0).GetAs<int64_t>());
+    EXPECT_EQ(std::to_string(a[0]), batch.GetValue(3, 0).ToString());
+    EXPECT_EQ(rids[a[0]].Get(), batch.GetRid(0).Get());
+    count += batch.GetSize();
+  }
+  EXPECT_EQ(row_count - 1, count);
+  EXPECT_EQ(row_count * (row_count - 1) / 2 - 3, sum);
+  EXPECT_DOUBLE_EQ(sum * 0.5, decimal_sum);
+  EXPECT_FALSE(table->NextBatch(batch, transaction));
+
+  // projection and a filter over the selection vector, against the tuple at
+  // a time iterator
+  ColumnBatch projected(schema, {1});
+  int64_t selected = 0;
+  while (table->NextBatch(projected, transaction)) {
+    const int32_t *b = projected.GetColumn<int32_t>(0);
+    projected.Filter([b](int row) { return b[row] < 10; });
+    for (int i = 0; i < projected.GetSelectedCount(); i++)
+      EXPECT_LT(b[projected.GetSelection()[i]], 10);
+    selected += projected.GetSelectedCount();
+  }
+  int64_t expected = 0;
+  for (auto itr = table->begin(transaction); itr != table->end(); ++itr)
+    expected += itr->GetValue(schema, 1).GetAs<int32_t>() < 10 ? 1 : 0;
+  EXPECT_EQ(expected, selected);
+  EXPECT_EQ(row_count / 10 - 1, selected);
+
+  // rewind starts over
+  projected.Rewind();
+  EXPECT_TRUE(table->NextBatch(projected, transaction));
+  EXPECT_EQ(ColumnBatch::CAPACITY, projected.GetSize());
+
+  delete table;
+  delete log_manager;
+  delete lock_manager;
+  delete buffer_pool_manager;
+  delete disk_manager;
+  delete transaction;
+  delete schema;
+  remove("test.db");
+  remove("test.log");
+}
+
+TEST(TableHeapTest, ParallelScanTest) {
+  Schema *schema = ParseCreateStatement("a bigint, b varchar(16)");
+  Transaction *transaction = new Transaction(0);
+  DiskManager *disk_manager = new DiskManager("test.db");
+  BufferPoolManager *buffer_pool_manager =
+      new BufferPoolManager(2000, disk_manager);
+  LockManager *lock_manager = new LockManager(false);
+  LogManager *log_manager = new LogManager(disk_manager);
+  TableHeap *table = new TableHeap(buffer_pool_manager, lock_manager,
+                                   log_manager, transaction);
+
+  const int64_t row_count = 30000;
+  std::vector<Tuple> tuples;
+  for (int64_t i = 0; i < row_count; i++) {
+    std::vector<Value> values{Value(TypeId::BIGINT, i),
+                              Value(TypeId::VARCHAR, std::to_string(i))};
+    tuples.emplace_back(values, schema);
+  }
+  std::vector<RID> rids;
+  ASSERT_TRUE(table->InsertTuples(tuples, rids, transaction));
+
+  for (int num_threads : {1, 2, 4}) {
+    // per worker partial results, merged after the scan
+    std::vector<int64_t> sums(num_threads, 0), counts(num_threads, 0);
+    ASSERT_TRUE(table->ParallelBatchScan(
+        num_threads, schema, {0},
+        [&](int worker_id, ColumnBatch &batch) {
+          const int64_t *a = batch.GetColumn<int64_t>(0);
+          int64_t sum = 0;
+          for (int row = 0; row < batch.GetSize(); row++)
+            sum += a[row];
+          sums[worker_id] += sum;
+          counts[worker_id] += batch.GetSize();
+        },
+        transaction));
+    int64_t sum = 0, count = 0;
+    for (int i = 0; i < num_threads; i++) {
+      sum += sums[i];
+      count += counts[i];
+    }
+    EXPECT_EQ(row_count, count);
+    EXPECT_EQ(row_count * (row_count - 1) / 2, sum);
+  }
+
+  // a reopened heap finds its pages through the page chain once
+  TableHeap reopened(buffer_pool_manager, lock_manager, log_manager,
+                     table->GetFirstPageId());
+  std::atomic<int64_t> count{0};
+  ASSERT_TRUE(reopened.ParallelScan(
+      3, [&](int, const Tuple &) { count++; }, transaction));
+  EXPECT_EQ(row_count, count);
+  EXPECT_EQ(table->GetFreeSpaceMap().GetPageIds(),
+            reopened.GetFreeSpaceMap().GetPageIds());
+
+  delete table;
+  delete log_manager;
+  delete lock_manager;
+  delete buffer_pool_manager;
+  delete disk_manager;
+  delete transaction;
+  delete schema;
+  remove("test.db");
+  remove("test.log");
+}
+
+TEST(TableHeapTest, PaxLayoutTest) {
+  Schema *schema =
+      ParseCreateStatement("a bigint, b int, c varchar(32), d double");
+  Transaction *transaction = new Transaction(0);
+  DiskManager *disk_manager = new DiskManager("test.db");
+  BufferPoolManager *buffer_pool_manager =
+      new BufferPoolManager(50, disk_manager);
+  LockManager *lock_manager = new LockManager(false);
+  LogManager *log_manager = new LogManager(disk_manager);
+  TableHeap *table =
+      new TableHeap(buffer_pool_manager, lock_manager, log_manager,
+                    transaction, TableLayout::PAX, schema);
+
+  auto make_tuple = [&](int64_t i, const std::string &c) {
+    std::vector<Value> values{
+        Value(TypeId::BIGINT, i), Value(TypeId::INTEGER, (int32_t)(i % 7)),
+        Value(TypeId::VARCHAR, c), Value(TypeId::DECIMAL, i * 0.25)};
+    return Tuple(values, schema);
+  };
+  const int64_t row_count = 20000;
+  std::vector<RID> rids;
+  RID rid;
+  for (int64_t i = 0; i < row_count; i++) {
+    // now and then a long value, to fill the varlen area early
+    std::string c = i % 10 == 0 ? std::string(30, 'x') : std::to_string(i);
+    ASSERT_TRUE(table->InsertTuple(make_tuple(i, c), rid, transaction));
+    rids.push_back(rid);
+  }
+  Tuple tuple;
+  for (int64_t i = 0; i < row_count; i += 101) {
+    ASSERT_TRUE(table->GetTuple(rids[i], tuple, transaction));
+    EXPECT_EQ(i, tuple.GetValue(schema, 0).GetAs<int64_t>());
+    EXPECT_EQ(i % 7, tuple.GetValue(schema, 1).GetAs<int32_t>());
+    EXPECT_EQ(i % 10 == 0 ? std::string(30, 'x') : std::to_string(i),
+              tuple.GetValue(schema, 2).ToString());
+    EXPECT_DOUBLE_EQ(i * 0.25, tuple.GetValue(schema, 3).GetAs<double>());
+  }
+
+  // updates in place, deletes and reuse of the freed rows
+  ASSERT_TRUE(
+      table->UpdateTuple(make_tuple(-1, "updated"), rids[5], transaction));
+  ASSERT_TRUE(table->GetTuple(rids[5], tuple, transaction));
+  EXPECT_EQ("updated", tuple.GetValue(schema, 2).ToString());
+  for (int64_t i = 0; i < row_count; i += 2) {
+    EXPECT_TRUE(table->MarkDelete(rids[i], transaction));
+    table->ApplyDelete(rids[i], transaction);
+  }
+  EXPECT_FALSE(table->GetTuple(rids[0], tuple, transaction));
+  int page_count = table->GetFreeSpaceMap().GetPageCount();
+  for (int64_t i = 0; i < row_count; i += 2)
+    ASSERT_TRUE(table->InsertTuple(make_tuple(i, std::to_string(i)), rid,
+                                   transaction));
+  EXPECT_EQ(page_count, table->GetFreeSpaceMap().GetPageCount());
+
+  // iterators and batches see the same rows
+  int64_t count = 0, sum = 0;
+  for (auto itr = table->begin(transaction, true); itr != table->end();
+       ++itr) {
+    count++;
+    sum += itr->GetValue(schema, 0).GetAs<int64_t>();
+  }
+  EXPECT_EQ(row_count, count);
+  ColumnBatch batch(schema, {0, 2});
+  int64_t batch_count = 0, batch_sum = 0;
+  while (table->NextBatch(batch, transaction)) {
+    const int64_t *a = batch.GetColumn<int64_t>(0);
+    for (int row = 0; row < batch.GetSize(); row++) {
+      batch_sum += a[row];
+      uint32_t length;
+      const char *c = batch.GetVarchar(1, row, length);
+      if (a[row] % 2 == 1 && a[row] % 10 != 5) {
+        EXPECT_EQ(std::to_string(a[row]), std::string(c, length));
+      }
+    }
+    batch_count += batch.GetSize();
+  }
+  EXPECT_EQ(count, batch_count);
+  EXPECT_EQ(sum, batch_sum);
+
+  // nulls come back from the page and into the batches
+  std::vector<Value> nulls{Value(TypeId::BIGINT, (int64_t)-2),
+                           Value(TypeId::INTEGER, (int32_t)PELOTON_INT32_NULL),
+                           Value(TypeId::VARCHAR, nullptr, 0, false),
+                           Value(TypeId::DECIMAL, 1.0)};
+  ASSERT_TRUE(table->InsertTuple(Tuple(nulls, schema), rid, transaction));
+  ASSERT_TRUE(table->GetTuple(rid, tuple, transaction));
+  EXPECT_FALSE(tuple.IsNull(schema, 0));
+  EXPECT_TRUE(tuple.IsNull(schema, 1));
+  EXPECT_TRUE(tuple.IsNull(schema, 2));
+  EXPECT_TRUE(tuple.GetValue(schema, 2).IsNull());
+  batch.Rewind();
+  int null_count = 0;
+  while (table->NextBatch(batch, transaction)) {
+    const int64_t *a = batch.GetColumn<int64_t>(0);
+    for (int row = 0; row < batch.GetSize(); row++) {
+      EXPECT_EQ(a[row] == -2, batch.IsNull(1, row));
+      EXPECT_EQ(a[row] == -2, batch.GetValue(1, row).IsNull());
+      null_count += batch.IsNull(1, row) ? 1 : 0;
+    }
+  }
+  EXPECT_EQ(1, null_count);
+
+  // a reopened heap keeps the layout of its pages
+  TableHeap reopened(buffer_pool_manager, lock_manager, log_manager,
+                     table->GetFirstPageId());
+  ASSERT_TRUE(reopened.InsertTuple(make_tuple(row_count, "new"), rid,
+                                   transaction));
+  ASSERT_TRUE(reopened.GetTuple(rid, tuple, transaction));
+  EXPECT_EQ("new", tuple.GetValue(schema, 2).ToString());
+
+  delete table;
+  delete log_manager;
+  delete lock_manager;
+  delete buffer_pool_manager;
+  delete disk_manager;
+  delete transaction;
+  delete schema;
+  remove("test.db");
+  remove("test.log");
+}
+
+TEST(TableHeapTest, ZoneMapTest) {
+  Schema *schema = ParseCreateStatement("ts bigint, b int, c varchar(16)");
+  Transaction *transaction = new Transaction(0);
+  DiskManager *disk_manager = new DiskManager("test.db");
+  BufferPoolManager *buffer_pool_manager =
+      new BufferPoolManager(50, disk_manager);
+  LockManager *lock_manager = new LockManager(false);
+  LogManager *log_manager = new LogManager(disk_manager);
+  TableHeap *table = new TableHeap(buffer_pool_manager, lock_manager,
+                                   log_manager, transaction);
+
+  // ts ascends, b is null in every tenth row
+  auto make_tuple = [&](int64_t ts) {
+    int32_t b = ts % 10 == 0 ? PELOTON_INT32_NULL : (int32_t)(ts % 1000);
+    std::vector<Value> values{Value(TypeId::BIGINT, ts),
+                              Value(TypeId::INTEGER, b),
+                              Value(TypeId::VARCHAR, std::to_string(ts))};
+    return Tuple(values, schema);
+  };
+  const int64_t row_count = 10000;
+  std::vector<RID> rids;
+  RID rid;
+  for (int64_t ts = 0; ts < row_count; ts++) {
+    ASSERT_TRUE(table->InsertTuple(make_tuple(ts), rid, transaction));
+    rids.push_back(rid);
+  }
+  auto scan = [&](const std::vector<RangePredicate> &predicates,
+                  int64_t &matches) {
+    int64_t count = 0;
+    matches = 0;
+    for (auto itr = table->begin(transaction, schema, predicates);
+         itr != table->end(); ++itr) {
+      count++;
+      bool match = true;
+      for (auto &predicate : predicates) {
+        Value value = itr->GetValue(schema, predicate.column_id);
+        if (predicate.op == RangeOp::IS_NULL)
+          match = match && value.IsNull();
+        else if (predicate.op == RangeOp::GE)
+          match = match && value.CompareGreaterThanEquals(predicate.value) ==
+                               CMP_TRUE;
+        else if (predicate.op == RangeOp::LT)
+          match = match &&
+                  value.CompareLessThan(predicate.value) == CMP_TRUE;
+      }
+      if (match)
+        matches++;
+    }
+    return count;
+  };
+
+  // the pages before and after the range are skipped
+  std::vector<RangePredicate> range{
+      RangePredicate(0, RangeOp::GE, Value(TypeId::BIGINT, (int64_t)5000)),
+      RangePredicate(0, RangeOp::LT, Value(TypeId::INTEGER, 5100))};
+  int64_t matches;
+  int64_t count = scan(range, matches);
+  EXPECT_EQ(100, matches);
+  EXPECT_LT(count, 400);
+  EXPECT_EQ(table->GetFreeSpaceMap().GetPageCount(),
+            table->GetZoneMap().GetPageCount());
+  ColumnZone zone;
+  ASSERT_TRUE(table->GetZoneMap().GetColumnZone(rids[0].GetPageId(), 1, zone));
+  EXPECT_TRUE(zone.has_values);
+  EXPECT_EQ(1, zone.min.GetAs<int32_t>());
+  EXPECT_GT(zone.null_count, 0);
+  EXPECT_FALSE(
+      table->GetZoneMap().GetColumnZone(rids[0].GetPageId(), 2, zone));
+  std::vector<RangePredicate> none{
+      RangePredicate(0, RangeOp::GT, Value(TypeId::DECIMAL, 1e9))};
+  EXPECT_EQ(0, scan(none, matches));
+
+  // zones widen on insert and update once the map is built
+  ASSERT_TRUE(table->InsertTuple(make_tuple(-5), rid, transaction));
+  // same size, so that it is updated in place
+  std::vector<Value> values{Value(TypeId::BIGINT, row_count * 2),
+                            Value(TypeId::INTEGER, PELOTON_INT32_NULL),
+                            Value(TypeId::VARCHAR, "42")};
+  ASSERT_TRUE(
+      table->UpdateTuple(Tuple(values, schema), rids[42], transaction));
+  std::vector<RangePredicate> low{
+      RangePredicate(0, RangeOp::LT, Value(TypeId::BIGINT, (int64_t)0))};
+  EXPECT_GE(scan(low, matches), 1);
+  EXPECT_EQ(1, matches);
+  std::vector<RangePredicate> high{RangePredicate(
+      0, RangeOp::GE, Value(TypeId::BIGINT, (int64_t)row_count))};
+  EXPECT_GE(scan(high, matches), 1);
+  EXPECT_EQ(1, matches);
+  std::vector<RangePredicate> nulls{
+      RangePredicate(1, RangeOp::IS_NULL, Value(TypeId::INTEGER))};
+  scan(nulls, matches);
+  EXPECT_EQ(row_count / 10 + 1, matches);
+
+  delete table;
+  delete log_manager;
+  delete lock_manager;
+  delete buffer_pool_manager;
+  delete disk_manager;
+  delete transaction;
+  delete schema;
+  remove("test.db");
+  remove("test.log");
+}
+
+TEST(TableHeapTest, PageChurnTest) {
+  Schema *schema = ParseCreateStatement("a int, b varchar(64)");
+  Transaction *transaction = new Transaction(0);
+  DiskManager *disk_manager = new DiskManager("test.db");
+  BufferPoolManager *buffer_pool_manager =
+      new BufferPoolManager(50, disk_manager);
+  LockManager *lock_manager = new LockManager(false);
+  LogManager *log_manager = new LogManager(disk_manager);
+  page_id_t page_id;
+  auto page =
+      static_cast<TablePage *>(buffer_pool_manager->NewPage(page_id));
+  page->Init(page_id, PAGE_SIZE, INVALID_PAGE_ID, log_manager, transaction);
+
+  // tuple i has a = i and i % 16 characters in b
+  std::vector<Tuple> tuples;
+  for (int32_t i = 0; i < 256; i++) {
+    std::vector<Value> values{Value(TypeId::INTEGER, i),
+                              Value(TypeId::VARCHAR,
+                                    std::string(i % 16, 'a' + i % 26))};
+    tuples.emplace_back(values, schema);
+  }
+  std::mt19937 random(42);
+  // live slots, and the tuple in every slot (-1: free)
+  std::vector<int> live;
+  std::vector<int32_t> contents;
+  RID rid;
+  auto insert = [&]() {
+    int32_t i = random() % tuples.size();
+    if (!page->InsertTuple(tuples[i], rid, transaction, lock_manager,
+                           log_manager))
+      return false;
+    int slot = rid.GetSlotNum();
+    if (slot >= static_cast<int>(contents.size()))
+      contents.resize(slot + 1, -1);
+    EXPECT_EQ(-1, contents[slot]);
+    contents[slot] = i;
+    live.push_back(slot);
+    return true;
+  };
+  while (insert()) {
+  }
+  const int slot_count = static_cast<int>(contents.size());
+
+  // every round deletes half of the tuples at random, resizes a quarter of
+  // the rest and fills the page up again
+  const int rounds = 200;
+  for (int round = 0; round < rounds; round++) {
+    for (size_t n = live.size() / 2; n > 0; n--) {
+      size_t victim = random() % live.size();
+      rid.Set(page_id, live[victim]);
+      page->ApplyDelete(rid, transaction, log_manager);
+      contents[live[victim]] = -1;
+      live[victim] = live.back();
+      live.pop_back();
+    }
+    for (size_t n = live.size() / 4; n > 0; n--) {
+      int slot = live[random() % live.size()];
+      int32_t i = random() % tuples.size();
+      Tuple old_tuple;
+      rid.Set(page_id, slot);
+      if (page->UpdateTuple(tuples[i], old_tuple, rid, transaction,
+                            lock_manager, log_manager))
+        contents[slot] = i;
+    }
+    while (insert()) {
+    }
+  }
+
+  // freed slots were reused, every tuple reads back
+  EXPECT_LT(static_cast<int>(contents.size()), slot_count * 2);
+  size_t count = 0;
+  bool valid = page->GetFirstTupleRid(rid);
+  while (valid) {
+    Tuple tuple;
+    ASSERT_TRUE(page->GetTuple(rid, tuple, transaction, lock_manager));
+    int32_t i = contents[rid.GetSlotNum()];
+    EXPECT_EQ(i, tuple.GetValue(schema, 0).GetAs<int32_t>());
+    EXPECT_EQ(tuples[i].GetValue(schema, 1).ToString(),
+              tuple.GetValue(schema, 1).ToString());
+    count++;
+    RID next_rid;
+    valid = page->GetNextTupleRid(rid, next_rid);
+    rid = next_rid;
+  }
+  EXPECT_EQ(live.size(), count);
+  buffer_pool_manager->UnpinPage(page_id, true);
+
+  delete log_manager;
+  delete lock_manager;
+  delete buffer_pool_manager;
+  delete disk_manager;
+  delete transaction;
+  delete schema;
+  remove("test.db");
+  remove("test.log");
+}
+
+TEST(TableHeapTest, OverflowTest) {
+  Schema *schema =
+      ParseCreateStatement("a int, b varchar(100000), c varchar(64)");
+  DiskManager *disk_manager = new DiskManager("test.db");
+  BufferPoolManager *buffer_pool_manager =
+      new BufferPoolManager(50, disk_manager);
+  LockManager *lock_manager = new LockManager(false);
+  LogManager *log_manager = new LogManager(disk_manager);
+  TransactionManager transaction_manager(lock_manager, log_manager);
+  Transaction *transaction = transaction_manager.Begin();
+  TableHeap *table =
+      new TableHeap(buffer_pool_manager, lock_manager, log_manager,
+                    transaction, TableLayout::NSM, schema);
+
+  auto make_string = [](int size, char first) {
+    std::string value(size, ' ');
+    for (int i = 0; i < size; i++)
+      value[i] = static_cast<char>(first + i % 26);
+    return value;
+  };
+  auto make_tuple = [&](int32_t a, const std::string &b) {
+    std::vector<Value> values{Value(TypeId::INTEGER, a),
+                              Value(TypeId::VARCHAR, b),
+                              Value(TypeId::VARCHAR, "small")};
+    return Tuple(values, schema);
+  };
+  // spans several overflow pages
+  const std::string large = make_string(3 * PAGE_SIZE + 100, 'a');
+  std::vector<RID> rids;
+  RID rid;
+  for (int32_t i = 0; i < 20; i++) {
+    ASSERT_TRUE(table->InsertTuple(
+        make_tuple(i, i % 2 == 0 ? large : "short"), rid, transaction));
+    rids.push_back(rid);
+  }
+
+  // only the pointer is stored in the tuple, the other columns read as usual
+  Tuple tuple(rids[0]);
+  ASSERT_TRUE(table->GetTuple(rids[0], tuple, transaction));
+  EXPECT_LE(tuple.GetLength(), OVERFLOW_THRESHOLD);
+  EXPECT_TRUE(tuple.IsOverflow(schema, 1));
+  EXPECT_FALSE(tuple.IsOverflow(schema, 2));
+  EXPECT_FALSE(tuple.IsNull(schema, 1));
+  EXPECT_EQ(0, tuple.GetValue(schema, 0).GetAs<int32_t>());
+  EXPECT_EQ("small", tuple.GetValue(schema, 2).ToString());
+  EXPECT_EQ(large, table->GetValue(tuple, schema, 1).ToString());
+  ASSERT_TRUE(table->GetTuple(rids[1], tuple, transaction));
+  EXPECT_FALSE(tuple.IsOverflow(schema, 1));
+  EXPECT_EQ("short", table->GetValue(tuple, schema, 1).ToString());
+
+  // batch scans read the overflow pages too
+  ColumnBatch batch(schema, {0, 1});
+  int rows = 0;
+  while (table->NextBatch(batch, transaction)) {
+    for (int row = 0; row < batch.GetSize(); row++) {
+      uint32_t length;
+      const char *value = batch.GetVarchar(1, row, length);
+      int32_t a = batch.GetColumn<int32_t>(0)[row];
+      EXPECT_EQ(a % 2 == 0 ? large : "short", std::string(value, length));
+      rows++;
+    }
+  }
+  EXPECT_EQ(20, rows);
+
+  // a tuple fetched and written back keeps sharing its overflow values
+  ASSERT_TRUE(table->GetTuple(rids[2], tuple, transaction));
+  ASSERT_TRUE(table->UpdateTuple(tuple, rids[2], transaction));
+  // updates write new overflow values
+  const std::string updated = make_string(2 * PAGE_SIZE, 'A');
+  ASSERT_TRUE(
+      table->UpdateTuple(make_tuple(4, updated), rids[4], transaction));
+  ASSERT_TRUE(table->MarkDelete(rids[6], transaction));
+  transaction_manager.Commit(transaction);
+  delete transaction;
+
+  transaction = transaction_manager.Begin();
+  ASSERT_TRUE(table->GetTuple(rids[2], tuple, transaction));
+  EXPECT_EQ(large, table->GetValue(tuple, schema, 1).ToString());
+  ASSERT_TRUE(table->GetTuple(rids[4], tuple, transaction));
+  EXPECT_EQ(updated, table->GetValue(tuple, schema, 1).ToString());
+  EXPECT_FALSE(table->GetTuple(rids[6], tuple, transaction));
+  // a rolled back update brings the old value back
+  ASSERT_TRUE(table->UpdateTuple(make_tuple(8, make_string(PAGE_SIZE, 'a')),
+                                 rids[8], transaction));
+  transaction_manager.Abort(transaction);
+  delete transaction;
+
+  transaction = transaction_manager.Begin();
+  ASSERT_TRUE(table->GetTuple(rids[8], tuple, transaction));
+  EXPECT_EQ(large, table->GetValue(tuple, schema, 1).ToString());
+  transaction_manager.Commit(transaction);
+
+  delete table;
+  delete log_manager;
+  delete lock_manager;
+  delete buffer_pool_manager;
+  delete disk_manager;
+  delete transaction;
+  delete schema;
+  remove("test.db");
+  remove("test.log");
+}
+
+TEST(TableHeapTest, VacuumTest) {
+  Schema *schema = ParseCreateStatement("a bigint, b varchar(32)");
+  Transaction *transaction = new Transaction(0);
+  DiskManager *disk_manager = new DiskManager("test.db");
+  BufferPoolManager *buffer_pool_manager =
+      new BufferPoolManager(50, disk_manager);
+  LockManager *lock_manager = new LockManager(false);
+  LogManager *log_manager = new LogManager(disk_manager);
+
+  for (auto layout : {TableLayout::NSM, TableLayout::PAX}) {
+    TableHeap table(buffer_pool_manager, lock_manager, log_manager,
+                    transaction, layout, schema);
+    const int64_t row_count = 20000;
+    std::vector<RID> rids;
+    RID rid;
+    for (int64_t i = 0; i < row_count; i++) {
+      std::vector<Value> values{Value(TypeId::BIGINT, i),
+                                Value(TypeId::VARCHAR, std::to_string(i))};
+      ASSERT_TRUE(table.InsertTuple(Tuple(values, schema), rid, transaction));
+      rids.push_back(rid);
+    }
+    auto count_rows = [&]() {
+      int64_t count = 0;
+      for (auto itr = table.begin(transaction); itr != table.end(); ++itr)
+        count++;
+      return count;
+    };
+    auto delete_rows = [&](int64_t begin, int64_t end, int64_t step) {
+      for (int64_t i = begin; i < end; i += step) {
+        EXPECT_TRUE(table.MarkDelete(rids[i], transaction));
+        table.ApplyDelete(rids[i], transaction);
+      }
+    };
+    // build the zone map, it has to follow the unlinks
+    std::vector<RangePredicate> all{
+        RangePredicate(0, RangeOp::GE, Value(TypeId::BIGINT, (int64_t)0))};
+    table.begin(transaction, schema, all);
+    const int page_count = table.GetFreeSpaceMap().GetPageCount();
+
+    // empty the middle pages and thin out the rest
+    delete_rows(row_count / 10, row_count * 9 / 10, 1);
+    delete_rows(0, row_count / 10, 2);
+    // a page still pinned, by a scan say, is deleted once it is unpinned
+    page_id_t pinned_page_id = rids[row_count / 2].GetPageId();
+    ASSERT_NE(nullptr, buffer_pool_manager->FetchPage(pinned_page_id));
+    int deleted_count = table.Vacuum(page_count);
+    EXPECT_GT(deleted_count, page_count / 2);
+    EXPECT_EQ(0, table.Vacuum(0));
+    buffer_pool_manager->UnpinPage(pinned_page_id, false);
+    EXPECT_EQ(1, table.Vacuum(0));
+    deleted_count++;
+    EXPECT_EQ(page_count - deleted_count,
+              table.GetFreeSpaceMap().GetPageCount());
+    EXPECT_EQ(table.GetFreeSpaceMap().GetPageCount(),
+              table.GetZoneMap().GetPageCount());
+    EXPECT_EQ(0, table.Vacuum(page_count));
+    int64_t remaining = row_count / 20 + row_count / 10;
+    EXPECT_EQ(remaining, count_rows());
+    int64_t filtered = 0;
+    for (auto itr = table.begin(transaction, schema, all);
+         itr != table.end(); ++itr)
+      filtered++;
+    EXPECT_EQ(remaining, filtered);
+
+    // the garbage left behind is reused without new pages
+    for (int64_t i = 0; i < row_count / 40; i++) {
+      std::vector<Value> values{Value(TypeId::BIGINT, -i),
+                                Value(TypeId::VARCHAR, std::to_string(i))};
+      ASSERT_TRUE(table.InsertTuple(Tuple(values, schema), rid, transaction));
+    }
+    EXPECT_EQ(page_count - deleted_count,
+              table.GetFreeSpaceMap().GetPageCount());
+
+    // the background vacuum picks up pages emptied later on
+    table.RunVacuumThread(4, std::chrono::milliseconds(1));
+    delete_rows(row_count * 9 / 10, row_count * 19 / 20, 1);
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+    while (table.GetFreeSpaceMap().GetPageCount() ==
+               page_count - deleted_count &&
+           std::chrono::steady_clock::now() < deadline)
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    table.StopVacuumThread();
+    EXPECT_LT(table.GetFreeSpaceMap().GetPageCount(),
+              page_count - deleted_count);
+    EXPECT_EQ(remaining + row_count / 40 - row_count / 20, count_rows());
+
+    EXPECT_TRUE(table.DeleteTableHeap());
+  }
+
+  delete log_manager;
+  delete lock_manager;
+  delete buffer_pool_manager;
+  delete disk_manager;
+  delete transaction;
+  delete schema;
+  remove("test.db");
+  remove("test.log");
+}
+
+TEST(TableHeapTest, PaxScanTest) {
+  // a wide table, of which the scan reads one column
+  std::string create = "a int";
+  for (int i = 1; i < 20; i++)
+    create += ", c" + std::to_string(i) + " bigint";
+  Schema *schema = ParseCreateStatement(create);
+  Transaction *transaction = new Transaction(0);
+  LockManager *lock_manager = new LockManager(false);
+
+  // a rewound batch scans the table again
+  const int row_count = 2000;
+  const int scan_count = 2;
+  std::vector<Tuple> tuples;
+  for (int i = 0; i < row_count; i++) {
+    std::vector<Value> values{Value(TypeId::INTEGER, (int32_t)i)};
+    for (int j = 1; j < 20; j++)
+      values.emplace_back(TypeId::BIGINT, (int64_t)j);
+    tuples.emplace_back(values, schema);
+  }
+  for (auto layout : {TableLayout::NSM, TableLayout::PAX}) {
+    // a buffer pool of its own that holds the whole table
+    DiskManager *disk_manager = new DiskManager("test.db");
+    BufferPoolManager *buffer_pool_manager =
+        new BufferPoolManager(10000, disk_manager);
+    LogManager *log_manager = new LogManager(disk_manager);
+    TableHeap table(buffer_pool_manager, lock_manager, log_manager,
+                    transaction, layout, schema);
+    std::vector<RID> rids;
+    ASSERT_TRUE(table.InsertTuples(tuples, rids, transaction));
+    ColumnBatch batch(schema, {0});
+    int64_t sum = 0;
+    for (int i = 0; i < scan_count; i++) {
+      while (table.NextBatch(batch, transaction)) {
+        const int32_t *a = batch.GetColumn<int32_t>(0);
+        for (int row = 0; row < batch.GetSize(); row++)
+          sum += a[row];
+      }
+      batch.Rewind();
+    }
+    EXPECT_EQ((int64_t)scan_count * row_count * (row_count - 1) / 2, sum);
+    delete log_manager;
+    delete buffer_pool_manager;
+    delete disk_manager;
+    remove("test.db");
+  }
+
+  delete lock_manager;
+  delete transaction;
+  delete schema;
+  remove("test.db");
+  remove("test.log");
+}
+
+TEST(TableHeapTest, ProjectionTest) {
+  // thirty one columns, of which the scan reads two
+  std::string create = "a int";
+  for (int i = 1; i < 29; i++)
+    create += ", c" + std::to_string(i) + " bigint";
+  create += ", s varchar(32), t varchar(32)";
+  Schema *schema = ParseCreateStatement(create);
+  Transaction *transaction = new Transaction(0);
+  LockManager *lock_manager = new LockManager(false);
+  const int row_count = 2000;
+  std::vector<bool> projection(schema->GetColumnCount(), false);
+  projection[0] = projection[29] = true;
+  for (auto layout : {TableLayout::NSM, TableLayout::PAX}) {
+    DiskManager *disk_manager = new DiskManager("test.db");
+    BufferPoolManager *buffer_pool_manager =
+        new BufferPoolManager(10000, disk_manager);
+    LogManager *log_manager = new LogManager(disk_manager);
+    TableHeap table(buffer_pool_manager, lock_manager, log_manager,
+                    transaction, layout, schema);
+    RID rid;
+    for (int i = 0; i < row_count; i++) {
+      std::vector<Value> values{Value(TypeId::INTEGER, i)};
+      for (int j = 1; j < 29; j++)
+        values.emplace_back(TypeId::BIGINT, (int64_t)j);
+      values.emplace_back(TypeId::VARCHAR, "s" + std::to_string(i % 10));
+      values.emplace_back(TypeId::VARCHAR, "a longer t " + std::to_string(i));
+      ASSERT_TRUE(table.InsertTuple(Tuple(values, schema), rid, transaction));
+    }
+    for (bool project : {false, true}) {
+      int64_t sum = 0, s_length = 0;
+      int count = 0;
+      auto itr = table.begin(transaction);
+      if (project)
+        itr.SetProjection(projection);
+      // begin reads the first tuple whole, skipped columns of the others
+      // read as null
+      bool first = true;
+      for (; itr != table.end(); ++itr, first = false) {
+        sum += itr->GetValue(schema, 0).GetAs<int32_t>();
+        s_length += itr->GetValue(schema, 29).GetLength();
+        if (project && !first) {
+          EXPECT_TRUE(itr->IsNull(schema, 5));
+          EXPECT_TRUE(itr->IsNull(schema, 30));
+          EXPECT_TRUE(itr->GetValue(schema, 30).IsNull());
+          // the payload of t is left behind
+          EXPECT_LT(itr->GetLength(), schema->GetVarlenOffset() + 16);
+        } else {
+          EXPECT_EQ(5, itr->GetValue(schema, 5).GetAs<int64_t>());
+          EXPECT_EQ("a longer t " + std::to_string(count),
+                    itr->GetValue(schema, 30).ToString());
+        }
+        count++;
+      }
+      EXPECT_EQ(row_count, count);
+      EXPECT_EQ((int64_t)row_count * (row_count - 1) / 2, sum);
+      EXPECT_EQ(row_count * 3, s_length);
+    }
+    delete log_manager;
+    delete buffer_pool_manager;
+    delete disk_manager;
+    remove("test.db");
+  }
+
+  delete lock_manager;
+  delete transaction;
+  delete schema;
+  remove("test.db");
+  remove("test.log");
+}
+
+TEST(TableHeapTest, EncodingTest) {
+  // a sorted day, a status out of a few values and a unique payload
+  Schema *schema =
+      ParseCreateStatement("day int, status varchar(32), a bigint");
+  Transaction *transaction = new Transaction(0);
+  LockManager *lock_manager = new LockManager(false);
+  const std::vector<std::string> statuses{"pending", "shipped", "delivered",
+                                          "returned with damage"};
+  const int row_count = 8000;
+  auto make_tuple = [&](int i, const std::string &status) {
+    std::vector<Value> values{Value(TypeId::INTEGER, (int32_t)(i / 100)),
+                              Value(TypeId::VARCHAR, status),
+                              Value(TypeId::BIGINT, (int64_t)i)};
+    return Tuple(values, schema);
+  };
+  const std::vector<ColumnEncoding> plain;
+  const std::vector<ColumnEncoding> encoded{
+      ColumnEncoding::RLE, ColumnEncoding::DICTIONARY, ColumnEncoding::PLAIN};
+  int page_counts[2];
+  for (int e = 0; e < 2; e++) {
+    DiskManager *disk_manager = new DiskManager("test.db");
+    BufferPoolManager *buffer_pool_manager =
+        new BufferPoolManager(10000, disk_manager);
+    LogManager *log_manager = new LogManager(disk_manager);
+    TableHeap table(buffer_pool_manager, lock_manager, log_manager,
+                    transaction, TableLayout::PAX, schema,
+                    e == 0 ? plain : encoded);
+    std::vector<RID> rids;
+    RID rid;
+    for (int i = 0; i < row_count; i++) {
+      ASSERT_TRUE(table.InsertTuple(make_tuple(i, statuses[i % 4]), rid,
+                                    transaction));
+      rids.push_back(rid);
+    }
+    page_counts[e] = table.GetFreeSpaceMap().GetPageCount();
+
+    std::vector<RangePredicate> shipped{
+        RangePredicate(1, RangeOp::EQ, Value(TypeId::VARCHAR, "shipped"))};
+    auto count_shipped = [&]() {
+      int count = 0;
+      for (auto itr = table.begin(transaction, schema, shipped, true);
+           itr != table.end(); ++itr) {
+        if (itr->GetValue(schema, 1).ToString() == "shipped")
+          count++;
+      }
+      return count;
+    };
+    EXPECT_EQ(row_count / 4, count_shipped());
+
+    // updates, deletes and vacuum keep the values intact
+    Tuple tuple;
+    for (int i = 0; i < row_count; i += 3) {
+      ASSERT_TRUE(table.UpdateTuple(make_tuple(i, "shipped"), rids[i],
+                                    transaction));
+    }
+    for (int i = 0; i < row_count / 2; i++) {
+      EXPECT_TRUE(table.MarkDelete(rids[i], transaction));
+      table.ApplyDelete(rids[i], transaction);
+    }
+    table.Vacuum(page_counts[e]);
+    for (int i = row_count / 2; i < row_count; i += 7) {
+      ASSERT_TRUE(table.GetTuple(rids[i], tuple, transaction));
+      EXPECT_EQ(i / 100, tuple.GetValue(schema, 0).GetAs<int32_t>());
+      EXPECT_EQ(i % 3 == 0 ? "shipped" : statuses[i % 4],
+                tuple.GetValue(schema, 1).ToString());
+      EXPECT_EQ(i, tuple.GetValue(schema, 2).GetAs<int64_t>());
+    }
+    int expected = 0;
+    for (int i = row_count / 2; i < row_count; i++)
+      expected += i % 3 == 0 || i % 4 == 1;
+    EXPECT_EQ(expected, count_shipped());
+
+    EXPECT_TRUE(table.DeleteTableHeap());
+    delete log_manager;
+    delete buffer_pool_manager;
+    delete disk_manager;
+    remove("test.db");
+  }
+  EXPECT_LT(page_counts[1], page_counts[0]);
+
+  delete lock_manager;
+  delete transaction;
+  delete schema;
+  remove("test.db");
+  remove("test.log");
+}
+
+} // namespace cmudb
@@ -0,0 +1,95 @@
+/**
+ * tuple_benchmark.cpp
+ */
+
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "table/tuple.h"
+#include "table/tuple_accessor.h"
+#include "vtable/virtual_table.h"
+#include "gtest/gtest.h"
+
+namespace cmudb {
+
+// two columns of every tuple read through Value and through the accessor
+TEST(TupleBenchmark, Accessor) {
+  Schema *schema = ParseCreateStatement(
+      "a bool, b smallint, c int, d bigint, e double, f varchar(32)");
+  TupleAccessor accessor(schema);
+  std::vector<Tuple> tuples;
+  const int row_count = 10000;
+  for (int i = 0; i < row_count; i++) {
+    std::vector<Value> values{
+        Value(TypeId::BOOLEAN, (int32_t)(i % 2)),
+        Value(TypeId::SMALLINT, (int32_t)(i % 1000)), Value(TypeId::INTEGER, i),
+        Value(TypeId::BIGINT, (int64_t)i * 3), Value(TypeId::DECIMAL, i * 0.5),
+        i % 10 == 0 ? Value(TypeId::VARCHAR, nullptr, 0, false)
+                    : Value(TypeId::VARCHAR, std::to_string(i))};
+    tuples.emplace_back(values, schema);
+  }
+
+  // the sum of c and the lengths of f
+  const int scan_count = 20;
+  int64_t sums[2] = {0, 0};
+  for (int use_accessor = 0; use_accessor < 2; use_accessor++) {
+    auto start = std::chrono::steady_clock::now();
+    for (int n = 0; n < scan_count; n++) {
+      for (auto &tuple : tuples) {
+        if (use_accessor) {
+          uint32_t length;
+          accessor.GetVarchar(tuple, 5, length);
+          sums[1] += accessor.GetInt32(tuple, 2) + length;
+        } else {
+          Value value = tuple.GetValue(schema, 5);
+          sums[0] += tuple.GetValue(schema, 2).GetAs<int32_t>() +
+                     (value.IsNull() ? 0 : value.GetLength() - 1);
+        }
+      }
+    }
+    std::chrono::duration<double, std::milli> elapsed =
+        std::chrono::steady_clock::now() - start;
+    std::cout << (use_accessor ? "accessor" : "value") << ": "
+              << row_count * scan_count / elapsed.count() << " rows/ms"
+              << std::endl;
+  }
+  EXPECT_EQ(sums[0], sums[1]);
+  delete schema;
+}
+
+// rows built and read back with their values on the heap and on an arena
+TEST(TupleBenchmark, Arena) {
+  Schema *schema =
+      ParseCreateStatement("a bigint, b varchar(32), c int, d varchar(32)");
+  const int row_count = 200000;
+  const std::string b = "some short text", d = "another short text";
+  Arena arena;
+  for (bool use_arena : {false, true}) {
+    auto start = std::chrono::steady_clock::now();
+    int64_t sum = 0;
+    for (int i = 0; i < row_count; i++) {
+      std::vector<Value> values{
+          Value(TypeId::BIGINT, (int64_t)i),
+          Value(TypeId::VARCHAR, b.c_str(), (uint32_t)b.size() + 1, false),
+          Value(TypeId::INTEGER, i),
+          Value(TypeId::VARCHAR, d.c_str(), (uint32_t)d.size() + 1, false)};
+      Tuple tuple(values, schema, use_arena ? &arena : nullptr);
+      Value value = tuple.GetValue(schema, 3, use_arena ? &arena : nullptr);
+      sum += value.GetLength() + tuple.GetValue(schema, 2).GetAs<int32_t>();
+      if (use_arena)
+        arena.Reset();
+    }
+    std::chrono::duration<double, std::milli> elapsed =
+        std::chrono::steady_clock::now() - start;
+    std::cout << (use_arena ? "arena" : "heap") << ": "
+              << row_count / elapsed.count() << " rows/ms" << std::endl;
+    EXPECT_EQ((int64_t)row_count * (d.size() + 1) +
+                  (int64_t)row_count * (row_count - 1) / 2,
+              sum);
+  }
+  delete schema;
+}
+
+} // namespace cmudb
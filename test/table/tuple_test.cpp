@@ -3,8 +3,11 @@
  */
 
 #include <algorithm>
+#include <atomic>
 #include <cstdio>
+#include <cstdlib>
 #include <iostream>
+#include <new>
 #include <string>
 #include <vector>
 
@@ -12,9 +15,25 @@
 #include "logging/common.h"
 #include "table/table_heap.h"
 #include "table/tuple.h"
+#include "table/tuple_accessor.h"
 #include "vtable/virtual_table.h"
 #include "gtest/gtest.h"
 
+// tuples and varchar values are allocated with new[], count them
+static std::atomic<int64_t> array_allocations{0};
+
+void *operator new[](size_t size) {
+  array_allocations++;
+  void *p = malloc(size == 0 ? 1 : size);
+  if (p == nullptr)
+    throw std::bad_alloc();
+  return p;
+}
+
+void operator delete[](void *p) noexcept { free(p); }
+
+void operator delete[](void *p, size_t) noexcept { free(p); }
+
 namespace cmudb {
 TEST(TupleTest, TableHeapTest) {
   // test1: parse create sql statement
@@ -61,4 +80,149 @@ TEST(TupleTest, TableHeapTest) {
   delete disk_manager;
 }
 
+TEST(TupleTest, NullBitmapTest) {
+  // nine columns, so that the bitmap takes two bytes
+  Schema *schema = ParseCreateStatement(
+      "a int, b varchar(16), c bigint, d double, e int, f int, g int, h int, "
+      "i varchar(16)");
+  EXPECT_EQ(2, schema->GetNullBitmapSize());
+  std::vector<Value> values;
+  for (int i = 0; i < schema->GetColumnCount(); i++) {
+    switch (schema->GetType(i)) {
+    case TypeId::VARCHAR:
+      values.emplace_back(TypeId::VARCHAR, nullptr, 0, false);
+      break;
+    case TypeId::BIGINT:
+      values.emplace_back(TypeId::BIGINT, (int64_t)i);
+      break;
+    case TypeId::DECIMAL:
+      values.emplace_back(TypeId::DECIMAL, PELOTON_DECIMAL_NULL);
+      break;
+    default:
+      values.emplace_back(TypeId::INTEGER, (int32_t)i);
+      break;
+    }
+  }
+  Tuple tuple(values, schema);
+  // a null varchar is its length prefix only
+  EXPECT_EQ(schema->GetVarlenOffset() + 2 * (int32_t)sizeof(uint32_t),
+            tuple.GetLength());
+  for (int i = 0; i < schema->GetColumnCount(); i++) {
+    bool is_null = i == 1 || i == 3 || i == 8;
+    EXPECT_EQ(is_null, tuple.IsNull(schema, i));
+    EXPECT_EQ(is_null, tuple.GetValue(schema, i).IsNull());
+  }
+  EXPECT_EQ(0x0a, tuple.GetNullBitmap(schema)[0]);
+  EXPECT_EQ(0x01, tuple.GetNullBitmap(schema)[1]);
+  EXPECT_EQ(6, tuple.GetValue(schema, 6).GetAs<int32_t>());
+
+  // a copy keeps the bitmap
+  Tuple copy(tuple);
+  EXPECT_TRUE(copy.IsNull(schema, 8));
+  EXPECT_FALSE(copy.IsNull(schema, 7));
+  delete schema;
+}
+
+TEST(TupleTest, MoveTest) {
+  Schema *schema = ParseCreateStatement("a int, b varchar(16)");
+  std::vector<Value> values{Value(TypeId::INTEGER, 7),
+                            Value(TypeId::VARCHAR, "seven")};
+  Tuple tuple(values, schema);
+  const char *data = tuple.GetData();
+  Tuple moved(std::move(tuple));
+  EXPECT_EQ(data, moved.GetData());
+  EXPECT_EQ(nullptr, tuple.GetData());
+  EXPECT_EQ(0, tuple.GetLength());
+  Tuple assigned;
+  assigned = std::move(moved);
+  EXPECT_EQ(data, assigned.GetData());
+  EXPECT_EQ("seven", assigned.GetValue(schema, 1).ToString());
+  // copies are deep and assignment frees the old data
+  Tuple copy(values, schema);
+  copy = assigned;
+  EXPECT_NE(data, copy.GetData());
+  copy = copy;
+  EXPECT_EQ(7, copy.GetValue(schema, 0).GetAs<int32_t>());
+  delete schema;
+}
+
+TEST(TupleTest, AccessorTest) {
+  Schema *schema = ParseCreateStatement(
+      "a bool, b smallint, c int, d bigint, e double, f varchar(32)");
+  TupleAccessor accessor(schema);
+  std::vector<Tuple> tuples;
+  const int row_count = 1000;
+  for (int i = 0; i < row_count; i++) {
+    std::vector<Value> values{
+        Value(TypeId::BOOLEAN, (int32_t)(i % 2)),
+        Value(TypeId::SMALLINT, (int32_t)(i % 1000)), Value(TypeId::INTEGER, i),
+        Value(TypeId::BIGINT, (int64_t)i * 3), Value(TypeId::DECIMAL, i * 0.5),
+        i % 10 == 0 ? Value(TypeId::VARCHAR, nullptr, 0, false)
+                    : Value(TypeId::VARCHAR, std::to_string(i))};
+    tuples.emplace_back(values, schema);
+  }
+  // every getter agrees with GetValue
+  for (int i = 0; i < row_count; i += 7) {
+    const Tuple &tuple = tuples[i];
+    EXPECT_EQ(i % 2, accessor.GetInt8(tuple, 0));
+    EXPECT_EQ(i % 1000, accessor.GetInt16(tuple, 1));
+    EXPECT_EQ(i, accessor.GetInt32(tuple, 2));
+    EXPECT_EQ((int64_t)i * 3, accessor.GetInt64(tuple, 3));
+    EXPECT_DOUBLE_EQ(i * 0.5, accessor.GetDouble(tuple, 4));
+    EXPECT_EQ(i % 10 == 0, accessor.IsNull(tuple, 5));
+    EXPECT_FALSE(accessor.IsNull(tuple, 2));
+    EXPECT_FALSE(accessor.IsOverflow(tuple, 5));
+    uint32_t length;
+    const char *data = accessor.GetVarchar(tuple, 5, length);
+    EXPECT_EQ(i % 10 == 0 ? "" : std::to_string(i), std::string(data, length));
+  }
+
+  // the sum of c and the lengths of f, through Value and through the accessor
+  int64_t sums[2] = {0, 0};
+  for (auto &tuple : tuples) {
+    uint32_t length;
+    accessor.GetVarchar(tuple, 5, length);
+    sums[1] += accessor.GetInt32(tuple, 2) + length;
+    Value value = tuple.GetValue(schema, 5);
+    sums[0] += tuple.GetValue(schema, 2).GetAs<int32_t>() +
+               (value.IsNull() ? 0 : value.GetLength() - 1);
+  }
+  EXPECT_EQ(sums[0], sums[1]);
+  delete schema;
+}
+
+TEST(TupleTest, ArenaTest) {
+  Schema *schema =
+      ParseCreateStatement("a bigint, b varchar(32), c int, d varchar(32)");
+  const int row_count = 2000;
+  const std::string b = "some short text", d = "another short text";
+  Arena arena;
+  for (bool use_arena : {false, true}) {
+    int64_t allocations = array_allocations;
+    int64_t sum = 0;
+    // build a row as an insert does, then read it back as a scan does
+    for (int i = 0; i < row_count; i++) {
+      std::vector<Value> values{
+          Value(TypeId::BIGINT, (int64_t)i),
+          Value(TypeId::VARCHAR, b.c_str(), (uint32_t)b.size() + 1, false),
+          Value(TypeId::INTEGER, i),
+          Value(TypeId::VARCHAR, d.c_str(), (uint32_t)d.size() + 1, false)};
+      Tuple tuple(values, schema, use_arena ? &arena : nullptr);
+      Value value = tuple.GetValue(schema, 3, use_arena ? &arena : nullptr);
+      sum += value.GetLength() + tuple.GetValue(schema, 2).GetAs<int32_t>();
+      if (use_arena)
+        arena.Reset();
+    }
+    allocations = array_allocations - allocations;
+    EXPECT_EQ((int64_t)row_count * (d.size() + 1) +
+                  (int64_t)row_count * (row_count - 1) / 2,
+              sum);
+    if (use_arena)
+      EXPECT_LE(allocations, 1);
+    else
+      EXPECT_GE(allocations, 2 * row_count);
+  }
+  delete schema;
+}
+
 } // namespace cmudb
@@ -1,6 +1,11 @@
 /**
  * virtual_table_test.cpp
  */
+#include <sstream>
+
+#include "catalog/catalog_cache.h"
+#include "page/header_page.h"
+#include "table/bulk_loader.h"
 #include "vtable/testing_vtable_util.h"
 
 namespace cmudb {
@@ -35,7 +40,19 @@ TEST(VtableTest, CreateTest) {
   EXPECT_TRUE(ExecSQL(db, "SELECT * FROM foo1"));
   EXPECT_TRUE(ExecSQL(db, "DELETE FROM foo1 WHERE b = 2"));
   EXPECT_TRUE(ExecSQL(db, "SELECT * FROM foo1"));
+  // the tables share the storage engine until the last one is disconnected
+  EXPECT_TRUE(ExecSQL(db, "CREATE VIRTUAL TABLE foo3 USING vtable ('a int, "
+                          "b varchar(8)', 'foo3_pk a')"));
+  EXPECT_TRUE(ExecSQL(db, "INSERT INTO foo3 VALUES(1, 'one')"));
   EXPECT_TRUE(ExecSQL(db, "DROP TABLE foo1"));
+  EXPECT_TRUE(ExecSQL(db, "INSERT INTO foo3 VALUES(2, 'two')"));
+  EXPECT_TRUE(ExecSQL(db, "SELECT * FROM foo3 WHERE a = 2"));
+  EXPECT_TRUE(ExecSQL(db, "DROP TABLE foo3"));
+  // and it is opened again by the next one
+  EXPECT_TRUE(ExecSQL(db, "CREATE VIRTUAL TABLE foo4 USING vtable ('a int', "
+                          "'foo4_pk a')"));
+  EXPECT_TRUE(ExecSQL(db, "INSERT INTO foo4 VALUES(4)"));
+  EXPECT_TRUE(ExecSQL(db, "SELECT * FROM foo4"));
 
   rc = sqlite3_close(db);
   EXPECT_EQ(rc, SQLITE_OK);
@@ -44,4 +61,482 @@ TEST(VtableTest, CreateTest) {
   remove("vtable.db");
   return;
 }
+
+TEST(VtableTest, CoveringIndexTest) {
+  std::string db_file = "sqlite.db";
+  remove(db_file.c_str());
+  remove("vtable.db");
+  sqlite3 *db;
+  int rc;
+  rc = sqlite3_open(db_file.c_str(), &db);
+  EXPECT_EQ(rc, SQLITE_OK);
+  rc = sqlite3_enable_load_extension(db, 1);
+  EXPECT_EQ(rc, SQLITE_OK);
+  char *zErrMsg = 0;
+  rc = sqlite3_load_extension(db, "libvtable", 0, &zErrMsg);
+  EXPECT_EQ(rc, SQLITE_OK);
+
+  // entries must fit the key, which is sized by the declared lengths
+  EXPECT_FALSE(ExecSQL(db, "CREATE VIRTUAL TABLE bad USING vtable ('a int, b "
+                           "varchar(64)', 'bad_idx a include b')"));
+  // b is stored in the index entry, c has to be read from the table heap
+  EXPECT_TRUE(ExecSQL(db, "CREATE VIRTUAL TABLE foo2 USING vtable ('a int, b "
+                          "varchar(8), c bigint', 'foo2_idx a include b')"));
+  EXPECT_TRUE(ExecSQL(db, "INSERT INTO foo2 VALUES(1, 'hello', 2)"));
+  EXPECT_TRUE(ExecSQL(db, "INSERT INTO foo2 VALUES(2, 'world', 3)"));
+  EXPECT_TRUE(ExecSQL(db, "INSERT INTO foo2 VALUES(3, 'nihao', 4)"));
+
+  auto query_b_c = [&](const std::string &expected_b, int64_t expected_c) {
+    sqlite3_stmt *stmt;
+    EXPECT_EQ(sqlite3_prepare_v2(db, "SELECT b, c FROM foo2 WHERE a = 2", -1,
+                                 &stmt, nullptr),
+              SQLITE_OK);
+    EXPECT_EQ(sqlite3_step(stmt), SQLITE_ROW);
+    EXPECT_EQ(std::string(reinterpret_cast<const char *>(
+                  sqlite3_column_text(stmt, 0))),
+              expected_b);
+    EXPECT_EQ(sqlite3_column_int64(stmt, 1), expected_c);
+    EXPECT_EQ(sqlite3_step(stmt), SQLITE_DONE);
+    sqlite3_finalize(stmt);
+  };
+  query_b_c("world", 3);
+  // the covered column must follow updates
+  EXPECT_TRUE(ExecSQL(db, "UPDATE foo2 SET b = 'again' WHERE a = 2"));
+  query_b_c("again", 3);
+  EXPECT_FALSE(ExecSQL(
+      db, "UPDATE foo2 SET b = 'longer than declared' WHERE a = 2"));
+  query_b_c("again", 3);
+  // a probe longer than the key matches nothing
+  EXPECT_TRUE(ExecSQL(db, "CREATE VIRTUAL TABLE foo5 USING vtable ('a "
+                          "varchar(8), b int', 'foo5_idx a')"));
+  EXPECT_TRUE(ExecSQL(db, "INSERT INTO foo5 VALUES('short', 1)"));
+  sqlite3_stmt *stmt;
+  EXPECT_EQ(sqlite3_prepare_v2(db, "SELECT b FROM foo5 WHERE a = ?", -1,
+                               &stmt, nullptr),
+            SQLITE_OK);
+  for (const std::string &a : {std::string(70, 'x'), std::string("short")}) {
+    sqlite3_bind_text(stmt, 1, a.c_str(), -1, SQLITE_TRANSIENT);
+    int rows = 0;
+    while (sqlite3_step(stmt) == SQLITE_ROW)
+      rows++;
+    EXPECT_EQ(a == "short" ? 1 : 0, rows);
+    sqlite3_reset(stmt);
+  }
+  sqlite3_finalize(stmt);
+  EXPECT_TRUE(ExecSQL(db, "DROP TABLE foo5"));
+  EXPECT_TRUE(ExecSQL(db, "DROP TABLE foo2"));
+
+  rc = sqlite3_close(db);
+  EXPECT_EQ(rc, SQLITE_OK);
+
+  remove(db_file.c_str());
+  remove("vtable.db");
+}
+
+TEST(VtableTest, IndexMetricsTest) {
+  std::string db_file = "sqlite.db";
+  remove(db_file.c_str());
+  remove("vtable.db");
+  sqlite3 *db;
+  int rc;
+  rc = sqlite3_open(db_file.c_str(), &db);
+  EXPECT_EQ(rc, SQLITE_OK);
+  rc = sqlite3_enable_load_extension(db, 1);
+  EXPECT_EQ(rc, SQLITE_OK);
+  char *zErrMsg = 0;
+  rc = sqlite3_load_extension(db, "libvtable", 0, &zErrMsg);
+  EXPECT_EQ(rc, SQLITE_OK);
+
+  auto metrics = [&](const std::string &sql) {
+    sqlite3_stmt *stmt;
+    std::string text;
+    EXPECT_EQ(sqlite3_prepare_v2(db, sql.c_str(), -1, &stmt, nullptr),
+              SQLITE_OK);
+    if (sqlite3_step(stmt) == SQLITE_ROW)
+      text = reinterpret_cast<const char *>(sqlite3_column_text(stmt, 0));
+    sqlite3_finalize(stmt);
+    return text;
+  };
+  EXPECT_TRUE(ExecSQL(db, "CREATE VIRTUAL TABLE foo3 USING vtable ('a int, b "
+                          "bigint', 'foo3_idx a')"));
+  // disabled by default
+  EXPECT_TRUE(ExecSQL(db, "INSERT INTO foo3 VALUES(1, 2)"));
+  EXPECT_NE(metrics("SELECT index_metrics('foo3_idx')").find("inserts: 0"),
+            std::string::npos);
+
+  metrics("SELECT index_metrics('foo3_idx', 'enable')");
+  EXPECT_TRUE(ExecSQL(db, "INSERT INTO foo3 VALUES(2, 3)"));
+  EXPECT_TRUE(ExecSQL(db, "INSERT INTO foo3 VALUES(3, 4)"));
+  EXPECT_TRUE(ExecSQL(db, "SELECT * FROM foo3 WHERE a = 2"));
+  std::string text = metrics("SELECT index_metrics('foo3_idx')");
+  EXPECT_NE(text.find("enabled: 1"), std::string::npos);
+  EXPECT_NE(text.find("inserts: 2"), std::string::npos);
+  EXPECT_NE(text.find("lookups: 1"), std::string::npos);
+  text = metrics("SELECT index_metrics('foo3_idx', 'reset')");
+  EXPECT_NE(text.find("inserts: 0"), std::string::npos);
+  // unknown index
+  EXPECT_EQ(metrics("SELECT index_metrics('bar_idx')"), "");
+  // statistics are collected on request or after enough writes, never while
+  // planning
+  EXPECT_NE(metrics("SELECT index_analyze('foo3_idx')").find("entries: 3"),
+            std::string::npos);
+  EXPECT_TRUE(ExecSQL(db, "SELECT * FROM foo3 WHERE a > 1"));
+  EXPECT_NE(metrics("SELECT index_analyze('foo3_idx', 0.5)").find("height: 1"),
+            std::string::npos);
+  EXPECT_EQ(metrics("SELECT index_analyze('foo3_idx', 2)"), "");
+  // statistics records have names of their own
+  EXPECT_FALSE(ExecSQL(db, "CREATE VIRTUAL TABLE __stats_foo3_idx USING "
+                           "vtable ('a int')"));
+  EXPECT_FALSE(ExecSQL(db, "CREATE VIRTUAL TABLE foo4 USING vtable ('a int', "
+                           "'__stats_foo4 a')"));
+  EXPECT_TRUE(ExecSQL(db, "DROP TABLE foo3"));
+
+  rc = sqlite3_close(db);
+  EXPECT_EQ(rc, SQLITE_OK);
+
+  remove(db_file.c_str());
+  remove("vtable.db");
+}
+
+TEST(VtableTest, PaxLayoutTest) {
+  std::string db_file = "sqlite.db";
+  remove(db_file.c_str());
+  remove("vtable.db");
+  sqlite3 *db;
+  int rc;
+  rc = sqlite3_open(db_file.c_str(), &db);
+  EXPECT_EQ(rc, SQLITE_OK);
+  rc = sqlite3_enable_load_extension(db, 1);
+  EXPECT_EQ(rc, SQLITE_OK);
+  char *zErrMsg = 0;
+  rc = sqlite3_load_extension(db, "libvtable", 0, &zErrMsg);
+  EXPECT_EQ(rc, SQLITE_OK);
+
+  auto query = [&](const std::string &sql) {
+    sqlite3_stmt *stmt;
+    std::string text;
+    EXPECT_EQ(sqlite3_prepare_v2(db, sql.c_str(), -1, &stmt, nullptr),
+              SQLITE_OK);
+    if (sqlite3_step(stmt) == SQLITE_ROW)
+      text = reinterpret_cast<const char *>(sqlite3_column_text(stmt, 0));
+    sqlite3_finalize(stmt);
+    return text;
+  };
+  EXPECT_TRUE(ExecSQL(db, "CREATE VIRTUAL TABLE foo4 USING vtable ('a int, b "
+                          "varchar(16)', 'layout=pax', 'foo4_idx a')"));
+  EXPECT_TRUE(ExecSQL(db, "BEGIN"));
+  for (int i = 0; i < 1000; i++)
+    EXPECT_TRUE(ExecSQL(db, "INSERT INTO foo4 VALUES(" + std::to_string(i) +
+                                ", 'v" + std::to_string(i) + "')"));
+  EXPECT_TRUE(ExecSQL(db, "COMMIT"));
+  EXPECT_EQ("1000", query("SELECT count(*) FROM foo4"));
+  EXPECT_EQ("v42", query("SELECT b FROM foo4 WHERE a = 42"));
+  EXPECT_TRUE(ExecSQL(db, "UPDATE foo4 SET b = 'changed' WHERE a = 42"));
+  EXPECT_EQ("changed", query("SELECT b FROM foo4 WHERE a = 42"));
+  EXPECT_TRUE(ExecSQL(db, "DELETE FROM foo4 WHERE a < 100"));
+  EXPECT_EQ("900", query("SELECT count(*) FROM foo4"));
+  EXPECT_EQ("v999", query("SELECT max(b) FROM foo4"));
+
+  // unknown options are rejected
+  EXPECT_FALSE(ExecSQL(db, "CREATE VIRTUAL TABLE foo5 USING vtable ('a int', "
+                           "'layout=columns')"));
+  sqlite3_close(db);
+  remove(db_file.c_str());
+  remove("vtable.db");
+}
+
+
+TEST(VtableTest, ZoneMapTest) {
+  std::string db_file = "sqlite.db";
+  remove(db_file.c_str());
+  remove("vtable.db");
+  sqlite3 *db;
+  int rc;
+  rc = sqlite3_open(db_file.c_str(), &db);
+  EXPECT_EQ(rc, SQLITE_OK);
+  rc = sqlite3_enable_load_extension(db, 1);
+  EXPECT_EQ(rc, SQLITE_OK);
+  char *zErrMsg = 0;
+  rc = sqlite3_load_extension(db, "libvtable", 0, &zErrMsg);
+  EXPECT_EQ(rc, SQLITE_OK);
+
+  auto query = [&](const std::string &sql) {
+    sqlite3_stmt *stmt;
+    std::string text;
+    EXPECT_EQ(sqlite3_prepare_v2(db, sql.c_str(), -1, &stmt, nullptr),
+              SQLITE_OK);
+    if (sqlite3_step(stmt) == SQLITE_ROW)
+      text = reinterpret_cast<const char *>(sqlite3_column_text(stmt, 0));
+    sqlite3_finalize(stmt);
+    return text;
+  };
+  EXPECT_TRUE(ExecSQL(db, "CREATE VIRTUAL TABLE foo6 USING vtable ('ts "
+                          "bigint, b double, c varchar(16)')"));
+  EXPECT_TRUE(ExecSQL(db, "BEGIN"));
+  for (int i = 0; i < 2000; i++)
+    EXPECT_TRUE(ExecSQL(db, "INSERT INTO foo6 VALUES(" + std::to_string(i) +
+                                ", " + std::to_string(i % 50) + ".5, 'v" +
+                                std::to_string(i) + "')"));
+  EXPECT_TRUE(ExecSQL(db, "COMMIT"));
+  EXPECT_EQ("100",
+            query("SELECT count(*) FROM foo6 WHERE ts >= 100 AND ts < 200"));
+  EXPECT_EQ("v1999", query("SELECT c FROM foo6 WHERE ts > 1998.5"));
+  EXPECT_EQ("19", query("SELECT count(*) FROM foo6 WHERE ts < 1000 AND "
+                        "b = 7.5 AND c <> 'v7'"));
+  EXPECT_EQ("0", query("SELECT count(*) FROM foo6 WHERE ts > 5000"));
+  // values the zone map cannot use are left to sqlite
+  EXPECT_EQ("2000", query("SELECT count(*) FROM foo6 WHERE ts < 'x'"));
+  EXPECT_TRUE(ExecSQL(db, "UPDATE foo6 SET ts = -1 WHERE ts = 1500"));
+  EXPECT_EQ("v1500", query("SELECT c FROM foo6 WHERE ts < 0"));
+  sqlite3_close(db);
+  remove(db_file.c_str());
+  remove("vtable.db");
+}
+
+TEST(VtableTest, OverflowTest) {
+  // large values go to overflow pages, in both layouts. Every connection
+  // holds one table, closing it shuts the storage engine down
+  for (std::string layout : {"nsm", "pax"}) {
+    std::string db_file = "sqlite.db";
+    remove(db_file.c_str());
+    remove("vtable.db");
+    sqlite3 *db;
+    int rc;
+    rc = sqlite3_open(db_file.c_str(), &db);
+    EXPECT_EQ(rc, SQLITE_OK);
+    rc = sqlite3_enable_load_extension(db, 1);
+    EXPECT_EQ(rc, SQLITE_OK);
+    char *zErrMsg = 0;
+    rc = sqlite3_load_extension(db, "libvtable", 0, &zErrMsg);
+    EXPECT_EQ(rc, SQLITE_OK);
+
+    auto query = [&](const std::string &sql) {
+      sqlite3_stmt *stmt;
+      std::string text;
+      EXPECT_EQ(sqlite3_prepare_v2(db, sql.c_str(), -1, &stmt, nullptr),
+                SQLITE_OK);
+      if (sqlite3_step(stmt) == SQLITE_ROW)
+        text = reinterpret_cast<const char *>(sqlite3_column_text(stmt, 0));
+      sqlite3_finalize(stmt);
+      return text;
+    };
+    EXPECT_TRUE(ExecSQL(db, "CREATE VIRTUAL TABLE foo7 USING vtable ('a "
+                            "int, b varchar(100000)', 'layout=" +
+                                layout + "')"));
+    EXPECT_TRUE(ExecSQL(db, "BEGIN"));
+    for (int i = 0; i < 100; i++)
+      EXPECT_TRUE(ExecSQL(db, "INSERT INTO foo7 VALUES(" + std::to_string(i) +
+                                  ", 'x' || hex(zeroblob(" +
+                                  std::to_string(i * 100) + ")))"));
+    EXPECT_TRUE(ExecSQL(db, "COMMIT"));
+    EXPECT_EQ("19801", query("SELECT length(b) FROM foo7 WHERE a = 99"));
+    EXPECT_EQ("x000", query("SELECT substr(b, 1, 4) FROM foo7 WHERE a = 50"));
+    EXPECT_TRUE(ExecSQL(db, "UPDATE foo7 SET b = b || 'y' WHERE a >= 90"));
+    EXPECT_EQ("y", query("SELECT substr(b, -1) FROM foo7 WHERE a = 95"));
+    EXPECT_TRUE(ExecSQL(db, "DELETE FROM foo7 WHERE a % 2 = 0"));
+    EXPECT_EQ("50", query("SELECT count(*) FROM foo7"));
+    EXPECT_EQ("500055", query("SELECT sum(length(b)) FROM foo7"));
+    sqlite3_close(db);
+    remove(db_file.c_str());
+    remove("vtable.db");
+  }
+}
+
+TEST(VtableTest, ProjectionTest) {
+  std::string db_file = "sqlite.db";
+  remove(db_file.c_str());
+  remove("vtable.db");
+  sqlite3 *db;
+  int rc;
+  rc = sqlite3_open(db_file.c_str(), &db);
+  EXPECT_EQ(rc, SQLITE_OK);
+  rc = sqlite3_enable_load_extension(db, 1);
+  EXPECT_EQ(rc, SQLITE_OK);
+  char *zErrMsg = 0;
+  rc = sqlite3_load_extension(db, "libvtable", 0, &zErrMsg);
+  EXPECT_EQ(rc, SQLITE_OK);
+
+  auto query = [&](const std::string &sql) {
+    sqlite3_stmt *stmt;
+    std::string text;
+    EXPECT_EQ(sqlite3_prepare_v2(db, sql.c_str(), -1, &stmt, nullptr),
+              SQLITE_OK);
+    if (sqlite3_step(stmt) == SQLITE_ROW)
+      text = reinterpret_cast<const char *>(sqlite3_column_text(stmt, 0));
+    sqlite3_finalize(stmt);
+    return text;
+  };
+  // a wide PAX table, of which the queries read a few columns
+  std::string columns = "a int";
+  for (int i = 1; i < 30; i++)
+    columns += ", c" + std::to_string(i) + " bigint";
+  columns += ", s varchar(16)";
+  EXPECT_TRUE(ExecSQL(db, "CREATE VIRTUAL TABLE foo9 USING vtable ('" +
+                              columns + "', 'layout=pax')"));
+  EXPECT_TRUE(ExecSQL(db, "BEGIN"));
+  for (int i = 0; i < 500; i++) {
+    std::string values = std::to_string(i);
+    for (int j = 1; j < 30; j++)
+      values += ", " + std::to_string(i * j);
+    EXPECT_TRUE(ExecSQL(db, "INSERT INTO foo9 VALUES(" + values + ", 's" +
+                                std::to_string(i) + "')"));
+  }
+  EXPECT_TRUE(ExecSQL(db, "COMMIT"));
+  EXPECT_EQ("124750", query("SELECT sum(a) FROM foo9"));
+  EXPECT_EQ("3480", query("SELECT c29 FROM foo9 WHERE s = 's120' AND "
+                          "a < 200"));
+  EXPECT_EQ("499", query("SELECT count(*) FROM foo9 WHERE c7 > 0"));
+  // updates still see every column of the row
+  EXPECT_TRUE(ExecSQL(db, "UPDATE foo9 SET c3 = -1 WHERE a = 10"));
+  EXPECT_EQ("-1|280|s10", query("SELECT c3 || '|' || c28 || '|' || s FROM "
+                                "foo9 WHERE a = 10"));
+  // a join rescans the inner table for every outer row
+  EXPECT_EQ("500", query("SELECT count(*) FROM foo9 x, foo9 y WHERE "
+                         "x.a < 5 AND y.a < 100"));
+  sqlite3_close(db);
+  remove(db_file.c_str());
+  remove("vtable.db");
+}
+
+TEST(VtableTest, AttachTest) {
+  std::string db_file = "sqlite.db";
+  remove(db_file.c_str());
+  remove("vtable.db");
+  // bulk load foo10 into a new database file
+  {
+    Schema schema({Column(TypeId::INTEGER, 4, "a"),
+                   Column(TypeId::VARCHAR, 16, "b")});
+    DiskManager disk_manager("vtable.db");
+    BufferPoolManager buffer_pool_manager(50, &disk_manager);
+    page_id_t header_page_id;
+    static_cast<HeaderPage *>(buffer_pool_manager.NewPage(header_page_id))
+        ->Init();
+    buffer_pool_manager.UnpinPage(header_page_id, true);
+    std::string csv;
+    for (int i = 0; i < 3000; i++)
+      csv += std::to_string(i) + ",b" + std::to_string(i % 10) + "\n";
+    std::istringstream in(csv);
+    BulkLoader loader(&schema, &disk_manager, &buffer_pool_manager);
+    EXPECT_TRUE(loader.LoadCsv(in, 2));
+    EXPECT_TRUE(loader.Finish());
+    CatalogCache catalog_cache(&buffer_pool_manager);
+    catalog_cache.SetRootId("foo10", loader.GetFirstPageId());
+    EXPECT_TRUE(catalog_cache.Flush());
+    buffer_pool_manager.FlushAllPages();
+  }
+  sqlite3 *db;
+  int rc;
+  rc = sqlite3_open(db_file.c_str(), &db);
+  EXPECT_EQ(rc, SQLITE_OK);
+  rc = sqlite3_enable_load_extension(db, 1);
+  EXPECT_EQ(rc, SQLITE_OK);
+  char *zErrMsg = 0;
+  rc = sqlite3_load_extension(db, "libvtable", 0, &zErrMsg);
+  EXPECT_EQ(rc, SQLITE_OK);
+
+  auto query = [&](const std::string &sql) {
+    sqlite3_stmt *stmt;
+    std::string text;
+    EXPECT_EQ(sqlite3_prepare_v2(db, sql.c_str(), -1, &stmt, nullptr),
+              SQLITE_OK);
+    if (sqlite3_step(stmt) == SQLITE_ROW)
+      text = reinterpret_cast<const char *>(sqlite3_column_text(stmt, 0));
+    sqlite3_finalize(stmt);
+    return text;
+  };
+  EXPECT_FALSE(ExecSQL(db, "CREATE VIRTUAL TABLE foo11 USING vtable "
+                           "('a int', 'attach=1')"));
+  // the index is built on attach
+  EXPECT_TRUE(ExecSQL(db, "CREATE VIRTUAL TABLE foo10 USING vtable "
+                          "('a int, b varchar(16)', 'foo10_pk a', "
+                          "'attach=1')"));
+  EXPECT_EQ("3000", query("SELECT count(*) FROM foo10"));
+  EXPECT_EQ("b4", query("SELECT b FROM foo10 WHERE a = 1234"));
+  // new pages go after the loaded ones
+  EXPECT_TRUE(ExecSQL(db, "BEGIN"));
+  for (int i = 3000; i < 4000; i++)
+    EXPECT_TRUE(ExecSQL(db, "INSERT INTO foo10 VALUES(" + std::to_string(i) +
+                                ", 'new')"));
+  EXPECT_TRUE(ExecSQL(db, "COMMIT"));
+  EXPECT_EQ("4000", query("SELECT count(*) FROM foo10"));
+  EXPECT_EQ("b7", query("SELECT b FROM foo10 WHERE a = 7"));
+  EXPECT_EQ("new", query("SELECT b FROM foo10 WHERE a = 3500"));
+  sqlite3_close(db);
+  remove(db_file.c_str());
+  remove("vtable.db");
+}
+
+TEST(VtableTest, EncodingTest) {
+  std::string db_file = "sqlite.db";
+  remove(db_file.c_str());
+  remove("vtable.db");
+  sqlite3 *db;
+  int rc;
+  rc = sqlite3_open(db_file.c_str(), &db);
+  EXPECT_EQ(rc, SQLITE_OK);
+  rc = sqlite3_enable_load_extension(db, 1);
+  EXPECT_EQ(rc, SQLITE_OK);
+  char *zErrMsg = 0;
+  rc = sqlite3_load_extension(db, "libvtable", 0, &zErrMsg);
+  EXPECT_EQ(rc, SQLITE_OK);
+
+  auto query = [&](const std::string &sql) {
+    sqlite3_stmt *stmt;
+    std::string text;
+    EXPECT_EQ(sqlite3_prepare_v2(db, sql.c_str(), -1, &stmt, nullptr),
+              SQLITE_OK);
+    if (sqlite3_step(stmt) == SQLITE_ROW)
+      text = reinterpret_cast<const char *>(sqlite3_column_text(stmt, 0));
+    sqlite3_finalize(stmt);
+    return text;
+  };
+  // encodings need a PAX table and columns of the right type
+  EXPECT_FALSE(ExecSQL(db, "CREATE VIRTUAL TABLE bad USING vtable ('day "
+                           "int, status varchar(16)', 'dict=status')"));
+  EXPECT_FALSE(ExecSQL(db, "CREATE VIRTUAL TABLE bad USING vtable ('day "
+                           "int, status varchar(16)', 'layout=pax', "
+                           "'dict=day')"));
+  EXPECT_TRUE(ExecSQL(db, "CREATE VIRTUAL TABLE foo8 USING vtable ('day "
+                          "int, status varchar(16), note varchar(16)', "
+                          "'layout=pax', 'dict=status', 'rle=day')"));
+  const char *statuses[] = {"new", "paid", "sent"};
+  EXPECT_TRUE(ExecSQL(db, "BEGIN"));
+  for (int i = 0; i < 3000; i++)
+    EXPECT_TRUE(ExecSQL(db, "INSERT INTO foo8 VALUES(" +
+                                std::to_string(i / 100) + ", '" +
+                                statuses[i % 3] + "', 'n" +
+                                std::to_string(i) + "')"));
+  EXPECT_TRUE(ExecSQL(db, "COMMIT"));
+  EXPECT_EQ("1000", query("SELECT count(*) FROM foo8 WHERE status = 'paid'"));
+  EXPECT_EQ("0", query("SELECT count(*) FROM foo8 WHERE status = 'lost'"));
+  EXPECT_EQ("33", query("SELECT count(*) FROM foo8 WHERE status = 'new' AND "
+                        "day = 10"));
+  EXPECT_TRUE(ExecSQL(db, "UPDATE foo8 SET status = 'lost' WHERE day = 7"));
+  EXPECT_EQ("100", query("SELECT count(*) FROM foo8 WHERE status = 'lost'"));
+  EXPECT_EQ("n701", query("SELECT note FROM foo8 WHERE status = 'lost' AND "
+                          "note = 'n701'"));
+  EXPECT_TRUE(ExecSQL(db, "DELETE FROM foo8 WHERE status = 'sent'"));
+  // the sent rows of day 7 are lost now
+  EXPECT_EQ("2033", query("SELECT count(*) FROM foo8"));
+  // nulls are stored as such
+  EXPECT_TRUE(ExecSQL(db, "INSERT INTO foo8 VALUES(NULL, NULL, 'null')"));
+  EXPECT_EQ("1", query("SELECT count(*) FROM foo8 WHERE status IS NULL AND "
+                       "day IS NULL"));
+  EXPECT_EQ("null", query("SELECT note FROM foo8 WHERE day IS NULL"));
+  // values moved to overflow pages are found as well
+  EXPECT_TRUE(ExecSQL(db, "CREATE VIRTUAL TABLE foo9 USING vtable ('a int, "
+                          "s varchar(3000)', 'layout=pax', 'dict=s')"));
+  std::string large(1500, 'l'), medium(700, 'm');
+  EXPECT_TRUE(ExecSQL(db, "INSERT INTO foo9 VALUES(1, '" + large + "')"));
+  EXPECT_TRUE(ExecSQL(db, "INSERT INTO foo9 VALUES(2, '" + medium + "')"));
+  EXPECT_TRUE(ExecSQL(db, "INSERT INTO foo9 VALUES(3, 'small')"));
+  EXPECT_EQ("1", query("SELECT a FROM foo9 WHERE s = '" + large + "'"));
+  EXPECT_EQ("2", query("SELECT a FROM foo9 WHERE s = '" + medium + "'"));
+  EXPECT_EQ("3", query("SELECT a FROM foo9 WHERE s = 'small'"));
+  EXPECT_EQ("0", query("SELECT count(*) FROM foo9 WHERE s = 'lost'"));
+  sqlite3_close(db);
+  remove(db_file.c_str());
+  remove("vtable.db");
+}
+
 } // namespace cmudb
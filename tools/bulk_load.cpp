@@ -0,0 +1,174 @@
+/**
+ * bulk_load.cpp
+ *
+ * Bulk load a CSV or binary file (see bulk_loader.h) into a new table of a
+ * database file, build its index and register both in the header page.
+ *
+ * usage: bulk_load [options] <table> '<columns>' <input file>
+ *   -d <db file>   database file, vtable.db by default
+ *   -i '<index>'   index to build, as in CREATE VIRTUAL TABLE: 'foo_pk a,b'
+ *   -o <option>    table option: layout=pax, dict=<columns> or rle=<columns>
+ *   -t <threads>   parser and index build threads
+ *   -b             binary input
+ *   -H             the first line of the CSV file is a header
+ *
+ * The loaded table is opened in sqlite with the attach=1 table option:
+ *   CREATE VIRTUAL TABLE <table> USING vtable('<columns>', '<index>',
+ *                                             'attach=1')
+ */
+
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <sys/stat.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+#include "catalog/catalog_cache.h"
+#include "common/exception.h"
+#include "page/header_page.h"
+#include "table/bulk_loader.h"
+#include "vtable/virtual_table.h"
+
+using namespace cmudb;
+
+static int Usage() {
+  std::cerr << "usage: bulk_load [-d db file] [-i index] [-o table option] "
+               "[-t threads] [-b] [-H] <table> <columns> <input file>"
+            << std::endl;
+  return 1;
+}
+
+static int Load(int argc, char **argv) {
+  std::string db_file = "vtable.db";
+  std::string index_string;
+  std::vector<std::string> options;
+  int num_threads = std::max<int>(std::thread::hardware_concurrency(), 1);
+  bool binary = false;
+  bool header = false;
+  int opt;
+  while ((opt = getopt(argc, argv, "d:i:o:t:bH")) != -1) {
+    switch (opt) {
+    case 'd':
+      db_file = optarg;
+      break;
+    case 'i':
+      index_string = optarg;
+      break;
+    case 'o':
+      options.emplace_back(optarg);
+      break;
+    case 't':
+      num_threads = std::max(std::atoi(optarg), 1);
+      break;
+    case 'b':
+      binary = true;
+      break;
+    case 'H':
+      header = true;
+      break;
+    default:
+      return Usage();
+    }
+  }
+  if (argc - optind != 3)
+    return Usage();
+  std::string table_name(argv[optind]);
+  if (IsStatisticsRecordName(table_name)) {
+    std::cerr << "reserved table name: " << table_name << std::endl;
+    return 1;
+  }
+  Schema *schema = ParseCreateStatement(argv[optind + 1]);
+
+  TableLayout layout = TableLayout::NSM;
+  std::vector<ColumnEncoding> encodings(schema->GetColumnCount(),
+                                        ColumnEncoding::PLAIN);
+  for (auto &option : options) {
+    std::string error;
+    if (option == "layout=pax")
+      layout = TableLayout::PAX;
+    else if (option.compare(0, 5, "dict=") == 0 ||
+             option.compare(0, 4, "rle=") == 0)
+      ParseEncodingOption(option, schema, encodings, error);
+    else if (option != "layout=nsm")
+      error = "unknown table option: " + option;
+    if (!error.empty()) {
+      std::cerr << error << std::endl;
+      delete schema;
+      return 1;
+    }
+  }
+  std::ifstream in(argv[optind + 2], std::ios::binary);
+  if (!in.is_open()) {
+    std::cerr << "cannot open " << argv[optind + 2] << std::endl;
+    delete schema;
+    return 1;
+  }
+
+  struct stat buffer;
+  bool is_file_exist = (stat(db_file.c_str(), &buffer) == 0);
+  DiskManager disk_manager(db_file);
+  BufferPoolManager buffer_pool_manager(BUFFER_POOL_SIZE, &disk_manager);
+  if (!is_file_exist) {
+    page_id_t header_page_id;
+    static_cast<HeaderPage *>(buffer_pool_manager.NewPage(header_page_id))
+        ->Init();
+    buffer_pool_manager.UnpinPage(header_page_id, true);
+  }
+  CatalogCache catalog_cache(&buffer_pool_manager);
+  page_id_t root_id;
+  if (catalog_cache.GetRootId(table_name, root_id)) {
+    std::cerr << "table " << table_name << " exists" << std::endl;
+    delete schema;
+    return 1;
+  }
+
+  auto start = std::chrono::steady_clock::now();
+  BulkLoader loader(schema, &disk_manager, &buffer_pool_manager, layout,
+                    encodings);
+  bool is_loaded = binary ? loader.LoadBinary(in)
+                          : loader.LoadCsv(in, num_threads, header);
+  if (!is_loaded || !loader.Finish()) {
+    // the pages written so far are not registered anywhere
+    std::cerr << loader.GetError() << std::endl;
+    delete schema;
+    return 1;
+  }
+  catalog_cache.SetRootId(table_name, loader.GetFirstPageId());
+  if (!index_string.empty()) {
+    // the index records its root in the catalog
+    Index *index = ConstructIndex(
+        ParseIndexStatement(index_string, table_name, schema),
+        &buffer_pool_manager, INVALID_PAGE_ID, &catalog_cache);
+    TableHeap table_heap(&buffer_pool_manager, nullptr, nullptr,
+                         loader.GetFirstPageId(), schema);
+    Transaction txn(0);
+    bool is_built = index->BuildIndex(&table_heap, schema, num_threads, &txn);
+    delete index;
+    if (!is_built) {
+      std::cerr << "cannot build index " << index_string << std::endl;
+      delete schema;
+      return 1;
+    }
+  }
+  catalog_cache.Flush();
+  buffer_pool_manager.FlushAllPages();
+  std::chrono::duration<double, std::milli> elapsed =
+      std::chrono::steady_clock::now() - start;
+  std::cout << "loaded " << loader.GetRowCount() << " rows into "
+            << table_name << " in " << elapsed.count() << "ms" << std::endl;
+  delete schema;
+  return 0;
+}
+
+int main(int argc, char **argv) {
+  try {
+    return Load(argc, argv);
+  } catch (Exception &e) {
+    // e.g. an unknown column type
+    std::cerr << e.what() << std::endl;
+    return 1;
+  }
+}